@@ -0,0 +1,202 @@
+#include "app/arrow_app.h"
+
+#include "stream/arrow_ipc.h"
+#include "stream/recording.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace eeg
+{
+	namespace
+	{
+		struct arrow_options
+		{
+			std::string input_path;
+			std::string output_path;      ///< Empty: the input with an `.arrow` extension
+			std::string annotations_path; ///< Empty: the output with `.annotations` before the extension
+			bool stream = false;
+			size_t batch = 65536;
+		};
+
+		void print_usage()
+		{
+			std::cerr << "Usage: eeg_app arrow --input <path> [options]\n"
+					  << "  --output <path>       samples (default <input>.arrow)\n"
+					  << "  --annotations <path>  annotations (default <output>.annotations.arrow)\n"
+					  << "  --stream              IPC streaming format instead of the file format\n"
+					  << "  --batch <samples>     most samples per record batch (default 65536)\n";
+		}
+
+		bool parse(int argc, char** argv, arrow_options& opts)
+		{
+			for (int i = 1; i < argc; ++i)
+			{
+				const std::string arg = argv[i];
+				if (arg == "--stream")
+				{
+					opts.stream = true;
+					continue;
+				}
+				if (i + 1 >= argc)
+				{
+					return false;
+				}
+				const std::string value = argv[++i];
+				if (arg == "--input")
+				{
+					opts.input_path = value;
+				}
+				else if (arg == "--output")
+				{
+					opts.output_path = value;
+				}
+				else if (arg == "--annotations")
+				{
+					opts.annotations_path = value;
+				}
+				else if (arg == "--batch")
+				{
+					opts.batch = static_cast<size_t>(std::atoi(value.c_str()));
+				}
+				else
+				{
+					return false;
+				}
+			}
+			return !opts.input_path.empty() && opts.batch > 0;
+		}
+
+		/**
+		 * `path` with its extension replaced, or added when it has none.
+		 */
+		std::string with_extension(const std::string& path, const std::string& extension)
+		{
+			const size_t slash = path.find_last_of("/\\");
+			const size_t dot = path.find_last_of('.');
+			if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+			{
+				return path + extension;
+			}
+			return path.substr(0, dot) + extension;
+		}
+
+		/**
+		 * Writes the batches `write_batches(writer)` produces to `path` in
+		 * the file or streaming format.
+		 */
+		template <typename F>
+		bool write_arrow(const std::string& path, const arrow_schema& schema, bool stream, F write_batches, std::string& error)
+		{
+			if (stream)
+			{
+				std::ofstream out(path, std::ios::binary | std::ios::trunc);
+				arrow_stream_writer writer(out);
+				if (!out || !writer.begin(schema))
+				{
+					error = path + ": cannot create";
+					return false;
+				}
+				if (!write_batches(writer) || !writer.end())
+				{
+					error = path + ": write failed";
+					return false;
+				}
+				return true;
+			}
+			arrow_file_writer writer;
+			if (!writer.open(path, schema, &error))
+			{
+				return false;
+			}
+			if (!write_batches(writer) || !writer.close())
+			{
+				error = path + ": write failed";
+				return false;
+			}
+			return true;
+		}
+	} // namespace
+
+	int arrow_main(int argc, char** argv)
+	{
+		arrow_options opts;
+		if (!parse(argc, argv, opts))
+		{
+			print_usage();
+			return 1;
+		}
+		const std::string extension = opts.stream ? ".arrows" : ".arrow";
+		if (opts.output_path.empty())
+		{
+			opts.output_path = with_extension(opts.input_path, extension);
+		}
+		if (opts.annotations_path.empty())
+		{
+			opts.annotations_path = with_extension(opts.output_path, ".annotations" + extension);
+		}
+
+		auto t0 = std::chrono::steady_clock::now();
+		recording_contents rec;
+		std::string error;
+		if (!load_recording(opts.input_path, rec, &error))
+		{
+			std::cerr << error << std::endl;
+			return 1;
+		}
+
+		// Batches are views into the loaded channels, cut at gaps so each
+		// has consecutive sample numbers
+		size_t n_batches = 0;
+		auto write_samples = [&](arrow_stream_writer& writer)
+		{
+			size_t offset = 0;
+			uint64_t first = rec.first_sample;
+			for (size_t g = 0; g <= rec.gaps.size(); ++g)
+			{
+				const size_t end = g < rec.gaps.size() ? rec.gaps[g].index : rec.n_samples;
+				for (size_t i = offset; i < end; i += opts.batch)
+				{
+					const size_t n = std::min(opts.batch, end - i);
+					if (!writer.write(samples_arrow_batch(rec.data.data() + i, rec.header.n_chans, rec.n_samples, n, first + (i - offset))))
+					{
+						return false;
+					}
+					++n_batches;
+				}
+				if (g < rec.gaps.size())
+				{
+					offset = end;
+					first = rec.gaps[g].sample;
+				}
+			}
+			return true;
+		};
+		if (!write_arrow(opts.output_path, samples_arrow_schema(rec.header), opts.stream, write_samples, error))
+		{
+			std::cerr << error << std::endl;
+			return 1;
+		}
+		auto write_annotations = [&](arrow_stream_writer& writer)
+		{
+			return writer.write(annotations_arrow_batch(rec.annotations));
+		};
+		if (!write_arrow(opts.annotations_path, annotations_arrow_schema(), opts.stream, write_annotations, error))
+		{
+			std::cerr << error << std::endl;
+			return 1;
+		}
+
+		const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+		std::cout << "Wrote " << rec.n_samples << " samples of " << rec.header.n_chans << " channels in " << n_batches << " batches to "
+				  << opts.output_path << std::endl;
+		std::cout << "Wrote " << rec.annotations.size() << " annotations to " << opts.annotations_path << std::endl;
+		std::cout << "Took " << ms << " ms" << std::endl;
+		return 0;
+	}
+} // namespace eeg
@@ -0,0 +1,26 @@
+/**
+ * @file arrow_app.h
+ * @brief Converts recordings to Apache Arrow IPC files or streams
+ */
+
+#pragma once
+
+namespace eeg
+{
+	/**
+	 * @brief Command line entry for `eeg_app arrow --input <path> [options]`
+	 *
+	 * @details Writes the samples of a recording as record batches of up to
+	 * `--batch` samples, with a `sample_number` column and one float64
+	 * column per channel, to `--output` (default: the input with an
+	 * `.arrow` extension). Batches end at gaps in the sample numbers. The
+	 * annotations go to a second file, `--annotations`, with `sample` and
+	 * `text` columns. `--stream` writes the streaming format instead of the
+	 * file format. The files open directly in pyarrow, polars or pandas,
+	 * e.g. with `pyarrow.ipc.open_file()` or `pyarrow.memory_map()` for
+	 * zero-copy reads.
+	 *
+	 * @return 0 on success, 1 on errors
+	 */
+	int arrow_main(int argc, char** argv);
+} // namespace eeg
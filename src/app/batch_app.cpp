@@ -0,0 +1,563 @@
+#include "app/batch_app.h"
+
+#include "pipeline/pipeline.h"
+#include "stream/recording.h"
+#include "util/json_writer.h"
+#include "util/work_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace eeg
+{
+	namespace
+	{
+		namespace fs = std::filesystem;
+		using clock = std::chrono::steady_clock;
+
+		struct batch_options
+		{
+			std::string config_path = default_pipeline_path();
+			std::string input; ///< Directory, glob or single recording
+			std::string output_dir = "batch_results";
+			std::string checkpoint_path; ///< Empty for `<output_dir>/checkpoint.txt`
+			std::string source;          ///< Empty for the first source
+			size_t threads = 0;          ///< Pool workers, 0 for one per core
+			size_t pipeline_threads = 1; ///< Workers of each segment's pipeline
+			double segment_s = 600;
+			double overlap_s = 5;
+			double progress_s = 2;
+		};
+
+		/**
+		 * What one sink received for one block.
+		 */
+		struct result_row
+		{
+			std::string sink;
+			uint64_t first_sample = 0;
+			std::vector<std::vector<double>> values; ///< Per sink input
+		};
+
+		/**
+		 * A recording being processed, shared by its segment tasks.
+		 */
+		struct file_job
+		{
+			std::string path;
+			uint64_t bytes = 0;
+			std::vector<recording_extent> extents;
+			std::atomic<size_t> remaining{0}; ///< Segments not yet finished
+			std::mutex mutex;
+			std::vector<result_row> rows;
+			std::string error; ///< First error of any segment
+		};
+
+		void print_usage()
+		{
+			std::cerr << "Usage: eeg_app batch --input <dir|glob> [options]\n"
+					  << "  --config <path>      pipeline file (default " << default_pipeline_path() << ")\n"
+					  << "  --source <name>      source fed with the recordings (default: first source)\n"
+					  << "  --output <dir>       results directory (default batch_results)\n"
+					  << "  --checkpoint <path>  completed-file list (default <output>/checkpoint.txt)\n"
+					  << "  --threads <n>        pool workers (default: one per core)\n"
+					  << "  --pipeline-threads <n> workers of each segment's pipeline (default 1)\n"
+					  << "  --segment <s>        split recordings into segments of this length (default 600)\n"
+					  << "  --overlap <s>        context read either side of a segment (default 5; after it, at least the longest window)\n"
+					  << "  --progress <s>       seconds between progress lines (default 2)\n";
+		}
+
+		bool parse(int argc, char** argv, batch_options& opts)
+		{
+			for (int i = 1; i + 1 < argc; i += 2)
+			{
+				const std::string arg = argv[i];
+				const std::string value = argv[i + 1];
+				if (arg == "--input")
+				{
+					opts.input = value;
+				}
+				else if (arg == "--config")
+				{
+					opts.config_path = value;
+				}
+				else if (arg == "--source")
+				{
+					opts.source = value;
+				}
+				else if (arg == "--output")
+				{
+					opts.output_dir = value;
+				}
+				else if (arg == "--checkpoint")
+				{
+					opts.checkpoint_path = value;
+				}
+				else if (arg == "--threads")
+				{
+					opts.threads = std::strtoul(value.c_str(), nullptr, 10);
+				}
+				else if (arg == "--pipeline-threads")
+				{
+					opts.pipeline_threads = std::strtoul(value.c_str(), nullptr, 10);
+				}
+				else if (arg == "--segment")
+				{
+					opts.segment_s = std::atof(value.c_str());
+				}
+				else if (arg == "--overlap")
+				{
+					opts.overlap_s = std::atof(value.c_str());
+				}
+				else if (arg == "--progress")
+				{
+					opts.progress_s = std::atof(value.c_str());
+				}
+				else
+				{
+					return false;
+				}
+			}
+			return argc % 2 == 1 && !opts.input.empty() && opts.segment_s > 0 && opts.overlap_s >= 0 && opts.progress_s > 0 &&
+				   opts.pipeline_threads > 0;
+		}
+
+		std::string checkpoint_key(const std::string& path)
+		{
+			std::error_code ec;
+			const fs::path absolute = fs::absolute(path, ec);
+			return ec ? path : absolute.lexically_normal().string();
+		}
+
+		/**
+		 * Schedules, runs and accounts for the files of one batch.
+		 */
+		class batch_run
+		{
+		public:
+			batch_run(const batch_options& opts, const json_value& config, work_pool& pool) : opts_(opts), config_(config), pool_(pool)
+			{
+				if (const json_value* stages = config.find("stages"))
+				{
+					for (const json_value& s : stages->items())
+					{
+						if (s.string_or("type", "") == "sink")
+						{
+							sinks_.push_back(s.string_or("name", ""));
+						}
+						if (s.string_or("type", "") == "window")
+						{
+							window_s_ = std::max(window_s_, s.number_or("window_s", 0));
+							window_samples_ = std::max(window_samples_, static_cast<size_t>(s.number_or("window", 0)));
+						}
+					}
+				}
+			}
+
+			bool open_checkpoint(std::set<std::string>& done, std::string& error)
+			{
+				{
+					std::ifstream in(opts_.checkpoint_path);
+					std::string line;
+					while (std::getline(in, line))
+					{
+						if (!line.empty())
+						{
+							done.insert(line);
+						}
+					}
+				}
+				checkpoint_.open(opts_.checkpoint_path, std::ios::app);
+				if (!checkpoint_)
+				{
+					error = opts_.checkpoint_path + ": cannot open";
+					return false;
+				}
+				return true;
+			}
+
+			/**
+			 * Queues a file; its segments are queued by the task itself, on
+			 * the worker that indexed it, for the others to steal.
+			 */
+			void add(const std::string& path, uint64_t bytes)
+			{
+				auto job = std::make_shared<file_job>();
+				job->path = path;
+				job->bytes = bytes;
+				bytes_total_ += bytes;
+				++files_total_;
+				pool_.submit([this, job] { index(job); });
+			}
+
+			void print_progress(double elapsed_s) const
+			{
+				const uint64_t bytes = bytes_done_.load();
+				const uint64_t samples = samples_done_.load();
+				std::cout << std::fixed << std::setprecision(1) << "[" << elapsed_s << " s] files " << files_done_.load() << "/" << files_total_;
+				if (files_failed_.load() > 0)
+				{
+					std::cout << " (" << files_failed_.load() << " failed)";
+				}
+				std::cout << ", segments " << segments_done_.load() << "/" << segments_total_.load() << ", " << std::setprecision(2)
+						  << samples / elapsed_s / 1e6 << " Msamples/s, " << bytes / elapsed_s / 1e6 << " MB/s";
+				if (bytes > 0 && bytes < bytes_total_)
+				{
+					std::cout << ", eta " << std::setprecision(0) << elapsed_s * static_cast<double>(bytes_total_ - bytes) / static_cast<double>(bytes) << " s";
+				}
+				std::cout << std::endl;
+			}
+
+			uint64_t files_done() const { return files_done_.load(); }
+			uint64_t files_failed() const { return files_failed_.load(); }
+			uint64_t samples_done() const { return samples_done_.load(); }
+			uint64_t bytes_done() const { return bytes_done_.load(); }
+
+		private:
+			void index(const std::shared_ptr<file_job>& job)
+			{
+				recording_reader reader;
+				std::string error;
+				if (!reader.open(job->path, &error) || !reader.scan(job->extents))
+				{
+					fail(error.empty() ? job->path + ": truncated record" : error);
+					return;
+				}
+				const double rate = reader.header().sampling_rate;
+				const size_t segment = std::max<size_t>(1, static_cast<size_t>(opts_.segment_s * rate));
+
+				// Segment boundaries at record boundaries, each at least
+				// `segment` samples except the last
+				std::vector<size_t> starts;
+				size_t samples = segment;
+				for (size_t i = 0; i < job->extents.size(); ++i)
+				{
+					if (samples >= segment)
+					{
+						starts.push_back(i);
+						samples = 0;
+					}
+					samples += job->extents[i].n_samples;
+				}
+				if (starts.empty())
+				{
+					finish(job);
+					return;
+				}
+				job->remaining = starts.size();
+				segments_total_ += starts.size();
+				// Past its end a segment also reads the longest window, so
+				// windows starting before the end complete as in a whole-file run
+				const size_t overlap = static_cast<size_t>(opts_.overlap_s * rate);
+				const size_t tail_overlap = std::max({overlap, window_samples_, static_cast<size_t>(std::ceil(window_s_ * rate))});
+				for (size_t s = 0; s < starts.size(); ++s)
+				{
+					const size_t end = s + 1 < starts.size() ? starts[s + 1] : job->extents.size();
+					pool_.submit([this, job, begin = starts[s], end, overlap, tail_overlap] { run_segment(job, begin, end, overlap, tail_overlap); });
+				}
+			}
+
+			void run_segment(const std::shared_ptr<file_job>& job, size_t begin, size_t end, size_t overlap, size_t tail_overlap)
+			{
+				const std::vector<recording_extent>& extents = job->extents;
+				size_t lead = begin;
+				for (size_t context = 0; lead > 0 && context < overlap;)
+				{
+					context += extents[--lead].n_samples;
+				}
+				size_t tail = end;
+				for (size_t context = 0; tail < extents.size() && context < tail_overlap;)
+				{
+					context += extents[tail++].n_samples;
+				}
+				const uint64_t keep_from = extents[begin].first_sample;
+				const uint64_t keep_to = end < extents.size() ? extents[end].first_sample : std::numeric_limits<uint64_t>::max();
+
+				std::mutex rows_mutex;
+				std::vector<result_row> rows;
+				pipeline p;
+				for (const std::string& name : sinks_)
+				{
+					p.set_sink(name, [&, name](const std::vector<block_ptr>& inputs) {
+						if (inputs.empty() || inputs[0]->first_sample < keep_from || inputs[0]->first_sample >= keep_to)
+						{
+							return;
+						}
+						result_row row;
+						row.sink = name;
+						row.first_sample = inputs[0]->first_sample;
+						for (const block_ptr& b : inputs)
+						{
+							row.values.push_back(b->values);
+						}
+						std::lock_guard<std::mutex> lock(rows_mutex);
+						rows.push_back(std::move(row));
+					});
+				}
+				std::string error;
+				if (!p.build(config_, &error))
+				{
+					segment_done(job, opts_.config_path + ": " + error);
+					return;
+				}
+				const std::vector<std::string> sources = p.sources();
+				const std::string source = !opts_.source.empty() ? opts_.source : sources.empty() ? std::string() : sources.front();
+				size_t n_chans = 0;
+				double rate = 0;
+				recording_reader reader;
+				if (!p.source_shape(source, n_chans, rate))
+				{
+					segment_done(job, opts_.config_path + ": no source \"" + source + "\"");
+					return;
+				}
+				if (!reader.open(job->path, &error) || !reader.seek(extents[lead].position))
+				{
+					segment_done(job, error.empty() ? job->path + ": seek failed" : error);
+					return;
+				}
+				if (reader.header().n_chans != n_chans)
+				{
+					segment_done(job, job->path + ": " + std::to_string(reader.header().n_chans) + " channels, source \"" + source + "\" takes " +
+										  std::to_string(n_chans));
+					return;
+				}
+
+				// Offline every block runs every stage: arrival times are push
+				// times, so deadlines would skip optional stages at random
+				p.set_threads(opts_.pipeline_threads);
+				p.set_overflow(overflow_policy::block);
+				p.set_scheduler(scheduler_policy::fifo);
+				p.start();
+				recording_record r;
+				std::vector<const double*> channels(n_chans);
+				size_t records = lead;
+				while (records < tail && reader.next(r))
+				{
+					if (r.type != recording_record_type::data)
+					{
+						continue;
+					}
+					for (size_t c = 0; c < n_chans; ++c)
+					{
+						channels[c] = r.data.data() + c * r.n_samples;
+					}
+					p.push(source, channels.data(), r.n_samples, r.first_sample);
+					if (records >= begin && records < end)
+					{
+						samples_done_ += r.n_samples * n_chans;
+					}
+					++records;
+				}
+				p.stop();
+				if (records < tail)
+				{
+					segment_done(job, job->path + ": truncated record");
+					return;
+				}
+
+				const uint64_t to = end < extents.size() ? extents[end].position : job->bytes;
+				bytes_done_ += to - (begin == 0 ? 0 : extents[begin].position);
+				{
+					std::lock_guard<std::mutex> lock(job->mutex);
+					job->rows.insert(job->rows.end(), std::make_move_iterator(rows.begin()), std::make_move_iterator(rows.end()));
+				}
+				segment_done(job, std::string());
+			}
+
+			void segment_done(const std::shared_ptr<file_job>& job, const std::string& error)
+			{
+				if (!error.empty())
+				{
+					std::lock_guard<std::mutex> lock(job->mutex);
+					if (job->error.empty())
+					{
+						job->error = error;
+					}
+				}
+				++segments_done_;
+				if (--job->remaining == 0)
+				{
+					finish(job);
+				}
+			}
+
+			/**
+			 * Writes a file's results once its last segment is done, then
+			 * records it in the checkpoint.
+			 */
+			void finish(const std::shared_ptr<file_job>& job)
+			{
+				if (!job->error.empty())
+				{
+					fail(job->error);
+					return;
+				}
+				std::sort(job->rows.begin(), job->rows.end(), [](const result_row& a, const result_row& b) {
+					return a.first_sample != b.first_sample ? a.first_sample < b.first_sample : a.sink < b.sink;
+				});
+
+				const std::string out_path = (fs::path(opts_.output_dir) / (fs::path(job->path).filename().string() + ".json")).string();
+				std::ofstream out(out_path, std::ios::trunc);
+				json_writer w(out, 0);
+				w.begin_object();
+				w.member("file", job->path);
+				w.member("config", opts_.config_path);
+				w.key("results").begin_array();
+				for (const result_row& row : job->rows)
+				{
+					w.begin_object();
+					w.member("sink", row.sink);
+					w.member("first_sample", row.first_sample);
+					w.key("values").begin_array();
+					for (const std::vector<double>& values : row.values)
+					{
+						w.begin_array();
+						for (const double v : values)
+						{
+							w.value(v);
+						}
+						w.end_array();
+					}
+					w.end_array();
+					w.end_object();
+				}
+				w.end_array();
+				w.end_object();
+				out << std::endl;
+				if (!out)
+				{
+					fail(out_path + ": write failed");
+					return;
+				}
+				job->rows = std::vector<result_row>();
+
+				{
+					std::lock_guard<std::mutex> lock(checkpoint_mutex_);
+					checkpoint_ << checkpoint_key(job->path) << std::endl;
+				}
+				++files_done_;
+			}
+
+			void fail(const std::string& error)
+			{
+				std::cerr << error << std::endl;
+				++files_failed_;
+				++files_done_;
+			}
+
+			const batch_options& opts_;
+			const json_value& config_;
+			work_pool& pool_;
+			std::vector<std::string> sinks_;
+			double window_s_ = 0;       ///< Longest `window` stage given in seconds
+			size_t window_samples_ = 0; ///< Longest `window` stage given in samples
+
+			std::mutex checkpoint_mutex_;
+			std::ofstream checkpoint_;
+
+			// Set before the first task runs
+			uint64_t files_total_ = 0;
+			uint64_t bytes_total_ = 0;
+
+			std::atomic<uint64_t> files_done_{0}; ///< Failed ones included
+			std::atomic<uint64_t> files_failed_{0};
+			std::atomic<uint64_t> segments_total_{0};
+			std::atomic<uint64_t> segments_done_{0};
+			std::atomic<uint64_t> samples_done_{0}; ///< Channel samples, overlap excluded
+			std::atomic<uint64_t> bytes_done_{0};
+		};
+	} // namespace
+
+	int batch_main(int argc, char** argv)
+	{
+		batch_options opts;
+		if (!parse(argc, argv, opts))
+		{
+			print_usage();
+			return 1;
+		}
+		if (opts.checkpoint_path.empty())
+		{
+			opts.checkpoint_path = (fs::path(opts.output_dir) / "checkpoint.txt").string();
+		}
+
+		json_value config;
+		std::string error;
+		if (!read_json_file(opts.config_path, config, &error))
+		{
+			std::cerr << error << std::endl;
+			return 1;
+		}
+		std::vector<std::string> files;
+		if (!find_recordings(opts.input, files, &error))
+		{
+			std::cerr << error << std::endl;
+			return 1;
+		}
+		std::error_code ec;
+		fs::create_directories(opts.output_dir, ec);
+		if (ec)
+		{
+			std::cerr << opts.output_dir << ": " << ec.message() << std::endl;
+			return 1;
+		}
+
+		work_pool pool(opts.threads);
+		batch_run run(opts, config, pool);
+		std::set<std::string> done;
+		if (!run.open_checkpoint(done, error))
+		{
+			std::cerr << error << std::endl;
+			return 1;
+		}
+
+		// Largest first, so the longest files do not start last and leave
+		// the pool waiting on them
+		std::vector<std::pair<uint64_t, std::string>> todo;
+		for (const std::string& f : files)
+		{
+			if (done.count(checkpoint_key(f)) == 0)
+			{
+				todo.emplace_back(fs::file_size(f, ec), f);
+			}
+		}
+		std::stable_sort(todo.begin(), todo.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+		std::cout << "Batch " << opts.config_path << ": " << todo.size() << " files to process, " << files.size() - todo.size()
+				  << " done in " << opts.checkpoint_path << ", " << pool.threads() << " workers" << std::endl;
+
+		const auto start = clock::now();
+		for (const auto& t : todo)
+		{
+			run.add(t.second, t.first);
+		}
+		const auto interval = std::chrono::milliseconds(static_cast<int64_t>(opts.progress_s * 1000));
+		while (!pool.wait_for(interval))
+		{
+			run.print_progress(std::chrono::duration<double>(clock::now() - start).count());
+		}
+		const double elapsed_s = std::chrono::duration<double>(clock::now() - start).count();
+
+		std::cout << std::fixed << std::setprecision(2) << "Processed " << run.files_done() - run.files_failed() << " files in " << elapsed_s
+				  << " s: " << run.samples_done() / std::max(elapsed_s, 1e-9) / 1e6 << " Msamples/s, "
+				  << run.bytes_done() / std::max(elapsed_s, 1e-9) / 1e6 << " MB/s, " << pool.steals() << " tasks stolen" << std::endl;
+		if (run.files_failed() > 0)
+		{
+			std::cerr << run.files_failed() << " files failed; run again to retry them" << std::endl;
+			return 1;
+		}
+		return 0;
+	}
+} // namespace eeg
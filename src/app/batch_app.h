@@ -0,0 +1,31 @@
+/**
+ * @file batch_app.h
+ * @brief Runs a pipeline over directories of recordings in parallel
+ */
+
+#pragma once
+
+namespace eeg
+{
+	/**
+	 * @brief Command line entry for `eeg_app batch --input <dir|glob> [options]`
+	 *
+	 * @details Feeds every recording matched by `--input` through the
+	 * pipeline file on a work-stealing pool (work_pool.h). Recordings longer
+	 * than `--segment` are split at record boundaries into segments run as
+	 * separate tasks. Each segment also reads `--overlap` of its neighbours
+	 * so windowed stages start warm, and keeps only the results whose first
+	 * sample falls inside it. Window positions therefore restart at each
+	 * segment rather than continuing from the one before.
+	 *
+	 * What reaches each sink is written to `<output>/<file>.json`. A file's
+	 * path is then appended to the checkpoint, and files already listed
+	 * there are skipped, so an interrupted run resumes where it stopped.
+	 * Resumption is per file: the segments of a file that was half done are
+	 * run again. Progress and throughput are printed every `--progress`
+	 * seconds.
+	 *
+	 * @return 0 when every file was processed, 1 on errors
+	 */
+	int batch_main(int argc, char** argv);
+} // namespace eeg
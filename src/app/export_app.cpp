@@ -0,0 +1,546 @@
+#include "app/export_app.h"
+
+#include "processor.h"
+#include "stream/recording.h"
+#include "util/json_writer.h"
+#include "util/npy_writer.h"
+#include "util/work_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace eeg
+{
+	namespace
+	{
+		namespace fs = std::filesystem;
+
+		struct export_options
+		{
+			std::string input;
+			std::string output_dir = "dataset";
+			std::string label;  ///< Annotation text prefix, empty for all
+			double pre_s = 0.2;  ///< Epoch start before the annotation
+			double post_s = 0.8; ///< Epoch end after the annotation
+			double notch_hz = 0; ///< 0 for no notch
+			double notch_width_hz = 4;
+			double low_hz = 0; ///< Bandpass when both are set
+			double high_hz = 0;
+			bool detrend = false;
+			bool baseline = false; ///< Subtract each channel's mean over the pre-annotation part
+			size_t threads = 0;
+		};
+
+		/**
+		 * Epochs cut from one recording, waiting for their turn to be
+		 * written.
+		 */
+		struct file_epochs
+		{
+			std::string path;
+			std::vector<float> data; ///< Epoch after epoch, each channel-major
+			std::vector<stream_annotation> events;
+			size_t skipped = 0; ///< Annotations whose epoch ran off the data or across a gap
+			std::string error;
+		};
+
+		struct dataset_shape
+		{
+			size_t n_chans = 0;
+			double sampling_rate = 0;
+			std::vector<std::string> labels;
+			size_t pre = 0; ///< Samples before the annotation
+			size_t length = 0;
+		};
+
+		void print_usage()
+		{
+			std::cerr << "Usage: eeg_app export --input <dir|glob> [options]\n"
+					  << "  --output <dir>      dataset directory (default dataset)\n"
+					  << "  --pre <s>           epoch start before each annotation (default 0.2)\n"
+					  << "  --post <s>          epoch end after each annotation (default 0.8)\n"
+					  << "  --label <prefix>    only annotations starting with this text\n"
+					  << "  --notch <hz>        notch filter centre, 0 for none (default 0)\n"
+					  << "  --notch-width <hz>  notch filter width (default 4)\n"
+					  << "  --low <hz>          bandpass low cutoff, with --high\n"
+					  << "  --high <hz>         bandpass high cutoff, with --low\n"
+					  << "  --detrend           remove each epoch's linear trend\n"
+					  << "  --baseline          subtract each channel's pre-annotation mean\n"
+					  << "  --threads <n>       worker threads (default: one per core)\n";
+		}
+
+		bool parse(int argc, char** argv, export_options& opts)
+		{
+			for (int i = 1; i < argc; ++i)
+			{
+				const std::string arg = argv[i];
+				if (arg == "--detrend")
+				{
+					opts.detrend = true;
+					continue;
+				}
+				if (arg == "--baseline")
+				{
+					opts.baseline = true;
+					continue;
+				}
+				if (i + 1 >= argc)
+				{
+					return false;
+				}
+				const std::string value = argv[++i];
+				if (arg == "--input")
+				{
+					opts.input = value;
+				}
+				else if (arg == "--output")
+				{
+					opts.output_dir = value;
+				}
+				else if (arg == "--pre")
+				{
+					opts.pre_s = std::atof(value.c_str());
+				}
+				else if (arg == "--post")
+				{
+					opts.post_s = std::atof(value.c_str());
+				}
+				else if (arg == "--label")
+				{
+					opts.label = value;
+				}
+				else if (arg == "--notch")
+				{
+					opts.notch_hz = std::atof(value.c_str());
+				}
+				else if (arg == "--notch-width")
+				{
+					opts.notch_width_hz = std::atof(value.c_str());
+				}
+				else if (arg == "--low")
+				{
+					opts.low_hz = std::atof(value.c_str());
+				}
+				else if (arg == "--high")
+				{
+					opts.high_hz = std::atof(value.c_str());
+				}
+				else if (arg == "--threads")
+				{
+					opts.threads = std::strtoul(value.c_str(), nullptr, 10);
+				}
+				else
+				{
+					return false;
+				}
+			}
+			const bool bandpass_ok = (opts.low_hz == 0 && opts.high_hz == 0) || (opts.low_hz > 0 && opts.high_hz > opts.low_hz);
+			return !opts.input.empty() && opts.pre_s >= 0 && opts.post_s > 0 && opts.notch_hz >= 0 && opts.notch_width_hz > 0 && bandpass_ok;
+		}
+
+		/**
+		 * Stretch of consecutive sample numbers in a loaded recording.
+		 */
+		struct sample_run
+		{
+			size_t offset = 0;
+			size_t n = 0;
+			uint64_t first = 0;
+		};
+
+		std::vector<sample_run> runs_of(const recording_contents& rec)
+		{
+			std::vector<sample_run> runs;
+			sample_run r{0, 0, rec.first_sample};
+			for (const sample_gap& g : rec.gaps)
+			{
+				r.n = g.index - r.offset;
+				runs.push_back(r);
+				r = sample_run{g.index, 0, g.sample};
+			}
+			r.n = rec.n_samples - r.offset;
+			if (r.n > 0)
+			{
+				runs.push_back(r);
+			}
+			return runs;
+		}
+
+		/**
+		 * Filters each run separately, so no filter smears across a gap.
+		 */
+		void filter_runs(recording_contents& rec, const std::vector<sample_run>& runs, const export_options& opts)
+		{
+			if (opts.notch_hz <= 0 && opts.low_hz <= 0)
+			{
+				return;
+			}
+			const size_t n_chans = rec.header.n_chans;
+			std::vector<double> block;
+			for (const sample_run& r : runs)
+			{
+				block.resize(n_chans * r.n);
+				for (size_t c = 0; c < n_chans; ++c)
+				{
+					const double* src = rec.data.data() + c * rec.n_samples + r.offset;
+					std::copy(src, src + r.n, block.begin() + static_cast<std::ptrdiff_t>(c * r.n));
+				}
+				if (opts.notch_hz > 0)
+				{
+					ba_bci_connect_filter_notch(block.data(), n_chans, r.n, rec.header.sampling_rate, opts.notch_hz, opts.notch_width_hz);
+				}
+				if (opts.low_hz > 0)
+				{
+					ba_bci_connect_filter_bandpass(block.data(), n_chans, r.n, rec.header.sampling_rate, opts.low_hz, opts.high_hz);
+				}
+				for (size_t c = 0; c < n_chans; ++c)
+				{
+					const double* src = block.data() + c * r.n;
+					std::copy(src, src + r.n, rec.data.begin() + static_cast<std::ptrdiff_t>(c * rec.n_samples + r.offset));
+				}
+			}
+		}
+
+		void cut_epochs(const std::string& path, const dataset_shape& shape, const export_options& opts, file_epochs& out)
+		{
+			out.path = path;
+			recording_contents rec;
+			if (!load_recording(path, rec, &out.error))
+			{
+				return;
+			}
+			if (rec.header.n_chans != shape.n_chans || rec.header.sampling_rate != shape.sampling_rate)
+			{
+				out.error = path + ": " + std::to_string(rec.header.n_chans) + " channels at " + std::to_string(rec.header.sampling_rate) +
+							" Hz, the dataset has " + std::to_string(shape.n_chans) + " at " + std::to_string(shape.sampling_rate) + " Hz";
+				return;
+			}
+			const std::vector<sample_run> runs = runs_of(rec);
+			filter_runs(rec, runs, opts);
+
+			const size_t n_chans = shape.n_chans;
+			const size_t length = shape.length;
+			std::vector<double> epoch(n_chans * length);
+			std::vector<double> detrended(n_chans * length);
+			for (const stream_annotation& a : rec.annotations)
+			{
+				if (a.text.compare(0, opts.label.size(), opts.label) != 0)
+				{
+					continue;
+				}
+				// The epoch must lie inside the run holding the annotation
+				const auto run = std::find_if(runs.begin(), runs.end(), [&](const sample_run& r) { return a.sample >= r.first && a.sample < r.first + r.n; });
+				if (run == runs.end() || a.sample - run->first < shape.pre || a.sample - run->first - shape.pre + length > run->n)
+				{
+					++out.skipped;
+					continue;
+				}
+				const size_t start = run->offset + static_cast<size_t>(a.sample - run->first) - shape.pre;
+				for (size_t c = 0; c < n_chans; ++c)
+				{
+					const double* src = rec.data.data() + c * rec.n_samples + start;
+					std::copy(src, src + length, epoch.begin() + static_cast<std::ptrdiff_t>(c * length));
+				}
+				if (opts.detrend)
+				{
+					ba_bci_connect_detrend(epoch.data(), n_chans, length, detrended.data());
+					epoch.swap(detrended);
+				}
+				if (opts.baseline && shape.pre > 0)
+				{
+					for (size_t c = 0; c < n_chans; ++c)
+					{
+						double* x = epoch.data() + c * length;
+						double mean = 0;
+						for (size_t i = 0; i < shape.pre; ++i)
+						{
+							mean += x[i];
+						}
+						mean /= static_cast<double>(shape.pre);
+						for (size_t i = 0; i < length; ++i)
+						{
+							x[i] -= mean;
+						}
+					}
+				}
+				for (const double v : epoch)
+				{
+					out.data.push_back(static_cast<float>(v));
+				}
+				out.events.push_back(a);
+			}
+		}
+
+		std::string csv_field(const std::string& s)
+		{
+			if (s.find_first_of(",\"\n\r") == std::string::npos)
+			{
+				return s;
+			}
+			std::string quoted = "\"";
+			for (const char ch : s)
+			{
+				quoted += ch;
+				if (ch == '"')
+				{
+					quoted += '"';
+				}
+			}
+			return quoted + "\"";
+		}
+
+		/**
+		 * Writes finished files' epochs in file order as they become
+		 * available.
+		 */
+		class dataset_writer
+		{
+		public:
+			dataset_writer(size_t n_files, const dataset_shape& shape) : pending_(n_files), shape_(shape) {}
+
+			bool open(const std::string& dir, std::string& error)
+			{
+				const std::string path = (fs::path(dir) / "epochs.npy").string();
+				if (!epochs_.open(path, "<f4", {shape_.n_chans, shape_.length}, sizeof(float)))
+				{
+					error = path + ": cannot create";
+					return false;
+				}
+				return true;
+			}
+
+			void add(size_t index, std::unique_ptr<file_epochs> f)
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				pending_[index] = std::move(f);
+				for (; next_ < pending_.size() && pending_[next_]; ++next_)
+				{
+					file_epochs& e = *pending_[next_];
+					if (!e.error.empty())
+					{
+						std::cerr << e.error << std::endl;
+						++failed_;
+					}
+					else
+					{
+						epochs_.append(e.data.data(), e.events.size());
+						files_.push_back(file_entry{e.path, e.events.size(), e.skipped});
+						for (const stream_annotation& a : e.events)
+						{
+							rows_.push_back(row{a.text, files_.size() - 1, a.sample});
+						}
+					}
+					pending_[next_].reset();
+				}
+			}
+
+			/**
+			 * Closes the tensor and writes the labels, index and metadata.
+			 */
+			bool finish(const std::string& dir, const export_options& opts, std::string& error)
+			{
+				if (!epochs_.close())
+				{
+					error = (fs::path(dir) / "epochs.npy").string() + ": write failed";
+					return false;
+				}
+
+				// Label ids follow the sorted annotation texts
+				std::map<std::string, int32_t> ids;
+				for (const row& r : rows_)
+				{
+					ids.emplace(r.text, 0);
+				}
+				std::vector<std::string> names;
+				for (auto& id : ids)
+				{
+					id.second = static_cast<int32_t>(names.size());
+					names.push_back(id.first);
+				}
+				std::vector<int32_t> labels;
+				labels.reserve(rows_.size());
+				for (const row& r : rows_)
+				{
+					labels.push_back(ids[r.text]);
+				}
+				npy_writer label_file;
+				const std::string labels_path = (fs::path(dir) / "labels.npy").string();
+				if (!label_file.open(labels_path, "<i4", {}, sizeof(int32_t)) || !label_file.append(labels.data(), labels.size()) || !label_file.close())
+				{
+					error = labels_path + ": write failed";
+					return false;
+				}
+
+				const std::string index_path = (fs::path(dir) / "index.csv").string();
+				std::ofstream index(index_path, std::ios::trunc);
+				index << "epoch,label,text,file,sample\n";
+				for (size_t i = 0; i < rows_.size(); ++i)
+				{
+					const row& r = rows_[i];
+					index << i << ',' << labels[i] << ',' << csv_field(r.text) << ',' << csv_field(files_[r.file].path) << ',' << r.sample << '\n';
+				}
+				if (!index.flush())
+				{
+					error = index_path + ": write failed";
+					return false;
+				}
+
+				const std::string meta_path = (fs::path(dir) / "dataset.json").string();
+				std::ofstream meta(meta_path, std::ios::trunc);
+				json_writer w(meta);
+				w.begin_object();
+				w.member("epochs", static_cast<uint64_t>(rows_.size()));
+				w.member("n_chans", static_cast<uint64_t>(shape_.n_chans));
+				w.member("n_samples", static_cast<uint64_t>(shape_.length));
+				w.member("sampling_rate", shape_.sampling_rate);
+				w.member("pre_samples", static_cast<uint64_t>(shape_.pre));
+				w.key("channels").begin_array();
+				for (const std::string& label : shape_.labels)
+				{
+					w.value(label);
+				}
+				w.end_array();
+				w.key("preprocessing").begin_object();
+				w.member("notch_hz", opts.notch_hz);
+				w.member("notch_width_hz", opts.notch_width_hz);
+				w.member("low_hz", opts.low_hz);
+				w.member("high_hz", opts.high_hz);
+				w.member("detrend", opts.detrend);
+				w.member("baseline", opts.baseline);
+				w.end_object();
+				w.member("label_prefix", opts.label);
+				w.key("labels").begin_array();
+				for (const std::string& name : names)
+				{
+					w.value(name);
+				}
+				w.end_array();
+				w.key("files").begin_array();
+				for (const file_entry& f : files_)
+				{
+					w.begin_object();
+					w.member("path", f.path);
+					w.member("epochs", static_cast<uint64_t>(f.epochs));
+					w.member("skipped", static_cast<uint64_t>(f.skipped));
+					w.end_object();
+				}
+				w.end_array();
+				w.end_object();
+				meta << std::endl;
+				if (!meta)
+				{
+					error = meta_path + ": write failed";
+					return false;
+				}
+				return true;
+			}
+
+			size_t epochs() const { return rows_.size(); }
+			size_t failed() const { return failed_; }
+
+		private:
+			struct file_entry
+			{
+				std::string path;
+				size_t epochs = 0;
+				size_t skipped = 0;
+			};
+
+			struct row
+			{
+				std::string text;
+				size_t file = 0;
+				uint64_t sample = 0;
+			};
+
+			std::mutex mutex_;
+			std::vector<std::unique_ptr<file_epochs>> pending_;
+			size_t next_ = 0;
+			const dataset_shape& shape_;
+			npy_writer epochs_;
+			std::vector<file_entry> files_;
+			std::vector<row> rows_;
+			size_t failed_ = 0;
+		};
+	} // namespace
+
+	int export_main(int argc, char** argv)
+	{
+		export_options opts;
+		if (!parse(argc, argv, opts))
+		{
+			print_usage();
+			return 1;
+		}
+		std::vector<std::string> files;
+		std::string error;
+		if (!find_recordings(opts.input, files, &error))
+		{
+			std::cerr << error << std::endl;
+			return 1;
+		}
+		if (files.empty())
+		{
+			std::cerr << opts.input << ": no recordings" << std::endl;
+			return 1;
+		}
+
+		// The first recording fixes the tensor's channels and rate
+		dataset_shape shape;
+		{
+			recording_reader first;
+			if (!first.open(files.front(), &error))
+			{
+				std::cerr << error << std::endl;
+				return 1;
+			}
+			shape.n_chans = first.header().n_chans;
+			shape.sampling_rate = first.header().sampling_rate;
+			shape.labels = first.header().labels;
+		}
+		shape.pre = static_cast<size_t>(std::lround(opts.pre_s * shape.sampling_rate));
+		shape.length = shape.pre + static_cast<size_t>(std::lround(opts.post_s * shape.sampling_rate));
+
+		std::error_code ec;
+		fs::create_directories(opts.output_dir, ec);
+		dataset_writer writer(files.size(), shape);
+		if (ec || !writer.open(opts.output_dir, error))
+		{
+			std::cerr << (ec ? opts.output_dir + ": " + ec.message() : error) << std::endl;
+			return 1;
+		}
+
+		const auto start = std::chrono::steady_clock::now();
+		{
+			work_pool pool(opts.threads);
+			for (size_t i = 0; i < files.size(); ++i)
+			{
+				pool.submit([&, i] {
+					auto f = std::make_unique<file_epochs>();
+					cut_epochs(files[i], shape, opts, *f);
+					writer.add(i, std::move(f));
+				});
+			}
+			pool.wait();
+		}
+		if (!writer.finish(opts.output_dir, opts, error))
+		{
+			std::cerr << error << std::endl;
+			return 1;
+		}
+		const double elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::cout << "Exported " << writer.epochs() << " epochs of " << shape.n_chans << " x " << shape.length << " from "
+				  << files.size() - writer.failed() << " files to " << opts.output_dir << " in " << elapsed_s << " s" << std::endl;
+		return writer.failed() > 0 ? 1 : 0;
+	}
+} // namespace eeg
@@ -0,0 +1,37 @@
+/**
+ * @file export_app.h
+ * @brief Exports annotated epochs of recordings as a training dataset
+ */
+
+#pragma once
+
+namespace eeg
+{
+	/**
+	 * @brief Command line entry for `eeg_app export --input <dir|glob> [options]`
+	 *
+	 * @details Cuts an epoch from `--pre` seconds before to `--post` seconds
+	 * after each annotation (optionally only those starting with `--label`)
+	 * of every matched recording. Epochs that would cross a gap in the
+	 * sample numbers are skipped. Filters run on each unbroken stretch of a
+	 * recording before the cuts; detrending and baseline removal run per
+	 * epoch. Files are processed in parallel on a `work_pool` and written in
+	 * file order, so output is reproducible.
+	 *
+	 * The output directory receives:
+	 *
+	 * - `epochs.npy`: float32, shape (epochs, channels, samples), C order,
+	 *   for `numpy.load(path, mmap_mode="r")`
+	 * - `labels.npy`: int32 label of each epoch, indexing `labels` in
+	 *   `dataset.json`
+	 * - `index.csv`: epoch, label, annotation text, file and sample number
+	 * - `dataset.json`: shape, sampling rate, channel labels,
+	 *   preprocessing, label names and per-file epoch counts
+	 *
+	 * Recordings whose channel count or sampling rate differ from the first
+	 * are reported and left out.
+	 *
+	 * @return 0 on success, 1 on errors
+	 */
+	int export_main(int argc, char** argv);
+} // namespace eeg
@@ -0,0 +1,181 @@
+#include "app/ica_app.h"
+
+#include "bci/ica.h"
+#include "processor.h"
+#include "stream/recording.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace eeg
+{
+	namespace
+	{
+		struct ica_app_options
+		{
+			std::string input_path;
+			std::string output_path; ///< Empty: the input with an `.ica.json` extension
+			double start_s = 0;
+			double duration_s = 0; ///< 0 for the rest of the recording
+			double highpass_hz = 1;
+			std::vector<size_t> remove;
+			ica_options ica;
+		};
+
+		void print_usage()
+		{
+			std::cerr << "Usage: eeg_app ica --input <path> [options]\n"
+					  << "  --output <path>           model (default <input>.ica.json)\n"
+					  << "  --start <s>               start of the fitting segment (default 0)\n"
+					  << "  --duration <s>            length of the fitting segment (default: to the end)\n"
+					  << "  --highpass <hz>           highpass before fitting, 0 for none (default 1)\n"
+					  << "  --components <n>          components to fit (default: one per channel)\n"
+					  << "  --max-iterations <n>      FastICA iterations (default 200)\n"
+					  << "  --threads <n>             workers sharing the components (default 1)\n"
+					  << "  --remove <i,j,...>        components the ica stage removes\n";
+		}
+
+		bool parse(int argc, char** argv, ica_app_options& opts)
+		{
+			for (int i = 1; i < argc; ++i)
+			{
+				const std::string arg = argv[i];
+				if (i + 1 >= argc)
+				{
+					return false;
+				}
+				const std::string value = argv[++i];
+				if (arg == "--input")
+				{
+					opts.input_path = value;
+				}
+				else if (arg == "--output")
+				{
+					opts.output_path = value;
+				}
+				else if (arg == "--start")
+				{
+					opts.start_s = std::atof(value.c_str());
+				}
+				else if (arg == "--duration")
+				{
+					opts.duration_s = std::atof(value.c_str());
+				}
+				else if (arg == "--highpass")
+				{
+					opts.highpass_hz = std::atof(value.c_str());
+				}
+				else if (arg == "--components")
+				{
+					opts.ica.components = static_cast<size_t>(std::atoi(value.c_str()));
+				}
+				else if (arg == "--max-iterations")
+				{
+					opts.ica.max_iterations = static_cast<size_t>(std::atoi(value.c_str()));
+				}
+				else if (arg == "--threads")
+				{
+					opts.ica.threads = static_cast<size_t>(std::max(1, std::atoi(value.c_str())));
+				}
+				else if (arg == "--remove")
+				{
+					std::istringstream in(value);
+					std::string item;
+					while (std::getline(in, item, ','))
+					{
+						opts.remove.push_back(static_cast<size_t>(std::atoi(item.c_str())));
+					}
+				}
+				else
+				{
+					return false;
+				}
+			}
+			return !opts.input_path.empty() && opts.start_s >= 0 && opts.duration_s >= 0 && opts.highpass_hz >= 0 && opts.ica.max_iterations > 0;
+		}
+	} // namespace
+
+	int ica_main(int argc, char** argv)
+	{
+		ica_app_options opts;
+		if (!parse(argc, argv, opts))
+		{
+			print_usage();
+			return 1;
+		}
+		if (opts.output_path.empty())
+		{
+			const size_t slash = opts.input_path.find_last_of("/\\");
+			const size_t dot = opts.input_path.find_last_of('.');
+			const bool has_extension = dot != std::string::npos && (slash == std::string::npos || dot > slash);
+			opts.output_path = (has_extension ? opts.input_path.substr(0, dot) : opts.input_path) + ".ica.json";
+		}
+
+		recording_contents rec;
+		std::string error;
+		if (!load_recording(opts.input_path, rec, &error))
+		{
+			std::cerr << error << std::endl;
+			return 1;
+		}
+		const size_t n_chans = rec.header.n_chans;
+		const double fs = rec.header.sampling_rate;
+		const size_t first = std::min(rec.n_samples, static_cast<size_t>(opts.start_s * fs));
+		const size_t n = opts.duration_s > 0 ? std::min(rec.n_samples - first, static_cast<size_t>(opts.duration_s * fs)) : rec.n_samples - first;
+
+		// Gaps are joined; a short one only adds a step the highpass settles
+		std::vector<double> x(n_chans * n);
+		for (size_t c = 0; c < n_chans; ++c)
+		{
+			std::copy(rec.data.begin() + static_cast<std::ptrdiff_t>(c * rec.n_samples + first),
+					  rec.data.begin() + static_cast<std::ptrdiff_t>(c * rec.n_samples + first + n), x.begin() + static_cast<std::ptrdiff_t>(c * n));
+		}
+		if (opts.highpass_hz > 0 && n > 0)
+		{
+			ba_bci_connect_filter_highpass(x.data(), n_chans, n, fs, opts.highpass_hz);
+		}
+
+		auto t0 = std::chrono::steady_clock::now();
+		ica_model model;
+		if (!model.fit(x.data(), n_chans, n, opts.ica, &error))
+		{
+			std::cerr << opts.input_path << ": " << error << std::endl;
+			return 1;
+		}
+		const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+		for (size_t r : opts.remove)
+		{
+			if (r >= model.n_components())
+			{
+				std::cerr << "--remove " << r << " is out of range for " << model.n_components() << " components" << std::endl;
+				return 1;
+			}
+		}
+		model.set_removed(opts.remove);
+		if (!model.save(opts.output_path, &error))
+		{
+			std::cerr << error << std::endl;
+			return 1;
+		}
+
+		std::cout << std::left << std::setw(11) << "component" << std::right << std::setw(11) << "variance %" << std::setw(11) << "kurtosis"
+				  << std::setw(9) << "removed" << std::endl;
+		for (size_t k = 0; k < model.n_components(); ++k)
+		{
+			const bool removed = std::find(model.removed().begin(), model.removed().end(), k) != model.removed().end();
+			std::cout << std::left << std::setw(11) << k << std::right << std::fixed << std::setprecision(2) << std::setw(11)
+					  << 100 * model.variance()[k] << std::setw(11) << model.kurtosis()[k] << std::setw(9) << (removed ? "yes" : "") << std::endl;
+		}
+		std::cout << "Fitted " << model.n_components() << " components on " << n << " samples of " << n_chans << " channels in "
+				  << model.iterations() << " iterations (" << (model.converged() ? "converged" : "not converged") << ", "
+				  << std::setprecision(1) << ms << " ms)" << std::endl;
+		std::cout << "Wrote " << opts.output_path << std::endl;
+		return 0;
+	}
+} // namespace eeg
@@ -0,0 +1,26 @@
+/**
+ * @file ica_app.h
+ * @brief Fits ICA models on recordings for online artifact removal
+ */
+
+#pragma once
+
+namespace eeg
+{
+	/**
+	 * @brief Command line entry for `eeg_app ica --input <path> [options]`
+	 *
+	 * @details Fits an `ica_model` (ica.h) on `--duration` seconds of a
+	 * recording from `--start`, by default all of it, after a `--highpass`
+	 * (default 1 Hz, 0 for none) that removes the drifts ICA would
+	 * otherwise spend components on. Prints each component's share of the
+	 * variance and its kurtosis, which is large for blinks, and writes the
+	 * model to `--output` (default: the input with an `.ica.json`
+	 * extension) with the `--remove` components marked for removal. The
+	 * `ica` pipeline stage then applies it to live blocks, which must be
+	 * highpassed the same way.
+	 *
+	 * @return 0 on success, 1 on errors
+	 */
+	int ica_main(int argc, char** argv);
+} // namespace eeg
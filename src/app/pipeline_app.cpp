@@ -0,0 +1,254 @@
+#include "app/pipeline_app.h"
+
+#include "pipeline/pipeline.h"
+#include "stream/simulated_device.h"
+#include "util/json_writer.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace eeg
+{
+	namespace
+	{
+		struct pipeline_app_options
+		{
+			std::string config_path = default_pipeline_path();
+			std::string source; ///< Empty for the first source
+			double duration_s = 60;
+			double acceleration = 10;
+			std::string json_path; ///< Stage statistics, skipped when empty
+		};
+
+		/**
+		 * Counts what reaches a sink and remembers the latest values.
+		 */
+		struct sink_log
+		{
+			std::mutex mutex;
+			uint64_t count = 0;
+			std::vector<std::vector<double>> latest; ///< Values per input
+		};
+
+		/**
+		 * Copies the electrode channels of each chunk into a source.
+		 */
+		struct feeder
+		{
+			pipeline* p = nullptr;
+			std::string source;
+			size_t sample_number_index = 0;
+			std::vector<size_t> electrode_index;
+			std::vector<const double*> channels;
+
+			static void on_chunk(const void* const* data, size_t size, void* user_data)
+			{
+				feeder& f = *static_cast<feeder*>(user_data);
+				for (size_t i = 0; i < f.electrode_index.size(); ++i)
+				{
+					f.channels[i] = static_cast<const double*>(data[f.electrode_index[i]]);
+				}
+				const size_t first = static_cast<const size_t*>(data[f.sample_number_index])[0];
+				f.p->push(f.source, f.channels.data(), size, first);
+			}
+		};
+
+		void print_usage()
+		{
+			std::cerr << "Usage: eeg_app pipeline [options]\n"
+					  << "  --config <path>   pipeline file (default " << default_pipeline_path() << ")\n"
+					  << "  --source <name>   source fed by the device (default: first source)\n"
+					  << "  --duration <s>    stream seconds (default 60)\n"
+					  << "  --accel <x>       stream seconds per wall second, 0 for unpaced (default 10)\n"
+					  << "  --json <path>     write stage statistics\n";
+		}
+
+		bool parse(int argc, char** argv, pipeline_app_options& opts)
+		{
+			for (int i = 1; i + 1 < argc; i += 2)
+			{
+				const std::string arg = argv[i];
+				const std::string value = argv[i + 1];
+				if (arg == "--config")
+				{
+					opts.config_path = value;
+				}
+				else if (arg == "--source")
+				{
+					opts.source = value;
+				}
+				else if (arg == "--duration")
+				{
+					opts.duration_s = std::atof(value.c_str());
+				}
+				else if (arg == "--accel")
+				{
+					opts.acceleration = std::atof(value.c_str());
+				}
+				else if (arg == "--json")
+				{
+					opts.json_path = value;
+				}
+				else
+				{
+					return false;
+				}
+			}
+			return argc % 2 == 1 && opts.duration_s > 0 && opts.acceleration >= 0;
+		}
+	} // namespace
+
+	int pipeline_main(int argc, char** argv)
+	{
+		pipeline_app_options opts;
+		if (!parse(argc, argv, opts))
+		{
+			print_usage();
+			return 1;
+		}
+
+		json_value config;
+		std::string error;
+		if (!read_json_file(opts.config_path, config, &error))
+		{
+			std::cerr << error << std::endl;
+			return 1;
+		}
+
+		// Sinks are attached before the stages are built
+		pipeline p;
+		std::vector<std::pair<std::string, std::unique_ptr<sink_log>>> sinks;
+		if (const json_value* stages = config.find("stages"))
+		{
+			for (const json_value& s : stages->items())
+			{
+				if (s.string_or("type", "") != "sink")
+				{
+					continue;
+				}
+				sinks.emplace_back(s.string_or("name", ""), std::make_unique<sink_log>());
+				sink_log* log = sinks.back().second.get();
+				p.set_sink(sinks.back().first, [log](const std::vector<block_ptr>& inputs) {
+					std::lock_guard<std::mutex> lock(log->mutex);
+					++log->count;
+					log->latest.clear();
+					for (const block_ptr& b : inputs)
+					{
+						log->latest.push_back(b->values);
+					}
+				});
+			}
+		}
+		if (!p.build(config, &error))
+		{
+			std::cerr << opts.config_path << ": " << error << std::endl;
+			return 1;
+		}
+
+		const std::vector<std::string> sources = p.sources();
+		if (sources.empty())
+		{
+			std::cerr << opts.config_path << ": no source stage" << std::endl;
+			return 1;
+		}
+		feeder f;
+		f.p = &p;
+		f.source = opts.source.empty() ? sources.front() : opts.source;
+		size_t n_chans = 0;
+		double rate = 0;
+		if (!p.source_shape(f.source, n_chans, rate))
+		{
+			std::cerr << "Unknown source " << f.source << std::endl;
+			return 1;
+		}
+
+		simulated_device_config dc;
+		dc.sampling_rate = rate;
+		dc.n_electrodes = n_chans;
+		dc.acceleration = opts.acceleration;
+		simulated_device device(dc);
+		f.sample_number_index = device.channel_index(BA_EEG_CHANNEL_ID_SAMPLE_NUMBER);
+		for (size_t i = 0; i < n_chans; ++i)
+		{
+			f.electrode_index.push_back(device.channel_index(static_cast<ba_eeg_channel>(BA_EEG_CHANNEL_ID_ELECTRODE_MEASUREMENT + i)));
+		}
+		f.channels.resize(n_chans);
+		device.set_callback_chunk(&feeder::on_chunk, &f);
+
+		std::cout << "Pipeline " << opts.config_path << ": " << p.stats().size() << " stages on " << p.threads() << " threads, feeding \""
+				  << f.source << "\" with " << n_chans << " channels at " << rate << " Hz" << std::endl;
+
+		if (opts.acceleration == 0)
+		{
+			p.set_overflow(overflow_policy::block);
+		}
+		p.start();
+		const uint64_t total = static_cast<uint64_t>(opts.duration_s * rate);
+		if (opts.acceleration > 0)
+		{
+			device.start_stream();
+			std::this_thread::sleep_until(device.scheduled_time(total));
+			device.stop_stream();
+		}
+		else
+		{
+			while (device.samples_emitted() < total)
+			{
+				device.emit_chunk();
+			}
+		}
+		p.stop();
+
+		for (const auto& s : sinks)
+		{
+			std::lock_guard<std::mutex> lock(s.second->mutex);
+			std::cout << "sink " << s.first << ": " << s.second->count << " results, latest";
+			for (const std::vector<double>& values : s.second->latest)
+			{
+				std::cout << " [";
+				for (size_t i = 0; i < values.size(); ++i)
+				{
+					std::cout << (i ? " " : "") << values[i];
+				}
+				std::cout << "]";
+			}
+			std::cout << std::endl;
+		}
+
+		std::cout << std::left << std::setw(18) << "stage" << std::setw(18) << "type" << std::right << std::setw(9) << "runs" << std::setw(9)
+				  << "dropped" << std::setw(10) << "unmatched" << std::setw(11) << "mean us" << std::setw(11) << "p99 us" << std::setw(8) << "missed" << std::setw(8) << "skipped" << std::endl;
+		for (const stage_stats& s : p.stats())
+		{
+			std::cout << std::left << std::setw(18) << s.name << std::setw(18) << s.type << std::right << std::setw(9) << s.runs << std::setw(9)
+					  << s.dropped << std::setw(10) << s.unmatched << std::fixed << std::setprecision(1) << std::setw(11) << s.mean_us
+					  << std::setw(11) << s.p99_us << std::setw(8) << s.deadline_misses << std::setw(8) << s.skipped << std::endl;
+		}
+
+		if (!opts.json_path.empty())
+		{
+			std::ofstream out(opts.json_path);
+			if (!out)
+			{
+				std::cerr << "Failed to open " << opts.json_path << std::endl;
+				return 1;
+			}
+			json_writer w(out);
+			w.begin_object();
+			w.member("config", opts.config_path);
+			w.member("threads", static_cast<uint64_t>(p.threads()));
+			w.key("stages");
+			p.write_stats(w);
+			w.end_object();
+			out << std::endl;
+		}
+		return 0;
+	}
+} // namespace eeg
@@ -0,0 +1,20 @@
+/**
+ * @file pipeline_app.h
+ * @brief Runs a pipeline file against a simulated device
+ */
+
+#pragma once
+
+namespace eeg
+{
+	/**
+	 * @brief Command line entry for `eeg_app pipeline [options]`
+	 *
+	 * @details Loads the pipeline (by default `pipeline.json` next to
+	 * `bacore.json`), streams a simulated device into its first source,
+	 * prints what reaches each sink and reports per-stage timing.
+	 *
+	 * @return 0 on success, 1 on errors
+	 */
+	int pipeline_main(int argc, char** argv);
+} // namespace eeg
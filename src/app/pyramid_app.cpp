@@ -0,0 +1,172 @@
+#include "app/pyramid_app.h"
+
+#include "stream/pyramid.h"
+#include "stream/recording.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace eeg
+{
+	namespace
+	{
+		struct pyramid_options
+		{
+			std::string input_path;
+			bool rebuild = false;
+			size_t pixels = 1920;
+			size_t channel = 0;
+			size_t base = 16;
+			size_t factor = 4;
+		};
+
+		void print_usage()
+		{
+			std::cerr << "Usage: eeg_app pyramid --input <path> [options]\n"
+					  << "  --rebuild           build the sidecar even if it exists\n"
+					  << "  --pixels <n>        overview query width (default 1920)\n"
+					  << "  --channel <n>       channel queried (default 0)\n"
+					  << "  --base <samples>    building: samples per level-0 bin (default 16)\n"
+					  << "  --factor <n>        building: bins merged per level (default 4)\n";
+		}
+
+		bool parse(int argc, char** argv, pyramid_options& opts)
+		{
+			for (int i = 1; i < argc; ++i)
+			{
+				const std::string arg = argv[i];
+				if (arg == "--rebuild")
+				{
+					opts.rebuild = true;
+					continue;
+				}
+				if (i + 1 >= argc)
+				{
+					return false;
+				}
+				const std::string value = argv[++i];
+				if (arg == "--input")
+				{
+					opts.input_path = value;
+				}
+				else if (arg == "--pixels")
+				{
+					opts.pixels = static_cast<size_t>(std::atoi(value.c_str()));
+				}
+				else if (arg == "--channel")
+				{
+					opts.channel = static_cast<size_t>(std::atoi(value.c_str()));
+				}
+				else if (arg == "--base")
+				{
+					opts.base = static_cast<size_t>(std::atoi(value.c_str()));
+				}
+				else if (arg == "--factor")
+				{
+					opts.factor = static_cast<size_t>(std::atoi(value.c_str()));
+				}
+				else
+				{
+					return false;
+				}
+			}
+			return !opts.input_path.empty() && opts.pixels > 0 && opts.base > 0 && opts.factor > 1;
+		}
+
+		double elapsed_ms(std::chrono::steady_clock::time_point t0)
+		{
+			return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+		}
+	} // namespace
+
+	int pyramid_main(int argc, char** argv)
+	{
+		pyramid_options opts;
+		if (!parse(argc, argv, opts))
+		{
+			print_usage();
+			return 1;
+		}
+
+		const std::string sidecar = pyramid_path(opts.input_path);
+		minmax_pyramid pyramid;
+		std::string error;
+		auto t0 = std::chrono::steady_clock::now();
+		if (!opts.rebuild && read_pyramid(sidecar, pyramid))
+		{
+			std::cout << "Loaded " << sidecar << " in " << elapsed_ms(t0) << " ms" << std::endl;
+		}
+		else
+		{
+			if (!build_recording_pyramid(opts.input_path, pyramid, &error, opts.base, opts.factor))
+			{
+				std::cerr << error << std::endl;
+				return 1;
+			}
+			const double build_ms = elapsed_ms(t0);
+			if (!write_pyramid(sidecar, pyramid, &error))
+			{
+				std::cerr << error << std::endl;
+				return 1;
+			}
+			std::cout << "Built " << sidecar << " in " << build_ms << " ms" << std::endl;
+		}
+		std::cout << pyramid.n_samples() << " samples, " << pyramid.n_chans() << " channels, " << pyramid.bytes() << " bytes" << std::endl;
+		for (size_t level = 0; level < pyramid.n_levels(); ++level)
+		{
+			std::cout << "  level " << level << ": " << pyramid.n_bins(level) << " bins of " << pyramid.bin_size(level) << " samples" << std::endl;
+		}
+		if (opts.channel >= pyramid.n_chans())
+		{
+			std::cerr << "No channel " << opts.channel << std::endl;
+			return 1;
+		}
+
+		std::vector<pyramid_bin> pixels(opts.pixels);
+		t0 = std::chrono::steady_clock::now();
+		const size_t drawn = pyramid.query(opts.channel, 0, pyramid.n_samples(), opts.pixels, pixels.data());
+		const double query_us = elapsed_ms(t0) * 1000;
+		if (drawn == 0)
+		{
+			std::cout << "Recording is shorter than " << opts.pixels * pyramid.base() << " samples; draw the samples directly" << std::endl;
+			return 0;
+		}
+
+		// The same overview from the samples, for comparison
+		recording_contents contents;
+		if (!load_recording(opts.input_path, contents, &error))
+		{
+			std::cerr << error << std::endl;
+			return 1;
+		}
+		t0 = std::chrono::steady_clock::now();
+		const double* x = contents.data.data() + opts.channel * contents.n_samples;
+		const double span = static_cast<double>(contents.n_samples) / static_cast<double>(opts.pixels);
+		double lo = x[0];
+		double hi = x[0];
+		for (size_t p = 0; p < opts.pixels; ++p)
+		{
+			const size_t a = static_cast<size_t>(static_cast<double>(p) * span);
+			const size_t b = std::max(a + 1, static_cast<size_t>(static_cast<double>(p + 1) * span));
+			const auto mm = std::minmax_element(x + a, x + std::min(b, contents.n_samples));
+			lo = std::min(lo, *mm.first);
+			hi = std::max(hi, *mm.second);
+		}
+		const double scan_us = elapsed_ms(t0) * 1000;
+
+		float pyr_lo = pixels[0].min;
+		float pyr_hi = pixels[0].max;
+		for (size_t p = 1; p < drawn; ++p)
+		{
+			pyr_lo = std::min(pyr_lo, pixels[p].min);
+			pyr_hi = std::max(pyr_hi, pixels[p].max);
+		}
+		std::cout << drawn << " pixels of channel " << opts.channel << ": pyramid " << query_us << " us, sample scan " << scan_us << " us" << std::endl;
+		std::cout << "  range " << pyr_lo << " .. " << pyr_hi << " (samples " << lo << " .. " << hi << ")" << std::endl;
+		return 0;
+	}
+} // namespace eeg
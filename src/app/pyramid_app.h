@@ -0,0 +1,21 @@
+/**
+ * @file pyramid_app.h
+ * @brief Builds and inspects the min/max pyramid sidecar of a recording
+ */
+
+#pragma once
+
+namespace eeg
+{
+	/**
+	 * @brief Command line entry for `eeg_app pyramid --input <path> [options]`
+	 *
+	 * @details Loads the recording's `.pyr` sidecar, building and writing it
+	 * first when it is missing or `--rebuild` is given, then prints its
+	 * levels and times a whole-recording overview query against scanning
+	 * the samples.
+	 *
+	 * @return 0 on success, 1 on errors
+	 */
+	int pyramid_main(int argc, char** argv);
+} // namespace eeg
@@ -0,0 +1,655 @@
+#include "app/soak.h"
+
+#include "processor.h"
+#include "ssvep_classifier.h"
+#include "stream/chunk_controller.h"
+#include "stream/plot_feed.h"
+#include "stream/simulated_device.h"
+#include "stream/stream_ring.h"
+#include "util/json_writer.h"
+#include "util/memory_accounting.h"
+#include "util/process_stats.h"
+#include "util/stats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace eeg
+{
+	namespace
+	{
+		using clock = std::chrono::steady_clock;
+
+		constexpr double mib = 1024.0 * 1024.0;
+
+		int64_t now_ns()
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now().time_since_epoch()).count();
+		}
+
+		struct soak_sample
+		{
+			double wall_s = 0;
+			double stream_s = 0;
+			process_memory memory;
+			size_t tracked_bytes = 0; ///< Sum over memory accounting categories
+			size_t ring_depth = 0;
+			size_t ring_depth_max = 0;
+			uint64_t dropped = 0;
+			uint64_t windows = 0;
+			uint64_t plot_frames = 0; ///< Frames drawn by all viewers since the last sample
+			size_t latency_count = 0;
+			double latency_p50_ms = 0;
+			double latency_p95_ms = 0;
+			double latency_p99_ms = 0;
+			double latency_max_ms = 0;
+			bool adaptive = false;
+			chunk_controller_metrics chunk; ///< Valid when `adaptive`
+		};
+
+		/**
+		 * The processing chain under test: the chunk callback feeds the ring,
+		 * a consumer thread windows it and runs preprocessing and classification.
+		 */
+		class chain
+		{
+		public:
+			chain(const soak_options& opts, simulated_device& device)
+				: opts_(opts),
+				  window_(static_cast<size_t>(opts.window_s * opts.sampling_rate)),
+				  hop_(std::max<size_t>(1, static_cast<size_t>(opts.hop_s * opts.sampling_rate))),
+				  // Sample numbers ride along in the ring to map windows back to chunk arrival times
+				  ring_(opts.n_electrodes, std::max<size_t>(window_ * 8, static_cast<size_t>(opts.sampling_rate * 30)), &device),
+				  arrivals_(ring_.capacity() / opts.chunk_size + 2),
+				  ssvep_freqs_{8.0, 10.0, 12.0, 15.0},
+				  latencies_ms_(tracked_allocator<double>(&device, memory_category::logs))
+			{
+				for (size_t i = 0; i < opts.n_electrodes; ++i)
+				{
+					electrode_index_.push_back(device.channel_index(static_cast<ba_eeg_channel>(BA_EEG_CHANNEL_ID_ELECTRODE_MEASUREMENT + i)));
+				}
+				sample_number_index_ = device.channel_index(BA_EEG_CHANNEL_ID_SAMPLE_NUMBER);
+				channel_ptrs_.resize(opts.n_electrodes);
+				if (opts.n_viewers > 0)
+				{
+					feed_ = std::make_unique<plot_feed>(opts.n_electrodes, std::vector<size_t>{4, 16, 64, 256}, 4096, &device);
+				}
+				device.set_callback_chunk(&chain::on_chunk, this);
+
+				if (opts.latency_target_ms > 0)
+				{
+					// Latencies are wall time, so the controller sees the accelerated rate
+					chunk_controller_config cc;
+					cc.sampling_rate = opts.sampling_rate * opts.acceleration;
+					cc.latency_target_ms = opts.latency_target_ms;
+					cc.max_chunk = window_;
+					cc.initial_chunk = hop_;
+					controller_ = std::make_unique<chunk_controller>(cc);
+				}
+			}
+
+			~chain() { stop(); }
+
+			void start()
+			{
+				running_.store(true);
+				consumer_ = std::thread(&chain::consume, this);
+				for (size_t v = 0; v < opts_.n_viewers; ++v)
+				{
+					viewers_.emplace_back(&chain::view, this, v);
+				}
+			}
+
+			void stop()
+			{
+				running_.store(false);
+				if (consumer_.joinable())
+				{
+					consumer_.join();
+				}
+				for (std::thread& t : viewers_)
+				{
+					t.join();
+				}
+				viewers_.clear();
+			}
+
+			void fill(soak_sample& s)
+			{
+				s.ring_depth = ring_.available();
+				s.ring_depth_max = depth_max_.exchange(0);
+				s.dropped = ring_.dropped();
+				s.windows = windows_.load();
+				s.plot_frames = plot_frames_.exchange(0);
+
+				std::vector<double> lat;
+				{
+					std::lock_guard<std::mutex> lock(latency_mutex_);
+					lat.assign(latencies_ms_.begin(), latencies_ms_.end());
+					latencies_ms_.clear();
+				}
+				std::sort(lat.begin(), lat.end());
+				s.latency_count = lat.size();
+				s.latency_p50_ms = percentile(lat, 0.50);
+				s.latency_p95_ms = percentile(lat, 0.95);
+				s.latency_p99_ms = percentile(lat, 0.99);
+				s.latency_max_ms = lat.empty() ? 0 : lat.back();
+
+				if (controller_)
+				{
+					s.adaptive = true;
+					s.chunk = controller_->metrics();
+				}
+			}
+
+			size_t ring_capacity() const { return ring_.capacity(); }
+
+			const chunk_controller* controller() const { return controller_.get(); }
+
+		private:
+			static void on_chunk(const void* const* data, size_t size, void* user_data)
+			{
+				static_cast<chain*>(user_data)->push(data, size);
+			}
+
+			void push(const void* const* data, size_t size)
+			{
+				const int64_t start = controller_ ? now_ns() : 0;
+				const size_t* sn = static_cast<const size_t*>(data[sample_number_index_]);
+				for (size_t i = 0; i < opts_.n_electrodes; ++i)
+				{
+					channel_ptrs_[i] = static_cast<const double*>(data[electrode_index_[i]]);
+				}
+				// Stamped before the samples are published, so a window completed
+				// from this chunk never reads an earlier lap's arrival
+				arrivals_[(sn[0] / opts_.chunk_size) % arrivals_.size()].store(now_ns(), std::memory_order_release);
+				ring_.write(channel_ptrs_.data(), size, sn);
+				if (feed_)
+				{
+					feed_->push(channel_ptrs_.data(), size);
+				}
+				if (controller_)
+				{
+					controller_->record_callback(static_cast<double>(now_ns() - start));
+				}
+			}
+
+			void consume()
+			{
+				const size_t n_chans = opts_.n_electrodes;
+				std::vector<double> raw(n_chans * window_);
+				std::vector<double> filtered(n_chans * window_);
+				std::vector<double> quality(n_chans);
+
+				while (running_.load())
+				{
+					const size_t depth = ring_.available();
+					size_t prev = depth_max_.load(std::memory_order_relaxed);
+					while (depth > prev && !depth_max_.compare_exchange_weak(prev, depth))
+					{
+					}
+
+					// The controller's hop can exceed the window; wait for both so
+					// the skip below always advances
+					const size_t hop = controller_ ? controller_->chunk_size() : hop_;
+					if (depth < std::max(window_, hop))
+					{
+						std::this_thread::sleep_for(std::chrono::milliseconds(1));
+						continue;
+					}
+
+					const int64_t start = now_ns();
+					uint64_t last = 0;
+					ring_.peek(raw.data(), window_);
+					ring_.peek_sample_numbers(&last, 1, window_ - 1);
+					if (!ring_.skip(hop))
+					{
+						continue;
+					}
+
+					ba_bci_connect_detrend(raw.data(), n_chans, window_, filtered.data());
+					ba_bci_connect_filter_notch(filtered.data(), n_chans, window_, opts_.sampling_rate, 50, 4);
+					ba_bci_connect_filter_bandpass(filtered.data(), n_chans, window_, opts_.sampling_rate, 1, 40);
+					ba_bci_connect_get_signal_quality(raw.data(), n_chans, window_, opts_.sampling_rate, quality.data());
+					double score = 0;
+					ba_bci_connect_ssvep_classify(filtered.data(), window_, n_chans, opts_.sampling_rate, ssvep_freqs_.data(), ssvep_freqs_.size(), &score);
+
+					// Latency from arrival of the chunk holding the window's last sample
+					const int64_t arrived = arrivals_[(last / opts_.chunk_size) % arrivals_.size()].load(std::memory_order_acquire);
+					const int64_t done = now_ns();
+					{
+						std::lock_guard<std::mutex> lock(latency_mutex_);
+						latencies_ms_.push_back(static_cast<double>(done - arrived) * 1e-6);
+					}
+					if (controller_)
+					{
+						// Queueing: the window was complete once its last chunk arrived
+						controller_->record_block(hop, static_cast<double>(done - start), static_cast<double>(std::max<int64_t>(0, start - arrived)));
+						controller_->update();
+					}
+					windows_.fetch_add(1, std::memory_order_relaxed);
+				}
+			}
+
+			/**
+			 * A monitor: redraws every channel of one time span at 30 frames
+			 * per wall second.
+			 */
+			void view(size_t index)
+			{
+				const double spans_s[] = {5, 30, 120, 600};
+				constexpr size_t pixels = 1000;
+				const uint64_t samples = static_cast<uint64_t>(spans_s[index % 4] * opts_.sampling_rate);
+				std::vector<plot_bin> columns(pixels);
+				while (running_.load())
+				{
+					volatile float sink = 0;
+					for (size_t c = 0; c < feed_->n_chans(); ++c)
+					{
+						if (feed_->draw(c, samples, pixels, columns.data()) > 0)
+						{
+							sink = columns[0].max;
+						}
+					}
+					(void)sink;
+					plot_frames_.fetch_add(1, std::memory_order_relaxed);
+					std::this_thread::sleep_for(std::chrono::milliseconds(33));
+				}
+			}
+
+			const soak_options& opts_;
+			size_t window_;
+			size_t hop_;
+			stream_ring ring_;
+			std::vector<std::atomic<int64_t>> arrivals_; ///< Arrival time per chunk slot
+
+			// Producer-side scratch, used only inside the chunk callback
+			std::vector<size_t> electrode_index_;
+			size_t sample_number_index_ = 0;
+			std::vector<const double*> channel_ptrs_;
+
+			std::vector<double> ssvep_freqs_;
+			std::atomic<bool> running_{false};
+			std::atomic<size_t> depth_max_{0};
+			std::atomic<uint64_t> windows_{0};
+			std::mutex latency_mutex_;
+			tracked_vector<double> latencies_ms_; ///< Latency log since the last sample
+			std::unique_ptr<chunk_controller> controller_; ///< Chooses the hop in adaptive mode
+			std::unique_ptr<plot_feed> feed_;               ///< Decimated views for the viewers
+			std::atomic<uint64_t> plot_frames_{0};
+			std::thread consumer_;
+			std::vector<std::thread> viewers_;
+		};
+
+		struct trend
+		{
+			linear_fit fit;
+			double start = 0; ///< Fitted value at the first post-warmup sample
+			double end = 0;   ///< Fitted value at the last sample
+			bool flagged = false;
+		};
+
+		/**
+		 * Fits `value` against stream hours over the post-warmup samples.
+		 */
+		template <typename F>
+		trend fit_trend(const std::vector<soak_sample>& samples, size_t first, F value)
+		{
+			std::vector<double> x;
+			std::vector<double> y;
+			for (size_t i = first; i < samples.size(); ++i)
+			{
+				x.push_back(samples[i].stream_s / 3600.0);
+				y.push_back(value(samples[i]));
+			}
+			trend t;
+			t.fit = fit_line(x, y);
+			if (!x.empty())
+			{
+				t.start = t.fit.intercept + t.fit.slope * x.front();
+				t.end = t.fit.intercept + t.fit.slope * x.back();
+			}
+			return t;
+		}
+
+		void write_trend(json_writer& w, const std::string& name, const trend& t, const char* unit)
+		{
+			w.key(name).begin_object();
+			w.member(std::string("slope_") + unit + "_per_hour", t.fit.slope);
+			w.member("r2", t.fit.r2);
+			w.member("fitted_start", t.start);
+			w.member("fitted_end", t.end);
+			w.member("flagged", t.flagged);
+			w.end_object();
+		}
+
+		void write_report(std::ostream& out, const soak_options& opts, const std::vector<soak_sample>& samples, const trend& rss,
+						  const trend& heap, const trend& latency, const trend& depth, const std::vector<std::string>& flags)
+		{
+			json_writer w(out);
+			w.begin_object();
+			w.key("config").begin_object();
+			w.member("duration_s", opts.duration_s);
+			w.member("acceleration", opts.acceleration);
+			w.member("sample_interval_s", opts.sample_interval_s);
+			w.member("sampling_rate", opts.sampling_rate);
+			w.member("n_electrodes", static_cast<uint64_t>(opts.n_electrodes));
+			w.member("chunk_size", static_cast<uint64_t>(opts.chunk_size));
+			w.member("window_s", opts.window_s);
+			w.member("hop_s", opts.hop_s);
+			if (opts.latency_target_ms > 0)
+			{
+				w.member("latency_target_ms", opts.latency_target_ms);
+			}
+			if (opts.n_viewers > 0)
+			{
+				w.member("n_viewers", static_cast<uint64_t>(opts.n_viewers));
+			}
+			w.end_object();
+
+			w.key("samples").begin_array();
+			for (const soak_sample& s : samples)
+			{
+				w.begin_object();
+				w.member("wall_s", s.wall_s);
+				w.member("stream_s", s.stream_s);
+				if (s.memory.rss_valid)
+				{
+					w.member("rss_bytes", static_cast<uint64_t>(s.memory.rss_bytes));
+				}
+				if (s.memory.heap_valid)
+				{
+					w.member("heap_in_use_bytes", static_cast<uint64_t>(s.memory.heap_in_use_bytes));
+					w.member("heap_free_bytes", static_cast<uint64_t>(s.memory.heap_free_bytes));
+					w.member("heap_mapped_bytes", static_cast<uint64_t>(s.memory.heap_mapped_bytes));
+				}
+				w.member("tracked_bytes", static_cast<uint64_t>(s.tracked_bytes));
+				w.member("ring_depth", static_cast<uint64_t>(s.ring_depth));
+				w.member("ring_depth_max", static_cast<uint64_t>(s.ring_depth_max));
+				w.member("dropped_samples", s.dropped);
+				w.member("windows", s.windows);
+				if (opts.n_viewers > 0)
+				{
+					w.member("plot_frames", s.plot_frames);
+				}
+				w.member("latency_count", static_cast<uint64_t>(s.latency_count));
+				w.member("latency_p50_ms", s.latency_p50_ms);
+				w.member("latency_p95_ms", s.latency_p95_ms);
+				w.member("latency_p99_ms", s.latency_p99_ms);
+				w.member("latency_max_ms", s.latency_max_ms);
+				if (s.adaptive)
+				{
+					w.key("chunk_controller");
+					write_chunk_metrics(w, s.chunk);
+				}
+				w.end_object();
+			}
+			w.end_array();
+
+			w.key("trends").begin_object();
+			write_trend(w, "rss_mb", rss, "mb");
+			write_trend(w, "heap_in_use_mb", heap, "mb");
+			write_trend(w, "latency_p99_ms", latency, "ms");
+			write_trend(w, "ring_depth", depth, "samples");
+			w.end_object();
+
+			w.key("memory_accounting");
+			write_memory_report(w);
+
+			w.key("flags").begin_array();
+			for (const std::string& f : flags)
+			{
+				w.value(f);
+			}
+			w.end_array();
+			w.end_object();
+			out << std::endl;
+		}
+
+		bool parse_duration(const std::string& s, double& seconds)
+		{
+			char* end = nullptr;
+			const double v = std::strtod(s.c_str(), &end);
+			if (end == s.c_str() || v < 0)
+			{
+				return false;
+			}
+			const std::string unit(end);
+			if (unit.empty() || unit == "s")
+			{
+				seconds = v;
+			}
+			else if (unit == "m")
+			{
+				seconds = v * 60;
+			}
+			else if (unit == "h")
+			{
+				seconds = v * 3600;
+			}
+			else
+			{
+				return false;
+			}
+			return true;
+		}
+
+		void print_usage()
+		{
+			std::cerr << "Usage: eeg_app soak [options]\n"
+					  << "  --duration <t>      stream time to cover, e.g. 4h, 90m, 600s (default 4h)\n"
+					  << "  --accel <x>         stream seconds per wall second (default 20)\n"
+					  << "  --interval <t>      stream time between samples (default 60s)\n"
+					  << "  --channels <n>      electrode channels (default 8)\n"
+					  << "  --rate <hz>         sampling rate (default 250)\n"
+					  << "  --chunk <n>         chunk size (default 25)\n"
+					  << "  --window <t>        processing window (default 2s)\n"
+					  << "  --hop <t>           processing hop (default 0.5s)\n"
+					  << "  --rss-limit <mb/h>  flag RSS or heap growth above this (default 1)\n"
+					  << "  --latency-limit <%> flag p99 latency growth above this (default 25)\n"
+					  << "  --latency-target <ms> adapt the hop to this wall-time latency target (default off)\n"
+					  << "  --viewers <n>       plot threads drawing decimated views of the stream (default 0)\n"
+					  << "  --json <path>       report path (default soak_report.json)\n";
+		}
+	} // namespace
+
+	int run_soak(const soak_options& opts)
+	{
+		if (opts.acceleration <= 0 || opts.sample_interval_s <= 0 || opts.window_s <= 0 || opts.n_electrodes == 0 || opts.chunk_size == 0)
+		{
+			std::cerr << "Invalid soak options" << std::endl;
+			return 1;
+		}
+
+		simulated_device_config dc;
+		dc.sampling_rate = opts.sampling_rate;
+		dc.n_electrodes = opts.n_electrodes;
+		dc.chunk_size = opts.chunk_size;
+		dc.acceleration = opts.acceleration;
+		simulated_device device(dc);
+		chain ch(opts, device);
+
+		std::cout << "Soak test: " << opts.duration_s / 3600.0 << " h of stream at " << opts.acceleration << "x ("
+				  << opts.duration_s / opts.acceleration / 60.0 << " min wall)" << std::endl;
+
+		std::vector<soak_sample> samples;
+		const auto wall_start = clock::now();
+		ch.start();
+		device.start_stream();
+
+		for (size_t k = 1;; ++k)
+		{
+			const double stream_s = std::min(opts.duration_s, static_cast<double>(k) * opts.sample_interval_s);
+			std::this_thread::sleep_until(device.scheduled_time(static_cast<uint64_t>(stream_s * opts.sampling_rate)));
+
+			soak_sample s;
+			s.wall_s = std::chrono::duration<double>(clock::now() - wall_start).count();
+			s.stream_s = static_cast<double>(device.samples_emitted()) / opts.sampling_rate;
+			s.memory = sample_process_memory();
+			for (size_t c = 0; c < memory_category_count; ++c)
+			{
+				s.tracked_bytes += memory_query_total(static_cast<memory_category>(c)).current_bytes;
+			}
+			ch.fill(s);
+			samples.push_back(s);
+
+			std::cout << std::fixed << std::setprecision(1) << "[" << s.stream_s / 60.0 << " min] rss " << s.memory.rss_bytes / mib << " MiB, heap "
+					  << s.memory.heap_in_use_bytes / mib << " MiB, depth " << s.ring_depth << ", p99 " << std::setprecision(2) << s.latency_p99_ms
+					  << " ms, dropped " << s.dropped;
+			if (s.adaptive)
+			{
+				std::cout << ", hop " << s.chunk.chunk_size << " (" << s.chunk.rationale << ")";
+			}
+			std::cout << std::endl;
+
+			if (stream_s >= opts.duration_s)
+			{
+				break;
+			}
+		}
+
+		device.stop_stream();
+		ch.stop();
+		if (ch.controller())
+		{
+			const chunk_controller_metrics m = ch.controller()->metrics();
+			std::cout << "Adaptive hop settled at " << m.chunk_size << " samples after " << m.adjustments << " adjustments: " << m.rationale
+					  << std::endl;
+		}
+
+		const size_t first = std::min(samples.size() - 1, static_cast<size_t>(opts.warmup_fraction * static_cast<double>(samples.size())));
+		trend rss = fit_trend(samples, first, [](const soak_sample& s) { return s.memory.rss_bytes / mib; });
+		trend heap = fit_trend(samples, first, [](const soak_sample& s) { return s.memory.heap_in_use_bytes / mib; });
+		trend latency = fit_trend(samples, first, [](const soak_sample& s) { return s.latency_p99_ms; });
+		trend depth = fit_trend(samples, first, [](const soak_sample& s) { return static_cast<double>(s.ring_depth); });
+
+		std::vector<std::string> flags;
+		rss.flagged = samples.front().memory.rss_valid && rss.fit.slope > opts.rss_limit_mb_per_hour;
+		heap.flagged = samples.front().memory.heap_valid && heap.fit.slope > opts.rss_limit_mb_per_hour;
+		latency.flagged = latency.start > 0 && latency.fit.r2 >= opts.latency_min_r2 &&
+						  (latency.end - latency.start) / latency.start * 100 > opts.latency_limit_pct;
+		// A ring that keeps filling means the consumer is falling behind
+		depth.flagged = depth.fit.slope > 0 && samples.back().ring_depth > ch.ring_capacity() / 2;
+		if (rss.flagged)
+		{
+			flags.push_back("rss_growth");
+		}
+		if (heap.flagged)
+		{
+			flags.push_back("heap_growth");
+		}
+		if (latency.flagged)
+		{
+			flags.push_back("latency_drift");
+		}
+		if (depth.flagged)
+		{
+			flags.push_back("queue_backlog");
+		}
+		if (samples.back().dropped > 0)
+		{
+			flags.push_back("dropped_samples");
+		}
+
+		std::ofstream out(opts.json_path);
+		if (!out)
+		{
+			std::cerr << "Failed to open " << opts.json_path << std::endl;
+			return 1;
+		}
+		write_report(out, opts, samples, rss, heap, latency, depth, flags);
+
+		std::cout << "Report written to " << opts.json_path << std::endl;
+		for (const std::string& f : flags)
+		{
+			std::cout << "FLAGGED: " << f << std::endl;
+		}
+		return flags.empty() ? 0 : 3;
+	}
+
+	int soak_main(int argc, char** argv)
+	{
+		soak_options opts;
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string arg = argv[i];
+			if (i + 1 >= argc)
+			{
+				print_usage();
+				return arg == "--help" ? 0 : 1;
+			}
+			const std::string value = argv[++i];
+			bool ok = true;
+			if (arg == "--duration")
+			{
+				ok = parse_duration(value, opts.duration_s);
+			}
+			else if (arg == "--interval")
+			{
+				ok = parse_duration(value, opts.sample_interval_s);
+			}
+			else if (arg == "--window")
+			{
+				ok = parse_duration(value, opts.window_s);
+			}
+			else if (arg == "--hop")
+			{
+				ok = parse_duration(value, opts.hop_s);
+			}
+			else if (arg == "--accel")
+			{
+				opts.acceleration = std::atof(value.c_str());
+			}
+			else if (arg == "--channels")
+			{
+				opts.n_electrodes = std::strtoul(value.c_str(), nullptr, 10);
+			}
+			else if (arg == "--rate")
+			{
+				opts.sampling_rate = std::atof(value.c_str());
+			}
+			else if (arg == "--chunk")
+			{
+				opts.chunk_size = std::strtoul(value.c_str(), nullptr, 10);
+			}
+			else if (arg == "--rss-limit")
+			{
+				opts.rss_limit_mb_per_hour = std::atof(value.c_str());
+			}
+			else if (arg == "--latency-limit")
+			{
+				opts.latency_limit_pct = std::atof(value.c_str());
+			}
+			else if (arg == "--latency-target")
+			{
+				opts.latency_target_ms = std::atof(value.c_str());
+			}
+			else if (arg == "--viewers")
+			{
+				opts.n_viewers = std::strtoul(value.c_str(), nullptr, 10);
+			}
+			else if (arg == "--json")
+			{
+				opts.json_path = value;
+			}
+			else
+			{
+				ok = false;
+			}
+			if (!ok)
+			{
+				print_usage();
+				return 1;
+			}
+		}
+		return run_soak(opts);
+	}
+} // namespace eeg
@@ -0,0 +1,58 @@
+/**
+ * @file soak.h
+ * @brief Long-running soak test of the streaming and processing chain
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace eeg
+{
+	struct soak_options
+	{
+		double duration_s = 4 * 3600;  ///< Stream time to cover
+		double acceleration = 20;      ///< Stream seconds per wall second
+		double sample_interval_s = 60; ///< Stream time between metric samples
+		double sampling_rate = 250;
+		size_t n_electrodes = 8;
+		size_t chunk_size = 25;
+		double window_s = 2; ///< Processing window length
+		double hop_s = 0.5;  ///< Processing hop between windows
+		double warmup_fraction = 0.1; ///< Leading share of samples excluded from trends
+		double rss_limit_mb_per_hour = 1; ///< RSS/heap growth flagged above this
+		double latency_limit_pct = 25;    ///< p99 latency growth over the run flagged above this
+		double latency_min_r2 = 0.3;      ///< Latency fits noisier than this are not called a trend
+		double latency_target_ms = 0;     ///< When > 0 the hop is chosen by a `chunk_controller` against this wall-time target
+		size_t n_viewers = 0;             ///< Plot threads reading a `plot_feed` of the stream, 0 for none
+		std::string json_path = "soak_report.json";
+	};
+
+	/**
+	 * @brief Runs the soak test and writes a JSON report
+	 *
+	 * @details A simulated device streams at `acceleration` times real time
+	 * into a `stream_ring`; a processing thread runs the full chain on every
+	 * window (detrend, notch, bandpass, signal quality, SSVEP classification).
+	 * Every `sample_interval_s` of stream time RSS, heap statistics, ring
+	 * depth, dropped samples and chunk-to-decision latency percentiles are
+	 * recorded. Linear trends over the post-warmup samples are then checked
+	 * against the limits.
+	 *
+	 * With `latency_target_ms` set, the processing hop adapts to the target
+	 * and the controller's decision and rationale are part of each sample.
+	 *
+	 * With `n_viewers` set, the chunk callback also feeds a `plot_feed` and
+	 * that many threads redraw it at 30 frames per wall second over spans
+	 * from 5 seconds to 10 minutes, as monitors showing the stream would.
+	 *
+	 * @return 0 when no trend is flagged, 3 when one is, 1 on setup errors
+	 */
+	int run_soak(const soak_options& opts);
+
+	/**
+	 * @brief Command line entry for `eeg_app soak [options]`
+	 */
+	int soak_main(int argc, char** argv);
+} // namespace eeg
@@ -0,0 +1,301 @@
+#include "app/triggers_app.h"
+
+#include "stream/adc_counts.h"
+#include "stream/annotation_store.h"
+#include "stream/recording.h"
+#include "stream/simulated_device.h"
+#include "stream/trigger_detector.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace eeg
+{
+	namespace
+	{
+		struct triggers_options
+		{
+			std::string input_path;  ///< Recorded mode when set
+			bool write = false;      ///< Append annotations to `input_path`
+			std::string record_path; ///< Streaming mode: record the stream here
+			bool packed = false;     ///< Record digital channels one bit per sample
+			int gain = 0;            ///< Streaming: electrode gain multiplier; records ADC counts when set
+			double duration_s = 60;
+			double acceleration = 10; ///< 0 for unpaced
+			double sampling_rate = 250;
+			size_t n_electrodes = 8;
+			size_t trigger_period = 250;
+			size_t show = 10; ///< Events printed
+		};
+
+		/**
+		 * Detects edges and optionally records chunks, from the chunk callback.
+		 */
+		struct trigger_feed
+		{
+			trigger_detector* detector = nullptr;
+			recording_writer* recorder = nullptr;
+			size_t sample_number_index = 0;
+			std::vector<size_t> electrode_index;
+			std::vector<size_t> digital_index;
+			std::vector<std::string> digital_labels;
+			std::vector<double> block;
+			std::vector<const bool*> digital;
+
+			static void on_chunk(const void* const* data, size_t size, void* user_data)
+			{
+				trigger_feed& f = *static_cast<trigger_feed*>(user_data);
+				f.detector->process_chunk(data, size, f.sample_number_index);
+				if (!f.recorder)
+				{
+					return;
+				}
+				const size_t* sample_numbers = static_cast<const size_t*>(data[f.sample_number_index]);
+				const uint64_t first = sample_numbers[0];
+				f.block.resize(f.electrode_index.size() * size);
+				for (size_t c = 0; c < f.electrode_index.size(); ++c)
+				{
+					const double* src = static_cast<const double*>(data[f.electrode_index[c]]);
+					std::copy(src, src + size, f.block.begin() + static_cast<std::ptrdiff_t>(c * size));
+				}
+				f.recorder->write_block(f.block.data(), size, sample_numbers);
+				for (size_t c = 0; c < f.digital_index.size(); ++c)
+				{
+					f.digital[c] = static_cast<const bool*>(data[f.digital_index[c]]);
+				}
+				f.recorder->write_digital(f.digital.data(), f.digital_labels, size, first);
+			}
+		};
+
+		void print_usage()
+		{
+			std::cerr << "Usage: eeg_app triggers [options]\n"
+					  << "  --input <path>      scan a recording instead of streaming\n"
+					  << "  --write             append the edges to the --input recording as annotations\n"
+					  << "  --record <path>     streaming: record samples, digital channels and edges\n"
+					  << "  --packed            streaming: record digital channels one bit per sample\n"
+					  << "  --gain <x>          streaming: electrode gain (4, 6, 8, 12); record int32 ADC counts\n"
+					  << "  --duration <s>      streaming: seconds of stream (default 60)\n"
+					  << "  --accel <x>         streaming: stream seconds per wall second, 0 for unpaced (default 10)\n"
+					  << "  --rate <hz>         streaming: sampling rate (default 250)\n"
+					  << "  --electrodes <n>    streaming: electrode count (default 8)\n"
+					  << "  --period <samples>  streaming: samples between trigger pulses (default 250)\n"
+					  << "  --show <n>          events to print (default 10)\n";
+		}
+
+		bool parse(int argc, char** argv, triggers_options& opts)
+		{
+			for (int i = 1; i < argc; ++i)
+			{
+				const std::string arg = argv[i];
+				if (arg == "--write")
+				{
+					opts.write = true;
+					continue;
+				}
+				if (arg == "--packed")
+				{
+					opts.packed = true;
+					continue;
+				}
+				if (i + 1 >= argc)
+				{
+					return false;
+				}
+				const std::string value = argv[++i];
+				if (arg == "--input")
+				{
+					opts.input_path = value;
+				}
+				else if (arg == "--record")
+				{
+					opts.record_path = value;
+				}
+				else if (arg == "--gain")
+				{
+					opts.gain = std::atoi(value.c_str());
+				}
+				else if (arg == "--duration")
+				{
+					opts.duration_s = std::atof(value.c_str());
+				}
+				else if (arg == "--accel")
+				{
+					opts.acceleration = std::atof(value.c_str());
+				}
+				else if (arg == "--rate")
+				{
+					opts.sampling_rate = std::atof(value.c_str());
+				}
+				else if (arg == "--electrodes")
+				{
+					opts.n_electrodes = static_cast<size_t>(std::atoi(value.c_str()));
+				}
+				else if (arg == "--period")
+				{
+					opts.trigger_period = static_cast<size_t>(std::atoi(value.c_str()));
+				}
+				else if (arg == "--show")
+				{
+					opts.show = static_cast<size_t>(std::atoi(value.c_str()));
+				}
+				else
+				{
+					return false;
+				}
+			}
+			return opts.duration_s > 0 && opts.acceleration >= 0 && opts.sampling_rate > 0 && opts.n_electrodes > 0 &&
+				   (!opts.write || !opts.input_path.empty()) && (!opts.packed || !opts.record_path.empty()) &&
+				   (opts.gain == 0 || ba_multiplier_to_gain_mode(opts.gain) != BA_GAIN_MODE_UNKNOWN);
+		}
+
+		void print_events(const annotation_store& store, const trigger_detector& detector, size_t show)
+		{
+			std::cout << detector.edges() << " edges on " << detector.labels().size() << " channels" << std::endl;
+			const std::vector<stream_annotation> events = store.all();
+			for (size_t i = 0; i < events.size() && i < show; ++i)
+			{
+				std::cout << "  " << events[i].sample << "  " << events[i].text << std::endl;
+			}
+			if (events.size() > show)
+			{
+				std::cout << "  ... " << events.size() - show << " more" << std::endl;
+			}
+		}
+
+		int run_recorded(const triggers_options& opts)
+		{
+			annotation_store store;
+			trigger_detector detector(store);
+			std::string error;
+			const auto t0 = std::chrono::steady_clock::now();
+			if (!extract_recording_triggers(opts.input_path, detector, &error))
+			{
+				std::cerr << error << std::endl;
+				return 1;
+			}
+			const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+			std::cout << opts.input_path << ": scanned in " << ms << " ms, ";
+			print_events(store, detector, opts.show);
+
+			if (opts.write)
+			{
+				recording_writer writer;
+				if (!writer.append(opts.input_path, &error))
+				{
+					std::cerr << error << std::endl;
+					return 1;
+				}
+				for (const stream_annotation& a : store.all())
+				{
+					writer.write_annotation(a.sample, a.text);
+				}
+				if (!writer.flush())
+				{
+					std::cerr << opts.input_path << ": write failed" << std::endl;
+					return 1;
+				}
+				std::cout << "Appended " << store.size() << " annotations to " << opts.input_path << std::endl;
+			}
+			return 0;
+		}
+
+		int run_streaming(const triggers_options& opts)
+		{
+			simulated_device_config dc;
+			dc.sampling_rate = opts.sampling_rate;
+			dc.n_electrodes = opts.n_electrodes;
+			dc.acceleration = opts.acceleration;
+			dc.trigger_period = opts.trigger_period;
+			dc.gain = opts.gain > 0 ? ba_multiplier_to_gain_mode(opts.gain) : BA_GAIN_MODE_UNKNOWN;
+			simulated_device device(dc);
+
+			annotation_store store;
+			trigger_detector detector(store);
+			trigger_feed feed;
+			feed.detector = &detector;
+			feed.sample_number_index = device.channel_index(BA_EEG_CHANNEL_ID_SAMPLE_NUMBER);
+			feed.digital_index.push_back(device.channel_index(BA_EEG_CHANNEL_ID_DIGITAL_INPUT));
+			feed.digital_labels.push_back("DI");
+			for (size_t i = 0; i < opts.n_electrodes; ++i)
+			{
+				feed.electrode_index.push_back(device.channel_index(static_cast<ba_eeg_channel>(BA_EEG_CHANNEL_ID_ELECTRODE_MEASUREMENT + i)));
+				feed.digital_index.push_back(device.channel_index(static_cast<ba_eeg_channel>(BA_EEG_CHANNEL_ID_ELECTRODE_CONTACT + i)));
+				feed.digital_labels.push_back("contact " + std::to_string(i + 1));
+			}
+			for (size_t c = 0; c < feed.digital_index.size(); ++c)
+			{
+				detector.add_channel(feed.digital_index[c], feed.digital_labels[c]);
+			}
+			feed.digital.resize(feed.digital_index.size());
+
+			recording_writer recorder;
+			if (!opts.record_path.empty())
+			{
+				recording_header header;
+				header.n_chans = opts.n_electrodes;
+				header.sampling_rate = opts.sampling_rate;
+				if (!recorder.open(opts.record_path, header))
+				{
+					std::cerr << "Failed to open " << opts.record_path << std::endl;
+					return 1;
+				}
+				recorder.set_pack_digital(opts.packed);
+				if (opts.gain > 0)
+				{
+					recorder.set_counts(std::vector<double>(opts.n_electrodes, adc_microvolts_per_count(dc.gain)));
+				}
+				feed.recorder = &recorder;
+			}
+			device.set_callback_chunk(&trigger_feed::on_chunk, &feed);
+
+			const uint64_t total = static_cast<uint64_t>(opts.duration_s * opts.sampling_rate);
+			if (opts.acceleration > 0)
+			{
+				device.start_stream();
+				std::this_thread::sleep_until(device.scheduled_time(total));
+				device.stop_stream();
+			}
+			else
+			{
+				while (device.samples_emitted() < total)
+				{
+					device.emit_chunk();
+				}
+			}
+
+			std::cout << "Streamed " << device.samples_emitted() << " samples, ";
+			print_events(store, detector, opts.show);
+			if (recorder.is_open())
+			{
+				for (const stream_annotation& a : store.all())
+				{
+					recorder.write_annotation(a.sample, a.text);
+				}
+				recorder.close();
+				std::cout << "Recorded to " << opts.record_path << std::endl;
+				if (recorder.float_fallbacks() > 0)
+				{
+					std::cout << recorder.float_fallbacks() << " blocks were off the ADC count grid and stored as float64" << std::endl;
+				}
+			}
+			return 0;
+		}
+	} // namespace
+
+	int triggers_main(int argc, char** argv)
+	{
+		triggers_options opts;
+		if (!parse(argc, argv, opts))
+		{
+			print_usage();
+			return 1;
+		}
+		return opts.input_path.empty() ? run_streaming(opts) : run_recorded(opts);
+	}
+} // namespace eeg
@@ -0,0 +1,23 @@
+/**
+ * @file triggers_app.h
+ * @brief Extracts digital-input and contact edges into annotations
+ */
+
+#pragma once
+
+namespace eeg
+{
+	/**
+	 * @brief Command line entry for `eeg_app triggers [options]`
+	 *
+	 * @details Without `--input`, streams a simulated device with periodic
+	 * digital-input pulses, turns edges on the digital input and contact
+	 * channels into annotations as chunks arrive and optionally records the
+	 * stream, edges included, with `--record`. With `--input`, runs the same
+	 * detector over the digital records of a recording; `--write` appends
+	 * the resulting annotations to it.
+	 *
+	 * @return 0 on success, 1 on errors
+	 */
+	int triggers_main(int argc, char** argv);
+} // namespace eeg
@@ -0,0 +1,202 @@
+#include "bci/ar_spectrum.h"
+
+#include "restrict.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace eeg
+{
+	namespace
+	{
+		constexpr double two_pi = 6.283185307179586;
+	} // namespace
+
+	bool ar_spectrum::init(size_t n_chans, double sampling_rate, const std::vector<double>& frequencies, size_t order, std::string* error)
+	{
+		const bool in_range = std::all_of(frequencies.begin(), frequencies.end(), [sampling_rate](double f) { return f >= 0 && f <= sampling_rate / 2; });
+		if (n_chans == 0 || sampling_rate <= 0 || order == 0 || frequencies.empty() || !in_range)
+		{
+			if (error)
+			{
+				*error = "AR spectrum needs an order of 1 or more and frequencies from 0 to half the sampling rate";
+			}
+			return false;
+		}
+		n_chans_ = n_chans;
+		order_ = order;
+		sampling_rate_ = sampling_rate;
+		frequencies_ = frequencies;
+		cos_.resize(frequencies.size() * order);
+		sin_.resize(frequencies.size() * order);
+		for (size_t f = 0; f < frequencies.size(); ++f)
+		{
+			const double w = two_pi * frequencies[f] / sampling_rate;
+			for (size_t lag = 1; lag <= order; ++lag)
+			{
+				cos_[f * order + lag - 1] = std::cos(w * static_cast<double>(lag));
+				sin_[f * order + lag - 1] = std::sin(w * static_cast<double>(lag));
+			}
+		}
+		a_.assign((order + 1) * n_chans, 0.0);
+		std::fill(a_.begin(), a_.begin() + static_cast<std::ptrdiff_t>(n_chans), 1.0);
+		previous_.resize(a_.size());
+		noise_.assign(n_chans, 0.0);
+		num_.resize(n_chans);
+		den_.resize(n_chans);
+		k_.resize(n_chans);
+		return true;
+	}
+
+	bool ar_spectrum::fit(const double* x, size_t n_samples)
+	{
+		const size_t C = n_chans_;
+		const size_t p = order_;
+		if (n_samples <= p)
+		{
+			return false;
+		}
+		if (forward_.size() < n_samples * C)
+		{
+			forward_.resize(n_samples * C);
+			backward_.resize(n_samples * C);
+		}
+		double* restrict f = forward_.data();
+		double* restrict b = backward_.data();
+		double* restrict e = noise_.data();
+
+		// Demeaned, transposed to sample-major; the initial error power is
+		// the variance
+		for (size_t c = 0; c < C; ++c)
+		{
+			const double* xc = x + c * n_samples;
+			double mean = 0;
+			for (size_t t = 0; t < n_samples; ++t)
+			{
+				mean += xc[t];
+			}
+			mean /= static_cast<double>(n_samples);
+			double power = 0;
+			for (size_t t = 0; t < n_samples; ++t)
+			{
+				const double v = xc[t] - mean;
+				f[t * C + c] = v;
+				power += v * v;
+			}
+			e[c] = power / static_cast<double>(n_samples);
+		}
+		std::copy(f, f + n_samples * C, b);
+		std::fill(a_.begin(), a_.end(), 0.0);
+		std::fill(a_.begin(), a_.begin() + static_cast<std::ptrdiff_t>(C), 1.0);
+
+		double* restrict num = num_.data();
+		double* restrict den = den_.data();
+		double* restrict k = k_.data();
+		double* restrict a = a_.data();
+		double* restrict prev = previous_.data();
+		for (size_t m = 1; m <= p; ++m)
+		{
+			std::fill(num, num + C, 0.0);
+			std::fill(den, den + C, 0.0);
+			for (size_t t = m; t < n_samples; ++t)
+			{
+				const double* restrict ft = f + t * C;
+				const double* restrict bt = b + (t - 1) * C;
+				for (size_t c = 0; c < C; ++c)
+				{
+					num[c] += ft[c] * bt[c];
+					den[c] += ft[c] * ft[c] + bt[c] * bt[c];
+				}
+			}
+			for (size_t c = 0; c < C; ++c)
+			{
+				k[c] = den[c] > 0 ? -2 * num[c] / den[c] : 0.0;
+				e[c] *= 1 - k[c] * k[c];
+			}
+
+			// Levinson step: a_i += k a_(m - i), with a_m = k
+			std::copy(a, a + (m + 1) * C, prev);
+			for (size_t i = 1; i <= m; ++i)
+			{
+				double* restrict ai = a + i * C;
+				const double* restrict am = prev + (m - i) * C;
+				for (size_t c = 0; c < C; ++c)
+				{
+					ai[c] += k[c] * am[c];
+				}
+			}
+
+			// Backwards in time so b[t - 1] is still the previous order's
+			for (size_t t = n_samples - 1; t >= m; --t)
+			{
+				double* restrict ft = f + t * C;
+				double* restrict bt = b + t * C;
+				const double* restrict bp = b + (t - 1) * C;
+				for (size_t c = 0; c < C; ++c)
+				{
+					const double fo = ft[c];
+					ft[c] = fo + k[c] * bp[c];
+					bt[c] = bp[c] + k[c] * fo;
+				}
+			}
+		}
+		return true;
+	}
+
+	void ar_spectrum::evaluate(double* out) const
+	{
+		const size_t C = n_chans_;
+		const size_t p = order_;
+		const size_t n_freqs = frequencies_.size();
+		std::vector<double> re(C);
+		std::vector<double> im(C);
+		for (size_t fi = 0; fi < n_freqs; ++fi)
+		{
+			// A(w) = sum_i a_i exp(-j w i)
+			std::fill(re.begin(), re.end(), 1.0);
+			std::fill(im.begin(), im.end(), 0.0);
+			const double* restrict cs = &cos_[fi * p];
+			const double* restrict sn = &sin_[fi * p];
+			for (size_t i = 1; i <= p; ++i)
+			{
+				const double* restrict ai = &a_[i * C];
+				const double cr = cs[i - 1];
+				const double si = sn[i - 1];
+				for (size_t c = 0; c < C; ++c)
+				{
+					re[c] += ai[c] * cr;
+					im[c] -= ai[c] * si;
+				}
+			}
+			// One-sided: twice the two-sided density, except at 0 and Nyquist
+			const double f = frequencies_[fi];
+			const double sides = f > 0 && f < sampling_rate_ / 2 ? 2.0 : 1.0;
+			for (size_t c = 0; c < C; ++c)
+			{
+				const double gain = re[c] * re[c] + im[c] * im[c];
+				out[c * n_freqs + fi] = gain > 0 ? sides * noise_[c] / (sampling_rate_ * gain) : 0.0;
+			}
+		}
+	}
+
+	bool compute_ar_spectrum(const double* x, size_t n_chans, size_t n_samples, double sampling_rate, const std::vector<double>& frequencies,
+							 size_t order, std::vector<double>& out, std::string* error)
+	{
+		ar_spectrum ar;
+		if (!ar.init(n_chans, sampling_rate, frequencies, order, error))
+		{
+			return false;
+		}
+		if (!ar.fit(x, n_samples))
+		{
+			if (error)
+			{
+				*error = "AR spectrum needs more samples than its order (" + std::to_string(order) + ")";
+			}
+			return false;
+		}
+		out.resize(n_chans * frequencies.size());
+		ar.evaluate(out.data());
+		return true;
+	}
+} // namespace eeg
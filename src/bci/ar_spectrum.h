@@ -0,0 +1,99 @@
+/**
+ * @file ar_spectrum.h
+ * @brief Autoregressive (Burg) power spectra at chosen frequencies
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace eeg
+{
+	/**
+	 * @brief Burg autoregressive spectrum estimator for all channels of a
+	 * window at once
+	 *
+	 * @details An order-p AR model fitted by Burg's method resolves
+	 * spectral peaks far finer than the `sampling rate / window` bin
+	 * spacing of an FFT, so half-second windows can track an alpha peak to
+	 * a fraction of a hertz. `fit()` removes each channel's mean and runs
+	 * the Burg recursion with the prediction errors stored sample-major,
+	 * so every loop runs over channels innermost and all channels are
+	 * fitted together in vectorised passes. `evaluate()` computes the
+	 * model's spectrum only at the frequencies given to `init()`, from
+	 * cosine and sine tables built once, at a cost of channels x
+	 * frequencies x order instead of a dense grid.
+	 *
+	 * Buffers are sized by `init()` for the largest window seen, so
+	 * repeated fits on streaming windows do not allocate.
+	 */
+	class ar_spectrum
+	{
+	public:
+		/**
+		 * @param frequencies Hz, between 0 and half the sampling rate
+		 * @return false without frequencies, with a frequency out of range
+		 * or an order of 0
+		 */
+		bool init(size_t n_chans, double sampling_rate, const std::vector<double>& frequencies, size_t order, std::string* error = nullptr);
+
+		size_t n_chans() const { return n_chans_; }
+		size_t order() const { return order_; }
+		const std::vector<double>& frequencies() const { return frequencies_; }
+
+		/**
+		 * @brief Fits the model to a channel-major window (channel n at
+		 * `x[n * n_samples]`)
+		 *
+		 * @return false if the window is not longer than the order
+		 */
+		bool fit(const double* x, size_t n_samples);
+
+		/**
+		 * @brief Prediction-error filter of the latest fit, `order() + 1`
+		 * coefficients per channel starting with 1, coefficient-major
+		 * (coefficient i of channel n at `[i * n_chans + n]`)
+		 */
+		const std::vector<double>& coefficients() const { return a_; }
+
+		/**
+		 * @brief Prediction-error variance per channel of the latest fit
+		 */
+		const std::vector<double>& noise() const { return noise_; }
+
+		/**
+		 * @brief One-sided power spectral density of the latest fit, in
+		 * squared input units per Hz
+		 *
+		 * @param out `n_chans * frequencies().size()`, channel-major
+		 */
+		void evaluate(double* out) const;
+
+	private:
+		size_t n_chans_ = 0;
+		size_t order_ = 0;
+		double sampling_rate_ = 0;
+		std::vector<double> frequencies_;
+		std::vector<double> cos_; ///< `f * order + (lag - 1)`
+		std::vector<double> sin_;
+
+		std::vector<double> forward_;  ///< Prediction errors, sample-major
+		std::vector<double> backward_;
+		std::vector<double> a_;
+		std::vector<double> previous_;
+		std::vector<double> noise_;
+		std::vector<double> num_;
+		std::vector<double> den_;
+		std::vector<double> k_;
+	};
+
+	/**
+	 * @brief Burg spectra of a channel-major window at `frequencies`
+	 *
+	 * @param out Resized to `n_chans * frequencies.size()`, channel-major
+	 */
+	bool compute_ar_spectrum(const double* x, size_t n_chans, size_t n_samples, double sampling_rate, const std::vector<double>& frequencies,
+							 size_t order, std::vector<double>& out, std::string* error = nullptr);
+} // namespace eeg
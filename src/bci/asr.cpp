@@ -0,0 +1,419 @@
+#include "bci/asr.h"
+
+#include "restrict.h"
+#include "util/linalg.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace eeg
+{
+	namespace
+	{
+		constexpr double pi = 3.14159265358979323846;
+
+		double median(std::vector<double>& v)
+		{
+			const size_t mid = v.size() / 2;
+			std::nth_element(v.begin(), v.begin() + static_cast<std::ptrdiff_t>(mid), v.end());
+			const double upper = v[mid];
+			if (v.size() % 2 == 1)
+			{
+				return upper;
+			}
+			return (*std::max_element(v.begin(), v.begin() + static_cast<std::ptrdiff_t>(mid)) + upper) / 2;
+		}
+
+		void identity(std::vector<double>& m, size_t n)
+		{
+			m.assign(n * n, 0.0);
+			for (size_t i = 0; i < n; ++i)
+			{
+				m[i * n + i] = 1;
+			}
+		}
+	} // namespace
+
+	bool asr_filter::calibrate(const double* x, size_t n_chans, size_t n_samples, double sampling_rate, const asr_options& opts, std::string* error)
+	{
+		const size_t window = std::max<size_t>(n_chans, static_cast<size_t>(std::lround(opts.window_s * sampling_rate)));
+		if (n_chans == 0 || sampling_rate <= 0 || n_samples < 10 * window)
+		{
+			if (error)
+			{
+				*error = "ASR calibration needs at least ten windows (" + std::to_string(10 * window) + " samples)";
+			}
+			return false;
+		}
+		const size_t C = n_chans;
+
+		// Robust covariance: element-wise median over half-overlapping
+		// windows, so a few artifacts left in the calibration data do not
+		// inflate it
+		const size_t hop = std::max<size_t>(1, window / 2);
+		const size_t n_windows = (n_samples - window) / hop + 1;
+		std::vector<double> covariances(n_windows * C * C);
+		for (size_t w = 0; w < n_windows; ++w)
+		{
+			double* cov = &covariances[w * C * C];
+			for (size_t i = 0; i < C; ++i)
+			{
+				const double* restrict a = x + i * n_samples + w * hop;
+				for (size_t j = i; j < C; ++j)
+				{
+					const double* restrict b = x + j * n_samples + w * hop;
+					double sum = 0;
+					for (size_t t = 0; t < window; ++t)
+					{
+						sum += a[t] * b[t];
+					}
+					cov[i * C + j] = cov[j * C + i] = sum / static_cast<double>(window);
+				}
+			}
+		}
+		std::vector<double> robust(C * C);
+		std::vector<double> column(n_windows);
+		for (size_t e = 0; e < C * C; ++e)
+		{
+			for (size_t w = 0; w < n_windows; ++w)
+			{
+				column[w] = covariances[w * C * C + e];
+			}
+			robust[e] = median(column);
+		}
+		std::vector<double> d;
+		std::vector<double> v;
+		symmetric_eigen(robust, C, d, v);
+		if (!(d[0] > 0))
+		{
+			if (error)
+			{
+				*error = "ASR calibration data has no variance";
+			}
+			return false;
+		}
+
+		std::vector<double> mixing(C * C, 0.0);
+		for (size_t i = 0; i < C; ++i)
+		{
+			for (size_t j = 0; j < C; ++j)
+			{
+				double sum = 0;
+				for (size_t k = 0; k < C; ++k)
+				{
+					sum += v[i * C + k] * std::sqrt(std::max(d[k], 0.0)) * v[j * C + k];
+				}
+				mixing[i * C + j] = sum;
+			}
+		}
+
+		// Per component, the RMS of its amplitude over windows with two
+		// thirds overlap; the threshold sits `cutoff` robust standard
+		// deviations above the median
+		const size_t rms_hop = std::max<size_t>(1, window / 3);
+		const size_t n_rms = (n_samples - window) / rms_hop + 1;
+		std::vector<double> threshold(C * C);
+		std::vector<double> y(n_samples);
+		std::vector<double> rms(n_rms);
+		for (size_t k = 0; k < C; ++k)
+		{
+			std::fill(y.begin(), y.end(), 0.0);
+			for (size_t c = 0; c < C; ++c)
+			{
+				const double a = v[c * C + k];
+				const double* restrict xc = x + c * n_samples;
+				for (size_t t = 0; t < n_samples; ++t)
+				{
+					y[t] += a * xc[t];
+				}
+			}
+			for (size_t w = 0; w < n_rms; ++w)
+			{
+				const double* restrict yw = &y[w * rms_hop];
+				double sum = 0;
+				for (size_t t = 0; t < window; ++t)
+				{
+					sum += yw[t] * yw[t];
+				}
+				rms[w] = std::sqrt(sum / static_cast<double>(window));
+			}
+			const double mid = median(rms);
+			for (double& r : rms)
+			{
+				r = std::abs(r - mid);
+			}
+			const double spread = 1.4826 * median(rms);
+			const double limit = mid + opts.cutoff * spread;
+			for (size_t c = 0; c < C; ++c)
+			{
+				threshold[k * C + c] = limit * v[c * C + k];
+			}
+		}
+
+		n_chans_ = C;
+		window_ = window;
+		delay_ = opts.lookahead_s < 0 ? window / 2 : static_cast<size_t>(std::lround(opts.lookahead_s * sampling_rate));
+		step_ = std::max<size_t>(1, opts.step);
+		max_rejected_ = std::min(C - 1, static_cast<size_t>(std::floor(opts.max_dims * static_cast<double>(C))));
+		mixing_ = std::move(mixing);
+		threshold_ = std::move(threshold);
+		eigenvectors_ = v;
+		segment_.resize(C * step_);
+		mixed_.resize(C * step_);
+		reset();
+		return true;
+	}
+
+	void asr_filter::reset()
+	{
+		ring_.assign(n_chans_ * window_, 0.0);
+		ring_slot_ = 0;
+		filled_ = 0;
+		sums_.assign(n_chans_ * n_chans_, 0.0);
+		delay_line_.assign(n_chans_ * delay_, 0.0);
+		delay_slot_ = 0;
+		phase_ = 0;
+		identity(previous_, n_chans_);
+		identity(current_, n_chans_);
+		previous_identity_ = true;
+		current_identity_ = true;
+		rejected_ = 0;
+	}
+
+	void asr_filter::update()
+	{
+		previous_ = current_;
+		previous_identity_ = current_identity_;
+		if (filled_ < window_)
+		{
+			return;
+		}
+		const size_t C = n_chans_;
+		std::vector<double> cov(sums_);
+		for (double& e : cov)
+		{
+			e /= static_cast<double>(window_);
+		}
+		refine_symmetric_eigen(cov, C, eigenvalues_, eigenvectors_);
+
+		// Eigenvalues are descending, so only the first `max_rejected_` may
+		// go; each is compared with its direction's calibrated threshold
+		std::vector<bool> keep(C, true);
+		rejected_ = 0;
+		for (size_t k = 0; k < max_rejected_; ++k)
+		{
+			double limit = 0;
+			for (size_t r = 0; r < C; ++r)
+			{
+				double sum = 0;
+				for (size_t c = 0; c < C; ++c)
+				{
+					sum += threshold_[r * C + c] * eigenvectors_[c * C + k];
+				}
+				limit += sum * sum;
+			}
+			if (eigenvalues_[k] > limit)
+			{
+				keep[k] = false;
+				++rejected_;
+			}
+		}
+		if (rejected_ == 0)
+		{
+			identity(current_, C);
+			current_identity_ = true;
+			return;
+		}
+
+		// R = M Bk' (Bk Bk')^-1 Vk' with Bk = Vk' M over the kept
+		// components Vk: the least-squares estimate of the data from them
+		std::vector<size_t> kept;
+		for (size_t k = 0; k < C; ++k)
+		{
+			if (keep[k])
+			{
+				kept.push_back(k);
+			}
+		}
+		const size_t K = kept.size();
+		std::vector<double> b(K * C, 0.0);
+		for (size_t r = 0; r < K; ++r)
+		{
+			for (size_t c = 0; c < C; ++c)
+			{
+				double sum = 0;
+				for (size_t i = 0; i < C; ++i)
+				{
+					sum += eigenvectors_[i * C + kept[r]] * mixing_[i * C + c];
+				}
+				b[r * C + c] = sum;
+			}
+		}
+		std::vector<double> gram(K * K);
+		for (size_t i = 0; i < K; ++i)
+		{
+			for (size_t j = i; j < K; ++j)
+			{
+				double sum = 0;
+				for (size_t c = 0; c < C; ++c)
+				{
+					sum += b[i * C + c] * b[j * C + c];
+				}
+				gram[i * K + j] = gram[j * K + i] = sum;
+			}
+		}
+		std::vector<double> g;
+		std::vector<double> q;
+		symmetric_eigen(gram, K, g, q);
+		std::vector<double> inverse(K * K, 0.0);
+		for (size_t i = 0; i < K; ++i)
+		{
+			for (size_t j = 0; j < K; ++j)
+			{
+				double sum = 0;
+				for (size_t l = 0; l < K; ++l)
+				{
+					sum += g[l] > g[0] * 1e-12 ? q[i * K + l] * q[j * K + l] / g[l] : 0.0;
+				}
+				inverse[i * K + j] = sum;
+			}
+		}
+		// M Bk' is C x K; then times the inverse, then Vk'
+		std::vector<double> mb(C * K, 0.0);
+		for (size_t i = 0; i < C; ++i)
+		{
+			for (size_t r = 0; r < K; ++r)
+			{
+				double sum = 0;
+				for (size_t c = 0; c < C; ++c)
+				{
+					sum += mixing_[i * C + c] * b[r * C + c];
+				}
+				mb[i * K + r] = sum;
+			}
+		}
+		std::vector<double> left;
+		matrix_multiply(mb, inverse, C, K, K, left);
+		std::vector<double> vk(K * C);
+		for (size_t r = 0; r < K; ++r)
+		{
+			for (size_t c = 0; c < C; ++c)
+			{
+				vk[r * C + c] = eigenvectors_[c * C + kept[r]];
+			}
+		}
+		matrix_multiply(left, vk, C, K, C, current_);
+		current_identity_ = false;
+	}
+
+	void asr_filter::process(const double* x, size_t n_samples, double* out)
+	{
+		const size_t C = n_chans_;
+		size_t t = 0;
+		while (t < n_samples)
+		{
+			const size_t len = std::min(n_samples - t, step_ - phase_);
+			for (size_t k = 0; k < len; ++k)
+			{
+				// Sliding covariance: add the new outer product, drop the
+				// oldest
+				double* restrict slot = &ring_[ring_slot_ * C];
+				const bool full = filled_ == window_;
+				for (size_t i = 0; i < C; ++i)
+				{
+					const double si = x[i * n_samples + t + k];
+					const double oi = full ? slot[i] : 0.0;
+					double* restrict row = &sums_[i * C];
+					for (size_t j = 0; j < C; ++j)
+					{
+						row[j] += si * x[j * n_samples + t + k] - oi * slot[j];
+					}
+				}
+				for (size_t i = 0; i < C; ++i)
+				{
+					slot[i] = x[i * n_samples + t + k];
+				}
+				filled_ = std::min(filled_ + 1, window_);
+				ring_slot_ = (ring_slot_ + 1) % window_;
+				if (ring_slot_ == 0)
+				{
+					std::fill(sums_.begin(), sums_.end(), 0.0);
+					for (size_t s = 0; s < window_; ++s)
+					{
+						const double* restrict sample = &ring_[s * C];
+						for (size_t i = 0; i < C; ++i)
+						{
+							double* restrict row = &sums_[i * C];
+							for (size_t j = 0; j < C; ++j)
+							{
+								row[j] += sample[i] * sample[j];
+							}
+						}
+					}
+				}
+
+				for (size_t i = 0; i < C; ++i)
+				{
+					const double s = x[i * n_samples + t + k];
+					if (delay_ > 0)
+					{
+						segment_[i * len + k] = delay_line_[delay_slot_ * C + i];
+						delay_line_[delay_slot_ * C + i] = s;
+					}
+					else
+					{
+						segment_[i * len + k] = s;
+					}
+				}
+				if (delay_ > 0)
+				{
+					delay_slot_ = (delay_slot_ + 1) % delay_;
+				}
+			}
+
+			// Reconstruction of the delayed samples, raised-cosine blended
+			// from the previous matrix to the current one over the step
+			if (previous_identity_ && current_identity_)
+			{
+				for (size_t i = 0; i < C; ++i)
+				{
+					std::copy(&segment_[i * len], &segment_[i * len] + len, out + i * n_samples + t);
+				}
+			}
+			else
+			{
+				for (size_t i = 0; i < C; ++i)
+				{
+					double* restrict from = &mixed_[0];
+					double* restrict y = out + i * n_samples + t;
+					std::fill(from, from + len, 0.0);
+					std::fill(y, y + len, 0.0);
+					for (size_t j = 0; j < C; ++j)
+					{
+						const double a = previous_[i * C + j];
+						const double b = current_[i * C + j];
+						const double* restrict s = &segment_[j * len];
+						for (size_t k = 0; k < len; ++k)
+						{
+							from[k] += a * s[k];
+							y[k] += b * s[k];
+						}
+					}
+					for (size_t k = 0; k < len; ++k)
+					{
+						const double w = 0.5 * (1 - std::cos(pi * static_cast<double>(phase_ + k + 1) / static_cast<double>(step_)));
+						y[k] = from[k] + w * (y[k] - from[k]);
+					}
+				}
+			}
+
+			phase_ += len;
+			t += len;
+			if (phase_ == step_)
+			{
+				phase_ = 0;
+				update();
+			}
+		}
+	}
+} // namespace eeg
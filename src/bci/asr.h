@@ -0,0 +1,118 @@
+/**
+ * @file asr.h
+ * @brief Artifact Subspace Reconstruction for streaming EEG
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace eeg
+{
+	struct asr_options
+	{
+		double cutoff = 20;       ///< Standard deviations of clean-data component amplitude that count as artifact; lower is more aggressive
+		double window_s = 0.5;    ///< Covariance window, both for calibration statistics and for tracking
+		double lookahead_s = -1;  ///< Output delay centring the window on the output sample; negative for `window_s / 2`
+		size_t step = 32;         ///< Samples between reconstruction updates, blended in between
+		double max_dims = 0.66;   ///< Largest fraction of channels reconstructed at once
+	};
+
+	/**
+	 * @brief Removes high-variance transients by reconstructing the
+	 * subspace they occupy from the rest of the channels
+	 *
+	 * @details `calibrate()` takes clean, highpassed data (a minute of
+	 * resting EEG is typical) and derives its mixing matrix, the square root
+	 * of a robust covariance (element-wise median over windows), and per
+	 * principal component an amplitude threshold of `cutoff` robust
+	 * standard deviations above the median window RMS.
+	 *
+	 * `process()` then tracks the covariance over the last `window_s`
+	 * seconds incrementally: each sample adds its outer product and removes
+	 * the oldest one's, and the sums are rebuilt from the window when it
+	 * wraps so rounding does not build up. Every `step` samples the
+	 * covariance is eigen-decomposed, warm-started from the previous
+	 * eigenvectors (`refine_symmetric_eigen()`), and components whose
+	 * variance exceeds their calibrated threshold, at most `max_dims` of
+	 * the channels, are replaced by their least-squares reconstruction
+	 * from the retained ones. Successive reconstruction matrices are
+	 * blended with a raised cosine over the next step; while nothing
+	 * exceeds the thresholds the data pass through unchanged.
+	 *
+	 * Latency: output lags input by `delay()` samples, `lookahead_s`
+	 * (default a quarter second), so the tracked window is centred on the
+	 * sample being cleaned. The first `delay()` outputs after `reset()`
+	 * come from the zero-filled delay line. Per sample the work is two
+	 * `n_chans` x `n_chans` rank-one updates, plus a matrix-vector product
+	 * while reconstructing and an eigen-decomposition per step, which for
+	 * 32 channels is a small fraction of one core at 500 Hz (see the `asr`
+	 * bench suite).
+	 */
+	class asr_filter
+	{
+	public:
+		/**
+		 * @param x Channel-major (channel n at `x[n * n_samples]`)
+		 * @return false with fewer than ten windows of samples or data
+		 * without variance
+		 */
+		bool calibrate(const double* x, size_t n_chans, size_t n_samples, double sampling_rate, const asr_options& opts,
+					   std::string* error = nullptr);
+
+		bool calibrated() const { return n_chans_ > 0; }
+		size_t n_chans() const { return n_chans_; }
+		size_t delay() const { return delay_; }
+
+		/**
+		 * @brief Components reconstructed at the latest update
+		 */
+		size_t rejected() const { return rejected_; }
+
+		/**
+		 * @brief Forgets the tracked window and delay line, keeping the
+		 * calibration; for gaps in the stream
+		 */
+		void reset();
+
+		/**
+		 * @brief Cleans a channel-major block
+		 *
+		 * @param out `n_chans * n_samples`, channel-major, holding the input
+		 * `delay()` samples earlier; must not overlap `x`
+		 */
+		void process(const double* x, size_t n_samples, double* out);
+
+	private:
+		void update();
+
+		size_t n_chans_ = 0;
+		size_t window_ = 0;
+		size_t delay_ = 0;
+		size_t step_ = 0;
+		size_t max_rejected_ = 0;
+		std::vector<double> mixing_;    ///< Square root of the calibration covariance
+		std::vector<double> threshold_; ///< Rows: component amplitude thresholds times the calibration eigenvectors
+
+		std::vector<double> ring_; ///< Last `window_` samples, sample-major
+		size_t ring_slot_ = 0;
+		size_t filled_ = 0;
+		std::vector<double> sums_; ///< Outer products over the ring
+		std::vector<double> delay_line_; ///< Last `delay_` samples, sample-major
+		size_t delay_slot_ = 0;
+		size_t phase_ = 0; ///< Samples since the latest update
+
+		std::vector<double> eigenvalues_;
+		std::vector<double> eigenvectors_; ///< Warm start for the next update
+		std::vector<double> previous_;     ///< Reconstruction blended from
+		std::vector<double> current_;      ///< Reconstruction blended to
+		bool previous_identity_ = true;
+		bool current_identity_ = true;
+		size_t rejected_ = 0;
+
+		std::vector<double> segment_; ///< Delayed samples of one step, channel-major
+		std::vector<double> mixed_;
+	};
+} // namespace eeg
@@ -0,0 +1,291 @@
+#include "bci/connectivity.h"
+
+#include "processor.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace eeg
+{
+	void connectivity_engine::pair_terms::resize(size_t n_pairs, size_t n_chans, size_t bins)
+	{
+		cross_re.assign(n_pairs * bins, 0.0);
+		cross_im.assign(n_pairs * bins, 0.0);
+		phase_re.assign(n_pairs * bins, 0.0);
+		phase_im.assign(n_pairs * bins, 0.0);
+		power.assign(n_chans * bins, 0.0);
+	}
+
+	bool connectivity_engine::init(size_t n_chans, size_t window, double sampling_rate, const connectivity_options& opts, std::string* error)
+	{
+		const size_t bins = (window - (window % 2)) / 2 + 1;
+		const double df = sampling_rate / static_cast<double>(window);
+		const size_t first = std::max<size_t>(1, static_cast<size_t>(std::ceil(opts.low_hz / df)));
+		// Below Nyquist, where every bin has the same weight in Parseval's sum
+		const size_t last = std::min((window - 1) / 2, static_cast<size_t>(std::floor(opts.high_hz / df)));
+		if (n_chans < 2 || window < 2 || sampling_rate <= 0 || first > last || opts.windows == 0)
+		{
+			if (error)
+			{
+				*error = "connectivity needs 2 or more channels and a band holding a frequency bin (bins every " + std::to_string(df) + " Hz)";
+			}
+			return false;
+		}
+		n_chans_ = n_chans;
+		window_ = window;
+		sampling_rate_ = sampling_rate;
+		first_bin_ = first;
+		n_bins_ = last - first + 1;
+
+		pair_i_.clear();
+		pair_j_.clear();
+		for (size_t i = 0; i < n_chans; ++i)
+		{
+			for (size_t j = i + 1; j < n_chans; ++j)
+			{
+				pair_i_.push_back(i);
+				pair_j_.push_back(j);
+			}
+		}
+		ring_.assign(opts.windows, pair_terms());
+		for (pair_terms& t : ring_)
+		{
+			t.resize(n_pairs(), n_chans_, n_bins_);
+		}
+		sums_.resize(n_pairs(), n_chans_, n_bins_);
+		slot_ = 0;
+		filled_ = 0;
+
+		magnitudes_.resize(n_chans * bins);
+		phases_.resize(n_chans * bins);
+		spectrum_re_.resize(n_chans * n_bins_);
+		spectrum_im_.resize(n_chans * n_bins_);
+		threads_ = std::max<size_t>(1, std::min(opts.threads, n_pairs()));
+		pool_ = threads_ > 1 ? std::make_unique<work_pool>(threads_) : nullptr;
+		return true;
+	}
+
+	template <typename F>
+	void connectivity_engine::for_pairs(F f)
+	{
+		const size_t n = n_pairs();
+		if (!pool_)
+		{
+			f(size_t(0), n);
+			return;
+		}
+		for (size_t k = 0; k < threads_; ++k)
+		{
+			const size_t begin = n * k / threads_;
+			const size_t end = n * (k + 1) / threads_;
+			pool_->submit([f, begin, end]() { f(begin, end); });
+		}
+		pool_->wait();
+	}
+
+	void connectivity_engine::add_window(const double* x)
+	{
+		const size_t bins = magnitudes_.size() / n_chans_;
+		const size_t nb = n_bins_;
+		ba_bci_connect_fft(x, n_chans_, window_, sampling_rate_, magnitudes_.data(), phases_.data());
+
+		pair_terms& slot = ring_[slot_];
+		const bool replacing = filled_ == ring_.size();
+		for (size_t c = 0; c < n_chans_; ++c)
+		{
+			for (size_t b = 0; b < nb; ++b)
+			{
+				const double m = magnitudes_[c * bins + first_bin_ + b];
+				const double ph = phases_[c * bins + first_bin_ + b];
+				spectrum_re_[c * nb + b] = m * std::cos(ph);
+				spectrum_im_[c * nb + b] = m * std::sin(ph);
+				const double power = m * m;
+				sums_.power[c * nb + b] += power - (replacing ? slot.power[c * nb + b] : 0.0);
+				slot.power[c * nb + b] = power;
+			}
+		}
+
+		slot_ = (slot_ + 1) % ring_.size();
+		filled_ = std::min(filled_ + 1, ring_.size());
+		const bool rebuild = slot_ == 0;
+		const std::vector<pair_terms>& ring = ring_;
+		for_pairs([this, &slot, &ring, replacing, rebuild, nb](size_t begin, size_t end) {
+			const double* re = spectrum_re_.data();
+			const double* im = spectrum_im_.data();
+			for (size_t p = begin; p < end; ++p)
+			{
+				const double* ar = re + pair_i_[p] * nb;
+				const double* ai = im + pair_i_[p] * nb;
+				const double* br = re + pair_j_[p] * nb;
+				const double* bi = im + pair_j_[p] * nb;
+				double* cross_re = &slot.cross_re[p * nb];
+				double* cross_im = &slot.cross_im[p * nb];
+				double* phase_re = &slot.phase_re[p * nb];
+				double* phase_im = &slot.phase_im[p * nb];
+				double* sum_cross_re = &sums_.cross_re[p * nb];
+				double* sum_cross_im = &sums_.cross_im[p * nb];
+				double* sum_phase_re = &sums_.phase_re[p * nb];
+				double* sum_phase_im = &sums_.phase_im[p * nb];
+				for (size_t b = 0; b < nb; ++b)
+				{
+					// a * conj(b), and the same of the unit phasors
+					const double r = ar[b] * br[b] + ai[b] * bi[b];
+					const double i = ai[b] * br[b] - ar[b] * bi[b];
+					const double mag = std::sqrt(r * r + i * i);
+					const double ur = mag > 0 ? r / mag : 0.0;
+					const double ui = mag > 0 ? i / mag : 0.0;
+					if (replacing && !rebuild)
+					{
+						sum_cross_re[b] -= cross_re[b];
+						sum_cross_im[b] -= cross_im[b];
+						sum_phase_re[b] -= phase_re[b];
+						sum_phase_im[b] -= phase_im[b];
+					}
+					cross_re[b] = r;
+					cross_im[b] = i;
+					phase_re[b] = ur;
+					phase_im[b] = ui;
+					if (!rebuild)
+					{
+						sum_cross_re[b] += r;
+						sum_cross_im[b] += i;
+						sum_phase_re[b] += ur;
+						sum_phase_im[b] += ui;
+					}
+				}
+				if (rebuild)
+				{
+					// Every slot is current here: re-add them from scratch
+					std::fill(sum_cross_re, sum_cross_re + nb, 0.0);
+					std::fill(sum_cross_im, sum_cross_im + nb, 0.0);
+					std::fill(sum_phase_re, sum_phase_re + nb, 0.0);
+					std::fill(sum_phase_im, sum_phase_im + nb, 0.0);
+					for (const pair_terms& w : ring)
+					{
+						for (size_t b = 0; b < nb; ++b)
+						{
+							sum_cross_re[b] += w.cross_re[p * nb + b];
+							sum_cross_im[b] += w.cross_im[p * nb + b];
+							sum_phase_re[b] += w.phase_re[p * nb + b];
+							sum_phase_im[b] += w.phase_im[p * nb + b];
+						}
+					}
+				}
+			}
+		});
+		if (rebuild)
+		{
+			std::fill(sums_.power.begin(), sums_.power.end(), 0.0);
+			for (const pair_terms& w : ring_)
+			{
+				for (size_t k = 0; k < w.power.size(); ++k)
+				{
+					sums_.power[k] += w.power[k];
+				}
+			}
+		}
+	}
+
+	void connectivity_engine::clear()
+	{
+		for (pair_terms& t : ring_)
+		{
+			t.resize(n_pairs(), n_chans_, n_bins_);
+		}
+		sums_.resize(n_pairs(), n_chans_, n_bins_);
+		slot_ = 0;
+		filled_ = 0;
+	}
+
+	void connectivity_engine::compute(connectivity_matrices& out)
+	{
+		const size_t n = n_chans_;
+		const size_t nb = n_bins_;
+		out.n_chans = n;
+		out.windows = filled_;
+		out.coherence.assign(n * n, 0.0);
+		out.plv.assign(n * n, 0.0);
+		out.correlation.assign(n * n, 0.0);
+		for (size_t c = 0; c < n; ++c)
+		{
+			out.coherence[c * n + c] = 1;
+			out.plv[c * n + c] = 1;
+			out.correlation[c * n + c] = 1;
+		}
+		if (filled_ == 0)
+		{
+			return;
+		}
+
+		// Band power per channel for correlation; the bin weights of
+		// Parseval's sum are equal inside the band, so they cancel
+		std::vector<double> total(n, 0.0);
+		for (size_t c = 0; c < n; ++c)
+		{
+			for (size_t b = 0; b < nb; ++b)
+			{
+				total[c] += sums_.power[c * nb + b];
+			}
+		}
+		const double windows = static_cast<double>(filled_);
+		for_pairs([this, &out, &total, n, nb, windows](size_t begin, size_t end) {
+			for (size_t p = begin; p < end; ++p)
+			{
+				const size_t i = pair_i_[p];
+				const size_t j = pair_j_[p];
+				const double* pi = &sums_.power[i * nb];
+				const double* pj = &sums_.power[j * nb];
+				double coherence = 0;
+				double plv = 0;
+				double cross = 0;
+				for (size_t b = 0; b < nb; ++b)
+				{
+					const double r = sums_.cross_re[p * nb + b];
+					const double im = sums_.cross_im[p * nb + b];
+					const double denominator = pi[b] * pj[b];
+					coherence += denominator > 0 ? (r * r + im * im) / denominator : 0.0;
+					plv += std::hypot(sums_.phase_re[p * nb + b], sums_.phase_im[p * nb + b]) / windows;
+					cross += r;
+				}
+				coherence /= static_cast<double>(nb);
+				plv /= static_cast<double>(nb);
+				const double scale = std::sqrt(total[i] * total[j]);
+				const double correlation = scale > 0 ? cross / scale : 0.0;
+				out.coherence[i * n + j] = out.coherence[j * n + i] = coherence;
+				out.plv[i * n + j] = out.plv[j * n + i] = plv;
+				out.correlation[i * n + j] = out.correlation[j * n + i] = correlation;
+			}
+		});
+	}
+
+	bool compute_connectivity(const double* x, size_t n_chans, size_t n_samples, double sampling_rate, size_t window, size_t hop,
+							  const connectivity_options& opts, connectivity_matrices& out, std::string* error)
+	{
+		if (window == 0 || hop == 0 || n_samples < window)
+		{
+			if (error)
+			{
+				*error = "connectivity needs at least one window of samples";
+			}
+			return false;
+		}
+		connectivity_options all = opts;
+		all.windows = (n_samples - window) / hop + 1;
+		connectivity_engine engine;
+		if (!engine.init(n_chans, window, sampling_rate, all, error))
+		{
+			return false;
+		}
+		std::vector<double> w(n_chans * window);
+		for (size_t start = 0; start + window <= n_samples; start += hop)
+		{
+			for (size_t c = 0; c < n_chans; ++c)
+			{
+				std::copy(x + c * n_samples + start, x + c * n_samples + start + window, w.data() + c * window);
+			}
+			engine.add_window(w.data());
+		}
+		engine.compute(out);
+		return true;
+	}
+} // namespace eeg
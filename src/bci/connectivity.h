@@ -0,0 +1,145 @@
+/**
+ * @file connectivity.h
+ * @brief Coherence, phase-locking value and correlation between all
+ * channel pairs from shared cross-spectra
+ */
+
+#pragma once
+
+#include "util/work_pool.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace eeg
+{
+	struct connectivity_options
+	{
+		double low_hz = 8;
+		double high_hz = 12;
+		size_t windows = 8; ///< Windows averaged; each new one pushes out the oldest
+		size_t threads = 1; ///< Workers sharing the channel pairs; 1 runs on the caller
+	};
+
+	/**
+	 * @brief Symmetric `n_chans` x `n_chans` matrices, row-major, with ones
+	 * on the diagonal; each measure is averaged over the band's frequency
+	 * bins
+	 */
+	struct connectivity_matrices
+	{
+		size_t n_chans = 0;
+		size_t windows = 0; ///< Windows averaged
+		std::vector<double> coherence;   ///< Magnitude-squared coherence, 0 to 1
+		std::vector<double> plv;         ///< Phase-locking value, 0 to 1
+		std::vector<double> correlation; ///< Pearson correlation of the band-limited signals
+	};
+
+	/**
+	 * @brief Sliding average of cross-spectra over the most recent windows
+	 *
+	 * @details Each window is transformed once with `ba_bci_connect_fft`,
+	 * and for every channel pair and band bin its cross-spectrum and unit
+	 * phase difference are kept. The three measures derive from the same
+	 * sums: coherence from the cross- and auto-spectra, the phase-locking
+	 * value from the phase differences, and correlation from the real part
+	 * of the cross-spectra (Parseval), so it covers the band only and
+	 * ignores the mean.
+	 *
+	 * Adding a window adds its terms to the running sums and subtracts
+	 * those of the window it replaces, so a hop costs one transform and
+	 * O(pairs x bins) instead of recomputing every window. The sums are
+	 * rebuilt from the stored terms each time the window ring wraps, which
+	 * keeps rounding from accumulating. Pairs are split across `threads`
+	 * workers of a `work_pool`.
+	 *
+	 * Windows are not tapered, as `ba_bci_connect_fft` does not; the band
+	 * should hold several bins, which come every `sampling rate / window`
+	 * Hz. Coherence over a single window is 1 by construction, so average
+	 * several.
+	 */
+	class connectivity_engine
+	{
+	public:
+		connectivity_engine() = default;
+		connectivity_engine(const connectivity_engine&) = delete;
+		connectivity_engine& operator=(const connectivity_engine&) = delete;
+
+		/**
+		 * @param window Samples per window
+		 * @return false if the band holds no frequency bin above DC
+		 */
+		bool init(size_t n_chans, size_t window, double sampling_rate, const connectivity_options& opts, std::string* error = nullptr);
+
+		/**
+		 * @brief Adds a channel-major window (channel n at `x[n * window]`)
+		 */
+		void add_window(const double* x);
+
+		/**
+		 * @brief Forgets every window
+		 */
+		void clear();
+
+		size_t n_chans() const { return n_chans_; }
+		size_t n_pairs() const { return pair_i_.size(); }
+		size_t n_windows() const { return filled_; }
+
+		/**
+		 * @brief Measures over the windows held; all zero off the diagonal
+		 * before the first window
+		 */
+		void compute(connectivity_matrices& out);
+
+	private:
+		/**
+		 * Per-pair terms of one window, or their sums; index `p * bins + b`.
+		 */
+		struct pair_terms
+		{
+			std::vector<double> cross_re;
+			std::vector<double> cross_im;
+			std::vector<double> phase_re;
+			std::vector<double> phase_im;
+			std::vector<double> power; ///< Per channel, `c * bins + b`
+
+			void resize(size_t n_pairs, size_t n_chans, size_t bins);
+		};
+
+		/**
+		 * Runs `f(first_pair, end_pair)` over all pairs, split across the pool.
+		 */
+		template <typename F>
+		void for_pairs(F f);
+
+		size_t n_chans_ = 0;
+		size_t window_ = 0;
+		double sampling_rate_ = 0;
+		size_t first_bin_ = 0; ///< Band bins of the transform
+		size_t n_bins_ = 0;
+		std::vector<size_t> pair_i_;
+		std::vector<size_t> pair_j_;
+
+		std::vector<pair_terms> ring_; ///< Terms of the windows held
+		pair_terms sums_;
+		size_t slot_ = 0; ///< Ring slot the next window goes to
+		size_t filled_ = 0;
+
+		std::vector<double> magnitudes_;
+		std::vector<double> phases_;
+		std::vector<double> spectrum_re_; ///< Band bins, `c * bins + b`
+		std::vector<double> spectrum_im_;
+		std::unique_ptr<work_pool> pool_;
+		size_t threads_ = 1;
+	};
+
+	/**
+	 * @brief Measures averaged over every `window`-sample window taken each
+	 * `hop` samples from a channel-major recording; `opts.windows` is
+	 * ignored
+	 */
+	bool compute_connectivity(const double* x, size_t n_chans, size_t n_samples, double sampling_rate, size_t window, size_t hop,
+							  const connectivity_options& opts, connectivity_matrices& out, std::string* error = nullptr);
+} // namespace eeg
@@ -0,0 +1,244 @@
+#include "bci/entropy.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace eeg
+{
+	namespace
+	{
+		/**
+		 * Tolerance of a channel: `factor` population standard deviations.
+		 */
+		double tolerance(const double* x, size_t n, double factor)
+		{
+			double mean = 0;
+			for (size_t i = 0; i < n; ++i)
+			{
+				mean += x[i];
+			}
+			mean /= static_cast<double>(n);
+			double ss = 0;
+			for (size_t i = 0; i < n; ++i)
+			{
+				ss += (x[i] - mean) * (x[i] - mean);
+			}
+			return factor * std::sqrt(ss / static_cast<double>(n));
+		}
+
+		/**
+		 * SampEn from unordered pair counts over the first `templates`
+		 * templates; without (m + 1) matches, the value one match would give.
+		 */
+		double sample_entropy(uint64_t pairs, uint64_t long_pairs, size_t templates)
+		{
+			if (long_pairs == 0)
+			{
+				const double t = static_cast<double>(templates);
+				return std::log(std::max(t * (t - 1) / 2, 1.0));
+			}
+			return -std::log(static_cast<double>(long_pairs) / static_cast<double>(pairs));
+		}
+	} // namespace
+
+	bool entropy_engine::init(size_t n_chans, const entropy_options& opts, std::string* error)
+	{
+		if (n_chans == 0 || opts.m == 0 || !(opts.r >= 0))
+		{
+			if (error)
+			{
+				*error = "entropy needs a template length of 1 or more and a tolerance of 0 or more";
+			}
+			return false;
+		}
+		n_chans_ = n_chans;
+		opts_ = opts;
+		threads_ = std::max<size_t>(1, std::min(opts.threads, n_chans));
+		pool_ = threads_ > 1 ? std::make_unique<work_pool>(threads_) : nullptr;
+		scratch_.assign(threads_, scratch());
+		return true;
+	}
+
+	bool entropy_engine::compute(const double* x, size_t n_samples, entropy_values& out)
+	{
+		if (n_samples < opts_.m + 2 || n_samples > UINT32_MAX)
+		{
+			return false;
+		}
+		out.sample.resize(n_chans_);
+		out.approximate.resize(n_chans_);
+		auto run = [this, x, n_samples, &out](size_t worker, size_t begin, size_t end)
+		{
+			for (size_t c = begin; c < end; ++c)
+			{
+				channel(x + c * n_samples, n_samples, scratch_[worker], out.sample[c], out.approximate[c]);
+			}
+		};
+		if (!pool_)
+		{
+			run(0, 0, n_chans_);
+			return true;
+		}
+		for (size_t k = 0; k < threads_; ++k)
+		{
+			const size_t begin = n_chans_ * k / threads_;
+			const size_t end = n_chans_ * (k + 1) / threads_;
+			pool_->submit([&run, k, begin, end]() { run(k, begin, end); });
+		}
+		pool_->wait();
+		return true;
+	}
+
+	void entropy_engine::channel(const double* x, size_t n_samples, scratch& s, double& sample, double& approximate) const
+	{
+		const size_t m = opts_.m;
+		const size_t templates = n_samples - m + 1;
+		const size_t last = templates - 1; // Templates with an (m + 1)-th value
+		const double r = tolerance(x, n_samples, opts_.r);
+
+		// Cells of width r over the first two values (one for m = 1): any
+		// template within r of another lies in one of its 3 x 3 neighbours
+		const double lowest = *std::min_element(x, x + n_samples);
+		const double scale = r > 0 ? 1 / r : 1;
+		auto cell = [lowest, scale](double v) { return static_cast<int64_t>(std::min((v - lowest) * scale, 1e15)); };
+		s.cells.resize(templates);
+		s.sorted.resize(templates);
+		s.order.resize(templates);
+		for (size_t i = 0; i < templates; ++i)
+		{
+			s.cells[i] = {cell(x[i]), m > 1 ? cell(x[i + 1]) : 0};
+			s.order[i] = static_cast<uint32_t>(i);
+		}
+		std::sort(s.order.begin(), s.order.end(), [&s](uint32_t a, uint32_t b) { return s.cells[a] < s.cells[b]; });
+
+		// Templates copied in sorted order, each followed by its (m + 1)-th
+		// value or NaN, which never matches, so candidates are contiguous
+		const size_t stride = m + 1;
+		s.values.resize(templates * stride);
+		for (size_t p = 0; p < templates; ++p)
+		{
+			const uint32_t i = s.order[p];
+			s.sorted[p] = s.cells[i];
+			std::copy(x + i, x + i + m, s.values.begin() + static_cast<std::ptrdiff_t>(p * stride));
+			s.values[p * stride + m] = i < last ? x[i + m] : std::numeric_limits<double>::quiet_NaN();
+		}
+
+		// Counts by sorted position, each starting with the self-match
+		s.matches.assign(templates, 1);
+		s.long_matches.assign(templates, 1);
+		uint64_t all_pairs = 0;
+		uint64_t long_pairs = 0;
+		auto visit = [&](size_t p, size_t begin, size_t end)
+		{
+			// Branch-free: whether a candidate matches is close to random,
+			// and a mispredicted branch costs more than the comparisons
+			const double* a = s.values.data() + p * stride;
+			uint32_t* matches = s.matches.data();
+			uint32_t* long_matches = s.long_matches.data();
+			uint32_t own = 0;
+			uint32_t own_long = 0;
+			for (size_t q = begin; q < end; ++q)
+			{
+				const double* b = s.values.data() + q * stride;
+				uint32_t match = 1;
+				for (size_t k = 0; k < m; ++k)
+				{
+					match &= static_cast<uint32_t>(std::abs(a[k] - b[k]) <= r);
+				}
+				const uint32_t long_match = match & static_cast<uint32_t>(std::abs(a[m] - b[m]) <= r);
+				matches[q] += match;
+				long_matches[q] += long_match;
+				own += match;
+				own_long += long_match;
+			}
+			matches[p] += own;
+			long_matches[p] += own_long;
+			all_pairs += own;
+			long_pairs += own_long;
+		};
+		// Each pair once: from the earlier template in sorted order to the
+		// rest of its own row of cells, then to the next row
+		const int64_t spread = m > 1 ? 1 : 0;
+		const auto first = s.sorted.begin();
+		for (size_t p = 0; p < templates; ++p)
+		{
+			const std::pair<int64_t, int64_t> c = s.sorted[p];
+			const auto row_end = std::upper_bound(first + static_cast<std::ptrdiff_t>(p), s.sorted.end(), std::make_pair(c.first, c.second + spread));
+			visit(p, p + 1, static_cast<size_t>(row_end - first));
+			const auto next = std::lower_bound(row_end, s.sorted.end(), std::make_pair(c.first + 1, c.second - spread));
+			const auto next_end = std::upper_bound(next, s.sorted.end(), std::make_pair(c.first + 1, c.second + spread));
+			visit(p, static_cast<size_t>(next - first), static_cast<size_t>(next_end - first));
+		}
+
+		const double t = static_cast<double>(templates);
+		double phi = 0;
+		double long_phi = 0;
+		uint64_t pairs = all_pairs;
+		for (size_t p = 0; p < templates; ++p)
+		{
+			phi += std::log(static_cast<double>(s.matches[p]) / t);
+			if (s.order[p] == last)
+			{
+				pairs -= s.matches[p] - 1; // SampEn leaves out the template without an (m + 1)-th value
+			}
+			else
+			{
+				long_phi += std::log(static_cast<double>(s.long_matches[p]) / (t - 1));
+			}
+		}
+		sample = sample_entropy(pairs, long_pairs, last);
+		approximate = phi / t - long_phi / (t - 1);
+	}
+
+	void entropy_direct(const double* x, size_t n_samples, size_t m, double r, double& sample, double& approximate)
+	{
+		const size_t templates = n_samples - m + 1;
+		const size_t last = templates - 1;
+		const double tol = tolerance(x, n_samples, r);
+		std::vector<uint32_t> matches(templates, 1);
+		std::vector<uint32_t> long_matches(templates, 1);
+		uint64_t pairs = 0;
+		uint64_t long_pairs = 0;
+		for (size_t i = 0; i < templates; ++i)
+		{
+			for (size_t j = i + 1; j < templates; ++j)
+			{
+				double d = 0;
+				for (size_t k = 0; k < m; ++k)
+				{
+					d = std::max(d, std::abs(x[i + k] - x[j + k]));
+				}
+				if (d > tol)
+				{
+					continue;
+				}
+				++matches[i];
+				++matches[j];
+				if (j < last)
+				{
+					++pairs;
+					if (std::abs(x[i + m] - x[j + m]) <= tol)
+					{
+						++long_pairs;
+						++long_matches[i];
+						++long_matches[j];
+					}
+				}
+			}
+		}
+		const double t = static_cast<double>(templates);
+		double phi = 0;
+		double long_phi = 0;
+		for (size_t i = 0; i < templates; ++i)
+		{
+			phi += std::log(static_cast<double>(matches[i]) / t);
+			if (i < last)
+			{
+				long_phi += std::log(static_cast<double>(long_matches[i]) / (t - 1));
+			}
+		}
+		sample = sample_entropy(pairs, long_pairs, last);
+		approximate = phi / t - long_phi / (t - 1);
+	}
+} // namespace eeg
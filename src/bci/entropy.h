@@ -0,0 +1,109 @@
+/**
+ * @file entropy.h
+ * @brief Sample and approximate entropy of EEG channels
+ */
+
+#pragma once
+
+#include "util/work_pool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace eeg
+{
+	struct entropy_options
+	{
+		size_t m = 2;       ///< Template length
+		double r = 0.2;     ///< Match tolerance as a fraction of each channel's standard deviation
+		size_t threads = 1; ///< Workers sharing the channels; 1 runs on the caller
+	};
+
+	/**
+	 * @brief Per-channel regularity measures of a window
+	 */
+	struct entropy_values
+	{
+		std::vector<double> sample;      ///< SampEn(m, r); capped at its largest finite value when no (m + 1) template matches
+		std::vector<double> approximate; ///< ApEn(m, r)
+	};
+
+	/**
+	 * @brief Sample and approximate entropy with a grid neighbour search
+	 *
+	 * @details Both measures count, for every length-m template of a
+	 * channel, the templates within Chebyshev distance r, and the
+	 * direct method compares all pairs: O(N^2 m) per channel. Here the
+	 * templates are binned by their first two values into cells of width
+	 * r and sorted by cell, so the candidates of a template are the
+	 * templates in the 3 x 3 neighbouring cells. Each pair is visited once,
+	 * from the template earlier in sorted order, whose later neighbours
+	 * form two contiguous ranges found by binary search: the rest of its
+	 * own row of cells and the next row, so the scan of a template ends
+	 * with its neighbourhood. Templates are copied in sorted order with
+	 * their (m + 1)-th value, and a candidate is tested for both lengths
+	 * without branches, so one pass over contiguous memory yields the
+	 * counts of both measures.
+	 *
+	 * For EEG and r = 0.2 standard deviations about a tenth of the pairs
+	 * are candidates, at most twice the matches, and a 10-second window
+	 * takes several times less than the direct method (see the `entropy`
+	 * bench suite). The search is exact, giving the same counts. Channels
+	 * are split across `threads` workers of a `work_pool`, each with its
+	 * own scratch buffers.
+	 */
+	class entropy_engine
+	{
+	public:
+		entropy_engine() = default;
+		entropy_engine(const entropy_engine&) = delete;
+		entropy_engine& operator=(const entropy_engine&) = delete;
+
+		/**
+		 * @return false for m of 0 or a negative tolerance
+		 */
+		bool init(size_t n_chans, const entropy_options& opts, std::string* error = nullptr);
+
+		size_t n_chans() const { return n_chans_; }
+
+		/**
+		 * @brief Measures of a channel-major window (channel n at
+		 * `x[n * n_samples]`)
+		 *
+		 * @return false if the window has fewer than m + 2 samples
+		 */
+		bool compute(const double* x, size_t n_samples, entropy_values& out);
+
+	private:
+		/**
+		 * Buffers of one worker.
+		 */
+		struct scratch
+		{
+			std::vector<std::pair<int64_t, int64_t>> cells;  ///< Cell of each template
+			std::vector<std::pair<int64_t, int64_t>> sorted; ///< Cells in sorted order
+			std::vector<uint32_t> order;                     ///< Templates in sorted order
+			std::vector<double> values;                      ///< Templates in sorted order, each with its (m + 1)-th value
+			std::vector<uint32_t> matches;                   ///< Per sorted position, length-m matches including itself
+			std::vector<uint32_t> long_matches;              ///< Per sorted position, length-(m + 1) matches including itself
+		};
+
+		void channel(const double* x, size_t n_samples, scratch& s, double& sample, double& approximate) const;
+
+		size_t n_chans_ = 0;
+		entropy_options opts_;
+		std::vector<scratch> scratch_;
+		std::unique_ptr<work_pool> pool_;
+		size_t threads_ = 1;
+	};
+
+	/**
+	 * @brief Direct O(N^2) reference of `entropy_engine::compute()` for one
+	 * channel, with `m` and `r` as in `entropy_options`
+	 */
+	void entropy_direct(const double* x, size_t n_samples, size_t m, double r, double& sample, double& approximate);
+} // namespace eeg
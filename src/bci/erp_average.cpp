@@ -0,0 +1,102 @@
+#include "bci/erp_average.h"
+
+#include "restrict.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace eeg
+{
+	bool erp_averager::init(size_t n_chans, size_t n_samples, const erp_options& opts, std::string* error)
+	{
+		if (n_chans == 0 || n_samples == 0 || opts.baseline > n_samples || opts.reject < 0)
+		{
+			if (error)
+			{
+				*error = "ERP averaging needs a non-empty epoch, a baseline inside it and a non-negative rejection threshold";
+			}
+			return false;
+		}
+		n_chans_ = n_chans;
+		n_samples_ = n_samples;
+		opts_ = opts;
+		classes_.clear();
+		epoch_.resize(n_chans * n_samples);
+		return true;
+	}
+
+	bool erp_averager::add(const std::string& label, const double* x)
+	{
+		auto it = std::find_if(classes_.begin(), classes_.end(), [&label](const erp_class& c) { return c.label == label; });
+		if (it == classes_.end())
+		{
+			erp_class c;
+			c.label = label;
+			c.mean.assign(n_chans_ * n_samples_, 0.0);
+			c.m2.assign(n_chans_ * n_samples_, 0.0);
+			classes_.push_back(std::move(c));
+			it = classes_.end() - 1;
+		}
+		erp_class& cls = *it;
+
+		const size_t n = n_samples_;
+		double peak = 0;
+		for (size_t c = 0; c < n_chans_; ++c)
+		{
+			const double* restrict src = x + c * n;
+			double* restrict dst = &epoch_[c * n];
+			double offset = 0;
+			if (opts_.baseline > 0)
+			{
+				for (size_t t = 0; t < opts_.baseline; ++t)
+				{
+					offset += src[t];
+				}
+				offset /= static_cast<double>(opts_.baseline);
+			}
+			for (size_t t = 0; t < n; ++t)
+			{
+				dst[t] = src[t] - offset;
+				peak = std::max(peak, std::abs(dst[t]));
+			}
+		}
+		if (opts_.reject > 0 && peak > opts_.reject)
+		{
+			++cls.rejected;
+			return false;
+		}
+
+		++cls.count;
+		const double inv = 1.0 / static_cast<double>(cls.count);
+		const double* restrict e = epoch_.data();
+		double* restrict mean = cls.mean.data();
+		double* restrict m2 = cls.m2.data();
+		for (size_t i = 0; i < epoch_.size(); ++i)
+		{
+			const double delta = e[i] - mean[i];
+			mean[i] += delta * inv;
+			m2[i] += delta * (e[i] - mean[i]);
+		}
+		return true;
+	}
+
+	const erp_class* erp_averager::find(const std::string& label) const
+	{
+		auto it = std::find_if(classes_.begin(), classes_.end(), [&label](const erp_class& c) { return c.label == label; });
+		return it == classes_.end() ? nullptr : &*it;
+	}
+
+	void erp_averager::variance(const erp_class& c, std::vector<double>& out) const
+	{
+		out.assign(c.m2.size(), 0.0);
+		if (c.count < 2)
+		{
+			return;
+		}
+		const double scale = 1.0 / static_cast<double>(c.count - 1);
+		for (size_t i = 0; i < out.size(); ++i)
+		{
+			out[i] = c.m2[i] * scale;
+		}
+	}
+} // namespace eeg
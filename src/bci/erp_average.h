@@ -0,0 +1,89 @@
+/**
+ * @file erp_average.h
+ * @brief Running event-related potential averages per stimulus class
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace eeg
+{
+	struct erp_options
+	{
+		size_t baseline = 0; ///< Leading samples whose per-channel mean is subtracted from each epoch; 0 for none
+		double reject = 0;   ///< Epochs with any absolute value above this after baseline correction are rejected; 0 keeps all
+	};
+
+	/**
+	 * @brief Running statistics of the accepted epochs of one stimulus class
+	 *
+	 * @details `mean` and `m2` are channel-major like the epochs, `m2`
+	 * holding the sum of squared deviations from the mean (Welford).
+	 */
+	struct erp_class
+	{
+		std::string label;
+		size_t count = 0;
+		size_t rejected = 0;
+		std::vector<double> mean;
+		std::vector<double> m2;
+	};
+
+	/**
+	 * @brief Averages epochs per stimulus class as they arrive
+	 *
+	 * @details Each accepted epoch updates its class's mean and squared
+	 * deviations per channel and time point with Welford's recurrence, so
+	 * an epoch costs O(channels x samples) however many came before, and
+	 * no epochs are stored. Baseline correction and the amplitude check run
+	 * on a copy before the update. Classes are created on first use, in the
+	 * order they are seen.
+	 */
+	class erp_averager
+	{
+	public:
+		/**
+		 * @return false for an empty epoch shape or a baseline longer than
+		 * the epoch
+		 */
+		bool init(size_t n_chans, size_t n_samples, const erp_options& opts, std::string* error = nullptr);
+
+		size_t n_chans() const { return n_chans_; }
+		size_t n_samples() const { return n_samples_; }
+
+		/**
+		 * @brief Adds a channel-major epoch (channel n at `x[n * n_samples]`)
+		 *
+		 * @return false if it was rejected
+		 */
+		bool add(const std::string& label, const double* x);
+
+		const std::vector<erp_class>& classes() const { return classes_; }
+
+		/**
+		 * @return nullptr for a label not seen yet
+		 */
+		const erp_class* find(const std::string& label) const;
+
+		/**
+		 * @brief Unbiased variance per channel and time point; zeros before a
+		 * class has two epochs
+		 */
+		void variance(const erp_class& c, std::vector<double>& out) const;
+
+		/**
+		 * @brief Forgets every class, keeping the shape and options
+		 */
+		void clear() { classes_.clear(); }
+
+	private:
+		size_t n_chans_ = 0;
+		size_t n_samples_ = 0;
+		erp_options opts_;
+		std::vector<erp_class> classes_;
+		std::vector<double> epoch_;
+	};
+} // namespace eeg
@@ -0,0 +1,558 @@
+#include "bci/ica.h"
+
+#include "restrict.h"
+#include "util/json_reader.h"
+#include "util/json_writer.h"
+#include "util/linalg.h"
+#include "util/work_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <memory>
+#include <numeric>
+#include <random>
+
+namespace eeg
+{
+	namespace
+	{
+		/**
+		 * `w = (w w')^(-1/2) w` for `k` x `k` row-major `w`, which makes the
+		 * rows orthonormal without favouring any of them.
+		 */
+		void decorrelate(std::vector<double>& w, size_t k)
+		{
+			std::vector<double> gram(k * k, 0.0);
+			for (size_t i = 0; i < k; ++i)
+			{
+				for (size_t j = i; j < k; ++j)
+				{
+					double sum = 0;
+					for (size_t l = 0; l < k; ++l)
+					{
+						sum += w[i * k + l] * w[j * k + l];
+					}
+					gram[i * k + j] = gram[j * k + i] = sum;
+				}
+			}
+			std::vector<double> values;
+			std::vector<double> vectors;
+			symmetric_eigen(gram, k, values, vectors);
+			std::vector<double> root(k * k, 0.0);
+			for (size_t i = 0; i < k; ++i)
+			{
+				for (size_t j = 0; j < k; ++j)
+				{
+					double sum = 0;
+					for (size_t l = 0; l < k; ++l)
+					{
+						sum += vectors[i * k + l] * vectors[j * k + l] / std::sqrt(std::max(values[l], 1e-300));
+					}
+					root[i * k + j] = sum;
+				}
+			}
+			std::vector<double> out;
+			matrix_multiply(root, w, k, k, k, out);
+			w.swap(out);
+		}
+
+		/**
+		 * `out = m x` over `n_samples` for an `rows` x `cols` matrix and a
+		 * channel-major `x`, one contiguous row update per coefficient.
+		 */
+		void project(const double* m, size_t rows, size_t cols, const double* x, size_t n_samples, double* out)
+		{
+			for (size_t r = 0; r < rows; ++r)
+			{
+				double* restrict y = out + r * n_samples;
+				std::fill(y, y + n_samples, 0.0);
+				for (size_t c = 0; c < cols; ++c)
+				{
+					const double a = m[r * cols + c];
+					const double* restrict xc = x + c * n_samples;
+					for (size_t t = 0; t < n_samples; ++t)
+					{
+						y[t] += a * xc[t];
+					}
+				}
+			}
+		}
+
+		void write_matrix(json_writer& w, const std::string& name, const std::vector<double>& m, size_t rows, size_t cols)
+		{
+			w.key(name).begin_array();
+			for (size_t r = 0; r < rows; ++r)
+			{
+				w.begin_array();
+				for (size_t c = 0; c < cols; ++c)
+				{
+					w.value(m[r * cols + c]);
+				}
+				w.end_array();
+			}
+			w.end_array();
+		}
+
+		bool read_vector(const json_value& root, const std::string& name, size_t n, std::vector<double>& out)
+		{
+			const json_value* v = root.find(name);
+			if (!v || !v->is_array() || v->size() != n)
+			{
+				return false;
+			}
+			out.clear();
+			for (const json_value& item : v->items())
+			{
+				out.push_back(item.as_number());
+			}
+			return true;
+		}
+
+		bool read_matrix(const json_value& root, const std::string& name, size_t rows, size_t cols, std::vector<double>& out)
+		{
+			const json_value* v = root.find(name);
+			if (!v || !v->is_array() || v->size() != rows)
+			{
+				return false;
+			}
+			out.clear();
+			for (const json_value& row : v->items())
+			{
+				if (!row.is_array() || row.size() != cols)
+				{
+					return false;
+				}
+				for (const json_value& item : row.items())
+				{
+					out.push_back(item.as_number());
+				}
+			}
+			return true;
+		}
+	} // namespace
+
+	bool ica_model::fit(const double* x, size_t n_chans, size_t n_samples, const ica_options& opts, std::string* error)
+	{
+		if (n_chans == 0 || n_samples < std::max<size_t>(2, n_chans * n_chans))
+		{
+			if (error)
+			{
+				*error = "ICA needs at least channels squared (" + std::to_string(n_chans * n_chans) + ") samples";
+			}
+			return false;
+		}
+		const size_t T = n_samples;
+		const double inv_t = 1.0 / static_cast<double>(T);
+
+		std::vector<double> mean(n_chans, 0.0);
+		for (size_t c = 0; c < n_chans; ++c)
+		{
+			mean[c] = std::accumulate(x + c * T, x + (c + 1) * T, 0.0) * inv_t;
+		}
+		std::vector<double> cov;
+		covariance(x, n_chans, T, mean.data(), cov);
+		double total = 0;
+		for (size_t c = 0; c < n_chans; ++c)
+		{
+			total += cov[c * n_chans + c];
+		}
+		std::vector<double> d;
+		std::vector<double> e;
+		symmetric_eigen(cov, n_chans, d, e);
+		if (!(total > 0) || !(d[0] > 0))
+		{
+			if (error)
+			{
+				*error = "ICA data has no variance";
+			}
+			return false;
+		}
+
+		// Whitening keeps the principal components above the rank cutoff;
+		// re-referenced or bridged channels leave near-zero ones behind
+		size_t k = 0;
+		while (k < n_chans && d[k] > d[0] * 1e-10)
+		{
+			++k;
+		}
+		if (opts.components > 0)
+		{
+			k = std::min(k, opts.components);
+		}
+		std::vector<double> whitening(k * n_chans);
+		for (size_t r = 0; r < k; ++r)
+		{
+			for (size_t c = 0; c < n_chans; ++c)
+			{
+				whitening[r * n_chans + c] = e[c * n_chans + r] / std::sqrt(d[r]);
+			}
+		}
+		std::vector<double> centred(n_chans * T);
+		for (size_t c = 0; c < n_chans; ++c)
+		{
+			for (size_t t = 0; t < T; ++t)
+			{
+				centred[c * T + t] = x[c * T + t] - mean[c];
+			}
+		}
+		std::vector<double> z(k * T);
+		project(whitening.data(), k, n_chans, centred.data(), T, z.data());
+		centred.clear();
+		centred.shrink_to_fit();
+
+		std::mt19937 rng(opts.seed);
+		std::normal_distribution<double> normal;
+		std::vector<double> w(k * k);
+		for (double& v : w)
+		{
+			v = normal(rng);
+		}
+		decorrelate(w, k);
+
+		// Fixed-point step per component: w+ = E{z g(w'z)} - E{g'(w'z)} w
+		// with g = tanh, the logcosh contrast's derivative
+		const size_t threads = std::max<size_t>(1, std::min(opts.threads, k));
+		std::unique_ptr<work_pool> pool = threads > 1 ? std::make_unique<work_pool>(threads) : nullptr;
+		std::vector<double> scratch(threads * T);
+		std::vector<double> next(k * k);
+		auto update = [&](size_t worker, size_t begin, size_t end) {
+			double* restrict y = &scratch[worker * T];
+			for (size_t r = begin; r < end; ++r)
+			{
+				const double* wr = &w[r * k];
+				std::fill(y, y + T, 0.0);
+				for (size_t j = 0; j < k; ++j)
+				{
+					const double a = wr[j];
+					const double* restrict zj = &z[j * T];
+					for (size_t t = 0; t < T; ++t)
+					{
+						y[t] += a * zj[t];
+					}
+				}
+				double slope = 0;
+				for (size_t t = 0; t < T; ++t)
+				{
+					const double g = std::tanh(y[t]);
+					y[t] = g;
+					slope += 1 - g * g;
+				}
+				slope *= inv_t;
+				for (size_t j = 0; j < k; ++j)
+				{
+					const double* restrict zj = &z[j * T];
+					double sum = 0;
+					for (size_t t = 0; t < T; ++t)
+					{
+						sum += zj[t] * y[t];
+					}
+					next[r * k + j] = sum * inv_t - slope * wr[j];
+				}
+			}
+		};
+
+		iterations_ = 0;
+		converged_ = false;
+		while (iterations_ < opts.max_iterations && !converged_)
+		{
+			if (!pool)
+			{
+				update(0, 0, k);
+			}
+			else
+			{
+				for (size_t worker = 0; worker < threads; ++worker)
+				{
+					const size_t begin = k * worker / threads;
+					const size_t end = k * (worker + 1) / threads;
+					pool->submit([&update, worker, begin, end]() { update(worker, begin, end); });
+				}
+				pool->wait();
+			}
+			decorrelate(next, k);
+			double change = 0;
+			for (size_t r = 0; r < k; ++r)
+			{
+				double dot = 0;
+				for (size_t j = 0; j < k; ++j)
+				{
+					dot += next[r * k + j] * w[r * k + j];
+				}
+				change = std::max(change, std::abs(1 - std::abs(dot)));
+			}
+			w.swap(next);
+			++iterations_;
+			converged_ = change < opts.tolerance;
+		}
+
+		// Unmixing w V; as the rows of w are orthonormal, its pseudo-inverse
+		// is E_k sqrt(D) w'
+		std::vector<double> unmixing;
+		matrix_multiply(w, whitening, k, k, n_chans, unmixing);
+		std::vector<double> mixing(n_chans * k, 0.0);
+		for (size_t c = 0; c < n_chans; ++c)
+		{
+			for (size_t r = 0; r < k; ++r)
+			{
+				double sum = 0;
+				for (size_t j = 0; j < k; ++j)
+				{
+					sum += e[c * n_chans + j] * std::sqrt(d[j]) * w[r * k + j];
+				}
+				mixing[c * k + r] = sum;
+			}
+		}
+
+		// Components have unit variance, so each explains its scalp map's
+		// squared norm
+		std::vector<double> share(k, 0.0);
+		for (size_t r = 0; r < k; ++r)
+		{
+			for (size_t c = 0; c < n_chans; ++c)
+			{
+				share[r] += mixing[c * k + r] * mixing[c * k + r];
+			}
+			share[r] /= total;
+		}
+		std::vector<size_t> order(k);
+		std::iota(order.begin(), order.end(), size_t(0));
+		std::stable_sort(order.begin(), order.end(), [&share](size_t a, size_t b) { return share[a] > share[b]; });
+
+		n_chans_ = n_chans;
+		n_components_ = k;
+		mean_ = mean;
+		unmixing_.assign(k * n_chans, 0.0);
+		mixing_.assign(n_chans * k, 0.0);
+		variance_.assign(k, 0.0);
+		kurtosis_.assign(k, 0.0);
+		for (size_t r = 0; r < k; ++r)
+		{
+			const size_t src = order[r];
+			// Sign fixed so the scalp map's largest weight is positive
+			size_t peak = 0;
+			for (size_t c = 1; c < n_chans; ++c)
+			{
+				if (std::abs(mixing[c * k + src]) > std::abs(mixing[peak * k + src]))
+				{
+					peak = c;
+				}
+			}
+			const double sign = mixing[peak * k + src] < 0 ? -1.0 : 1.0;
+			for (size_t c = 0; c < n_chans; ++c)
+			{
+				unmixing_[r * n_chans + c] = sign * unmixing[src * n_chans + c];
+				mixing_[c * k + r] = sign * mixing[c * k + src];
+			}
+			variance_[r] = share[src];
+
+			const double* restrict wr = &w[src * k];
+			double m2 = 0;
+			double m4 = 0;
+			for (size_t t = 0; t < T; ++t)
+			{
+				double s = 0;
+				for (size_t j = 0; j < k; ++j)
+				{
+					s += wr[j] * z[j * T + t];
+				}
+				m2 += s * s;
+				m4 += s * s * s * s;
+			}
+			m2 *= inv_t;
+			m4 *= inv_t;
+			kurtosis_[r] = m2 > 0 ? m4 / (m2 * m2) - 3 : 0.0;
+		}
+		removed_.clear();
+		update_projection();
+		return true;
+	}
+
+	bool ica_model::save(const std::string& path, std::string* error) const
+	{
+		std::ofstream out(path, std::ios::trunc);
+		if (!out)
+		{
+			if (error)
+			{
+				*error = "failed to open " + path;
+			}
+			return false;
+		}
+		json_writer w(out);
+		w.begin_object();
+		w.member("n_chans", static_cast<uint64_t>(n_chans_));
+		w.member("n_components", static_cast<uint64_t>(n_components_));
+		w.member("iterations", static_cast<uint64_t>(iterations_));
+		w.member("converged", converged_);
+		w.key("mean").begin_array();
+		for (double v : mean_)
+		{
+			w.value(v);
+		}
+		w.end_array();
+		write_matrix(w, "unmixing", unmixing_, n_components_, n_chans_);
+		write_matrix(w, "mixing", mixing_, n_chans_, n_components_);
+		w.key("variance").begin_array();
+		for (double v : variance_)
+		{
+			w.value(v);
+		}
+		w.end_array();
+		w.key("kurtosis").begin_array();
+		for (double v : kurtosis_)
+		{
+			w.value(v);
+		}
+		w.end_array();
+		w.key("removed").begin_array();
+		for (size_t r : removed_)
+		{
+			w.value(static_cast<uint64_t>(r));
+		}
+		w.end_array();
+		w.end_object();
+		out << std::endl;
+		if (!out.flush())
+		{
+			if (error)
+			{
+				*error = path + ": write failed";
+			}
+			return false;
+		}
+		return true;
+	}
+
+	bool ica_model::load(const std::string& path, std::string* error)
+	{
+		json_value root;
+		if (!read_json_file(path, root, error))
+		{
+			return false;
+		}
+		const double chans = root.number_or("n_chans", 0);
+		const double components = root.number_or("n_components", 0);
+		if (!(chans >= 1) || !(components >= 1) || components > chans)
+		{
+			if (error)
+			{
+				*error = path + ": not an ICA model";
+			}
+			return false;
+		}
+		ica_model m;
+		m.n_chans_ = static_cast<size_t>(chans);
+		m.n_components_ = static_cast<size_t>(components);
+		m.iterations_ = static_cast<size_t>(root.number_or("iterations", 0));
+		m.converged_ = root.bool_or("converged", false);
+		if (!read_vector(root, "mean", m.n_chans_, m.mean_) || !read_matrix(root, "unmixing", m.n_components_, m.n_chans_, m.unmixing_)
+			|| !read_matrix(root, "mixing", m.n_chans_, m.n_components_, m.mixing_))
+		{
+			if (error)
+			{
+				*error = path + ": ICA model matrices do not match its channel and component counts";
+			}
+			return false;
+		}
+		if (!read_vector(root, "variance", m.n_components_, m.variance_))
+		{
+			m.variance_.assign(m.n_components_, 0.0);
+		}
+		if (!read_vector(root, "kurtosis", m.n_components_, m.kurtosis_))
+		{
+			m.kurtosis_.assign(m.n_components_, 0.0);
+		}
+		std::vector<size_t> removed;
+		if (const json_value* r = root.find("removed"))
+		{
+			for (const json_value& item : r->items())
+			{
+				removed.push_back(static_cast<size_t>(item.as_number()));
+			}
+		}
+		m.set_removed(removed);
+		*this = std::move(m);
+		return true;
+	}
+
+	void ica_model::sources(const double* x, size_t n_samples, double* out) const
+	{
+		project(unmixing_.data(), n_components_, n_chans_, x, n_samples, out);
+		for (size_t r = 0; r < n_components_; ++r)
+		{
+			const double shift = std::inner_product(mean_.begin(), mean_.end(), unmixing_.begin() + static_cast<std::ptrdiff_t>(r * n_chans_), 0.0);
+			double* y = out + r * n_samples;
+			for (size_t t = 0; t < n_samples; ++t)
+			{
+				y[t] -= shift;
+			}
+		}
+	}
+
+	void ica_model::set_removed(const std::vector<size_t>& components)
+	{
+		removed_.clear();
+		for (size_t r : components)
+		{
+			if (r < n_components_ && std::find(removed_.begin(), removed_.end(), r) == removed_.end())
+			{
+				removed_.push_back(r);
+			}
+		}
+		std::sort(removed_.begin(), removed_.end());
+		update_projection();
+	}
+
+	void ica_model::update_projection()
+	{
+		// Cleaned = P x + (I - P) mean with P = I - A_r U_r over the removed
+		// components r
+		const size_t n = n_chans_;
+		projection_.assign(n * n, 0.0);
+		for (size_t i = 0; i < n; ++i)
+		{
+			projection_[i * n + i] = 1;
+		}
+		for (size_t r : removed_)
+		{
+			for (size_t i = 0; i < n; ++i)
+			{
+				const double a = mixing_[i * n_components_ + r];
+				for (size_t j = 0; j < n; ++j)
+				{
+					projection_[i * n + j] -= a * unmixing_[r * n + j];
+				}
+			}
+		}
+		offset_.assign(n, 0.0);
+		for (size_t i = 0; i < n; ++i)
+		{
+			double sum = mean_[i];
+			for (size_t j = 0; j < n; ++j)
+			{
+				sum -= projection_[i * n + j] * mean_[j];
+			}
+			offset_[i] = sum;
+		}
+	}
+
+	void ica_model::clean(const double* x, size_t n_samples, double* out) const
+	{
+		if (removed_.empty())
+		{
+			std::copy(x, x + n_chans_ * n_samples, out);
+			return;
+		}
+		project(projection_.data(), n_chans_, n_chans_, x, n_samples, out);
+		for (size_t i = 0; i < n_chans_; ++i)
+		{
+			double* restrict y = out + i * n_samples;
+			const double b = offset_[i];
+			for (size_t t = 0; t < n_samples; ++t)
+			{
+				y[t] += b;
+			}
+		}
+	}
+} // namespace eeg
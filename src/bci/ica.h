@@ -0,0 +1,132 @@
+/**
+ * @file ica.h
+ * @brief FastICA decomposition fitted offline and applied to live blocks
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace eeg
+{
+	struct ica_options
+	{
+		size_t components = 0; ///< 0 for one per channel; fewer drops the weakest principal components first
+		size_t max_iterations = 200;
+		double tolerance = 1e-4; ///< Largest change of a component direction at convergence
+		size_t threads = 1;      ///< Workers sharing the components of each iteration
+		uint32_t seed = 1;       ///< For the initial unmixing matrix
+	};
+
+	/**
+	 * @brief Independent components of multichannel EEG, for removing eye
+	 * and muscle artifacts
+	 *
+	 * @details `fit()` runs symmetric FastICA with the logcosh contrast on
+	 * a calibration segment: centring, PCA whitening through a Jacobi
+	 * eigen-decomposition (linalg.h), then fixed-point updates of all
+	 * components at once, each update followed by symmetric
+	 * decorrelation. The components of an iteration are independent and
+	 * are shared across a `work_pool`; their loops run over contiguous
+	 * samples and vectorise.
+	 *
+	 * Components are ordered by the share of channel variance they
+	 * explain, and their excess kurtosis on the fitting data is kept as a
+	 * hint: blinks give strongly positive values. After `set_removed()`,
+	 * `clean()` subtracts the removed components' back-projection from a
+	 * block. That is a single precomputed `n_chans` x `n_chans` projection,
+	 * so each block costs `n_chans` multiply-adds per channel and sample
+	 * whatever the number of components.
+	 *
+	 * Live data must be preprocessed like the fitting data, typically with
+	 * the same highpass, for the projection to stay valid.
+	 */
+	class ica_model
+	{
+	public:
+		/**
+		 * @param x Channel-major (channel n at `x[n * n_samples]`)
+		 * @return false with fewer samples than channels squared or a
+		 * covariance without any variance
+		 */
+		bool fit(const double* x, size_t n_chans, size_t n_samples, const ica_options& opts, std::string* error = nullptr);
+
+		/**
+		 * @brief Writes the model, including the removed components, as JSON
+		 */
+		bool save(const std::string& path, std::string* error = nullptr) const;
+
+		bool load(const std::string& path, std::string* error = nullptr);
+
+		bool valid() const { return n_chans_ > 0; }
+		size_t n_chans() const { return n_chans_; }
+		size_t n_components() const { return n_components_; }
+		size_t iterations() const { return iterations_; }
+		bool converged() const { return converged_; }
+
+		const std::vector<double>& mean() const { return mean_; }
+
+		/**
+		 * @brief `n_components` x `n_chans`, row-major; maps centred
+		 * channels to unit-variance components
+		 */
+		const std::vector<double>& unmixing() const { return unmixing_; }
+
+		/**
+		 * @brief `n_chans` x `n_components`, row-major; column k is
+		 * component k's scalp map
+		 */
+		const std::vector<double>& mixing() const { return mixing_; }
+
+		/**
+		 * @brief Fraction of the fitting data's channel variance each
+		 * component explains, descending
+		 */
+		const std::vector<double>& variance() const { return variance_; }
+
+		/**
+		 * @brief Excess kurtosis of each component on the fitting data
+		 */
+		const std::vector<double>& kurtosis() const { return kurtosis_; }
+
+		/**
+		 * @brief Component time courses of a block
+		 *
+		 * @param out `n_components * n_samples`, component-major
+		 */
+		void sources(const double* x, size_t n_samples, double* out) const;
+
+		/**
+		 * @brief Selects the components `clean()` removes; indices out of
+		 * range are ignored
+		 */
+		void set_removed(const std::vector<size_t>& components);
+
+		const std::vector<size_t>& removed() const { return removed_; }
+
+		/**
+		 * @brief Writes a channel-major block with the removed components
+		 * subtracted to `out`, which must not overlap `x`
+		 */
+		void clean(const double* x, size_t n_samples, double* out) const;
+
+	private:
+		void update_projection();
+
+		size_t n_chans_ = 0;
+		size_t n_components_ = 0;
+		size_t iterations_ = 0;
+		bool converged_ = false;
+		std::vector<double> mean_;
+		std::vector<double> unmixing_;
+		std::vector<double> mixing_;
+		std::vector<double> variance_;
+		std::vector<double> kurtosis_;
+		std::vector<size_t> removed_;
+		std::vector<double> projection_; ///< `n_chans` x `n_chans`, identity minus the removed back-projection
+		std::vector<double> offset_;     ///< Restores the removed components' share of the mean
+	};
+} // namespace eeg
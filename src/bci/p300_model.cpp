@@ -0,0 +1,90 @@
+#include "bci/p300_model.h"
+
+#include "util/process_stats.h"
+
+#include <utility>
+
+namespace eeg
+{
+	namespace
+	{
+		size_t footprint(const process_memory& m)
+		{
+			return m.heap_valid ? m.heap_in_use_bytes : m.rss_bytes;
+		}
+	} // namespace
+
+	p300_model::~p300_model()
+	{
+		reset();
+	}
+
+	p300_model::p300_model(p300_model&& other) noexcept
+		: handle_(std::exchange(other.handle_, nullptr)), spec_(std::exchange(other.spec_, nullptr)), memory_(std::move(other.memory_))
+	{
+	}
+
+	p300_model& p300_model::operator=(p300_model&& other) noexcept
+	{
+		if (this != &other)
+		{
+			reset();
+			handle_ = std::exchange(other.handle_, nullptr);
+			spec_ = std::exchange(other.spec_, nullptr);
+			memory_ = std::move(other.memory_);
+		}
+		return *this;
+	}
+
+	void p300_model::reset()
+	{
+		if (handle_)
+		{
+			ba_bci_connect_p300_free(handle_);
+			handle_ = nullptr;
+		}
+		spec_ = nullptr;
+		memory_ = tracked_external();
+	}
+
+	ba_bci_connect_error p300_model::init(uint8_t model_number, memory_owner owner)
+	{
+		reset();
+
+		const p300_model_spec* spec = nullptr;
+		for (const p300_model_spec& s : p300_models)
+		{
+			if (s.model_number == model_number)
+			{
+				spec = &s;
+			}
+		}
+		if (!spec)
+		{
+			return BA_BCI_CONNECT_ERROR_NOT_ALLOWED_MODEL_NUMBER;
+		}
+
+		const size_t before = footprint(sample_process_memory());
+		void* handle = nullptr;
+		const ba_bci_connect_error err = ba_bci_connect_p300_init(&handle, model_number);
+		if (err != BA_BCI_CONNECT_ERROR_OK)
+		{
+			return err;
+		}
+		const size_t after = footprint(sample_process_memory());
+
+		handle_ = handle;
+		spec_ = spec;
+		memory_ = tracked_external(owner, memory_category::classifier_models, after > before ? after - before : 0);
+		return BA_BCI_CONNECT_ERROR_OK;
+	}
+
+	ba_bci_connect_error p300_model::predict(const double* measurements, double* result) const
+	{
+		if (!handle_)
+		{
+			return BA_BCI_CONNECT_ERROR_UNKNOWN;
+		}
+		return ba_bci_connect_p300_predict(handle_, measurements, result);
+	}
+} // namespace eeg
@@ -0,0 +1,64 @@
+/**
+ * @file p300_model.h
+ * @brief Owning wrapper around a bciconnect P300 model instance
+ */
+
+#pragma once
+
+#include "bci/p300_models.h"
+#include "p300_classifier.h"
+#include "util/memory_accounting.h"
+
+namespace eeg
+{
+	/**
+	 * @brief RAII handle for `ba_bci_connect_p300_*`
+	 *
+	 * @details The model's memory lives inside bciconnect, so it is estimated
+	 * from the growth of the process heap (or RSS where heap statistics are
+	 * unavailable) across `ba_bci_connect_p300_init` and accounted under
+	 * `memory_category::classifier_models`. The estimate is skewed if other
+	 * threads allocate concurrently with `init()`.
+	 */
+	class p300_model
+	{
+	public:
+		p300_model() = default;
+		~p300_model();
+		p300_model(p300_model&& other) noexcept;
+		p300_model& operator=(p300_model&& other) noexcept;
+		p300_model(const p300_model&) = delete;
+		p300_model& operator=(const p300_model&) = delete;
+
+		/**
+		 * @brief Loads a model from the zoo, replacing any loaded one
+		 *
+		 * @param owner Manager the model's memory is accounted to
+		 */
+		ba_bci_connect_error init(uint8_t model_number, memory_owner owner = nullptr);
+
+		bool valid() const { return handle_ != nullptr; }
+
+		/**
+		 * @brief Input geometry of the loaded model; only valid when `valid()`
+		 */
+		const p300_model_spec& spec() const { return *spec_; }
+
+		/**
+		 * @brief See `ba_bci_connect_p300_predict`
+		 */
+		ba_bci_connect_error predict(const double* measurements, double* result) const;
+
+		/**
+		 * @brief Estimated bytes held by the model
+		 */
+		size_t memory_bytes() const { return memory_.bytes(); }
+
+	private:
+		void reset();
+
+		void* handle_ = nullptr;
+		const p300_model_spec* spec_ = nullptr;
+		tracked_external memory_;
+	};
+} // namespace eeg
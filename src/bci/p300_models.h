@@ -0,0 +1,42 @@
+/**
+ * @file p300_models.h
+ * @brief Input geometry of the P300 model zoo shipped with bciconnect
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace eeg
+{
+	/**
+	 * @brief Samples per repetition expected by every P300 model
+	 */
+	constexpr size_t p300_samples_per_repetition = 176;
+
+	/**
+	 * @brief Shape of the measurement array `ba_bci_connect_p300_predict` expects
+	 *
+	 * @details Mirrors the model list documented in p300_classifier.h. The
+	 * array is laid out channel-major, repetitions within a channel.
+	 */
+	struct p300_model_spec
+	{
+		uint8_t model_number;
+		size_t n_chans;
+		size_t repetitions;
+		const char* description;
+
+		constexpr size_t input_size() const { return n_chans * repetitions * p300_samples_per_repetition; }
+	};
+
+	constexpr p300_model_spec p300_models[] = {
+		{0, 8, 3, "8 electrode Standard Kit, 3 repetitions"},
+		{1, 8, 1, "8 electrode Standard Kit, 1 repetition"},
+		{2, 8, 3, "8 electrode Standard Kit, 3 repetitions, fast (215 ms)"},
+		{3, 2, 3, "O1 and O2 only, 3 repetitions, fast (215 ms)"},
+	};
+
+	constexpr size_t p300_model_count = sizeof(p300_models) / sizeof(p300_models[0]);
+} // namespace eeg
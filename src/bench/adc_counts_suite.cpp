@@ -0,0 +1,109 @@
+#include "bench/suites.h"
+
+#include "stream/adc_counts.h"
+#include "stream/count_ring.h"
+#include "stream/stream_ring.h"
+
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace eeg::bench
+{
+	namespace
+	{
+		constexpr size_t n_chans = 32;
+		constexpr size_t n_samples = 250; ///< One second at 250 Hz
+
+		double scale()
+		{
+			return adc_microvolts_per_count(BA_GAIN_MODE_X8);
+		}
+
+		/**
+		 * One second of device-like samples: whole counts at gain 8.
+		 */
+		std::shared_ptr<std::vector<double>> samples()
+		{
+			auto x = std::make_shared<std::vector<double>>(n_chans * n_samples);
+			for (size_t i = 0; i < x->size(); ++i)
+			{
+				(*x)[i] = std::nearbyint(50 * std::sin(0.05 * static_cast<double>(i)) / scale()) * scale();
+			}
+			return x;
+		}
+
+		void run_kernels(harness& h, const std::string& variant, void (*to)(const double*, size_t, double, int32_t*),
+						 void (*from)(const int32_t*, size_t, double, double*))
+		{
+			const std::vector<parameter> params = {{"n_chans", static_cast<double>(n_chans)}, {"n_samples", static_cast<double>(n_samples)}};
+			if (h.selected("adc_counts", "to_counts/" + variant))
+			{
+				h.run("adc_counts", "to_counts/" + variant, params, [to]() -> operation {
+					auto x = samples();
+					auto counts = std::make_shared<std::vector<int32_t>>(x->size());
+					return [x, counts, to] { to(x->data(), x->size(), scale(), counts->data()); };
+				});
+			}
+			if (h.selected("adc_counts", "from_counts/" + variant))
+			{
+				h.run("adc_counts", "from_counts/" + variant, params, [from]() -> operation {
+					auto x = samples();
+					auto counts = std::make_shared<std::vector<int32_t>>(x->size());
+					to_counts(x->data(), x->size(), scale(), counts->data());
+					return [x, counts, from] { from(counts->data(), counts->size(), scale(), x->data()); };
+				});
+			}
+		}
+
+		/**
+		 * One second through a ring: write from chunk pointers, then read a
+		 * channel-major block.
+		 */
+		template <typename Ring>
+		void run_ring(harness& h, const std::string& name, size_t bytes_per_sample, std::shared_ptr<Ring> (*make)())
+		{
+			if (!h.selected("adc_counts", name))
+			{
+				return;
+			}
+			h.run("adc_counts", name,
+				  {{"n_chans", static_cast<double>(n_chans)},
+				   {"n_samples", static_cast<double>(n_samples)},
+				   {"bytes", static_cast<double>(n_chans * n_samples * bytes_per_sample)}},
+				  [make]() -> operation {
+					  auto x = samples();
+					  auto out = std::make_shared<std::vector<double>>(x->size());
+					  auto ring = make();
+					  auto channels = std::make_shared<std::vector<const double*>>(n_chans);
+					  for (size_t c = 0; c < n_chans; ++c)
+					  {
+						  (*channels)[c] = x->data() + c * n_samples;
+					  }
+					  return [x, out, ring, channels] {
+						  ring->write(channels->data(), n_samples);
+						  ring->read(out->data(), n_samples);
+					  };
+				  });
+		}
+
+		std::shared_ptr<stream_ring> make_stream_ring()
+		{
+			return std::make_shared<stream_ring>(n_chans, n_samples * 4);
+		}
+
+		std::shared_ptr<count_ring> make_count_ring()
+		{
+			return std::make_shared<count_ring>(std::vector<double>(n_chans, scale()), n_samples * 4);
+		}
+	} // namespace
+
+	void run_adc_counts_suite(harness& h)
+	{
+		run_kernels(h, "simd", &to_counts, &from_counts);
+		run_kernels(h, "scalar", &to_counts_scalar, &from_counts_scalar);
+		run_ring<stream_ring>(h, "ring/float64", sizeof(double), &make_stream_ring);
+		run_ring<count_ring>(h, "ring/counts", sizeof(int32_t), &make_count_ring);
+	}
+} // namespace eeg::bench
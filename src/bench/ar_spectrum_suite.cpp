@@ -0,0 +1,97 @@
+#include "bench/suites.h"
+
+#include "bci/ar_spectrum.h"
+#include "util/synthetic_signal.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace eeg::bench
+{
+	namespace
+	{
+		constexpr size_t n_chans = 32;
+		constexpr double rate = 250;
+		constexpr size_t window = 125; ///< Half a second
+		constexpr size_t order = 16;
+
+		std::shared_ptr<const std::vector<double>> samples()
+		{
+			synthetic_signal_spec spec;
+			spec.sampling_rate = rate;
+			return std::make_shared<const std::vector<double>>(synthetic_eeg(spec, n_chans, window));
+		}
+
+		/**
+		 * `n` frequencies spread evenly from `low` to `high` Hz.
+		 */
+		std::vector<double> grid(double low, double high, size_t n)
+		{
+			std::vector<double> f(n);
+			for (size_t i = 0; i < n; ++i)
+			{
+				f[i] = low + (high - low) * static_cast<double>(i) / static_cast<double>(n - 1);
+			}
+			return f;
+		}
+	} // namespace
+
+	void run_ar_spectrum_suite(harness& h)
+	{
+		const std::vector<parameter> params = {
+			{"n_chans", static_cast<double>(n_chans)}, {"window", static_cast<double>(window)}, {"order", static_cast<double>(order)}};
+		if (h.selected("ar_spectrum", "fit/batched"))
+		{
+			h.run("ar_spectrum", "fit/batched", params, []() -> operation {
+				auto x = samples();
+				auto ar = std::make_shared<ar_spectrum>();
+				ar->init(n_chans, rate, grid(7, 13, 61), order);
+				return [x, ar] {
+					ar->fit(x->data(), window);
+					volatile double sink = ar->noise()[0];
+					(void)sink;
+				};
+			});
+		}
+		if (h.selected("ar_spectrum", "fit/per_channel"))
+		{
+			// The same fits one channel at a time, where the recursion's
+			// inner loops have nothing to vectorise over
+			h.run("ar_spectrum", "fit/per_channel", params, []() -> operation {
+				auto x = samples();
+				auto ar = std::make_shared<ar_spectrum>();
+				ar->init(1, rate, grid(7, 13, 61), order);
+				return [x, ar] {
+					double sink_sum = 0;
+					for (size_t c = 0; c < n_chans; ++c)
+					{
+						ar->fit(x->data() + c * window, window);
+						sink_sum += ar->noise()[0];
+					}
+					volatile double sink = sink_sum;
+					(void)sink;
+				};
+			});
+		}
+		for (size_t n_freqs : {size_t(61), size_t(1024)})
+		{
+			const std::string name = n_freqs == 61 ? "evaluate/alpha_0.1hz" : "evaluate/dense_1024";
+			if (h.selected("ar_spectrum", name))
+			{
+				h.run("ar_spectrum", name, params, [n_freqs]() -> operation {
+					auto x = samples();
+					auto ar = std::make_shared<ar_spectrum>();
+					ar->init(n_chans, rate, n_freqs == 61 ? grid(7, 13, 61) : grid(0, rate / 2, n_freqs), order);
+					ar->fit(x->data(), window);
+					auto out = std::make_shared<std::vector<double>>(n_chans * n_freqs);
+					return [ar, out] {
+						ar->evaluate(out->data());
+						volatile double sink = (*out)[0];
+						(void)sink;
+					};
+				});
+			}
+		}
+	}
+} // namespace eeg::bench
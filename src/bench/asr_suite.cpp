@@ -0,0 +1,76 @@
+#include "bench/suites.h"
+
+#include "bci/asr.h"
+#include "util/synthetic_signal.h"
+
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace eeg::bench
+{
+	namespace
+	{
+		constexpr size_t n_chans = 32;
+		constexpr double rate = 500;
+		constexpr size_t calibration = 30000; ///< One minute
+		constexpr size_t chunk = 25;
+		constexpr size_t n_samples = 5000;
+
+		/**
+		 * A filter calibrated on clean data and a stream to feed it, with
+		 * an artifact over every channel throughout when `artifact`, which
+		 * keeps the reconstruction running.
+		 */
+		operation feed(bool artifact)
+		{
+			synthetic_signal_spec spec;
+			spec.sampling_rate = rate;
+			auto filter = std::make_shared<asr_filter>();
+			{
+				const std::vector<double> clean = synthetic_eeg(spec, n_chans, calibration);
+				filter->calibrate(clean.data(), n_chans, calibration, rate, asr_options());
+			}
+			spec.seed = 2;
+			auto x = std::make_shared<std::vector<double>>(synthetic_eeg(spec, n_chans, n_samples));
+			if (artifact)
+			{
+				for (size_t c = 0; c < n_chans; ++c)
+				{
+					for (size_t t = 0; t < n_samples; ++t)
+					{
+						(*x)[c * n_samples + t] += 300 * std::sin(0.02 * static_cast<double>(t)) * std::cos(0.3 * static_cast<double>(c));
+					}
+				}
+			}
+			auto in = std::make_shared<std::vector<double>>(n_chans * chunk);
+			auto out = std::make_shared<std::vector<double>>(n_chans * chunk);
+			auto start = std::make_shared<size_t>(0);
+			return [filter, x, in, out, start] {
+				for (size_t c = 0; c < n_chans; ++c)
+				{
+					std::copy(x->begin() + static_cast<std::ptrdiff_t>(c * n_samples + *start),
+							  x->begin() + static_cast<std::ptrdiff_t>(c * n_samples + *start + chunk), in->begin() + static_cast<std::ptrdiff_t>(c * chunk));
+				}
+				filter->process(in->data(), chunk, out->data());
+				*start = *start + 2 * chunk > n_samples ? 0 : *start + chunk;
+				volatile double sink = (*out)[0];
+				(void)sink;
+			};
+		}
+	} // namespace
+
+	void run_asr_suite(harness& h)
+	{
+		const std::vector<parameter> params = {{"n_chans", static_cast<double>(n_chans)}, {"sampling_rate", rate}, {"chunk", static_cast<double>(chunk)}};
+		if (h.selected("asr", "chunk/clean"))
+		{
+			h.run("asr", "chunk/clean", params, []() -> operation { return feed(false); });
+		}
+		if (h.selected("asr", "chunk/artifact"))
+		{
+			h.run("asr", "chunk/artifact", params, []() -> operation { return feed(true); });
+		}
+	}
+} // namespace eeg::bench
@@ -0,0 +1,344 @@
+#include "bench/bench_harness.h"
+
+#include "util/json_writer.h"
+#include "util/stats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+namespace eeg::bench
+{
+	namespace
+	{
+		using clock = std::chrono::steady_clock;
+
+		double elapsed_ns(clock::time_point from, clock::time_point to)
+		{
+			return std::chrono::duration<double, std::nano>(to - from).count();
+		}
+
+		/**
+		 * Per-call event counts plus the derived ratios that separate
+		 * memory-bound from compute-bound kernels. Events the platform could
+		 * not count are reported as null.
+		 */
+		void write_counters(json_writer& w, const perf_sample& s, size_t iterations)
+		{
+			const double n = static_cast<double>(iterations);
+			w.key("counters_per_call").begin_object();
+			for (size_t i = 0; i < perf_event_count; ++i)
+			{
+				w.key(perf_event_name(static_cast<perf_event>(i)));
+				if (s.valid[i])
+				{
+					w.value(s.values[i] / n);
+				}
+				else
+				{
+					w.null();
+				}
+			}
+			if (s.has(perf_event::cycles) && s.has(perf_event::instructions) && s.get(perf_event::cycles) > 0)
+			{
+				w.member("instructions_per_cycle", s.get(perf_event::instructions) / s.get(perf_event::cycles));
+			}
+			if (s.has(perf_event::cache_misses) && s.has(perf_event::instructions) && s.get(perf_event::instructions) > 0)
+			{
+				w.member("cache_misses_per_kilo_instruction", 1000 * s.get(perf_event::cache_misses) / s.get(perf_event::instructions));
+			}
+			w.end_object();
+		}
+
+		std::vector<size_t> default_thread_counts()
+		{
+			const size_t hw = std::max<size_t>(1, std::thread::hardware_concurrency());
+			std::vector<size_t> counts{1};
+			for (size_t n = 2; n < hw; n *= 2)
+			{
+				counts.push_back(n);
+			}
+			if (hw > 1)
+			{
+				counts.push_back(hw);
+			}
+			return counts;
+		}
+	} // namespace
+
+	latency_stats measure_latency(const operation& op, const options& opts)
+	{
+		// One untimed call to fault in buffers and warm caches
+		op();
+
+		std::vector<double> samples;
+		samples.reserve(std::min<size_t>(opts.max_iterations, 4096));
+		const auto start = clock::now();
+		while (samples.size() < opts.max_iterations &&
+			   (samples.size() < opts.min_iterations || elapsed_ns(start, clock::now()) < opts.min_seconds * 1e9))
+		{
+			const auto t0 = clock::now();
+			op();
+			samples.push_back(elapsed_ns(t0, clock::now()));
+		}
+
+		latency_stats stats;
+		stats.iterations = samples.size();
+		double sum = 0;
+		for (const double s : samples)
+		{
+			sum += s;
+		}
+		std::sort(samples.begin(), samples.end());
+		stats.mean_ns = sum / static_cast<double>(samples.size());
+		stats.min_ns = samples.front();
+		stats.p50_ns = percentile(samples, 0.50);
+		stats.p90_ns = percentile(samples, 0.90);
+		stats.p99_ns = percentile(samples, 0.99);
+		stats.max_ns = samples.back();
+		return stats;
+	}
+
+	throughput_stats measure_throughput(const operation_factory& factory, size_t threads, double seconds)
+	{
+		throughput_stats stats;
+		stats.threads = threads;
+
+		// Build every thread's state up front so setup cost is not measured
+		std::vector<operation> ops;
+		for (size_t i = 0; i < threads; ++i)
+		{
+			ops.push_back(factory());
+			if (!ops.back())
+			{
+				return stats;
+			}
+		}
+
+		std::atomic<size_t> ready{0};
+		std::atomic<bool> go{false};
+		std::atomic<bool> stop{false};
+		std::vector<size_t> counts(threads, 0);
+		std::vector<std::thread> workers;
+		for (size_t i = 0; i < threads; ++i)
+		{
+			workers.emplace_back([&, i] {
+				ops[i]();
+				++ready;
+				while (!go.load(std::memory_order_acquire))
+				{
+					std::this_thread::yield();
+				}
+				size_t n = 0;
+				while (!stop.load(std::memory_order_relaxed))
+				{
+					ops[i]();
+					++n;
+				}
+				counts[i] = n;
+			});
+		}
+
+		while (ready.load() < threads)
+		{
+			std::this_thread::yield();
+		}
+		const auto start = clock::now();
+		go.store(true, std::memory_order_release);
+		std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+		stop.store(true);
+		for (auto& w : workers)
+		{
+			w.join();
+		}
+		// Threads finish their last call after `stop`, so measure to the join
+		stats.seconds = elapsed_ns(start, clock::now()) * 1e-9;
+
+		for (const size_t n : counts)
+		{
+			stats.operations += n;
+		}
+		stats.ops_per_second = static_cast<double>(stats.operations) / stats.seconds;
+		stats.mean_ns_per_op = stats.operations ? stats.seconds * 1e9 * static_cast<double>(threads) / static_cast<double>(stats.operations) : 0;
+		return stats;
+	}
+
+	perf_sample measure_counters(const operation& op, size_t iterations, perf_counters& counters)
+	{
+		counters.start();
+		for (size_t i = 0; i < iterations; ++i)
+		{
+			op();
+		}
+		counters.stop();
+		return counters.read();
+	}
+
+	harness::harness(options opts) : opts_(std::move(opts))
+	{
+		if (opts_.thread_counts.empty())
+		{
+			opts_.thread_counts = default_thread_counts();
+		}
+		if (opts_.hardware_counters)
+		{
+			counters_ = std::make_unique<perf_counters>();
+			if (!counters_->available())
+			{
+				std::cerr << "Hardware counters disabled: " << counters_->unavailable_reason() << std::endl;
+			}
+		}
+	}
+
+	harness::~harness() = default;
+
+	bool harness::selected(const std::string& suite, const std::string& name) const
+	{
+		return opts_.filter.empty() || (suite + "/" + name).find(opts_.filter) != std::string::npos;
+	}
+
+	void harness::run(const std::string& suite, const std::string& name, std::vector<parameter> params, const operation_factory& factory)
+	{
+		if (!selected(suite, name))
+		{
+			return;
+		}
+
+		case_result r;
+		r.suite = suite;
+		r.name = name;
+		r.params = std::move(params);
+
+		const operation op = factory();
+		if (!op)
+		{
+			r.ok = false;
+			r.error = "setup failed";
+			std::cerr << suite << "/" << name << ": setup failed" << std::endl;
+			results_.push_back(std::move(r));
+			return;
+		}
+		r.latency = measure_latency(op, opts_);
+		if (counters_ && counters_->available())
+		{
+			// Separate pass so the per-call clock reads are not counted
+			r.counter_iterations = r.latency.iterations;
+			r.counters = measure_counters(op, r.counter_iterations, *counters_);
+		}
+
+		for (const size_t threads : opts_.thread_counts)
+		{
+			throughput_stats t = measure_throughput(factory, threads, opts_.throughput_seconds);
+			if (t.operations == 0)
+			{
+				r.ok = false;
+				r.error = "setup failed for " + std::to_string(threads) + " threads";
+				break;
+			}
+			r.throughput.push_back(t);
+		}
+
+		std::cerr << suite << "/" << name << ": p50 " << r.latency.p50_ns / 1e3 << " us";
+		if (r.counters.has(perf_event::cycles) && r.counters.has(perf_event::instructions) && r.counters.get(perf_event::cycles) > 0)
+		{
+			std::cerr << ", IPC " << r.counters.get(perf_event::instructions) / r.counters.get(perf_event::cycles);
+		}
+		if (!r.throughput.empty())
+		{
+			std::cerr << ", " << r.throughput.back().ops_per_second << " ops/s on " << r.throughput.back().threads << " threads";
+		}
+		std::cerr << std::endl;
+		results_.push_back(std::move(r));
+	}
+
+	void harness::fail(const std::string& suite, const std::string& name, std::vector<parameter> params, const std::string& error)
+	{
+		if (!selected(suite, name))
+		{
+			return;
+		}
+		case_result r;
+		r.suite = suite;
+		r.name = name;
+		r.params = std::move(params);
+		r.ok = false;
+		r.error = error;
+		std::cerr << suite << "/" << name << ": " << error << std::endl;
+		results_.push_back(std::move(r));
+	}
+
+	void harness::write_json(std::ostream& out) const
+	{
+		json_writer w(out);
+		w.begin_object();
+		w.key("config").begin_object();
+		w.member("min_seconds", opts_.min_seconds);
+		w.member("throughput_seconds", opts_.throughput_seconds);
+		w.member("hardware_threads", static_cast<uint64_t>(std::thread::hardware_concurrency()));
+		w.key("hardware_counters").begin_object();
+		w.member("available", counters_ && counters_->available());
+		if (!counters_)
+		{
+			w.member("reason", "disabled by option");
+		}
+		else if (!counters_->available())
+		{
+			w.member("reason", counters_->unavailable_reason());
+		}
+		w.end_object();
+		w.end_object();
+
+		w.key("results").begin_array();
+		for (const case_result& r : results_)
+		{
+			w.begin_object();
+			w.member("suite", r.suite);
+			w.member("name", r.name);
+			w.key("params").begin_object();
+			for (const parameter& p : r.params)
+			{
+				w.member(p.first, p.second);
+			}
+			w.end_object();
+			w.member("ok", r.ok);
+			if (!r.ok)
+			{
+				w.member("error", r.error);
+			}
+			if (r.latency.iterations > 0)
+			{
+				w.key("latency_ns").begin_object();
+				w.member("iterations", static_cast<uint64_t>(r.latency.iterations));
+				w.member("mean", r.latency.mean_ns);
+				w.member("min", r.latency.min_ns);
+				w.member("p50", r.latency.p50_ns);
+				w.member("p90", r.latency.p90_ns);
+				w.member("p99", r.latency.p99_ns);
+				w.member("max", r.latency.max_ns);
+				w.end_object();
+			}
+			if (r.counter_iterations > 0)
+			{
+				write_counters(w, r.counters, r.counter_iterations);
+			}
+			w.key("throughput").begin_array();
+			for (const throughput_stats& t : r.throughput)
+			{
+				w.begin_object();
+				w.member("threads", static_cast<uint64_t>(t.threads));
+				w.member("operations", static_cast<uint64_t>(t.operations));
+				w.member("seconds", t.seconds);
+				w.member("ops_per_second", t.ops_per_second);
+				w.member("mean_ns_per_op", t.mean_ns_per_op);
+				w.end_object();
+			}
+			w.end_array();
+			w.end_object();
+		}
+		w.end_array();
+		w.end_object();
+		out << std::endl;
+	}
+} // namespace eeg::bench
@@ -0,0 +1,142 @@
+/**
+ * @file bench_harness.h
+ * @brief Latency and throughput measurement for benchmark suites
+ */
+
+#pragma once
+
+#include "bench/perf_counters.h"
+
+#include <cstddef>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace eeg::bench
+{
+	/**
+	 * @brief One call of the code under test
+	 */
+	using operation = std::function<void()>;
+
+	/**
+	 * @brief Creates an operation together with any state it needs
+	 *
+	 * @details Called once per measuring thread, so each thread owns its own
+	 * buffers and classifier instances. Return an empty operation to signal
+	 * that setup failed.
+	 */
+	using operation_factory = std::function<operation()>;
+
+	/**
+	 * @brief Named numeric parameter of a benchmark case (channels, window, ...)
+	 */
+	using parameter = std::pair<std::string, double>;
+
+	struct latency_stats
+	{
+		size_t iterations = 0;
+		double mean_ns = 0;
+		double min_ns = 0;
+		double p50_ns = 0;
+		double p90_ns = 0;
+		double p99_ns = 0;
+		double max_ns = 0;
+	};
+
+	struct throughput_stats
+	{
+		size_t threads = 0;
+		size_t operations = 0;
+		double seconds = 0;
+		double ops_per_second = 0;
+		double mean_ns_per_op = 0; ///< Wall time per operation as seen by one thread
+	};
+
+	struct case_result
+	{
+		std::string suite;
+		std::string name;
+		std::vector<parameter> params;
+		bool ok = true;
+		std::string error;
+		latency_stats latency;
+		std::vector<throughput_stats> throughput;
+		size_t counter_iterations = 0; ///< Calls covered by `counters`, 0 if not collected
+		perf_sample counters;          ///< Hardware event totals over `counter_iterations` calls
+	};
+
+	struct options
+	{
+		double min_seconds = 0.5;        ///< Minimum measuring time per latency run
+		size_t min_iterations = 10;      ///< Minimum calls per latency run
+		size_t max_iterations = 100000;  ///< Cap on calls per latency run
+		double throughput_seconds = 0.5; ///< Measuring time per thread count
+		std::vector<size_t> thread_counts; ///< Empty means 1, the powers of two below the hardware threads, then the hardware threads
+		std::string filter;              ///< Substring that case names must contain
+		bool hardware_counters = true;   ///< Collect perf counters when the platform allows
+	};
+
+	/**
+	 * @brief Runs benchmark cases and collects their results
+	 */
+	class harness
+	{
+	public:
+		explicit harness(options opts);
+		~harness();
+
+		/**
+		 * @brief Whether a case passes the name filter
+		 */
+		bool selected(const std::string& suite, const std::string& name) const;
+
+		/**
+		 * @brief Measures single-thread latency and multi-thread throughput
+		 *
+		 * @param suite Suite the case belongs to
+		 * @param name Case name, unique within the suite
+		 * @param params Parameters reported alongside the result
+		 * @param factory Creates per-thread operations
+		 */
+		void run(const std::string& suite, const std::string& name, std::vector<parameter> params, const operation_factory& factory);
+
+		/**
+		 * @brief Records a case that could not be run
+		 */
+		void fail(const std::string& suite, const std::string& name, std::vector<parameter> params, const std::string& error);
+
+		const std::vector<case_result>& results() const { return results_; }
+		const options& opts() const { return opts_; }
+
+		/**
+		 * @brief Writes all results as a JSON document
+		 */
+		void write_json(std::ostream& out) const;
+
+	private:
+		options opts_;
+		std::vector<case_result> results_;
+		std::unique_ptr<perf_counters> counters_;
+	};
+
+	/**
+	 * @brief Times individual calls of `op` on the calling thread
+	 */
+	latency_stats measure_latency(const operation& op, const options& opts);
+
+	/**
+	 * @brief Runs `threads` copies of the operation concurrently for `seconds`
+	 *
+	 * @return Stats with `operations == 0` if any thread's setup failed
+	 */
+	throughput_stats measure_throughput(const operation_factory& factory, size_t threads, double seconds);
+
+	/**
+	 * @brief Counts hardware events over `iterations` untimed calls of `op`
+	 */
+	perf_sample measure_counters(const operation& op, size_t iterations, perf_counters& counters);
+} // namespace eeg::bench
@@ -0,0 +1,116 @@
+#include "bench/suites.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace
+{
+	void print_usage()
+	{
+		std::cerr << "Usage: bench [options]\n"
+				  << "  --filter <text>          run cases whose suite/name contains text\n"
+				  << "  --json <path>            write results to path instead of stdout\n"
+				  << "  --min-time <seconds>     minimum latency measuring time per case\n"
+				  << "  --throughput-time <sec>  measuring time per thread count\n"
+				  << "  --threads <n,n,...>      thread counts for throughput runs\n"
+				  << "  --no-counters            skip hardware performance counters\n";
+	}
+
+	std::vector<size_t> parse_list(const std::string& s)
+	{
+		std::vector<size_t> out;
+		std::stringstream ss(s);
+		std::string item;
+		while (std::getline(ss, item, ','))
+		{
+			const size_t n = std::strtoul(item.c_str(), nullptr, 10);
+			if (n > 0)
+			{
+				out.push_back(n);
+			}
+		}
+		return out;
+	}
+} // namespace
+
+int main(int argc, char** argv)
+{
+	eeg::bench::options opts;
+	std::string json_path;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		const bool has_value = i + 1 < argc;
+		if (arg == "--filter" && has_value)
+		{
+			opts.filter = argv[++i];
+		}
+		else if (arg == "--json" && has_value)
+		{
+			json_path = argv[++i];
+		}
+		else if (arg == "--min-time" && has_value)
+		{
+			opts.min_seconds = std::atof(argv[++i]);
+		}
+		else if (arg == "--throughput-time" && has_value)
+		{
+			opts.throughput_seconds = std::atof(argv[++i]);
+		}
+		else if (arg == "--no-counters")
+		{
+			opts.hardware_counters = false;
+		}
+		else if (arg == "--threads" && has_value)
+		{
+			opts.thread_counts = parse_list(argv[++i]);
+		}
+		else
+		{
+			print_usage();
+			return arg == "--help" ? 0 : 1;
+		}
+	}
+
+	eeg::bench::harness h(opts);
+	eeg::bench::run_classifier_suite(h);
+	eeg::bench::run_fused_suite(h);
+	eeg::bench::run_trigger_suite(h);
+	eeg::bench::run_bit_pack_suite(h);
+	eeg::bench::run_adc_counts_suite(h);
+	eeg::bench::run_plot_feed_suite(h);
+	eeg::bench::run_connectivity_suite(h);
+	eeg::bench::run_ica_suite(h);
+	eeg::bench::run_asr_suite(h);
+	eeg::bench::run_erp_suite(h);
+	eeg::bench::run_ar_spectrum_suite(h);
+	eeg::bench::run_entropy_suite(h);
+
+	if (json_path.empty())
+	{
+		h.write_json(std::cout);
+	}
+	else
+	{
+		std::ofstream out(json_path);
+		if (!out)
+		{
+			std::cerr << "Failed to open " << json_path << std::endl;
+			return 1;
+		}
+		h.write_json(out);
+	}
+
+	for (const auto& r : h.results())
+	{
+		if (!r.ok)
+		{
+			return 2;
+		}
+	}
+	return 0;
+}
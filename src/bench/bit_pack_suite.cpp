@@ -0,0 +1,131 @@
+#include "bench/suites.h"
+
+#include "stream/bool_ring.h"
+#include "util/bit_pack.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace eeg::bench
+{
+	namespace
+	{
+		constexpr size_t n_samples = 250 * 60; ///< One minute at 250 Hz
+		constexpr size_t n_chans = 64;         ///< Contact channels of a 32-channel bipolar device
+		constexpr size_t window = 250;         ///< Contact query window, one second
+
+		/**
+		 * Contact channels that are good except for a dropout on every eighth
+		 * channel.
+		 */
+		std::shared_ptr<std::vector<char>> contacts()
+		{
+			auto x = std::make_shared<std::vector<char>>(n_chans * n_samples, 1);
+			for (size_t c = 0; c < n_chans; c += 8)
+			{
+				for (size_t i = n_samples / 2; i < n_samples / 2 + 100; ++i)
+				{
+					(*x)[c * n_samples + i] = 0;
+				}
+			}
+			return x;
+		}
+
+		void run_pack(harness& h, const std::string& variant, void (*pack)(const bool*, size_t, uint64_t*))
+		{
+			const std::string name = "pack/" + variant;
+			if (!h.selected("bit_pack", name))
+			{
+				return;
+			}
+			h.run("bit_pack", name, {{"n_samples", static_cast<double>(n_samples)}}, [pack]() -> operation {
+				auto x = contacts();
+				auto bits = std::make_shared<std::vector<uint64_t>>(packed_words(n_samples));
+				return [x, bits, pack] { pack(reinterpret_cast<const bool*>(x->data()), n_samples, bits->data()); };
+			});
+		}
+
+		void run_unpack(harness& h, const std::string& variant, void (*unpack)(const uint64_t*, size_t, size_t, bool*))
+		{
+			const std::string name = "unpack/" + variant;
+			if (!h.selected("bit_pack", name))
+			{
+				return;
+			}
+			h.run("bit_pack", name, {{"n_samples", static_cast<double>(n_samples)}}, [unpack]() -> operation {
+				auto x = contacts();
+				auto bits = std::make_shared<std::vector<uint64_t>>(packed_words(n_samples));
+				pack_bools(reinterpret_cast<const bool*>(x->data()), n_samples, bits->data());
+				return [x, bits, unpack] { unpack(bits->data(), 0, n_samples, reinterpret_cast<bool*>(x->data())); };
+			});
+		}
+
+		/**
+		 * Channels with every contact good over each one-second window, from
+		 * a ring of bytes scanned sample by sample or from a `bool_ring`.
+		 */
+		void run_contact_window(harness& h)
+		{
+			const std::vector<parameter> params = {{"n_chans", static_cast<double>(n_chans)}, {"window", static_cast<double>(window)}};
+			if (h.selected("bit_pack", "contact_window/bytes"))
+			{
+				std::vector<parameter> bytes = params;
+				bytes.emplace_back("bytes", static_cast<double>(n_chans * n_samples));
+				h.run("bit_pack", "contact_window/bytes", bytes, []() -> operation {
+					auto x = contacts();
+					return [x] {
+						volatile size_t good = 0;
+						for (size_t start = 0; start + window <= n_samples; start += window)
+						{
+							for (size_t c = 0; c < n_chans; ++c)
+							{
+								const char* p = x->data() + c * n_samples + start;
+								bool all = true;
+								for (size_t i = 0; i < window && all; ++i)
+								{
+									all = p[i] != 0;
+								}
+								good = good + (all ? 1 : 0);
+							}
+						}
+					};
+				});
+			}
+			if (h.selected("bit_pack", "contact_window/packed"))
+			{
+				std::vector<parameter> packed = params;
+				packed.emplace_back("bytes", static_cast<double>(n_chans * packed_words(n_samples) * sizeof(uint64_t)));
+				h.run("bit_pack", "contact_window/packed", packed, []() -> operation {
+					auto x = contacts();
+					auto ring = std::make_shared<bool_ring>(n_chans, n_samples);
+					std::vector<const bool*> channels(n_chans);
+					for (size_t c = 0; c < n_chans; ++c)
+					{
+						channels[c] = reinterpret_cast<const bool*>(x->data() + c * n_samples);
+					}
+					ring->write(channels.data(), n_samples);
+					return [ring] {
+						volatile size_t good = 0;
+						for (size_t start = 0; start + window <= n_samples; start += window)
+						{
+							for (size_t c = 0; c < n_chans; ++c)
+							{
+								good = good + (ring->all_set(c, window, start) ? 1 : 0);
+							}
+						}
+					};
+				});
+			}
+		}
+	} // namespace
+
+	void run_bit_pack_suite(harness& h)
+	{
+		run_pack(h, "simd", &pack_bools);
+		run_pack(h, "scalar", &pack_bools_scalar);
+		run_unpack(h, "simd", &unpack_bools);
+		run_unpack(h, "scalar", &unpack_bools_scalar);
+		run_contact_window(h);
+	}
+} // namespace eeg::bench
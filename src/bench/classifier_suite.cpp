@@ -0,0 +1,101 @@
+#include "bench/suites.h"
+
+#include "bci/p300_model.h"
+#include "ssvep_classifier.h"
+#include "util/synthetic_signal.h"
+
+#include <memory>
+#include <string>
+
+namespace eeg::bench
+{
+	namespace
+	{
+		constexpr double sampling_rate = 250;
+
+		const size_t ssvep_class_counts[] = {2, 4, 8};
+		const size_t ssvep_channel_counts[] = {2, 4, 8, 16, 32};
+		const double ssvep_window_seconds[] = {1, 2, 4};
+
+		void run_ssvep(harness& h)
+		{
+			for (const size_t n_classes : ssvep_class_counts)
+			{
+				for (const size_t n_chans : ssvep_channel_counts)
+				{
+					for (const double window : ssvep_window_seconds)
+					{
+						const size_t n_time_steps = static_cast<size_t>(window * sampling_rate);
+						const std::string name = "ssvep_classify/classes:" + std::to_string(n_classes) + "/chans:" + std::to_string(n_chans) +
+												 "/steps:" + std::to_string(n_time_steps);
+						if (!h.selected("classifiers", name))
+						{
+							continue;
+						}
+
+						// Class frequencies 0.75 Hz apart starting at 7 Hz, stimulus on class 1
+						auto freqs = std::make_shared<std::vector<double>>();
+						for (size_t k = 0; k < n_classes; ++k)
+						{
+							freqs->push_back(7.0 + 0.75 * static_cast<double>(k));
+						}
+						synthetic_signal_spec spec;
+						spec.sampling_rate = sampling_rate;
+						spec.tone_hz = (*freqs)[1];
+						auto x = std::make_shared<const std::vector<double>>(synthetic_eeg(spec, n_chans, n_time_steps));
+
+						// The classifier is a pure function, so threads share inputs
+						h.run("classifiers", name,
+							  {{"n_classes", static_cast<double>(n_classes)},
+							   {"n_chans", static_cast<double>(n_chans)},
+							   {"n_time_steps", static_cast<double>(n_time_steps)},
+							   {"sampling_rate", sampling_rate}},
+							  [=]() -> operation {
+								  return [=] {
+									  double score = 0;
+									  volatile size_t cls = ba_bci_connect_ssvep_classify(x->data(), n_time_steps, n_chans, sampling_rate, freqs->data(),
+																						  freqs->size(), &score);
+									  (void)cls;
+								  };
+							  });
+					}
+				}
+			}
+		}
+
+		void run_p300(harness& h)
+		{
+			for (const p300_model_spec& spec : p300_models)
+			{
+				const std::string name = "p300_predict/model:" + std::to_string(spec.model_number);
+				std::vector<parameter> params = {{"model_number", spec.model_number},
+												 {"n_chans", static_cast<double>(spec.n_chans)},
+												 {"repetitions", static_cast<double>(spec.repetitions)},
+												 {"n_samples", static_cast<double>(p300_samples_per_repetition)}};
+
+				// Model instances are not documented as thread-safe, so every
+				// thread initializes its own
+				h.run("classifiers", name, std::move(params), [spec]() -> operation {
+					auto model = std::make_shared<p300_model>();
+					if (model->init(spec.model_number) != BA_BCI_CONNECT_ERROR_OK)
+					{
+						return {};
+					}
+					synthetic_signal_spec signal;
+					auto measurements = std::make_shared<const std::vector<double>>(
+						synthetic_eeg(signal, spec.n_chans * spec.repetitions, p300_samples_per_repetition));
+					return [model, measurements] {
+						double result = 0;
+						model->predict(measurements->data(), &result);
+					};
+				});
+			}
+		}
+	} // namespace
+
+	void run_classifier_suite(harness& h)
+	{
+		run_ssvep(h);
+		run_p300(h);
+	}
+} // namespace eeg::bench
@@ -0,0 +1,90 @@
+#include "bench/suites.h"
+
+#include "bci/connectivity.h"
+#include "util/synthetic_signal.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace eeg::bench
+{
+	namespace
+	{
+		constexpr size_t n_chans = 32;
+		constexpr double rate = 250;
+		constexpr size_t window = 250; ///< One second
+		constexpr size_t hop = 62;
+		constexpr size_t averaged = 8;
+		constexpr size_t n_samples = window + hop * 200;
+
+		std::shared_ptr<const std::vector<double>> samples()
+		{
+			synthetic_signal_spec spec;
+			spec.sampling_rate = rate;
+			return std::make_shared<const std::vector<double>>(synthetic_eeg(spec, n_chans, n_samples));
+		}
+
+		/**
+		 * Copies the window starting at `start` out of the channel-major
+		 * recording.
+		 */
+		void cut(const std::vector<double>& x, size_t start, size_t n, std::vector<double>& out)
+		{
+			out.resize(n_chans * n);
+			for (size_t c = 0; c < n_chans; ++c)
+			{
+				std::copy(x.begin() + static_cast<std::ptrdiff_t>(c * n_samples + start),
+						  x.begin() + static_cast<std::ptrdiff_t>(c * n_samples + start + n), out.begin() + static_cast<std::ptrdiff_t>(c * n));
+			}
+		}
+	} // namespace
+
+	void run_connectivity_suite(harness& h)
+	{
+		const std::vector<parameter> params = {{"n_chans", static_cast<double>(n_chans)},
+											   {"window", static_cast<double>(window)},
+											   {"hop", static_cast<double>(hop)},
+											   {"windows", static_cast<double>(averaged)}};
+		if (h.selected("connectivity", "hop/incremental"))
+		{
+			h.run("connectivity", "hop/incremental", params, []() -> operation {
+				auto x = samples();
+				auto engine = std::make_shared<connectivity_engine>();
+				connectivity_options opts;
+				opts.windows = averaged;
+				engine->init(n_chans, window, rate, opts);
+				auto w = std::make_shared<std::vector<double>>();
+				auto m = std::make_shared<connectivity_matrices>();
+				auto start = std::make_shared<size_t>(0);
+				return [x, engine, w, m, start] {
+					cut(*x, *start, window, *w);
+					engine->add_window(w->data());
+					engine->compute(*m);
+					*start = *start + hop + window > n_samples ? 0 : *start + hop;
+					volatile double sink = m->coherence[1];
+					(void)sink;
+				};
+			});
+		}
+		if (h.selected("connectivity", "hop/recompute"))
+		{
+			h.run("connectivity", "hop/recompute", params, []() -> operation {
+				auto x = samples();
+				auto w = std::make_shared<std::vector<double>>();
+				auto m = std::make_shared<connectivity_matrices>();
+				auto start = std::make_shared<size_t>(0);
+				constexpr size_t span = window + (averaged - 1) * hop;
+				return [x, w, m, start] {
+					cut(*x, *start, span, *w);
+					connectivity_options opts;
+					compute_connectivity(w->data(), n_chans, span, rate, window, hop, opts, *m);
+					*start = *start + hop + span > n_samples ? 0 : *start + hop;
+					volatile double sink = m->coherence[1];
+					(void)sink;
+				};
+			});
+		}
+	}
+} // namespace eeg::bench
@@ -0,0 +1,85 @@
+#include "bench/suites.h"
+
+#include "bci/entropy.h"
+#include "util/synthetic_signal.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace eeg::bench
+{
+	namespace
+	{
+		constexpr size_t n_chans = 8;
+
+		/**
+		 * Ten seconds of `n_chans` channels at `rate`.
+		 */
+		std::shared_ptr<const std::vector<double>> samples(double rate)
+		{
+			synthetic_signal_spec spec;
+			spec.sampling_rate = rate;
+			return std::make_shared<const std::vector<double>>(synthetic_eeg(spec, n_chans, static_cast<size_t>(rate * 10)));
+		}
+	} // namespace
+
+	void run_entropy_suite(harness& h)
+	{
+		for (double rate : {250.0, 500.0})
+		{
+			const size_t window = static_cast<size_t>(rate * 10);
+			const std::string suffix = rate == 250 ? "/10s_250hz" : "/10s_500hz";
+			const std::vector<parameter> params = {{"n_chans", static_cast<double>(n_chans)}, {"window", static_cast<double>(window)}, {"m", 2}};
+			if (h.selected("entropy", "grid" + suffix))
+			{
+				h.run("entropy", "grid" + suffix, params, [rate, window]() -> operation {
+					auto x = samples(rate);
+					auto engine = std::make_shared<entropy_engine>();
+					engine->init(n_chans, entropy_options());
+					auto values = std::make_shared<entropy_values>();
+					return [x, engine, values, window] {
+						engine->compute(x->data(), window, *values);
+						volatile double sink = values->sample[0];
+						(void)sink;
+					};
+				});
+			}
+			if (h.selected("entropy", "grid_4_threads" + suffix))
+			{
+				h.run("entropy", "grid_4_threads" + suffix, params, [rate, window]() -> operation {
+					auto x = samples(rate);
+					auto engine = std::make_shared<entropy_engine>();
+					entropy_options opts;
+					opts.threads = 4;
+					engine->init(n_chans, opts);
+					auto values = std::make_shared<entropy_values>();
+					return [x, engine, values, window] {
+						engine->compute(x->data(), window, *values);
+						volatile double sink = values->sample[0];
+						(void)sink;
+					};
+				});
+			}
+			if (h.selected("entropy", "direct" + suffix))
+			{
+				// Every template pair compared, as in the textbook definitions
+				h.run("entropy", "direct" + suffix, params, [rate, window]() -> operation {
+					auto x = samples(rate);
+					return [x, window] {
+						double sink_sum = 0;
+						for (size_t c = 0; c < n_chans; ++c)
+						{
+							double sample = 0;
+							double approximate = 0;
+							entropy_direct(x->data() + c * window, window, 2, 0.2, sample, approximate);
+							sink_sum += sample + approximate;
+						}
+						volatile double sink = sink_sum;
+						(void)sink;
+					};
+				});
+			}
+		}
+	}
+} // namespace eeg::bench
@@ -0,0 +1,102 @@
+#include "bench/suites.h"
+
+#include "bci/erp_average.h"
+#include "util/synthetic_signal.h"
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace eeg::bench
+{
+	namespace
+	{
+		constexpr size_t n_chans = 8;
+		constexpr size_t n_samples = 200; ///< 0.8 s at 250 Hz
+		constexpr size_t baseline = 25;
+		constexpr size_t stored = 240;    ///< Epochs per class by the end of a calibration run
+		constexpr size_t n_classes = 2;
+
+		std::shared_ptr<const std::vector<double>> epochs()
+		{
+			synthetic_signal_spec spec;
+			return std::make_shared<const std::vector<double>>(synthetic_eeg(spec, n_chans * stored, n_samples));
+		}
+	} // namespace
+
+	void run_erp_suite(harness& h)
+	{
+		const std::vector<parameter> params = {{"n_chans", static_cast<double>(n_chans)},
+											   {"n_samples", static_cast<double>(n_samples)},
+											   {"epochs_per_class", static_cast<double>(stored)}};
+		if (h.selected("erp", "epoch/running"))
+		{
+			h.run("erp", "epoch/running", params, []() -> operation {
+				auto x = epochs();
+				auto averager = std::make_shared<erp_averager>();
+				erp_options opts;
+				opts.baseline = baseline;
+				averager->init(n_chans, n_samples, opts);
+				auto next = std::make_shared<size_t>(0);
+				return [x, averager, next] {
+					const size_t e = *next % stored;
+					averager->add(e % n_classes == 0 ? "target" : "other", x->data() + e * n_chans * n_samples);
+					*next = *next + 1;
+					volatile double sink = averager->classes()[0].mean[0];
+					(void)sink;
+				};
+			});
+		}
+		if (h.selected("erp", "epoch/reaverage"))
+		{
+			// The stored-epoch approach the averager replaces: keep every
+			// epoch of the class and average them all again after each one
+			h.run("erp", "epoch/reaverage", params, []() -> operation {
+				auto x = epochs();
+				auto history = std::make_shared<std::vector<std::deque<std::vector<double>>>>(n_classes);
+				auto mean = std::make_shared<std::vector<double>>(n_chans * n_samples);
+				auto next = std::make_shared<size_t>(0);
+				return [x, history, mean, next] {
+					const size_t e = *next % stored;
+					std::deque<std::vector<double>>& epochs = (*history)[e % n_classes];
+					const double* src = x->data() + e * n_chans * n_samples;
+					std::vector<double> epoch(src, src + n_chans * n_samples);
+					for (size_t c = 0; c < n_chans; ++c)
+					{
+						double offset = 0;
+						for (size_t t = 0; t < baseline; ++t)
+						{
+							offset += epoch[c * n_samples + t];
+						}
+						offset /= static_cast<double>(baseline);
+						for (size_t t = 0; t < n_samples; ++t)
+						{
+							epoch[c * n_samples + t] -= offset;
+						}
+					}
+					epochs.push_back(std::move(epoch));
+					if (epochs.size() > stored / n_classes)
+					{
+						epochs.pop_front();
+					}
+					std::fill(mean->begin(), mean->end(), 0.0);
+					for (const std::vector<double>& stored_epoch : epochs)
+					{
+						for (size_t i = 0; i < mean->size(); ++i)
+						{
+							(*mean)[i] += stored_epoch[i];
+						}
+					}
+					for (double& v : *mean)
+					{
+						v /= static_cast<double>(epochs.size());
+					}
+					*next = *next + 1;
+					volatile double sink = (*mean)[0];
+					(void)sink;
+				};
+			});
+		}
+	}
+} // namespace eeg::bench
@@ -0,0 +1,214 @@
+#include "bench/suites.h"
+
+#include "pipeline/fused.h"
+#include "pipeline/pipeline.h"
+#include "pipeline/stages.h"
+#include "util/synthetic_signal.h"
+
+#include <map>
+#include <memory>
+#include <string>
+
+namespace eeg::bench
+{
+	namespace
+	{
+		constexpr double sampling_rate = 500;
+		constexpr size_t block_samples = 500; ///< One second per operation
+
+		struct mains
+		{
+			static constexpr double center_hz = 50;
+			static constexpr double width_hz = 4;
+		};
+		struct eeg_band
+		{
+			static constexpr double low_hz = 1;
+			static constexpr double high_hz = 40;
+		};
+		struct by_four
+		{
+			static constexpr size_t factor = 4;
+		};
+		struct quarter_second
+		{
+			static constexpr size_t window = 32; ///< At the decimated rate
+		};
+
+		template <size_t N>
+		using embedded_chain = fused::chain<N, fused::notch<mains>, fused::bandpass<eeg_band>, fused::decimate<by_four>, fused::band_power<quarter_second>>;
+
+		/**
+		 * The same chain as pipeline stages, JSON as a pipeline file would have it.
+		 */
+		json_value runtime_config(size_t n_chans)
+		{
+			json_value config;
+			parse_json(R"({"threads": 1, "queue_capacity": 4, "overflow": "block", "stages": [
+				{"name": "eeg", "type": "source", "channels": )" +
+						   std::to_string(n_chans) + R"(, "sampling_rate": 500},
+				{"name": "notch", "type": "iir_notch", "input": "eeg", "center_hz": 50, "width_hz": 4},
+				{"name": "bandpass", "type": "iir_bandpass", "input": "notch", "low_hz": 1, "high_hz": 40},
+				{"name": "decimate", "type": "decimate", "input": "bandpass", "factor": 4},
+				{"name": "power", "type": "band_power", "input": "decimate", "window": 32},
+				{"name": "out", "type": "sink", "input": "power"}]})",
+					   config);
+			return config;
+		}
+
+		std::vector<parameter> params(size_t n_chans)
+		{
+			return {{"n_chans", static_cast<double>(n_chans)},
+					{"n_samples", static_cast<double>(block_samples)},
+					{"sampling_rate", sampling_rate}};
+		}
+
+		std::shared_ptr<const std::vector<double>> input(size_t n_chans)
+		{
+			synthetic_signal_spec spec;
+			spec.sampling_rate = sampling_rate;
+			spec.tone_hz = 50;
+			spec.tone_uv = 20;
+			return std::make_shared<const std::vector<double>>(synthetic_eeg(spec, n_chans, block_samples));
+		}
+
+		template <size_t N>
+		void run_compile_time(harness& h)
+		{
+			const std::string name = "fused_chain/compile_time/chans:" + std::to_string(N);
+			if (!h.selected("fused", name))
+			{
+				return;
+			}
+			h.run("fused", name, params(N), []() -> operation {
+				auto chain = std::make_shared<embedded_chain<N>>();
+				chain->init(sampling_rate);
+				auto x = input(N);
+				return [chain, x] {
+					volatile double sink = 0;
+					chain->process(x->data(), block_samples, [&](const double* p) { sink = sink + p[0]; });
+				};
+			});
+		}
+
+		void run_dynamic(harness& h, size_t n_chans)
+		{
+			const std::string name = "fused_chain/dynamic_channels/chans:" + std::to_string(n_chans);
+			if (!h.selected("fused", name))
+			{
+				return;
+			}
+			h.run("fused", name, params(n_chans), [n_chans]() -> operation {
+				auto chain = std::make_shared<embedded_chain<fused::dynamic>>();
+				chain->init(sampling_rate, n_chans);
+				auto x = input(n_chans);
+				return [chain, x] {
+					volatile double sink = 0;
+					chain->process(x->data(), block_samples, [&](const double* p) { sink = sink + p[0]; });
+				};
+			});
+		}
+
+		/**
+		 * Runtime stages called back to back on one thread: virtual dispatch
+		 * and intermediate blocks, without scheduler overhead.
+		 */
+		void run_runtime_stages(harness& h, size_t n_chans)
+		{
+			const std::string name = "fused_chain/runtime_stages/chans:" + std::to_string(n_chans);
+			if (!h.selected("fused", name))
+			{
+				return;
+			}
+			h.run("fused", name, params(n_chans), [n_chans]() -> operation {
+				std::map<std::string, stage_factory> registry;
+				register_builtin_stages(registry);
+				const json_value config = runtime_config(n_chans);
+				auto stages = std::make_shared<std::vector<std::unique_ptr<pipeline_stage>>>();
+				const std::vector<json_value>& items = config.find("stages")->items();
+				for (size_t i = 1; i + 1 < items.size(); ++i)
+				{
+					std::string error;
+					stages->push_back(registry[items[i].string_or("type", "")](items[i], stage_context(), error));
+					if (!stages->back())
+					{
+						return {};
+					}
+				}
+				auto x = input(n_chans);
+				auto sample = std::make_shared<uint64_t>(0);
+				return [stages, x, sample, n_chans] {
+					auto block = std::make_shared<pipeline_block>();
+					block->first_sample = *sample;
+					block->n_chans = n_chans;
+					block->n_samples = block_samples;
+					block->sampling_rate = sampling_rate;
+					block->data = *x;
+					*sample += block_samples;
+
+					std::vector<block_ptr> in{block};
+					std::vector<pipeline_block> out;
+					for (auto& stage : *stages)
+					{
+						std::vector<block_ptr> next;
+						for (const block_ptr& b : in)
+						{
+							out.clear();
+							stage->process({b}, out);
+							for (pipeline_block& o : out)
+							{
+								next.push_back(std::make_shared<const pipeline_block>(std::move(o)));
+							}
+						}
+						in = std::move(next);
+					}
+				};
+			});
+		}
+
+		/**
+		 * The full runtime graph: scheduler, queues and one worker thread.
+		 */
+		void run_runtime_graph(harness& h, size_t n_chans)
+		{
+			const std::string name = "fused_chain/runtime_graph/chans:" + std::to_string(n_chans);
+			if (!h.selected("fused", name))
+			{
+				return;
+			}
+			h.run("fused", name, params(n_chans), [n_chans]() -> operation {
+				auto p = std::make_shared<pipeline>();
+				if (!p->build(runtime_config(n_chans)))
+				{
+					return {};
+				}
+				p->start();
+				auto x = input(n_chans);
+				auto channels = std::make_shared<std::vector<const double*>>();
+				for (size_t c = 0; c < n_chans; ++c)
+				{
+					channels->push_back(x->data() + c * block_samples);
+				}
+				auto sample = std::make_shared<uint64_t>(0);
+				return [p, x, channels, sample] {
+					p->push("eeg", channels->data(), block_samples, *sample);
+					*sample += block_samples;
+					p->wait_idle();
+				};
+			});
+		}
+	} // namespace
+
+	void run_fused_suite(harness& h)
+	{
+		run_compile_time<8>(h);
+		run_dynamic(h, 8);
+		run_runtime_stages(h, 8);
+		run_runtime_graph(h, 8);
+
+		run_compile_time<32>(h);
+		run_dynamic(h, 32);
+		run_runtime_stages(h, 32);
+		run_runtime_graph(h, 32);
+	}
+} // namespace eeg::bench
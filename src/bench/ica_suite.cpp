@@ -0,0 +1,127 @@
+#include "bench/suites.h"
+
+#include "bci/ica.h"
+#include "util/synthetic_signal.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace eeg::bench
+{
+	namespace
+	{
+		constexpr size_t n_chans = 32;
+		constexpr double rate = 250;
+		constexpr size_t n_samples = 7500; ///< 30 s of calibration
+		constexpr size_t chunk = 25;
+		constexpr size_t iterations = 20;
+
+		std::shared_ptr<const std::vector<double>> samples()
+		{
+			synthetic_signal_spec spec;
+			spec.sampling_rate = rate;
+			return std::make_shared<const std::vector<double>>(synthetic_eeg(spec, n_chans, n_samples));
+		}
+
+		std::shared_ptr<ica_model> fitted(const std::vector<double>& x)
+		{
+			auto model = std::make_shared<ica_model>();
+			ica_options opts;
+			opts.max_iterations = iterations;
+			model->fit(x.data(), n_chans, n_samples, opts);
+			model->set_removed({0, 1});
+			return model;
+		}
+	} // namespace
+
+	void run_ica_suite(harness& h)
+	{
+		const std::vector<parameter> fit_params = {{"n_chans", static_cast<double>(n_chans)},
+												   {"n_samples", static_cast<double>(n_samples)},
+												   {"iterations", static_cast<double>(iterations)}};
+		for (size_t threads : {size_t(1), size_t(4)})
+		{
+			const std::string name = "fit/threads:" + std::to_string(threads);
+			if (h.selected("ica", name))
+			{
+				h.run("ica", name, fit_params, [threads]() -> operation {
+					auto x = samples();
+					return [x, threads] {
+						ica_model model;
+						ica_options opts;
+						opts.max_iterations = iterations;
+						opts.tolerance = 0; // Always the full count, so runs compare
+						opts.threads = threads;
+						model.fit(x->data(), n_chans, n_samples, opts);
+						volatile double sink = model.unmixing()[0];
+						(void)sink;
+					};
+				});
+			}
+		}
+
+		const std::vector<parameter> chunk_params = {{"n_chans", static_cast<double>(n_chans)}, {"chunk", static_cast<double>(chunk)}, {"removed", 2}};
+		if (h.selected("ica", "clean/projection"))
+		{
+			h.run("ica", "clean/projection", chunk_params, []() -> operation {
+				auto x = samples();
+				auto model = fitted(*x);
+				auto in = std::make_shared<std::vector<double>>(n_chans * chunk);
+				for (size_t c = 0; c < n_chans; ++c)
+				{
+					std::copy(x->begin() + static_cast<std::ptrdiff_t>(c * n_samples), x->begin() + static_cast<std::ptrdiff_t>(c * n_samples + chunk),
+							  in->begin() + static_cast<std::ptrdiff_t>(c * chunk));
+				}
+				auto out = std::make_shared<std::vector<double>>(n_chans * chunk);
+				return [model, in, out] {
+					model->clean(in->data(), chunk, out->data());
+					volatile double sink = (*out)[0];
+					(void)sink;
+				};
+			});
+		}
+		if (h.selected("ica", "clean/unmix_remix"))
+		{
+			// Sources, zero the removed ones, mix back: what `clean()` folds
+			// into one matrix
+			h.run("ica", "clean/unmix_remix", chunk_params, []() -> operation {
+				auto x = samples();
+				auto model = fitted(*x);
+				auto in = std::make_shared<std::vector<double>>(n_chans * chunk);
+				for (size_t c = 0; c < n_chans; ++c)
+				{
+					std::copy(x->begin() + static_cast<std::ptrdiff_t>(c * n_samples), x->begin() + static_cast<std::ptrdiff_t>(c * n_samples + chunk),
+							  in->begin() + static_cast<std::ptrdiff_t>(c * chunk));
+				}
+				auto s = std::make_shared<std::vector<double>>(model->n_components() * chunk);
+				auto out = std::make_shared<std::vector<double>>(n_chans * chunk);
+				return [model, in, s, out] {
+					const size_t k = model->n_components();
+					model->sources(in->data(), chunk, s->data());
+					for (size_t r : model->removed())
+					{
+						std::fill(s->begin() + static_cast<std::ptrdiff_t>(r * chunk), s->begin() + static_cast<std::ptrdiff_t>((r + 1) * chunk), 0.0);
+					}
+					const std::vector<double>& a = model->mixing();
+					for (size_t c = 0; c < n_chans; ++c)
+					{
+						double* y = out->data() + c * chunk;
+						std::fill(y, y + chunk, model->mean()[c]);
+						for (size_t j = 0; j < k; ++j)
+						{
+							const double w = a[c * k + j];
+							const double* sj = s->data() + j * chunk;
+							for (size_t t = 0; t < chunk; ++t)
+							{
+								y[t] += w * sj[t];
+							}
+						}
+					}
+					volatile double sink = (*out)[0];
+					(void)sink;
+				};
+			});
+		}
+	}
+} // namespace eeg::bench
@@ -0,0 +1,184 @@
+#include "bench/perf_counters.h"
+
+#include "platforms.h"
+
+#ifdef __PLATFORM_LINUX__
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace eeg::bench
+{
+	const char* perf_event_name(perf_event e)
+	{
+		switch (e)
+		{
+		case perf_event::cycles: return "cycles";
+		case perf_event::instructions: return "instructions";
+		case perf_event::cache_misses: return "cache_misses";
+		case perf_event::branch_misses: return "branch_misses";
+		case perf_event::vector_instructions: return "vector_instructions";
+		default: return "unknown";
+		}
+	}
+
+#ifdef __PLATFORM_LINUX__
+	namespace
+	{
+		bool is_intel_cpu()
+		{
+			std::ifstream cpuinfo("/proc/cpuinfo");
+			std::string line;
+			while (std::getline(cpuinfo, line))
+			{
+				if (line.compare(0, 9, "vendor_id") == 0)
+				{
+					return line.find("GenuineIntel") != std::string::npos;
+				}
+			}
+			return false;
+		}
+
+		bool event_attr(perf_event e, perf_event_attr& attr)
+		{
+			std::memset(&attr, 0, sizeof(attr));
+			attr.size = sizeof(attr);
+			attr.type = PERF_TYPE_HARDWARE;
+			switch (e)
+			{
+			case perf_event::cycles: attr.config = PERF_COUNT_HW_CPU_CYCLES; break;
+			case perf_event::instructions: attr.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+			case perf_event::cache_misses: attr.config = PERF_COUNT_HW_CACHE_MISSES; break;
+			case perf_event::branch_misses: attr.config = PERF_COUNT_HW_BRANCH_MISSES; break;
+			case perf_event::vector_instructions:
+				// FP_ARITH_INST_RETIRED (0xC7), all packed 128/256/512-bit umasks.
+				// Raw encodings are vendor specific, so only try on Intel.
+				if (!is_intel_cpu())
+				{
+					return false;
+				}
+				attr.type = PERF_TYPE_RAW;
+				attr.config = 0xFCC7;
+				break;
+			default: return false;
+			}
+			attr.disabled = 1;
+			// User space only, which is what unprivileged processes may count
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+			return true;
+		}
+	} // namespace
+
+	perf_counters::perf_counters()
+	{
+		fds_.fill(-1);
+		int last_errno = 0;
+		for (size_t i = 0; i < perf_event_count; ++i)
+		{
+			perf_event_attr attr;
+			if (!event_attr(static_cast<perf_event>(i), attr))
+			{
+				continue;
+			}
+			const long fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+			if (fd < 0)
+			{
+				last_errno = errno;
+				continue;
+			}
+			fds_[i] = static_cast<int>(fd);
+			++open_count_;
+		}
+
+		if (open_count_ == 0)
+		{
+			reason_ = std::string("perf_event_open failed: ") + std::strerror(last_errno);
+			if (last_errno == EACCES || last_errno == EPERM)
+			{
+				reason_ += " (check /proc/sys/kernel/perf_event_paranoid or container seccomp policy)";
+			}
+		}
+	}
+
+	perf_counters::~perf_counters()
+	{
+		for (const int fd : fds_)
+		{
+			if (fd >= 0)
+			{
+				close(fd);
+			}
+		}
+	}
+
+	void perf_counters::start()
+	{
+		for (const int fd : fds_)
+		{
+			if (fd >= 0)
+			{
+				ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+				ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+			}
+		}
+	}
+
+	void perf_counters::stop()
+	{
+		for (const int fd : fds_)
+		{
+			if (fd >= 0)
+			{
+				ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+			}
+		}
+	}
+
+	perf_sample perf_counters::read() const
+	{
+		perf_sample s;
+		for (size_t i = 0; i < perf_event_count; ++i)
+		{
+			if (fds_[i] < 0)
+			{
+				continue;
+			}
+			uint64_t buf[3] = {0, 0, 0}; // value, time enabled, time running
+			if (::read(fds_[i], buf, sizeof(buf)) != static_cast<ssize_t>(sizeof(buf)) || buf[2] == 0)
+			{
+				continue;
+			}
+			s.valid[i] = true;
+			s.values[i] = static_cast<double>(buf[0]) * (static_cast<double>(buf[1]) / static_cast<double>(buf[2]));
+		}
+		return s;
+	}
+#else
+	perf_counters::perf_counters() : reason_("hardware counters are only supported on Linux")
+	{
+		fds_.fill(-1);
+	}
+
+	perf_counters::~perf_counters() = default;
+
+	void perf_counters::start()
+	{
+	}
+
+	void perf_counters::stop()
+	{
+	}
+
+	perf_sample perf_counters::read() const
+	{
+		return {};
+	}
+#endif
+} // namespace eeg::bench
@@ -0,0 +1,92 @@
+/**
+ * @file perf_counters.h
+ * @brief Hardware performance counters for benchmark runs
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace eeg::bench
+{
+	/**
+	 * @brief Counted hardware events
+	 */
+	enum class perf_event : size_t
+	{
+		cycles,
+		instructions,
+		cache_misses,
+		branch_misses,
+		vector_instructions, ///< Retired packed FP operations, Intel only
+		count
+	};
+
+	constexpr size_t perf_event_count = static_cast<size_t>(perf_event::count);
+
+	/**
+	 * @brief JSON/report name of an event
+	 */
+	const char* perf_event_name(perf_event e);
+
+	/**
+	 * @brief Counter values over a measured region
+	 *
+	 * @details Values are scaled for multiplexing when the kernel could not
+	 * keep every counter scheduled for the whole region.
+	 */
+	struct perf_sample
+	{
+		std::array<bool, perf_event_count> valid{};
+		std::array<double, perf_event_count> values{};
+
+		bool has(perf_event e) const { return valid[static_cast<size_t>(e)]; }
+		double get(perf_event e) const { return values[static_cast<size_t>(e)]; }
+	};
+
+	/**
+	 * @brief Counts hardware events of the calling thread
+	 *
+	 * @details Uses `perf_event_open` on Linux. Every event is opened on its
+	 * own so that a single unsupported event (common in VMs and containers)
+	 * does not disable the rest. When no event can be opened, `available()`
+	 * is false and `unavailable_reason()` says why; `start()`/`stop()` are
+	 * then no-ops and `read()` returns an empty sample.
+	 *
+	 * Must be used on the thread that created it.
+	 */
+	class perf_counters
+	{
+	public:
+		perf_counters();
+		~perf_counters();
+		perf_counters(const perf_counters&) = delete;
+		perf_counters& operator=(const perf_counters&) = delete;
+
+		bool available() const { return open_count_ > 0; }
+		const std::string& unavailable_reason() const { return reason_; }
+
+		/**
+		 * @brief Resets and enables all opened counters
+		 */
+		void start();
+
+		/**
+		 * @brief Disables all opened counters
+		 */
+		void stop();
+
+		/**
+		 * @brief Reads counter values accumulated between `start()` and `stop()`
+		 */
+		perf_sample read() const;
+
+	private:
+		std::array<int, perf_event_count> fds_;
+		size_t open_count_ = 0;
+		std::string reason_;
+	};
+} // namespace eeg::bench
@@ -0,0 +1,144 @@
+#include "bench/suites.h"
+
+#include "stream/plot_feed.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace eeg::bench
+{
+	namespace
+	{
+		constexpr size_t n_chans = 32;
+		constexpr size_t rate = 250;
+		constexpr size_t chunk = 10;
+		constexpr size_t n_samples = rate * 600; ///< Ten minutes
+		constexpr size_t pixels = 1000;
+		const std::vector<size_t> bin_sizes = {4, 16, 64, 256};
+
+		/**
+		 * Spans of four monitors, in samples: 5 s, 30 s, 2 min and 10 min.
+		 */
+		const size_t spans[] = {rate * 5, rate * 30, rate * 120, rate * 600};
+
+		std::shared_ptr<std::vector<double>> samples()
+		{
+			auto x = std::make_shared<std::vector<double>>(n_chans * n_samples);
+			for (size_t i = 0; i < x->size(); ++i)
+			{
+				(*x)[i] = 50 * std::sin(0.05 * static_cast<double>(i)) + 5 * std::sin(0.91 * static_cast<double>(i));
+			}
+			return x;
+		}
+
+		/**
+		 * One second of chunks into a shared four-level feed, against one
+		 * single-level feed per monitor as each decimating on its own.
+		 */
+		void run_push(harness& h)
+		{
+			const std::vector<parameter> params = {{"n_chans", static_cast<double>(n_chans)}, {"chunk", static_cast<double>(chunk)}, {"viewers", 4}};
+			auto make = [](bool shared) -> operation {
+				auto x = samples();
+				auto feeds = std::make_shared<std::vector<std::unique_ptr<plot_feed>>>();
+				if (shared)
+				{
+					feeds->push_back(std::make_unique<plot_feed>(n_chans, bin_sizes, 4096));
+				}
+				else
+				{
+					for (const size_t span : spans)
+					{
+						feeds->push_back(std::make_unique<plot_feed>(n_chans, std::vector<size_t>{std::max<size_t>(1, span / pixels)}, 4096));
+					}
+				}
+				auto pos = std::make_shared<size_t>(0);
+				auto channels = std::make_shared<std::vector<const double*>>(n_chans);
+				return [x, feeds, pos, channels] {
+					for (size_t i = 0; i < rate; i += chunk)
+					{
+						for (size_t c = 0; c < n_chans; ++c)
+						{
+							(*channels)[c] = x->data() + c * n_samples + *pos;
+						}
+						for (const auto& f : *feeds)
+						{
+							f->push(channels->data(), chunk);
+						}
+						*pos = (*pos + chunk) % n_samples;
+					}
+				};
+			};
+			if (h.selected("plot_feed", "push/shared"))
+			{
+				h.run("plot_feed", "push/shared", params, [make] { return make(true); });
+			}
+			if (h.selected("plot_feed", "push/per_viewer"))
+			{
+				h.run("plot_feed", "push/per_viewer", params, [make] { return make(false); });
+			}
+		}
+
+		/**
+		 * One frame of every monitor for one channel, from the feed against a
+		 * min/max scan of the raw samples.
+		 */
+		void run_draw(harness& h)
+		{
+			const std::vector<parameter> params = {{"pixels", static_cast<double>(pixels)}, {"viewers", 4}};
+			if (h.selected("plot_feed", "draw/feed"))
+			{
+				h.run("plot_feed", "draw/feed", params, []() -> operation {
+					auto x = samples();
+					auto feed = std::make_shared<plot_feed>(n_chans, bin_sizes, 4096);
+					std::vector<const double*> channels(n_chans);
+					for (size_t c = 0; c < n_chans; ++c)
+					{
+						channels[c] = x->data() + c * n_samples;
+					}
+					feed->push(channels.data(), n_samples);
+					auto out = std::make_shared<std::vector<plot_bin>>(pixels);
+					return [feed, out] {
+						volatile float sink = 0;
+						for (const size_t span : spans)
+						{
+							feed->draw(0, span, pixels, out->data());
+							sink = (*out)[0].max;
+						}
+						(void)sink;
+					};
+				});
+			}
+			if (h.selected("plot_feed", "draw/raw"))
+			{
+				h.run("plot_feed", "draw/raw", params, []() -> operation {
+					auto x = samples();
+					auto out = std::make_shared<std::vector<plot_bin>>(pixels);
+					return [x, out] {
+						volatile float sink = 0;
+						for (const size_t span : spans)
+						{
+							const double* p = x->data() + n_samples - span;
+							for (size_t i = 0; i < pixels; ++i)
+							{
+								const auto mm = std::minmax_element(p + i * span / pixels, p + (i + 1) * span / pixels);
+								(*out)[i] = plot_bin{static_cast<float>(*mm.first), static_cast<float>(*mm.second)};
+							}
+							sink = (*out)[0].max;
+						}
+						(void)sink;
+					};
+				});
+			}
+		}
+	} // namespace
+
+	void run_plot_feed_suite(harness& h)
+	{
+		run_push(h);
+		run_draw(h);
+	}
+} // namespace eeg::bench
@@ -0,0 +1,123 @@
+/**
+ * @file suites.h
+ * @brief Benchmark suites run by the bench target
+ */
+
+#pragma once
+
+#include "bench/bench_harness.h"
+
+namespace eeg::bench
+{
+	/**
+	 * @brief SSVEP classification and P300 prediction cost
+	 *
+	 * @details Sweeps `ba_bci_connect_ssvep_classify` over class counts,
+	 * channel counts and window lengths, and `ba_bci_connect_p300_predict` over
+	 * every model in the zoo.
+	 */
+	void run_classifier_suite(harness& h);
+
+	/**
+	 * @brief Compile-time fused chain against the runtime pipeline
+	 *
+	 * @details Runs notch, bandpass, decimation and band power on one second
+	 * of data as a `fused::chain` with a fixed channel count, the same chain
+	 * with a run-time channel count, the equivalent pipeline stages called
+	 * back to back, and the full scheduled pipeline graph.
+	 */
+	void run_fused_suite(harness& h);
+
+	/**
+	 * @brief Edge extraction from `bool` channels
+	 *
+	 * @details `find_edges` against `find_edges_scalar` over a minute of
+	 * 250 Hz digital input with sparse, busy and per-sample toggling pulses.
+	 */
+	void run_trigger_suite(harness& h);
+
+	/**
+	 * @brief Bit-packed `bool` channels
+	 *
+	 * @details SIMD pack and unpack against the scalar references over a
+	 * minute of one channel, and per-second "all contacts good" checks on 64
+	 * contact channels from bytes against a `bool_ring`.
+	 */
+	void run_bit_pack_suite(harness& h);
+
+	/**
+	 * @brief Electrode samples as int32 ADC counts
+	 *
+	 * @details SIMD count conversion both ways against the scalar references
+	 * on one second of 32 channels, and the same second through a
+	 * `stream_ring` against a `count_ring`.
+	 */
+	void run_adc_counts_suite(harness& h);
+
+	/**
+	 * @brief Shared live plot decimation
+	 *
+	 * @details One second of 32-channel chunks into a four-level
+	 * `plot_feed` against one feed per monitor, and a frame of four monitors
+	 * spanning 5 s to 10 min drawn from the feed against scanning the
+	 * samples.
+	 */
+	void run_plot_feed_suite(harness& h);
+
+	/**
+	 * @brief Channel-pair connectivity per hop
+	 *
+	 * @details A hop of 32-channel, one-second windows averaged over eight
+	 * windows: `connectivity_engine` adding the new window to its running
+	 * sums, against recomputing all eight windows from scratch.
+	 */
+	void run_connectivity_suite(harness& h);
+
+	/**
+	 * @brief FastICA fitting and online component removal
+	 *
+	 * @details Twenty iterations on 30 s of 32-channel calibration data
+	 * with one and four workers, and removing two components from a
+	 * 25-sample chunk with `ica_model::clean()`'s single projection against
+	 * unmixing, zeroing and mixing back.
+	 */
+	void run_ica_suite(harness& h);
+
+	/**
+	 * @brief Artifact Subspace Reconstruction per chunk
+	 *
+	 * @details 25-sample chunks of 32 channels at 500 Hz (50 ms of data)
+	 * through a calibrated `asr_filter`, on clean data and with an artifact
+	 * that keeps components reconstructed; real time needs well under
+	 * 50 ms per chunk.
+	 */
+	void run_asr_suite(harness& h);
+
+	/**
+	 * @brief ERP averaging per new epoch
+	 *
+	 * @details Eight-channel, 200-sample epochs of two classes:
+	 * `erp_averager`'s running update against storing the epochs and
+	 * re-averaging a class's (up to 120) after each one.
+	 */
+	void run_erp_suite(harness& h);
+
+	/**
+	 * @brief Burg AR spectra on half-second windows
+	 *
+	 * @details 32 channels at 250 Hz, order 16: fitting all channels in
+	 * one channel-vectorised pass against one channel at a time, and
+	 * evaluating the alpha band every 0.1 Hz against a dense 1024-point
+	 * grid up to Nyquist.
+	 */
+	void run_ar_spectrum_suite(harness& h);
+
+	/**
+	 * @brief Sample and approximate entropy of 10-second windows
+	 *
+	 * @details Eight channels at 250 and 500 Hz, m = 2 and r = 0.2:
+	 * `entropy_engine`'s grid neighbour search, on one and four threads,
+	 * against comparing every template pair.
+	 */
+	void run_entropy_suite(harness& h);
+} // namespace eeg::bench
@@ -0,0 +1,52 @@
+#include "bench/suites.h"
+
+#include "stream/trigger_detector.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace eeg::bench
+{
+	namespace
+	{
+		constexpr size_t n_samples = 250 * 60; ///< One minute at 250 Hz
+
+		const size_t pulse_periods[] = {250, 25, 2}; ///< Samples between pulses: sparse, busy, toggling
+
+		using scan_function = size_t (*)(const bool*, size_t, uint64_t, bool&, std::vector<trigger_edge>&);
+
+		void run_scan(harness& h, const std::string& variant, scan_function scan)
+		{
+			for (const size_t period : pulse_periods)
+			{
+				const std::string name = "find_edges/" + variant + "/period:" + std::to_string(period);
+				if (!h.selected("triggers", name))
+				{
+					continue;
+				}
+				auto x = std::make_shared<std::vector<char>>(n_samples);
+				for (size_t i = 0; i < n_samples; ++i)
+				{
+					(*x)[i] = i % period < period / 2 ? 1 : 0;
+				}
+				h.run("triggers", name, {{"n_samples", static_cast<double>(n_samples)}, {"period", static_cast<double>(period)}},
+					  [x, scan]() -> operation {
+						  auto edges = std::make_shared<std::vector<trigger_edge>>();
+						  edges->reserve(n_samples);
+						  return [x, scan, edges] {
+							  edges->clear();
+							  bool level = false;
+							  scan(reinterpret_cast<const bool*>(x->data()), x->size(), 0, level, *edges);
+						  };
+					  });
+			}
+		}
+	} // namespace
+
+	void run_trigger_suite(harness& h)
+	{
+		run_scan(h, "simd", &find_edges);
+		run_scan(h, "scalar", &find_edges_scalar);
+	}
+} // namespace eeg::bench
@@ -2,8 +2,44 @@
 #include <iomanip>
 #include "bacore.h"
 #include "eeg_manager.h"
+#include "app/arrow_app.h"
+#include "app/batch_app.h"
+#include "app/export_app.h"
+#include "app/ica_app.h"
+#include "app/pipeline_app.h"
+#include "app/pyramid_app.h"
+#include "app/soak.h"
+#include "app/triggers_app.h"
+
+#include <string>
+
+int main(int argc, char** argv) {
+    // Subcommands; without one the app runs the device scan test
+    if (argc > 1 && std::string(argv[1]) == "soak") {
+        return eeg::soak_main(argc - 1, argv + 1);
+    }
+    if (argc > 1 && std::string(argv[1]) == "pipeline") {
+        return eeg::pipeline_main(argc - 1, argv + 1);
+    }
+    if (argc > 1 && std::string(argv[1]) == "triggers") {
+        return eeg::triggers_main(argc - 1, argv + 1);
+    }
+    if (argc > 1 && std::string(argv[1]) == "batch") {
+        return eeg::batch_main(argc - 1, argv + 1);
+    }
+    if (argc > 1 && std::string(argv[1]) == "export") {
+        return eeg::export_main(argc - 1, argv + 1);
+    }
+    if (argc > 1 && std::string(argv[1]) == "pyramid") {
+        return eeg::pyramid_main(argc - 1, argv + 1);
+    }
+    if (argc > 1 && std::string(argv[1]) == "arrow") {
+        return eeg::arrow_main(argc - 1, argv + 1);
+    }
+    if (argc > 1 && std::string(argv[1]) == "ica") {
+        return eeg::ica_main(argc - 1, argv + 1);
+    }
 
-int main() {
     std::cout << "BrainAccess EEG Test Application" << std::endl;
     
     // Test library initialization
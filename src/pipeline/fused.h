@@ -0,0 +1,459 @@
+/**
+ * @file fused.h
+ * @brief Compile-time composed streaming pipelines
+ */
+
+#pragma once
+
+#include "restrict.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace eeg::fused
+{
+	/**
+	 * @brief Channel count meaning "set at run time"
+	 */
+	constexpr size_t dynamic = 0;
+
+	constexpr double two_pi = 6.283185307179586;
+	constexpr double butterworth_q = 0.7071067811865476;
+
+	/**
+	 * @brief Per-channel values; a fixed array when the count is known
+	 */
+	template <size_t N>
+	struct channel_values
+	{
+		std::array<double, N> v{};
+
+		void resize(size_t) {}
+		static constexpr size_t size() { return N; }
+		double* data() { return v.data(); }
+		const double* data() const { return v.data(); }
+		double& operator[](size_t i) { return v[i]; }
+	};
+
+	template <>
+	struct channel_values<dynamic>
+	{
+		std::vector<double> v;
+
+		void resize(size_t n) { v.assign(n, 0.0); }
+		size_t size() const { return v.size(); }
+		double* data() { return v.data(); }
+		const double* data() const { return v.data(); }
+		double& operator[](size_t i) { return v[i]; }
+	};
+
+	/**
+	 * @brief Normalized second-order section (a0 = 1), RBJ cookbook designs
+	 */
+	struct biquad_coefficients
+	{
+		double b0 = 1;
+		double b1 = 0;
+		double b2 = 0;
+		double a1 = 0;
+		double a2 = 0;
+
+		static biquad_coefficients notch(double fs, double center_hz, double width_hz)
+		{
+			const double w0 = two_pi * center_hz / fs;
+			const double alpha = std::sin(w0) / (2 * (center_hz / width_hz));
+			return normalize(1, -2 * std::cos(w0), 1, 1 + alpha, -2 * std::cos(w0), 1 - alpha);
+		}
+
+		static biquad_coefficients lowpass(double fs, double cutoff_hz, double q = butterworth_q)
+		{
+			const double w0 = two_pi * cutoff_hz / fs;
+			const double alpha = std::sin(w0) / (2 * q);
+			const double c = std::cos(w0);
+			return normalize((1 - c) / 2, 1 - c, (1 - c) / 2, 1 + alpha, -2 * c, 1 - alpha);
+		}
+
+		static biquad_coefficients highpass(double fs, double cutoff_hz, double q = butterworth_q)
+		{
+			const double w0 = two_pi * cutoff_hz / fs;
+			const double alpha = std::sin(w0) / (2 * q);
+			const double c = std::cos(w0);
+			return normalize((1 + c) / 2, -(1 + c), (1 + c) / 2, 1 + alpha, -2 * c, 1 - alpha);
+		}
+
+	private:
+		static biquad_coefficients normalize(double b0, double b1, double b2, double a0, double a1, double a2)
+		{
+			return {b0 / a0, b1 / a0, b2 / a0, a1 / a0, a2 / a0};
+		}
+	};
+
+	/**
+	 * @brief One biquad per channel, transposed direct form II
+	 */
+	template <size_t N>
+	class biquad_bank
+	{
+	public:
+		void init(const biquad_coefficients& c, size_t n_chans)
+		{
+			c_ = c;
+			z1_.resize(n_chans);
+			z2_.resize(n_chans);
+		}
+
+		/**
+		 * @brief Filters one sample of every channel in place
+		 */
+		void step(double* restrict x)
+		{
+			const biquad_coefficients c = c_;
+			for (size_t i = 0; i < z1_.size(); ++i)
+			{
+				const double in = x[i];
+				const double y = c.b0 * in + z1_[i];
+				z1_[i] = c.b1 * in - c.a1 * y + z2_[i];
+				z2_[i] = c.b2 * in - c.a2 * y;
+				x[i] = y;
+			}
+		}
+
+	private:
+		biquad_coefficients c_;
+		channel_values<N> z1_;
+		channel_values<N> z2_;
+	};
+
+	/**
+	 * @brief Shortest odd tap count whose Hilbert transformer is within
+	 * about 0.5% of unit gain from `low_hz` to `fs / 2 - low_hz`
+	 *
+	 * @details The Hamming-windowed response rolls off to zero at DC and
+	 * Nyquist over roughly `1.65 fs / taps`, so the lowest frequency of
+	 * interest sets the length and with it the delay.
+	 */
+	inline size_t hilbert_taps(double fs, double low_hz)
+	{
+		const size_t taps = static_cast<size_t>(std::ceil(1.65 * fs / low_hz));
+		return std::max<size_t>(taps | 1, 3);
+	}
+
+	/**
+	 * @brief Analytic signal of every channel through a Hamming-windowed FIR
+	 * Hilbert transformer of odd length `taps`
+	 *
+	 * @details The filter is antisymmetric with zeros at even lags, so each
+	 * output costs `(taps + 1) / 4` multiplies per channel. Its group delay
+	 * is `delay() = (taps - 1) / 2` samples at all frequencies: the outputs
+	 * of a step describe the input `delay()` steps earlier, whose delayed
+	 * value is the real part. History is kept sample-major and twice over,
+	 * so every tap reads a contiguous row of channels and the channel loops
+	 * vectorise.
+	 */
+	template <size_t N>
+	class hilbert_bank
+	{
+	public:
+		void init(size_t taps, size_t n_chans)
+		{
+			delay_ = taps / 2;
+			n_chans_ = n_chans;
+			coefficients_.clear();
+			for (size_t m = 1; m <= delay_; m += 2)
+			{
+				const double window = 0.54 + 0.46 * std::cos(two_pi / 2 * static_cast<double>(m) / static_cast<double>(delay_));
+				coefficients_.push_back(window * 4 / (two_pi * static_cast<double>(m)));
+			}
+			rows_ = 2 * delay_ + 1;
+			history_.assign(2 * rows_ * n_chans_, 0.0);
+			head_ = 0;
+		}
+
+		size_t delay() const { return delay_; }
+
+		/**
+		 * @brief Takes one sample of every channel and writes the real and
+		 * imaginary parts for the sample `delay()` steps back
+		 */
+		void step(const double* restrict x, double* restrict re, double* restrict im)
+		{
+			const size_t n = N == dynamic ? n_chans_ : N;
+			head_ = head_ + 1 == rows_ ? 0 : head_ + 1;
+			double* restrict a = &history_[head_ * n];
+			double* restrict b = &history_[(head_ + rows_) * n];
+			for (size_t c = 0; c < n; ++c)
+			{
+				a[c] = x[c];
+				b[c] = x[c];
+			}
+			// Rows head_ + 1 to head_ + rows_ hold the window, oldest first
+			const double* newest = &history_[(head_ + rows_) * n];
+			const double* centre = newest - delay_ * n;
+			for (size_t c = 0; c < n; ++c)
+			{
+				re[c] = centre[c];
+				im[c] = 0;
+			}
+			for (size_t j = 0; j < coefficients_.size(); ++j)
+			{
+				const size_t m = 2 * j + 1;
+				const double h = coefficients_[j];
+				const double* restrict older = centre - m * n;
+				const double* restrict newer = centre + m * n;
+				for (size_t c = 0; c < n; ++c)
+				{
+					im[c] += h * (older[c] - newer[c]);
+				}
+			}
+		}
+
+	private:
+		std::vector<double> coefficients_; ///< Odd lags 1, 3, ... up to the delay
+		std::vector<double> history_;      ///< `2 * rows_` rows of `n_chans_` samples
+		size_t delay_ = 0;
+		size_t rows_ = 1;
+		size_t head_ = 0;
+		size_t n_chans_ = N;
+	};
+
+	/**
+	 * @details Stage specs below take a parameter type with static constexpr
+	 * members and expose `kernel<N>`, the per-channel-count implementation.
+	 * A kernel has `init(fs, n_chans)`, returns its output rate from
+	 * `output_rate(fs)`, and in `push(x, next)` processes one sample of
+	 * every channel (`x` has `n_chans` values, modifiable in place) and calls
+	 * `next(y)` zero or more times.
+	 */
+
+	/**
+	 * @brief Biquad notch; `P::center_hz`, `P::width_hz`
+	 */
+	template <typename P>
+	struct notch
+	{
+		template <size_t N>
+		class kernel
+		{
+		public:
+			void init(double fs, size_t n_chans) { f_.init(biquad_coefficients::notch(fs, P::center_hz, P::width_hz), n_chans); }
+			static double output_rate(double fs) { return fs; }
+
+			template <typename Next>
+			void push(double* x, Next&& next)
+			{
+				f_.step(x);
+				next(x);
+			}
+
+		private:
+			biquad_bank<N> f_;
+		};
+	};
+
+	/**
+	 * @brief Fourth-order bandpass as a Butterworth highpass and lowpass
+	 * pair; `P::low_hz`, `P::high_hz`
+	 */
+	template <typename P>
+	struct bandpass
+	{
+		static_assert(P::low_hz > 0 && P::high_hz > P::low_hz, "bandpass needs 0 < low_hz < high_hz");
+
+		template <size_t N>
+		class kernel
+		{
+		public:
+			void init(double fs, size_t n_chans)
+			{
+				high_.init(biquad_coefficients::highpass(fs, P::low_hz), n_chans);
+				low_.init(biquad_coefficients::lowpass(fs, P::high_hz), n_chans);
+			}
+			static double output_rate(double fs) { return fs; }
+
+			template <typename Next>
+			void push(double* x, Next&& next)
+			{
+				high_.step(x);
+				low_.step(x);
+				next(x);
+			}
+
+		private:
+			biquad_bank<N> high_;
+			biquad_bank<N> low_;
+		};
+	};
+
+	/**
+	 * @brief Keeps every `P::factor`-th sample
+	 *
+	 * @details Does not filter; place it after a lowpass or bandpass below
+	 * the new Nyquist frequency.
+	 */
+	template <typename P>
+	struct decimate
+	{
+		static_assert(P::factor >= 1, "decimation factor must be at least 1");
+
+		template <size_t N>
+		class kernel
+		{
+		public:
+			void init(double, size_t) { phase_ = 0; }
+			static double output_rate(double fs) { return fs / static_cast<double>(P::factor); }
+
+			template <typename Next>
+			void push(double* x, Next&& next)
+			{
+				if (++phase_ == P::factor)
+				{
+					phase_ = 0;
+					next(x);
+				}
+			}
+
+		private:
+			size_t phase_ = 0;
+		};
+	};
+
+	/**
+	 * @brief Mean power per channel over non-overlapping windows of
+	 * `P::window` samples; emits one vector per window
+	 */
+	template <typename P>
+	struct band_power
+	{
+		static_assert(P::window >= 1, "band power window must be at least one sample");
+
+		template <size_t N>
+		class kernel
+		{
+		public:
+			void init(double, size_t n_chans)
+			{
+				sum_.resize(n_chans);
+				out_.resize(n_chans);
+				count_ = 0;
+			}
+			static double output_rate(double fs) { return fs / static_cast<double>(P::window); }
+
+			template <typename Next>
+			void push(double* x, Next&& next)
+			{
+				for (size_t i = 0; i < sum_.size(); ++i)
+				{
+					sum_[i] += x[i] * x[i];
+				}
+				if (++count_ == P::window)
+				{
+					for (size_t i = 0; i < sum_.size(); ++i)
+					{
+						out_[i] = sum_[i] / static_cast<double>(P::window);
+						sum_[i] = 0;
+					}
+					count_ = 0;
+					next(out_.data());
+				}
+			}
+
+		private:
+			channel_values<N> sum_;
+			channel_values<N> out_;
+			size_t count_ = 0;
+		};
+	};
+
+	/**
+	 * @brief Stages fused into one per-sample loop
+	 *
+	 * @details `chain<8, notch<mains>, bandpass<eeg_band>, decimate<by4>,
+	 * band_power<one_second>>` runs every stage on a sample before moving to
+	 * the next one: no virtual calls, no intermediate blocks, and with a
+	 * fixed `N` the per-channel loops have constant trip counts the compiler
+	 * can unroll and vectorise. With `N == dynamic` the channel count is
+	 * passed to `init()` and the same kernels run with run-time loops.
+	 */
+	template <size_t N, typename... Stages>
+	class chain
+	{
+	public:
+		static constexpr size_t channels = N;
+
+		void init(double fs, size_t n_chans = N)
+		{
+			n_chans_ = N == dynamic ? n_chans : N;
+			init_stage<0>(fs);
+			sample_.resize(n_chans_);
+		}
+
+		size_t n_chans() const { return n_chans_; }
+
+		/**
+		 * @brief Pushes one sample of every channel
+		 *
+		 * @param out Called with a pointer to `n_chans()` values for every
+		 * output of the last stage
+		 */
+		template <typename Out>
+		void push(const double* x, Out&& out)
+		{
+			for (size_t i = 0; i < n_chans_; ++i)
+			{
+				sample_[i] = x[i];
+			}
+			run<0>(sample_.data(), out);
+		}
+
+		/**
+		 * @brief Pushes a channel-major block (channel n at `x[n * n_samples]`)
+		 */
+		template <typename Out>
+		void process(const double* x, size_t n_samples, Out&& out)
+		{
+			for (size_t t = 0; t < n_samples; ++t)
+			{
+				for (size_t i = 0; i < n_chans_; ++i)
+				{
+					sample_[i] = x[i * n_samples + t];
+				}
+				run<0>(sample_.data(), out);
+			}
+		}
+
+	private:
+		template <size_t I>
+		void init_stage(double fs)
+		{
+			if constexpr (I < sizeof...(Stages))
+			{
+				std::get<I>(kernels_).init(fs, n_chans_);
+				init_stage<I + 1>(std::tuple_element_t<I, kernel_tuple>::output_rate(fs));
+			}
+		}
+
+		template <size_t I, typename Out>
+		void run(double* x, Out& out)
+		{
+			if constexpr (I == sizeof...(Stages))
+			{
+				out(static_cast<const double*>(x));
+			}
+			else
+			{
+				std::get<I>(kernels_).push(x, [this, &out](double* y) { run<I + 1>(y, out); });
+			}
+		}
+
+		using kernel_tuple = std::tuple<typename Stages::template kernel<N>...>;
+
+		kernel_tuple kernels_;
+		channel_values<N> sample_;
+		size_t n_chans_ = N;
+	};
+} // namespace eeg::fused
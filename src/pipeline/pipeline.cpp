@@ -0,0 +1,699 @@
+#include "pipeline/pipeline.h"
+
+#include "bacore.h"
+#include "pipeline/stages.h"
+#include "util/json_writer.h"
+#include "util/stats.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace eeg
+{
+	namespace
+	{
+		constexpr size_t recent_runs = 1024;
+
+		struct stage_registry
+		{
+			std::mutex mutex;
+			std::map<std::string, stage_factory> factories;
+		};
+
+		stage_registry& registry()
+		{
+			static stage_registry* r = [] {
+				auto* reg = new stage_registry();
+				register_builtin_stages(reg->factories);
+				return reg;
+			}();
+			return *r;
+		}
+
+		bool fail(std::string* error, const std::string& message)
+		{
+			if (error)
+			{
+				*error = message;
+			}
+			return false;
+		}
+	} // namespace
+
+	pipeline_block derive_block(const pipeline_block& from)
+	{
+		pipeline_block b;
+		b.sequence = from.sequence;
+		b.first_sample = from.first_sample;
+		b.n_chans = from.n_chans;
+		b.n_samples = from.n_samples;
+		b.sampling_rate = from.sampling_rate;
+		b.arrival = from.arrival;
+		return b;
+	}
+
+	void register_stage_type(const std::string& type, stage_factory factory)
+	{
+		stage_registry& r = registry();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		r.factories[type] = std::move(factory);
+	}
+
+	std::vector<std::string> stage_types()
+	{
+		stage_registry& r = registry();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		std::vector<std::string> types{"source"};
+		for (const auto& f : r.factories)
+		{
+			types.push_back(f.first);
+		}
+		return types;
+	}
+
+	std::string default_pipeline_path()
+	{
+		const std::string config = BA_CONFIG_DEFAULT_PATH;
+		const size_t slash = config.find_last_of("/\\");
+		return (slash == std::string::npos ? std::string() : config.substr(0, slash + 1)) + "pipeline.json";
+	}
+
+	pipeline::pipeline(memory_owner owner) : owner_(owner)
+	{
+	}
+
+	pipeline::~pipeline()
+	{
+		stop();
+	}
+
+	void pipeline::set_sink(const std::string& stage_name, pipeline_sink sink)
+	{
+		sinks_[stage_name] = std::move(sink);
+	}
+
+	bool pipeline::load_file(const std::string& path, std::string* error)
+	{
+		json_value config;
+		if (!read_json_file(path, config, error))
+		{
+			return false;
+		}
+		if (!build(config, error))
+		{
+			if (error)
+			{
+				*error = path + ": " + *error;
+			}
+			return false;
+		}
+		return true;
+	}
+
+	bool pipeline::build(const json_value& config, std::string* error)
+	{
+		if (started_)
+		{
+			return fail(error, "pipeline is running");
+		}
+		nodes_.clear();
+		order_.clear();
+		if (!config.is_object())
+		{
+			return fail(error, "pipeline must be a JSON object");
+		}
+		n_threads_ = static_cast<size_t>(std::max(1.0, config.number_or("threads", 2)));
+		queue_capacity_ = static_cast<size_t>(std::max(1.0, config.number_or("queue_capacity", 32)));
+		const std::string overflow = config.string_or("overflow", "drop");
+		if (overflow != "drop" && overflow != "block")
+		{
+			return fail(error, "\"overflow\" must be \"drop\" or \"block\"");
+		}
+		overflow_ = overflow == "block" ? overflow_policy::block : overflow_policy::drop;
+		const std::string scheduler = config.string_or("scheduler", "fifo");
+		if (scheduler != "fifo" && scheduler != "deadline")
+		{
+			return fail(error, "\"scheduler\" must be \"fifo\" or \"deadline\"");
+		}
+		scheduler_ = scheduler == "deadline" ? scheduler_policy::deadline : scheduler_policy::fifo;
+		recovery_ = std::chrono::nanoseconds(static_cast<int64_t>(std::max(0.0, config.number_or("recovery_ms", 1000)) * 1e6));
+
+		const json_value* stages = config.find("stages");
+		if (!stages || !stages->is_array() || stages->size() == 0)
+		{
+			return fail(error, "\"stages\" must be a non-empty array");
+		}
+
+		// Names and inputs first, so stages may refer to later ones
+		std::map<std::string, size_t> index;
+		std::vector<std::vector<std::string>> input_names(stages->size());
+		nodes_.resize(stages->size());
+		for (size_t i = 0; i < stages->size(); ++i)
+		{
+			const json_value& s = stages->items()[i];
+			node& n = nodes_[i];
+			n.name = s.string_or("name", "");
+			n.type = s.string_or("type", "");
+			const std::string where = "stage " + std::to_string(i) + (n.name.empty() ? "" : " (" + n.name + ")");
+			if (n.name.empty() || n.type.empty())
+			{
+				return fail(error, where + ": \"name\" and \"type\" are required");
+			}
+			if (!index.emplace(n.name, i).second)
+			{
+				return fail(error, where + ": duplicate name");
+			}
+			if (const json_value* in = s.find("input"))
+			{
+				input_names[i].push_back(in->as_string());
+			}
+			if (const json_value* ins = s.find("inputs"))
+			{
+				for (const json_value& in : ins->items())
+				{
+					input_names[i].push_back(in.as_string());
+				}
+			}
+			if (n.type == "source")
+			{
+				n.source_chans = static_cast<size_t>(s.number_or("channels", 0));
+				n.source_rate = s.number_or("sampling_rate", 250);
+				if (n.source_chans == 0 || n.source_rate <= 0 || !input_names[i].empty())
+				{
+					return fail(error, where + ": sources need \"channels\" and \"sampling_rate\" and take no inputs");
+				}
+			}
+			else if (input_names[i].empty())
+			{
+				return fail(error, where + ": no \"input\"");
+			}
+			n.deadline_ms = s.number_or("deadline_ms", 0);
+			n.optional = s.bool_or("optional", false);
+			if (n.deadline_ms < 0 || (n.type == "source" && (n.deadline_ms > 0 || n.optional)))
+			{
+				return fail(error, where + ": \"deadline_ms\" must be positive and sources take neither it nor \"optional\"");
+			}
+		}
+
+		for (size_t i = 0; i < nodes_.size(); ++i)
+		{
+			for (size_t slot = 0; slot < input_names[i].size(); ++slot)
+			{
+				const auto it = index.find(input_names[i][slot]);
+				if (it == index.end())
+				{
+					return fail(error, nodes_[i].name + ": unknown input \"" + input_names[i][slot] + "\"");
+				}
+				nodes_[i].inputs.push_back(it->second);
+				nodes_[it->second].consumers.emplace_back(i, slot);
+			}
+			nodes_[i].queues.resize(nodes_[i].inputs.size());
+		}
+
+		// Kahn's algorithm; anything left over sits on a cycle
+		std::vector<size_t> pending(nodes_.size());
+		for (size_t i = 0; i < nodes_.size(); ++i)
+		{
+			pending[i] = nodes_[i].inputs.size();
+			if (pending[i] == 0)
+			{
+				order_.push_back(i);
+			}
+		}
+		for (size_t k = 0; k < order_.size(); ++k)
+		{
+			for (const auto& c : nodes_[order_[k]].consumers)
+			{
+				if (--pending[c.first] == 0)
+				{
+					order_.push_back(c.first);
+				}
+			}
+		}
+		if (order_.size() != nodes_.size())
+		{
+			return fail(error, "stages form a cycle");
+		}
+
+		// A stage has to finish in time for the tightest deadline downstream
+		for (auto it = order_.rbegin(); it != order_.rend(); ++it)
+		{
+			node& n = nodes_[*it];
+			n.deadline = std::chrono::nanoseconds::max();
+			if (n.deadline_ms > 0)
+			{
+				n.deadline = std::chrono::nanoseconds(static_cast<int64_t>(n.deadline_ms * 1e6));
+			}
+			for (const auto& c : n.consumers)
+			{
+				n.deadline = std::min(n.deadline, nodes_[c.first].deadline);
+			}
+		}
+
+		stage_registry& r = registry();
+		for (size_t i = 0; i < nodes_.size(); ++i)
+		{
+			node& n = nodes_[i];
+			n.recent_ns.reserve(recent_runs);
+			if (n.type == "source")
+			{
+				continue;
+			}
+			stage_factory factory;
+			{
+				std::lock_guard<std::mutex> lock(r.mutex);
+				const auto it = r.factories.find(n.type);
+				if (it == r.factories.end())
+				{
+					return fail(error, n.name + ": unknown stage type \"" + n.type + "\"");
+				}
+				factory = it->second;
+			}
+			stage_context ctx;
+			ctx.name = n.name;
+			ctx.owner = owner_;
+			const auto sink = sinks_.find(n.name);
+			if (sink != sinks_.end())
+			{
+				ctx.sink = sink->second;
+			}
+			std::string stage_error;
+			n.stage = factory(stages->items()[i], ctx, stage_error);
+			if (!n.stage)
+			{
+				return fail(error, n.name + ": " + stage_error);
+			}
+		}
+		return true;
+	}
+
+	void pipeline::start()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (started_ || nodes_.empty())
+		{
+			return;
+		}
+		started_ = true;
+		stopping_ = false;
+		for (size_t i = 0; i < n_threads_; ++i)
+		{
+			workers_.emplace_back(&pipeline::worker, this);
+		}
+	}
+
+	void pipeline::stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (!started_)
+			{
+				return;
+			}
+		}
+		wait_idle();
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stopping_ = true;
+		}
+		work_cv_.notify_all();
+		room_cv_.notify_all();
+		for (std::thread& t : workers_)
+		{
+			t.join();
+		}
+		workers_.clear();
+		for (size_t i : order_)
+		{
+			if (nodes_[i].stage)
+			{
+				nodes_[i].stage->finish();
+			}
+		}
+		std::lock_guard<std::mutex> lock(mutex_);
+		started_ = false;
+	}
+
+	bool pipeline::push(const std::string& source, const double* const* channels, size_t n, uint64_t first_sample)
+	{
+		size_t index = nodes_.size();
+		for (size_t i = 0; i < nodes_.size(); ++i)
+		{
+			if (nodes_[i].type == "source" && nodes_[i].name == source)
+			{
+				index = i;
+				break;
+			}
+		}
+		if (index == nodes_.size())
+		{
+			return false;
+		}
+
+		// Copy outside the lock; only sequencing and delivery are serialized
+		const node& src = nodes_[index];
+		auto block = std::make_shared<pipeline_block>();
+		block->arrival = std::chrono::steady_clock::now();
+		block->first_sample = first_sample;
+		block->n_chans = src.source_chans;
+		block->n_samples = n;
+		block->sampling_rate = src.source_rate;
+		block->data.resize(src.source_chans * n);
+		for (size_t c = 0; c < src.source_chans; ++c)
+		{
+			std::copy(channels[c], channels[c] + n, block->data.begin() + static_cast<std::ptrdiff_t>(c * n));
+		}
+
+		std::unique_lock<std::mutex> lock(mutex_);
+		if (overflow_ == overflow_policy::block)
+		{
+			room_cv_.wait(lock, [&] { return !started_ || stopping_ || has_room(nodes_[index]); });
+		}
+		if (!started_ || stopping_)
+		{
+			return false;
+		}
+		block->sequence = next_sequence_++;
+		++nodes_[index].runs;
+		++nodes_[index].emitted;
+		deliver(index, block);
+		return true;
+	}
+
+	bool pipeline::has_room(const node& n) const
+	{
+		for (const auto& c : n.consumers)
+		{
+			if (nodes_[c.first].queues[c.second].blocks.size() >= queue_capacity_)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool pipeline::ready(node& n)
+	{
+		if (n.queued || n.running || !n.stage)
+		{
+			return false;
+		}
+		if (overflow_ == overflow_policy::block && !has_room(n))
+		{
+			return false;
+		}
+		return aligned(n);
+	}
+
+	bool pipeline::aligned(node& n)
+	{
+		while (true)
+		{
+			uint64_t newest = 0;
+			uint64_t oldest = UINT64_MAX;
+			for (const input_queue& q : n.queues)
+			{
+				if (q.blocks.empty())
+				{
+					return false;
+				}
+				newest = std::max(newest, q.blocks.front()->sequence);
+				oldest = std::min(oldest, q.blocks.front()->sequence);
+			}
+			if (newest == oldest)
+			{
+				return true;
+			}
+			// Sequences only grow, so a head older than another input's head
+			// can never be matched
+			for (input_queue& q : n.queues)
+			{
+				if (q.blocks.front()->sequence < newest)
+				{
+					q.blocks.pop_front();
+					++n.unmatched;
+				}
+			}
+		}
+	}
+
+	void pipeline::schedule(size_t index)
+	{
+		node& n = nodes_[index];
+		if (ready(n))
+		{
+			n.queued = true;
+			ready_.push_back(index);
+			work_cv_.notify_one();
+		}
+	}
+
+	size_t pipeline::next_ready()
+	{
+		auto best = ready_.begin();
+		if (scheduler_ == scheduler_policy::deadline)
+		{
+			// Ready stages have a head block in every queue. Without a deadline
+			// the key saturates and the oldest arrival wins among the rest.
+			const auto key = [this](size_t index) {
+				const node& n = nodes_[index];
+				const auto arrival = n.queues.front().blocks.front()->arrival;
+				const auto due = n.deadline == std::chrono::nanoseconds::max() ? std::chrono::steady_clock::time_point::max() : arrival + n.deadline;
+				return std::make_pair(due, arrival);
+			};
+			auto best_key = key(*best);
+			for (auto it = std::next(best); it != ready_.end(); ++it)
+			{
+				const auto k = key(*it);
+				if (k < best_key)
+				{
+					best = it;
+					best_key = k;
+				}
+			}
+		}
+		const size_t index = *best;
+		ready_.erase(best);
+		return index;
+	}
+
+	bool pipeline::behind(const node& n, std::chrono::steady_clock::time_point now) const
+	{
+		if (last_miss_ != std::chrono::steady_clock::time_point() && now - last_miss_ < recovery_)
+		{
+			return true;
+		}
+		return n.deadline != std::chrono::nanoseconds::max() && now > n.queues.front().blocks.front()->arrival + n.deadline;
+	}
+
+	void pipeline::deliver(size_t from, const block_ptr& block)
+	{
+		for (const auto& c : nodes_[from].consumers)
+		{
+			node& consumer = nodes_[c.first];
+			std::deque<block_ptr>& q = consumer.queues[c.second].blocks;
+			q.push_back(block);
+			// Under `block` a multi-block emission may overshoot; it drains first
+			if (overflow_ == overflow_policy::drop && q.size() > queue_capacity_)
+			{
+				q.pop_front();
+				++consumer.dropped;
+			}
+			schedule(c.first);
+		}
+	}
+
+	void pipeline::worker()
+	{
+		std::vector<block_ptr> inputs;
+		std::vector<pipeline_block> out;
+		std::unique_lock<std::mutex> lock(mutex_);
+		while (true)
+		{
+			work_cv_.wait(lock, [this] { return stopping_ || !ready_.empty(); });
+			if (ready_.empty())
+			{
+				return;
+			}
+			const size_t index = next_ready();
+			node& n = nodes_[index];
+			n.queued = false;
+			// Under `drop`, deliver() may have popped a head since the node was
+			// queued; re-align so a join never gets blocks of different sequences
+			if (!aligned(n))
+			{
+				if (ready_.empty() && running_count_ == 0)
+				{
+					idle_cv_.notify_all();
+				}
+				continue;
+			}
+			const bool skip = scheduler_ == scheduler_policy::deadline && n.optional && behind(n, std::chrono::steady_clock::now());
+			inputs.clear();
+			for (input_queue& q : n.queues)
+			{
+				inputs.push_back(std::move(q.blocks.front()));
+				q.blocks.pop_front();
+			}
+			if (overflow_ == overflow_policy::block)
+			{
+				// Producers held back by this stage's queues may continue
+				for (size_t producer : n.inputs)
+				{
+					schedule(producer);
+				}
+				room_cv_.notify_all();
+			}
+			if (skip)
+			{
+				++n.skipped;
+				schedule(index);
+				if (ready_.empty() && running_count_ == 0)
+				{
+					idle_cv_.notify_all();
+				}
+				continue;
+			}
+			n.running = true;
+			++running_count_;
+			lock.unlock();
+
+			out.clear();
+			const auto t0 = std::chrono::steady_clock::now();
+			n.stage->process(inputs, out);
+			const auto t1 = std::chrono::steady_clock::now();
+			const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+
+			lock.lock();
+			++n.runs;
+			n.total_ns += ns;
+			n.max_ns = std::max(n.max_ns, ns);
+			if (n.recent_ns.size() < recent_runs)
+			{
+				n.recent_ns.push_back(ns);
+			}
+			else
+			{
+				n.recent_ns[n.recent_pos] = ns;
+				n.recent_pos = (n.recent_pos + 1) % recent_runs;
+			}
+			if (n.deadline != std::chrono::nanoseconds::max() && t1 > inputs.front()->arrival + n.deadline)
+			{
+				++n.deadline_misses;
+				n.max_late_ns = std::max(n.max_late_ns, std::chrono::duration<double, std::nano>(t1 - (inputs.front()->arrival + n.deadline)).count());
+				last_miss_ = t1;
+			}
+			n.running = false;
+			--running_count_;
+			for (pipeline_block& b : out)
+			{
+				++n.emitted;
+				deliver(index, std::make_shared<const pipeline_block>(std::move(b)));
+			}
+			schedule(index);
+			if (ready_.empty() && running_count_ == 0)
+			{
+				idle_cv_.notify_all();
+			}
+		}
+	}
+
+	void pipeline::wait_idle()
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		idle_cv_.wait(lock, [this] { return !started_ || (ready_.empty() && running_count_ == 0); });
+	}
+
+	std::vector<std::string> pipeline::sources() const
+	{
+		std::vector<std::string> names;
+		for (const node& n : nodes_)
+		{
+			if (n.type == "source")
+			{
+				names.push_back(n.name);
+			}
+		}
+		return names;
+	}
+
+	bool pipeline::source_shape(const std::string& source, size_t& n_chans, double& sampling_rate) const
+	{
+		for (const node& n : nodes_)
+		{
+			if (n.type == "source" && n.name == source)
+			{
+				n_chans = n.source_chans;
+				sampling_rate = n.source_rate;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	std::vector<stage_stats> pipeline::stats() const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		std::vector<stage_stats> out;
+		for (size_t i : order_)
+		{
+			const node& n = nodes_[i];
+			stage_stats s;
+			s.name = n.name;
+			s.type = n.type;
+			s.runs = n.runs;
+			s.emitted = n.emitted;
+			s.dropped = n.dropped;
+			s.unmatched = n.unmatched;
+			s.deadline_ms = n.deadline == std::chrono::nanoseconds::max() ? 0 : std::chrono::duration<double, std::milli>(n.deadline).count();
+			s.optional = n.optional;
+			s.deadline_misses = n.deadline_misses;
+			s.skipped = n.skipped;
+			s.max_late_ms = n.max_late_ns * 1e-6;
+			for (const input_queue& q : n.queues)
+			{
+				s.queued += q.blocks.size();
+			}
+			if (n.stage && n.runs > 0)
+			{
+				std::vector<double> recent = n.recent_ns;
+				std::sort(recent.begin(), recent.end());
+				s.total_ms = n.total_ns * 1e-6;
+				s.mean_us = n.total_ns / static_cast<double>(n.runs) * 1e-3;
+				s.p50_us = percentile(recent, 0.50) * 1e-3;
+				s.p99_us = percentile(recent, 0.99) * 1e-3;
+				s.max_us = n.max_ns * 1e-3;
+			}
+			out.push_back(s);
+		}
+		return out;
+	}
+
+	void pipeline::write_stats(json_writer& w) const
+	{
+		w.begin_array();
+		for (const stage_stats& s : stats())
+		{
+			w.begin_object();
+			w.member("name", s.name);
+			w.member("type", s.type);
+			w.member("runs", s.runs);
+			w.member("emitted", s.emitted);
+			w.member("dropped", s.dropped);
+			w.member("unmatched", s.unmatched);
+			w.member("queued", static_cast<uint64_t>(s.queued));
+			w.member("total_ms", s.total_ms);
+			w.member("mean_us", s.mean_us);
+			w.member("p50_us", s.p50_us);
+			w.member("p99_us", s.p99_us);
+			w.member("max_us", s.max_us);
+			w.member("deadline_ms", s.deadline_ms);
+			w.member("optional", s.optional);
+			w.member("deadline_misses", s.deadline_misses);
+			w.member("skipped", s.skipped);
+			w.member("max_late_ms", s.max_late_ms);
+			w.end_object();
+		}
+		w.end_array();
+	}
+} // namespace eeg
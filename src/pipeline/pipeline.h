@@ -0,0 +1,336 @@
+/**
+ * @file pipeline.h
+ * @brief Declarative processing graph and its stage scheduler
+ */
+
+#pragma once
+
+#include "util/json_reader.h"
+#include "util/memory_accounting.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace eeg
+{
+	class json_writer;
+
+	/**
+	 * @brief Unit of data flowing along pipeline edges
+	 *
+	 * @details Blocks are immutable once emitted and shared by every consumer
+	 * of a stage. `sequence` identifies blocks derived from the same upstream
+	 * block, which is what multi-input stages join on.
+	 */
+	struct pipeline_block
+	{
+		uint64_t sequence = 0;
+		uint64_t first_sample = 0; ///< Sample number of the first sample in `data`
+		size_t n_chans = 0;
+		size_t n_samples = 0;
+		double sampling_rate = 0;
+		std::vector<double> data;   ///< Channel-major, channel n at `data[n * n_samples]`
+		std::vector<double> values; ///< Stage results such as per-channel quality or a classification
+		std::chrono::steady_clock::time_point arrival; ///< When the newest samples reached the source; deadlines count from here
+	};
+
+	using block_ptr = std::shared_ptr<const pipeline_block>;
+
+	/**
+	 * @brief Processing step of a pipeline
+	 *
+	 * @details The scheduler never runs a stage concurrently with itself and
+	 * feeds it blocks in sequence order, so stages may keep state between
+	 * calls without locking.
+	 */
+	class pipeline_stage
+	{
+	public:
+		virtual ~pipeline_stage() = default;
+
+		/**
+		 * @param inputs One block per declared input, all with the same sequence
+		 * @param out Blocks to emit, in order; arrives empty. `derive_block()`
+		 * starts one from an input's metadata.
+		 */
+		virtual void process(const std::vector<block_ptr>& inputs, std::vector<pipeline_block>& out) = 0;
+
+		/**
+		 * @brief Called once after the pipeline stops, e.g. to close files
+		 */
+		virtual void finish() {}
+	};
+
+	/**
+	 * @brief Block with the metadata of `from` and no data or values
+	 */
+	pipeline_block derive_block(const pipeline_block& from);
+
+	using pipeline_sink = std::function<void(const std::vector<block_ptr>& inputs)>;
+
+	/**
+	 * @brief What a stage factory gets besides its JSON settings
+	 */
+	struct stage_context
+	{
+		std::string name;
+		memory_owner owner = nullptr;
+		pipeline_sink sink; ///< Callback registered for this stage's name, may be empty
+	};
+
+	/**
+	 * @brief Creates a stage from its JSON description
+	 *
+	 * @return nullptr with `error` set when the settings are invalid
+	 */
+	using stage_factory = std::function<std::unique_ptr<pipeline_stage>(const json_value& config, const stage_context& ctx, std::string& error)>;
+
+	/**
+	 * @brief Makes a stage type available to pipeline files; replaces an
+	 * existing type of the same name
+	 */
+	void register_stage_type(const std::string& type, stage_factory factory);
+
+	/**
+	 * @brief Registered stage type names, built-in ones included
+	 */
+	std::vector<std::string> stage_types();
+
+	/**
+	 * @brief Timing and flow counters of one stage
+	 */
+	struct stage_stats
+	{
+		std::string name;
+		std::string type;
+		uint64_t runs = 0;
+		uint64_t emitted = 0;
+		uint64_t dropped = 0;   ///< Input blocks discarded because a queue was full
+		uint64_t unmatched = 0; ///< Input blocks discarded because no partner with the same sequence arrived
+		size_t queued = 0;      ///< Blocks waiting in the stage's input queues
+		double total_ms = 0;
+		double mean_us = 0;
+		double p50_us = 0;
+		double p99_us = 0; ///< Over the most recent runs
+		double max_us = 0;
+		double deadline_ms = 0; ///< Effective deadline after arrival, 0 when none
+		bool optional = false;
+		uint64_t deadline_misses = 0; ///< Runs that finished after the deadline
+		uint64_t skipped = 0;         ///< Optional runs left out because the scheduler was behind
+		double max_late_ms = 0;       ///< Worst finish time past the deadline
+	};
+
+	/**
+	 * @brief What happens when a stage's input queue is full
+	 */
+	enum class overflow_policy
+	{
+		drop,  ///< Discard the oldest queued block; for live streams
+		block, ///< Hold back producers until there is room; for offline data
+	};
+
+	/**
+	 * @brief Order in which ready stages run
+	 */
+	enum class scheduler_policy
+	{
+		fifo,     ///< In the order they became ready
+		deadline, ///< Earliest deadline first, skipping optional stages when behind
+	};
+
+	/**
+	 * @brief Default pipeline file, in the directory of `BA_CONFIG_DEFAULT_PATH`
+	 */
+	std::string default_pipeline_path();
+
+	/**
+	 * @brief DAG of stages fed by sources and scheduled on a thread pool
+	 *
+	 * @details A pipeline file is a JSON object:
+	 *
+	 *     {
+	 *       "threads": 4,
+	 *       "queue_capacity": 32,
+	 *       "overflow": "drop",
+	 *       "scheduler": "deadline",
+	 *       "stages": [
+	 *         {"name": "eeg", "type": "source", "channels": 8, "sampling_rate": 250},
+	 *         {"name": "window", "type": "window", "input": "eeg", "window_s": 2, "hop_s": 0.5},
+	 *         {"name": "bandpass", "type": "bandpass", "input": "window", "low_hz": 1, "high_hz": 40},
+	 *         {"name": "out", "type": "sink", "inputs": ["bandpass"], "deadline_ms": 50}
+	 *       ]
+	 *     }
+	 *
+	 * Stages name their upstream stages in `input` or `inputs`; the graph
+	 * must be acyclic. Sources are fed with `push()`, typically from a chunk
+	 * callback. A stage becomes ready when every input queue holds a block;
+	 * heads with different sequences are resolved by discarding the older
+	 * one. Stages that re-block, such as `window`, keep the sequence of the
+	 * block completing each output, so join them only with branches
+	 * re-blocked the same way. Ready stages run on `threads` workers, so independent branches
+	 * and successive blocks of a chain run in parallel.
+	 *
+	 * Queues hold at most `queue_capacity` blocks. With the default `drop`
+	 * policy a full queue drops its oldest block rather than blocking the
+	 * producer, which keeps `push()` safe to call from a chunk callback;
+	 * drops are counted per stage. With `block`, a stage is not run while
+	 * any consumer queue is full and `push()` waits for room, so nothing is
+	 * lost when feeding recorded data as fast as possible.
+	 *
+	 * A stage may set `deadline_ms`, the time after its input's samples
+	 * reached the source by which it should have finished; upstream stages
+	 * inherit the tightest deadline of their consumers. Runs finishing late
+	 * are counted as deadline misses whatever the scheduler. With
+	 * `"scheduler": "deadline"` workers pick the ready stage whose head block
+	 * has the earliest deadline, stages without one last and oldest first.
+	 * Stages marked `"optional": true` are then skipped, their inputs
+	 * discarded, while the scheduler is behind: when their own deadline has
+	 * already passed, or within `recovery_ms` (default 1000) of any deadline
+	 * miss. Consumers of a skipped stage get nothing for that block, so
+	 * optional stages belong on branches the deadline stages do not need.
+	 */
+	class pipeline
+	{
+	public:
+		explicit pipeline(memory_owner owner = nullptr);
+		~pipeline();
+		pipeline(const pipeline&) = delete;
+		pipeline& operator=(const pipeline&) = delete;
+
+		/**
+		 * @brief Registers the callback of a `sink` stage; call before `build()`
+		 */
+		void set_sink(const std::string& stage_name, pipeline_sink sink);
+
+		bool load_file(const std::string& path, std::string* error = nullptr);
+		bool build(const json_value& config, std::string* error = nullptr);
+
+		/**
+		 * @brief Overrides the file's `overflow` setting; call before `start()`
+		 */
+		void set_overflow(overflow_policy policy) { overflow_ = policy; }
+
+		/**
+		 * @brief Overrides the file's `scheduler` setting; call before `start()`
+		 */
+		void set_scheduler(scheduler_policy policy) { scheduler_ = policy; }
+
+		/**
+		 * @brief Overrides the file's `threads` setting; call before `start()`
+		 */
+		void set_threads(size_t n) { n_threads_ = n > 0 ? n : 1; }
+
+		void start();
+
+		/**
+		 * @brief Processes everything queued, stops the workers and calls
+		 * `finish()` on every stage
+		 */
+		void stop();
+
+		/**
+		 * @brief Feeds a source stage
+		 *
+		 * @param channels One pointer per source channel, each to `n` samples
+		 * @return false if there is no source of that name or the pipeline
+		 * is not running
+		 */
+		bool push(const std::string& source, const double* const* channels, size_t n, uint64_t first_sample);
+
+		/**
+		 * @brief Blocks until no stage is ready or running
+		 */
+		void wait_idle();
+
+		/**
+		 * @brief Names of source stages in file order
+		 */
+		std::vector<std::string> sources() const;
+
+		/**
+		 * @brief Channel count and sampling rate of a source
+		 */
+		bool source_shape(const std::string& source, size_t& n_chans, double& sampling_rate) const;
+
+		std::vector<stage_stats> stats() const;
+		void write_stats(json_writer& w) const;
+
+		size_t threads() const { return n_threads_; }
+
+	private:
+		struct input_queue
+		{
+			std::deque<block_ptr> blocks;
+		};
+
+		struct node
+		{
+			std::string name;
+			std::string type;
+			std::unique_ptr<pipeline_stage> stage; ///< Null for sources
+			std::vector<size_t> inputs;
+			std::vector<input_queue> queues;                   ///< One per input
+			std::vector<std::pair<size_t, size_t>> consumers; ///< (node, input slot)
+			size_t source_chans = 0;
+			double source_rate = 0;
+			double deadline_ms = 0; ///< Declared, 0 when none
+			std::chrono::nanoseconds deadline = std::chrono::nanoseconds::max(); ///< Effective, inherited from consumers
+			bool optional = false;
+			bool queued = false;
+			bool running = false;
+
+			uint64_t runs = 0;
+			uint64_t emitted = 0;
+			uint64_t dropped = 0;
+			uint64_t unmatched = 0;
+			uint64_t deadline_misses = 0;
+			uint64_t skipped = 0;
+			double max_late_ns = 0;
+			double total_ns = 0;
+			double max_ns = 0;
+			std::vector<double> recent_ns; ///< Ring of the latest run times
+			size_t recent_pos = 0;
+		};
+
+		bool ready(node& n);
+		bool aligned(node& n);
+		bool has_room(const node& n) const;
+		void schedule(size_t index);
+		size_t next_ready();
+		bool behind(const node& n, std::chrono::steady_clock::time_point now) const;
+		void deliver(size_t from, const block_ptr& block);
+		void worker();
+
+		memory_owner owner_;
+		std::map<std::string, pipeline_sink> sinks_;
+		std::vector<node> nodes_;
+		std::vector<size_t> order_; ///< Topological order
+		size_t n_threads_ = 2;
+		size_t queue_capacity_ = 32;
+		overflow_policy overflow_ = overflow_policy::drop;
+		scheduler_policy scheduler_ = scheduler_policy::fifo;
+		std::chrono::nanoseconds recovery_{std::chrono::seconds(1)};
+
+		mutable std::mutex mutex_;
+		std::condition_variable work_cv_;
+		std::condition_variable idle_cv_;
+		std::condition_variable room_cv_;
+		std::deque<size_t> ready_;
+		size_t running_count_ = 0;
+		uint64_t next_sequence_ = 0;
+		std::chrono::steady_clock::time_point last_miss_; ///< Epoch when nothing has missed
+		bool started_ = false;
+		bool stopping_ = false;
+		std::vector<std::thread> workers_;
+	};
+} // namespace eeg
@@ -0,0 +1,1290 @@
+#include "pipeline/stages.h"
+
+#include "bci/ar_spectrum.h"
+#include "bci/asr.h"
+#include "bci/connectivity.h"
+#include "bci/entropy.h"
+#include "bci/ica.h"
+#include "bci/p300_model.h"
+#include "pipeline/fused.h"
+#include "processor.h"
+#include "ssvep_classifier.h"
+#include "stream/adc_counts.h"
+#include "stream/arrow_ipc.h"
+#include "stream/pyramid.h"
+#include "stream/recording.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+namespace eeg
+{
+	namespace
+	{
+		/**
+		 * Cuts `window`-sample blocks every `hop` samples from a continuous
+		 * stream of blocks. Windows start at sample numbers that are
+		 * multiples of `hop`, so where a stream (or a segment of a batch
+		 * run) begins does not move them. A window carries the sequence of
+		 * the block holding its last sample, so several windows completed by
+		 * one block share it.
+		 */
+		class window_stage : public pipeline_stage
+		{
+		public:
+			window_stage(double window_s, double hop_s, size_t window, size_t hop, memory_owner owner)
+				: window_s_(window_s), hop_s_(hop_s), window_(window), hop_(hop), owner_(owner)
+			{
+			}
+
+			void process(const std::vector<block_ptr>& inputs, std::vector<pipeline_block>& out) override
+			{
+				const pipeline_block& in = *inputs[0];
+				if (in.n_chans == 0)
+				{
+					return;
+				}
+				if (buffers_.empty() || in.n_chans != buffers_.size() || in.first_sample != next_sample_)
+				{
+					reset(in);
+				}
+				for (size_t c = 0; c < buffers_.size(); ++c)
+				{
+					const double* src = in.data.data() + c * in.n_samples;
+					buffers_[c].insert(buffers_[c].end(), src, src + in.n_samples);
+				}
+				next_sample_ = in.first_sample + in.n_samples;
+
+				while (start_ + window_ <= buffers_[0].size())
+				{
+					// Keeps the sequence of `in`, which holds the window's last sample
+					pipeline_block b = derive_block(in);
+					b.first_sample = buffer_first_ + start_;
+					b.n_samples = window_;
+					b.data.resize(buffers_.size() * window_);
+					for (size_t c = 0; c < buffers_.size(); ++c)
+					{
+						std::copy(buffers_[c].begin() + static_cast<std::ptrdiff_t>(start_),
+								  buffers_[c].begin() + static_cast<std::ptrdiff_t>(start_ + window_),
+								  b.data.begin() + static_cast<std::ptrdiff_t>(c * window_));
+					}
+					out.push_back(std::move(b));
+					start_ += hop_;
+				}
+
+				// Drop consumed samples once they outweigh a window
+				if (start_ >= window_)
+				{
+					const size_t consumed = std::min(start_, buffers_[0].size());
+					for (auto& buf : buffers_)
+					{
+						buf.erase(buf.begin(), buf.begin() + static_cast<std::ptrdiff_t>(consumed));
+					}
+					buffer_first_ += consumed;
+					start_ -= consumed;
+				}
+			}
+
+		private:
+			void reset(const pipeline_block& in)
+			{
+				if (window_s_ > 0)
+				{
+					window_ = std::max<size_t>(1, static_cast<size_t>(std::lround(window_s_ * in.sampling_rate)));
+					hop_ = std::max<size_t>(1, static_cast<size_t>(std::lround(hop_s_ * in.sampling_rate)));
+				}
+				buffers_.assign(in.n_chans, tracked_vector<double>(tracked_allocator<double>(owner_, memory_category::ring_buffers)));
+				buffer_first_ = in.first_sample;
+				start_ = static_cast<size_t>((hop_ - in.first_sample % hop_) % hop_);
+			}
+
+			double window_s_;
+			double hop_s_;
+			size_t window_;
+			size_t hop_;
+			memory_owner owner_;
+			std::vector<tracked_vector<double>> buffers_;
+			uint64_t buffer_first_ = 0; ///< Sample number of `buffers_[c][0]`
+			uint64_t next_sample_ = 0;
+			size_t start_ = 0;          ///< Offset of the next window in the buffers
+		};
+
+		class select_stage : public pipeline_stage
+		{
+		public:
+			explicit select_stage(std::vector<size_t> channels) : channels_(std::move(channels)) {}
+
+			void process(const std::vector<block_ptr>& inputs, std::vector<pipeline_block>& out) override
+			{
+				const pipeline_block& in = *inputs[0];
+				pipeline_block b = derive_block(in);
+				b.n_chans = 0;
+				for (size_t c : channels_)
+				{
+					if (c < in.n_chans)
+					{
+						b.data.insert(b.data.end(), in.data.begin() + static_cast<std::ptrdiff_t>(c * in.n_samples),
+									  in.data.begin() + static_cast<std::ptrdiff_t>((c + 1) * in.n_samples));
+						++b.n_chans;
+					}
+				}
+				out.push_back(std::move(b));
+			}
+
+		private:
+			std::vector<size_t> channels_;
+		};
+
+		/**
+		 * processor.h operation applied to each block. The op receives a copy of
+		 * the input in `x` and writes its result to `y`, which starts as
+		 * another copy so in-place filters can ignore `x`.
+		 */
+		using block_op = std::function<void(double* x, double* y, size_t n_chans, size_t n_samples, double fs)>;
+
+		class transform_stage : public pipeline_stage
+		{
+		public:
+			explicit transform_stage(block_op op) : op_(std::move(op)) {}
+
+			void process(const std::vector<block_ptr>& inputs, std::vector<pipeline_block>& out) override
+			{
+				const pipeline_block& in = *inputs[0];
+				pipeline_block b = derive_block(in);
+				b.data = in.data;
+				scratch_ = in.data;
+				if (in.n_chans > 0 && in.n_samples > 0)
+				{
+					op_(scratch_.data(), b.data.data(), in.n_chans, in.n_samples, in.sampling_rate);
+				}
+				out.push_back(std::move(b));
+			}
+
+		private:
+			block_op op_;
+			std::vector<double> scratch_;
+		};
+
+		class quality_stage : public pipeline_stage
+		{
+		public:
+			void process(const std::vector<block_ptr>& inputs, std::vector<pipeline_block>& out) override
+			{
+				const pipeline_block& in = *inputs[0];
+				pipeline_block b = derive_block(in);
+				scratch_ = in.data;
+				b.values.resize(in.n_chans);
+				ba_bci_connect_get_signal_quality(scratch_.data(), in.n_chans, in.n_samples, in.sampling_rate, b.values.data());
+				out.push_back(std::move(b));
+			}
+
+		private:
+			std::vector<double> scratch_;
+		};
+
+		class ssvep_stage : public pipeline_stage
+		{
+		public:
+			explicit ssvep_stage(std::vector<double> freqs) : freqs_(std::move(freqs)) {}
+
+			void process(const std::vector<block_ptr>& inputs, std::vector<pipeline_block>& out) override
+			{
+				const pipeline_block& in = *inputs[0];
+				pipeline_block b = derive_block(in);
+				double score = 0;
+				const size_t cls =
+					ba_bci_connect_ssvep_classify(in.data.data(), in.n_samples, in.n_chans, in.sampling_rate, freqs_.data(), freqs_.size(), &score);
+				b.values = {static_cast<double>(cls), score};
+				out.push_back(std::move(b));
+			}
+
+		private:
+			std::vector<double> freqs_;
+		};
+
+		class p300_stage : public pipeline_stage
+		{
+		public:
+			explicit p300_stage(p300_model model) : model_(std::move(model)) {}
+
+			void process(const std::vector<block_ptr>& inputs, std::vector<pipeline_block>& out) override
+			{
+				const pipeline_block& in = *inputs[0];
+				if (in.data.size() != model_.spec().input_size())
+				{
+					return;
+				}
+				pipeline_block b = derive_block(in);
+				double result = 0;
+				if (model_.predict(in.data.data(), &result) == BA_BCI_CONNECT_ERROR_OK)
+				{
+					b.values = {result};
+					out.push_back(std::move(b));
+				}
+			}
+
+		private:
+			p300_model model_;
+		};
+
+		class recorder_stage : public pipeline_stage
+		{
+		public:
+			recorder_stage(std::string path, std::vector<std::string> labels, double count_scale, bool pyramid)
+				: path_(std::move(path)), labels_(std::move(labels)), count_scale_(count_scale), build_pyramid_(pyramid)
+			{
+			}
+
+			void process(const std::vector<block_ptr>& inputs, std::vector<pipeline_block>& out) override
+			{
+				(void)out;
+				const pipeline_block& in = *inputs[0];
+				if (!writer_.is_open())
+				{
+					if (failed_)
+					{
+						return;
+					}
+					recording_header h;
+					h.n_chans = in.n_chans;
+					h.sampling_rate = in.sampling_rate;
+					h.labels = labels_;
+					if (!writer_.open(path_, h))
+					{
+						failed_ = true;
+						return;
+					}
+					if (count_scale_ > 0)
+					{
+						writer_.set_counts(std::vector<double>(in.n_chans, count_scale_));
+					}
+					if (build_pyramid_)
+					{
+						pyramid_ = minmax_pyramid(in.n_chans);
+					}
+				}
+				if (in.n_chans == writer_.header().n_chans)
+				{
+					writer_.write_block(in.data.data(), in.n_samples, in.first_sample);
+					if (build_pyramid_)
+					{
+						pyramid_.append(in.data.data(), in.n_samples);
+					}
+				}
+			}
+
+			void finish() override
+			{
+				if (writer_.is_open() && build_pyramid_)
+				{
+					write_pyramid(pyramid_path(path_), pyramid_);
+				}
+				writer_.close();
+			}
+
+		private:
+			std::string path_;
+			std::vector<std::string> labels_;
+			double count_scale_; ///< Microvolts per count, 0 to write float64
+			bool build_pyramid_;
+			recording_writer writer_;
+			minmax_pyramid pyramid_;
+			bool failed_ = false;
+		};
+
+		/**
+		 * Writes data blocks as Arrow record batches, one per block, with the
+		 * channels copied straight from the block.
+		 */
+		class arrow_stage : public pipeline_stage
+		{
+		public:
+			arrow_stage(std::string path, std::vector<std::string> labels, bool stream)
+				: path_(std::move(path)), labels_(std::move(labels)), stream_(stream)
+			{
+			}
+
+			void process(const std::vector<block_ptr>& inputs, std::vector<pipeline_block>& out) override
+			{
+				(void)out;
+				const pipeline_block& in = *inputs[0];
+				if (!writer_)
+				{
+					if (failed_)
+					{
+						return;
+					}
+					recording_header h;
+					h.n_chans = in.n_chans;
+					h.sampling_rate = in.sampling_rate;
+					h.labels = labels_;
+					const arrow_schema schema = samples_arrow_schema(h);
+					if (stream_)
+					{
+						stream_out_.open(path_, std::ios::binary | std::ios::trunc);
+						stream_writer_ = std::make_unique<arrow_stream_writer>(stream_out_);
+						if (!stream_out_ || !stream_writer_->begin(schema))
+						{
+							failed_ = true;
+							return;
+						}
+						writer_ = stream_writer_.get();
+					}
+					else
+					{
+						if (!file_writer_.open(path_, schema))
+						{
+							failed_ = true;
+							return;
+						}
+						writer_ = &file_writer_;
+					}
+					n_chans_ = in.n_chans;
+				}
+				if (in.n_chans == n_chans_)
+				{
+					writer_->write(samples_arrow_batch(in.data.data(), in.n_chans, in.n_samples, in.n_samples, in.first_sample));
+				}
+			}
+
+			void finish() override
+			{
+				if (stream_writer_)
+				{
+					stream_writer_->end();
+					stream_out_.close();
+				}
+				file_writer_.close();
+				writer_ = nullptr;
+			}
+
+		private:
+			std::string path_;
+			std::vector<std::string> labels_;
+			bool stream_; ///< Streaming format, for a pipe or a reader following along
+			std::ofstream stream_out_;
+			std::unique_ptr<arrow_stream_writer> stream_writer_;
+			arrow_file_writer file_writer_;
+			arrow_stream_writer* writer_ = nullptr;
+			size_t n_chans_ = 0;
+			bool failed_ = false;
+		};
+
+		class sink_stage : public pipeline_stage
+		{
+		public:
+			explicit sink_stage(pipeline_sink sink) : sink_(std::move(sink)) {}
+
+			void process(const std::vector<block_ptr>& inputs, std::vector<pipeline_block>& out) override
+			{
+				(void)out;
+				if (sink_)
+				{
+					sink_(inputs);
+				}
+			}
+
+		private:
+			pipeline_sink sink_;
+		};
+
+		/**
+		 * Streaming biquad cascade, the run-time counterpart of the fused
+		 * notch and bandpass kernels. Filter state carries over between
+		 * blocks and restarts after a gap in sample numbers.
+		 */
+		class iir_stage : public pipeline_stage
+		{
+		public:
+			using design = std::function<std::vector<fused::biquad_coefficients>(double fs)>;
+
+			explicit iir_stage(design d) : design_(std::move(d)) {}
+
+			void process(const std::vector<block_ptr>& inputs, std::vector<pipeline_block>& out) override
+			{
+				const pipeline_block& in = *inputs[0];
+				if (in.n_chans != n_chans_ || in.sampling_rate != fs_ || in.first_sample != next_sample_)
+				{
+					n_chans_ = in.n_chans;
+					fs_ = in.sampling_rate;
+					const std::vector<fused::biquad_coefficients> sections = design_(fs_);
+					banks_.assign(sections.size(), fused::biquad_bank<fused::dynamic>());
+					for (size_t k = 0; k < sections.size(); ++k)
+					{
+						banks_[k].init(sections[k], n_chans_);
+					}
+					sample_.resize(n_chans_);
+				}
+				next_sample_ = in.first_sample + in.n_samples;
+
+				pipeline_block b = derive_block(in);
+				b.data.resize(in.data.size());
+				for (size_t t = 0; t < in.n_samples; ++t)
+				{
+					for (size_t c = 0; c < n_chans_; ++c)
+					{
+						sample_[c] = in.data[c * in.n_samples + t];
+					}
+					for (auto& bank : banks_)
+					{
+						bank.step(sample_.data());
+					}
+					for (size_t c = 0; c < n_chans_; ++c)
+					{
+						b.data[c * in.n_samples + t] = sample_[c];
+					}
+				}
+				out.push_back(std::move(b));
+			}
+
+		private:
+			design design_;
+			std::vector<fused::biquad_bank<fused::dynamic>> banks_;
+			std::vector<double> sample_;
+			size_t n_chans_ = 0;
+			double fs_ = 0;
+			uint64_t next_sample_ = 0;
+		};
+
+		/**
+		 * Analytic signal through a streaming FIR Hilbert transformer. Output
+		 * blocks are labelled with the sample numbers they describe, `delay`
+		 * behind the input; after a start or a gap the first `delay` outputs
+		 * are dropped, as they depend on samples from before it.
+		 */
+		class hilbert_stage : public pipeline_stage
+		{
+		public:
+			enum class output
+			{
+				analytic, ///< Real parts, then imaginary parts
+				envelope,
+				phase,
+				polar, ///< Envelopes, then phases
+			};
+
+			hilbert_stage(size_t taps, double low_hz, output o) : taps_(taps), low_hz_(low_hz), output_(o) {}
+
+			void process(const std::vector<block_ptr>& inputs, std::vector<pipeline_block>& out) override
+			{
+				const pipeline_block& in = *inputs[0];
+				if (in.n_chans != n_chans_ || in.sampling_rate != fs_ || in.first_sample != next_sample_)
+				{
+					n_chans_ = in.n_chans;
+					fs_ = in.sampling_rate;
+					bank_.init(taps_ > 0 ? taps_ : fused::hilbert_taps(fs_, low_hz_), n_chans_);
+					warmup_ = bank_.delay();
+					sample_.resize(n_chans_);
+					re_.resize(n_chans_);
+					im_.resize(n_chans_);
+				}
+				next_sample_ = in.first_sample + in.n_samples;
+
+				const size_t skip = std::min(warmup_, in.n_samples);
+				warmup_ -= skip;
+				const size_t n = in.n_samples - skip;
+				const size_t delay = bank_.delay();
+				pipeline_block b = derive_block(in);
+				b.n_chans = output_ == output::analytic || output_ == output::polar ? 2 * n_chans_ : n_chans_;
+				b.first_sample = in.first_sample + skip - delay;
+				b.n_samples = n;
+				b.data.resize(b.n_chans * n);
+				double* first = b.data.data();
+				double* second = first + n_chans_ * n;
+				for (size_t t = 0; t < in.n_samples; ++t)
+				{
+					for (size_t c = 0; c < n_chans_; ++c)
+					{
+						sample_[c] = in.data[c * in.n_samples + t];
+					}
+					bank_.step(sample_.data(), re_.data(), im_.data());
+					if (t < skip)
+					{
+						continue;
+					}
+					const size_t k = t - skip;
+					for (size_t c = 0; c < n_chans_; ++c)
+					{
+						const double re = re_[c];
+						const double im = im_[c];
+						switch (output_)
+						{
+						case output::analytic:
+							first[c * n + k] = re;
+							second[c * n + k] = im;
+							break;
+						case output::envelope:
+							first[c * n + k] = std::sqrt(re * re + im * im);
+							break;
+						case output::phase:
+							first[c * n + k] = std::atan2(im, re);
+							break;
+						case output::polar:
+							first[c * n + k] = std::sqrt(re * re + im * im);
+							second[c * n + k] = std::atan2(im, re);
+							break;
+						}
+					}
+				}
+				if (n == 0)
+				{
+					return; // Still warming up: nothing to emit, and no valid first sample
+				}
+				out.push_back(std::move(b));
+			}
+
+		private:
+			size_t taps_; ///< 0 to size from `low_hz_`
+			double low_hz_;
+			output output_;
+			fused::hilbert_bank<fused::dynamic> bank_;
+			std::vector<double> sample_;
+			std::vector<double> re_;
+			std::vector<double> im_;
+			size_t warmup_ = 0; ///< Outputs still to drop
+			size_t n_chans_ = 0;
+			double fs_ = 0;
+			uint64_t next_sample_ = 0;
+		};
+
+		/**
+		 * Artifact Subspace Reconstruction, calibrated on the first
+		 * `calibration_s` seconds of the stream, which pass through
+		 * unchanged. After that output lags by the filter's delay; the
+		 * delayed warm-up outputs are dropped, so sample numbers continue
+		 * from the calibration's.
+		 */
+		class asr_stage : public pipeline_stage
+		{
+		public:
+			asr_stage(const asr_options& opts, double calibration_s) : opts_(opts), calibration_s_(calibration_s) {}
+
+			void process(const std::vector<block_ptr>& inputs, std::vector<pipeline_block>& out) override
+			{
+				const pipeline_block& in = *inputs[0];
+				if (in.n_chans != n_chans_ || in.sampling_rate != fs_)
+				{
+					n_chans_ = in.n_chans;
+					fs_ = in.sampling_rate;
+					filter_ = asr_filter();
+					calibration_.assign(n_chans_, std::vector<double>());
+				}
+				if (!filter_.calibrated())
+				{
+					for (size_t c = 0; c < n_chans_; ++c)
+					{
+						calibration_[c].insert(calibration_[c].end(), in.data.begin() + static_cast<std::ptrdiff_t>(c * in.n_samples),
+											   in.data.begin() + static_cast<std::ptrdiff_t>((c + 1) * in.n_samples));
+					}
+					const size_t have = calibration_.empty() ? 0 : calibration_[0].size();
+					if (have > 0 && static_cast<double>(have) >= calibration_s_ * fs_)
+					{
+						std::vector<double> x;
+						x.reserve(n_chans_ * have);
+						for (std::vector<double>& c : calibration_)
+						{
+							x.insert(x.end(), c.begin(), c.end());
+							c.clear();
+						}
+						// Unusable data starts the calibration over
+						filter_.calibrate(x.data(), n_chans_, have, fs_, opts_);
+						warmup_ = filter_.delay();
+					}
+					next_sample_ = in.first_sample + in.n_samples;
+					pipeline_block b = derive_block(in);
+					b.data = in.data;
+					out.push_back(std::move(b));
+					return;
+				}
+				if (in.first_sample != next_sample_)
+				{
+					filter_.reset();
+					warmup_ = filter_.delay();
+				}
+				next_sample_ = in.first_sample + in.n_samples;
+
+				scratch_.resize(in.data.size());
+				filter_.process(in.data.data(), in.n_samples, scratch_.data());
+				const size_t skip = std::min(warmup_, in.n_samples);
+				warmup_ -= skip;
+				const size_t n = in.n_samples - skip;
+				if (n == 0)
+				{
+					return;
+				}
+				pipeline_block b = derive_block(in);
+				b.first_sample = in.first_sample + skip - filter_.delay();
+				b.n_samples = n;
+				b.data.resize(n_chans_ * n);
+				for (size_t c = 0; c < n_chans_; ++c)
+				{
+					std::copy(scratch_.begin() + static_cast<std::ptrdiff_t>(c * in.n_samples + skip),
+							  scratch_.begin() + static_cast<std::ptrdiff_t>((c + 1) * in.n_samples), b.data.begin() + static_cast<std::ptrdiff_t>(c * n));
+				}
+				out.push_back(std::move(b));
+			}
+
+		private:
+			asr_options opts_;
+			double calibration_s_;
+			asr_filter filter_;
+			std::vector<std::vector<double>> calibration_; ///< Per channel, until calibrated
+			std::vector<double> scratch_;
+			size_t warmup_ = 0; ///< Outputs still to drop
+			size_t n_chans_ = 0;
+			double fs_ = 0;
+			uint64_t next_sample_ = 0;
+		};
+
+		/**
+		 * Keeps every `factor`-th sample, with the phase carried over blocks.
+		 */
+		class decimate_stage : public pipeline_stage
+		{
+		public:
+			explicit decimate_stage(size_t factor) : factor_(factor) {}
+
+			void process(const std::vector<block_ptr>& inputs, std::vector<pipeline_block>& out) override
+			{
+				const pipeline_block& in = *inputs[0];
+				// Offset of the first kept sample in this block
+				size_t first = (factor_ - 1 - phase_) % factor_;
+				phase_ = (phase_ + in.n_samples) % factor_;
+				pipeline_block b = derive_block(in);
+				b.sampling_rate = in.sampling_rate / static_cast<double>(factor_);
+				b.first_sample = in.first_sample + first;
+				b.n_samples = first < in.n_samples ? (in.n_samples - first + factor_ - 1) / factor_ : 0;
+				b.data.resize(in.n_chans * b.n_samples);
+				for (size_t c = 0; c < in.n_chans; ++c)
+				{
+					for (size_t k = 0; k < b.n_samples; ++k)
+					{
+						b.data[c * b.n_samples + k] = in.data[c * in.n_samples + first + k * factor_];
+					}
+				}
+				out.push_back(std::move(b));
+			}
+
+		private:
+			size_t factor_;
+			size_t phase_ = 0; ///< Samples seen since the last kept one
+		};
+
+		/**
+		 * Mean power per channel over non-overlapping windows, emitted in
+		 * `values` as each window completes; the result keeps the metadata
+		 * of the block that completed it. Windows start at sample numbers
+		 * that are multiples of `window`, like the window stage's, and
+		 * windows with missing samples are not emitted.
+		 */
+		class band_power_stage : public pipeline_stage
+		{
+		public:
+			explicit band_power_stage(size_t window) : window_(window) {}
+
+			void process(const std::vector<block_ptr>& inputs, std::vector<pipeline_block>& out) override
+			{
+				const pipeline_block& in = *inputs[0];
+				if (sum_.size() != in.n_chans)
+				{
+					sum_.assign(in.n_chans, 0.0);
+					count_ = 0;
+				}
+				for (size_t t = 0; t < in.n_samples; ++t)
+				{
+					const uint64_t sample = in.first_sample + t;
+					if (sample / window_ != current_)
+					{
+						// A new window, or a gap: restart the sums
+						current_ = sample / window_;
+						std::fill(sum_.begin(), sum_.end(), 0.0);
+						count_ = 0;
+					}
+					for (size_t c = 0; c < in.n_chans; ++c)
+					{
+						const double x = in.data[c * in.n_samples + t];
+						sum_[c] += x * x;
+					}
+					if (++count_ == window_)
+					{
+						pipeline_block b = derive_block(in);
+						b.n_samples = 0;
+						b.values.resize(in.n_chans);
+						for (size_t c = 0; c < in.n_chans; ++c)
+						{
+							b.values[c] = sum_[c] / static_cast<double>(window_);
+							sum_[c] = 0;
+						}
+						count_ = 0;
+						out.push_back(std::move(b));
+					}
+				}
+			}
+
+		private:
+			size_t window_;
+			std::vector<double> sum_;
+			size_t count_ = 0;
+			uint64_t current_ = UINT64_MAX; ///< Window index, sample number / `window_`, being summed
+		};
+
+		/**
+		 * Burg AR spectrum of each window at the configured frequencies, as
+		 * densities (channel-major) or each channel's peak frequency.
+		 */
+		class ar_spectrum_stage : public pipeline_stage
+		{
+		public:
+			ar_spectrum_stage(std::vector<double> frequencies, size_t order, bool peak)
+				: frequencies_(std::move(frequencies)), order_(order), peak_(peak)
+			{
+			}
+
+			void process(const std::vector<block_ptr>& inputs, std::vector<pipeline_block>& out) override
+			{
+				const pipeline_block& in = *inputs[0];
+				if (in.n_chans != n_chans_ || in.sampling_rate != fs_)
+				{
+					n_chans_ = in.n_chans;
+					fs_ = in.sampling_rate;
+					ready_ = ar_.init(n_chans_, fs_, frequencies_, order_);
+					psd_.resize(n_chans_ * frequencies_.size());
+				}
+				if (!ready_ || !ar_.fit(in.data.data(), in.n_samples))
+				{
+					return;
+				}
+				ar_.evaluate(psd_.data());
+				pipeline_block b = derive_block(in);
+				b.n_samples = 0;
+				if (!peak_)
+				{
+					b.values = psd_;
+				}
+				else
+				{
+					const size_t n = frequencies_.size();
+					b.values.resize(n_chans_);
+					for (size_t c = 0; c < n_chans_; ++c)
+					{
+						const double* p = &psd_[c * n];
+						b.values[c] = frequencies_[static_cast<size_t>(std::max_element(p, p + n) - p)];
+					}
+				}
+				out.push_back(std::move(b));
+			}
+
+		private:
+			std::vector<double> frequencies_;
+			size_t order_;
+			bool peak_;
+			ar_spectrum ar_;
+			bool ready_ = false;
+			std::vector<double> psd_;
+			size_t n_chans_ = 0;
+			double fs_ = 0;
+		};
+
+		/**
+		 * Sample then approximate entropy of each window, per channel.
+		 */
+		class entropy_stage : public pipeline_stage
+		{
+		public:
+			explicit entropy_stage(const entropy_options& opts) : opts_(opts) {}
+
+			void process(const std::vector<block_ptr>& inputs, std::vector<pipeline_block>& out) override
+			{
+				const pipeline_block& in = *inputs[0];
+				if (in.n_chans != n_chans_)
+				{
+					n_chans_ = in.n_chans;
+					ready_ = engine_.init(n_chans_, opts_);
+				}
+				if (!ready_ || !engine_.compute(in.data.data(), in.n_samples, values_))
+				{
+					return;
+				}
+				pipeline_block b = derive_block(in);
+				b.n_samples = 0;
+				b.values = values_.sample;
+				b.values.insert(b.values.end(), values_.approximate.begin(), values_.approximate.end());
+				out.push_back(std::move(b));
+			}
+
+		private:
+			entropy_options opts_;
+			entropy_engine engine_;
+			bool ready_ = false;
+			entropy_values values_;
+			size_t n_chans_ = 0;
+		};
+
+		/**
+		 * Channel-pair connectivity over the most recent windows, emitted in
+		 * `values` for every window: coherence, then phase-locking value,
+		 * then correlation, each over pairs (0, 1), (0, 2), ..., (1, 2), ...
+		 */
+		class connectivity_stage : public pipeline_stage
+		{
+		public:
+			explicit connectivity_stage(const connectivity_options& opts) : opts_(opts) {}
+
+			void process(const std::vector<block_ptr>& inputs, std::vector<pipeline_block>& out) override
+			{
+				const pipeline_block& in = *inputs[0];
+				if (in.n_chans != n_chans_ || in.n_samples != window_ || in.sampling_rate != fs_)
+				{
+					n_chans_ = in.n_chans;
+					window_ = in.n_samples;
+					fs_ = in.sampling_rate;
+					ready_ = engine_.init(n_chans_, window_, fs_, opts_);
+				}
+				if (!ready_)
+				{
+					return;
+				}
+				engine_.add_window(in.data.data());
+				engine_.compute(matrices_);
+
+				pipeline_block b = derive_block(in);
+				b.n_samples = 0;
+				const size_t n_pairs = engine_.n_pairs();
+				b.values.resize(3 * n_pairs);
+				size_t p = 0;
+				for (size_t i = 0; i < n_chans_; ++i)
+				{
+					for (size_t j = i + 1; j < n_chans_; ++j, ++p)
+					{
+						b.values[p] = matrices_.coherence[i * n_chans_ + j];
+						b.values[n_pairs + p] = matrices_.plv[i * n_chans_ + j];
+						b.values[2 * n_pairs + p] = matrices_.correlation[i * n_chans_ + j];
+					}
+				}
+				out.push_back(std::move(b));
+			}
+
+		private:
+			connectivity_options opts_;
+			connectivity_engine engine_;
+			connectivity_matrices matrices_;
+			bool ready_ = false;
+			size_t n_chans_ = 0;
+			size_t window_ = 0;
+			double fs_ = 0;
+		};
+
+		/**
+		 * Applies a fitted ICA model: removes its selected components from
+		 * each block, or emits the component time courses instead.
+		 */
+		class ica_stage : public pipeline_stage
+		{
+		public:
+			ica_stage(ica_model model, bool sources) : model_(std::move(model)), sources_(sources) {}
+
+			void process(const std::vector<block_ptr>& inputs, std::vector<pipeline_block>& out) override
+			{
+				const pipeline_block& in = *inputs[0];
+				if (in.n_chans != model_.n_chans())
+				{
+					return;
+				}
+				pipeline_block b = derive_block(in);
+				if (sources_)
+				{
+					b.n_chans = model_.n_components();
+					b.data.resize(b.n_chans * in.n_samples);
+					model_.sources(in.data.data(), in.n_samples, b.data.data());
+				}
+				else
+				{
+					b.data.resize(in.data.size());
+					model_.clean(in.data.data(), in.n_samples, b.data.data());
+				}
+				out.push_back(std::move(b));
+			}
+
+		private:
+			ica_model model_;
+			bool sources_;
+		};
+
+		std::vector<double> numbers(const json_value* v)
+		{
+			std::vector<double> out;
+			if (v)
+			{
+				for (const json_value& x : v->items())
+				{
+					out.push_back(x.as_number());
+				}
+			}
+			return out;
+		}
+
+		/**
+		 * Factory for an operation that needs nothing but its block.
+		 */
+		stage_factory transform(block_op op)
+		{
+			return [op](const json_value&, const stage_context&, std::string&) -> std::unique_ptr<pipeline_stage> {
+				return std::make_unique<transform_stage>(op);
+			};
+		}
+	} // namespace
+
+	void register_builtin_stages(std::map<std::string, stage_factory>& registry)
+	{
+		registry["window"] = [](const json_value& c, const stage_context& ctx, std::string& error) -> std::unique_ptr<pipeline_stage> {
+			const double window_s = c.number_or("window_s", 0);
+			const double hop_s = c.number_or("hop_s", window_s);
+			const size_t window = static_cast<size_t>(c.number_or("window", 0));
+			const size_t hop = static_cast<size_t>(c.number_or("hop", static_cast<double>(window)));
+			if ((window_s <= 0 || hop_s <= 0) && (window == 0 || hop == 0))
+			{
+				error = "window needs \"window_s\" (and \"hop_s\") or \"window\" (and \"hop\") > 0";
+				return nullptr;
+			}
+			return std::make_unique<window_stage>(window_s, hop_s, window, hop, ctx.owner);
+		};
+
+		registry["select"] = [](const json_value& c, const stage_context&, std::string& error) -> std::unique_ptr<pipeline_stage> {
+			std::vector<size_t> channels;
+			for (double x : numbers(c.find("channels")))
+			{
+				channels.push_back(static_cast<size_t>(x));
+			}
+			if (channels.empty())
+			{
+				error = "select needs a non-empty \"channels\" array";
+				return nullptr;
+			}
+			return std::make_unique<select_stage>(std::move(channels));
+		};
+
+		registry["detrend"] = transform([](double* x, double* y, size_t n_chans, size_t n, double) { ba_bci_connect_detrend(x, n_chans, n, y); });
+		registry["demean"] = transform([](double* x, double* y, size_t n_chans, size_t n, double) { ba_bci_connect_demean(x, n_chans, n, y); });
+		registry["standardize"] =
+			transform([](double* x, double* y, size_t n_chans, size_t n, double) { ba_bci_connect_standartize(x, n_chans, n, y); });
+
+		registry["ewma"] = [](const json_value& c, const stage_context&, std::string& error) -> std::unique_ptr<pipeline_stage> {
+			const double alpha = c.number_or("alpha", 0);
+			if (alpha <= 0 || alpha > 1)
+			{
+				error = "ewma needs 0 < \"alpha\" <= 1";
+				return nullptr;
+			}
+			return std::make_unique<transform_stage>(
+				[alpha](double* x, double* y, size_t n_chans, size_t n, double) { ba_bci_connect_ewma(x, n_chans, n, alpha, y); });
+		};
+
+		registry["ewma_standardize"] = [](const json_value& c, const stage_context&, std::string& error) -> std::unique_ptr<pipeline_stage> {
+			const double alpha = c.number_or("alpha", 0);
+			const double epsilon = c.number_or("epsilon", 1e-4);
+			if (alpha <= 0 || alpha > 1)
+			{
+				error = "ewma_standardize needs 0 < \"alpha\" <= 1";
+				return nullptr;
+			}
+			return std::make_unique<transform_stage>([alpha, epsilon](double* x, double* y, size_t n_chans, size_t n, double) {
+				ba_bci_connect_ewma_standartize(x, n_chans, n, alpha, epsilon, y);
+			});
+		};
+
+		registry["lowpass"] = [](const json_value& c, const stage_context&, std::string& error) -> std::unique_ptr<pipeline_stage> {
+			const double cutoff = c.number_or("cutoff_hz", 0);
+			if (cutoff <= 0)
+			{
+				error = "lowpass needs \"cutoff_hz\" > 0";
+				return nullptr;
+			}
+			return std::make_unique<transform_stage>(
+				[cutoff](double*, double* y, size_t n_chans, size_t n, double fs) { ba_bci_connect_filter_lowpass(y, n_chans, n, fs, cutoff); });
+		};
+
+		registry["highpass"] = [](const json_value& c, const stage_context&, std::string& error) -> std::unique_ptr<pipeline_stage> {
+			const double cutoff = c.number_or("cutoff_hz", 0);
+			if (cutoff <= 0)
+			{
+				error = "highpass needs \"cutoff_hz\" > 0";
+				return nullptr;
+			}
+			return std::make_unique<transform_stage>(
+				[cutoff](double*, double* y, size_t n_chans, size_t n, double fs) { ba_bci_connect_filter_highpass(y, n_chans, n, fs, cutoff); });
+		};
+
+		registry["bandpass"] = [](const json_value& c, const stage_context&, std::string& error) -> std::unique_ptr<pipeline_stage> {
+			const double low = c.number_or("low_hz", 0);
+			const double high = c.number_or("high_hz", 0);
+			if (low <= 0 || high <= low)
+			{
+				error = "bandpass needs 0 < \"low_hz\" < \"high_hz\"";
+				return nullptr;
+			}
+			return std::make_unique<transform_stage>(
+				[low, high](double*, double* y, size_t n_chans, size_t n, double fs) { ba_bci_connect_filter_bandpass(y, n_chans, n, fs, low, high); });
+		};
+
+		registry["notch"] = [](const json_value& c, const stage_context&, std::string& error) -> std::unique_ptr<pipeline_stage> {
+			const double center = c.number_or("center_hz", 50);
+			const double width = c.number_or("width_hz", 4);
+			if (center <= 0 || width <= 0)
+			{
+				error = "notch needs \"center_hz\" and \"width_hz\" > 0";
+				return nullptr;
+			}
+			return std::make_unique<transform_stage>(
+				[center, width](double*, double* y, size_t n_chans, size_t n, double fs) { ba_bci_connect_filter_notch(y, n_chans, n, fs, center, width); });
+		};
+
+		registry["iir_notch"] = [](const json_value& c, const stage_context&, std::string& error) -> std::unique_ptr<pipeline_stage> {
+			const double center = c.number_or("center_hz", 50);
+			const double width = c.number_or("width_hz", 4);
+			if (center <= 0 || width <= 0)
+			{
+				error = "iir_notch needs \"center_hz\" and \"width_hz\" > 0";
+				return nullptr;
+			}
+			return std::make_unique<iir_stage>([center, width](double fs) {
+				return std::vector<fused::biquad_coefficients>{fused::biquad_coefficients::notch(fs, center, width)};
+			});
+		};
+
+		registry["iir_bandpass"] = [](const json_value& c, const stage_context&, std::string& error) -> std::unique_ptr<pipeline_stage> {
+			const double low = c.number_or("low_hz", 0);
+			const double high = c.number_or("high_hz", 0);
+			if (low <= 0 || high <= low)
+			{
+				error = "iir_bandpass needs 0 < \"low_hz\" < \"high_hz\"";
+				return nullptr;
+			}
+			return std::make_unique<iir_stage>([low, high](double fs) {
+				return std::vector<fused::biquad_coefficients>{fused::biquad_coefficients::highpass(fs, low),
+															   fused::biquad_coefficients::lowpass(fs, high)};
+			});
+		};
+
+		registry["asr"] = [](const json_value& c, const stage_context&, std::string& error) -> std::unique_ptr<pipeline_stage> {
+			asr_options opts;
+			opts.cutoff = c.number_or("cutoff", opts.cutoff);
+			opts.window_s = c.number_or("window_s", opts.window_s);
+			opts.lookahead_s = c.number_or("lookahead_s", opts.lookahead_s);
+			opts.max_dims = c.number_or("max_dims", opts.max_dims);
+			const double step = c.number_or("step", static_cast<double>(opts.step));
+			const double calibration_s = c.number_or("calibration_s", 60);
+			if (opts.cutoff <= 0 || opts.window_s <= 0 || step < 1 || opts.max_dims < 0 || opts.max_dims > 1 || calibration_s < 10 * opts.window_s)
+			{
+				error = "asr needs \"cutoff\" and \"window_s\" > 0, \"step\" >= 1, \"max_dims\" from 0 to 1 and \"calibration_s\" of at least ten windows";
+				return nullptr;
+			}
+			opts.step = static_cast<size_t>(step);
+			return std::make_unique<asr_stage>(opts, calibration_s);
+		};
+
+		registry["decimate"] = [](const json_value& c, const stage_context&, std::string& error) -> std::unique_ptr<pipeline_stage> {
+			const double factor = c.number_or("factor", 0);
+			if (factor < 1)
+			{
+				error = "decimate needs \"factor\" >= 1";
+				return nullptr;
+			}
+			return std::make_unique<decimate_stage>(static_cast<size_t>(factor));
+		};
+
+		registry["hilbert"] = [](const json_value& c, const stage_context&, std::string& error) -> std::unique_ptr<pipeline_stage> {
+			const double taps = c.number_or("taps", 0);
+			const double low = c.number_or("low_hz", 4);
+			if (c.find("taps") ? taps < 3 || static_cast<size_t>(taps) % 2 == 0 : low <= 0)
+			{
+				error = "hilbert needs odd \"taps\" >= 3 or \"low_hz\" > 0";
+				return nullptr;
+			}
+			const std::map<std::string, hilbert_stage::output> outputs = {{"analytic", hilbert_stage::output::analytic},
+																		   {"envelope", hilbert_stage::output::envelope},
+																		   {"phase", hilbert_stage::output::phase},
+																		   {"polar", hilbert_stage::output::polar}};
+			const auto o = outputs.find(c.string_or("output", "analytic"));
+			if (o == outputs.end())
+			{
+				error = "hilbert \"output\" must be analytic, envelope, phase or polar";
+				return nullptr;
+			}
+			return std::make_unique<hilbert_stage>(static_cast<size_t>(taps), low, o->second);
+		};
+
+		registry["band_power"] = [](const json_value& c, const stage_context&, std::string& error) -> std::unique_ptr<pipeline_stage> {
+			const double window = c.number_or("window", 0);
+			if (window < 1)
+			{
+				error = "band_power needs \"window\" >= 1 samples";
+				return nullptr;
+			}
+			return std::make_unique<band_power_stage>(static_cast<size_t>(window));
+		};
+
+		registry["ar_spectrum"] = [](const json_value& c, const stage_context&, std::string& error) -> std::unique_ptr<pipeline_stage> {
+			std::vector<double> frequencies = numbers(c.find("frequencies"));
+			if (frequencies.empty())
+			{
+				const double low = c.number_or("low_hz", 0);
+				const double high = c.number_or("high_hz", 0);
+				const double step = c.number_or("step_hz", 0.1);
+				if (step > 0 && high > low && low >= 0)
+				{
+					const size_t n = static_cast<size_t>(std::floor((high - low) / step + 1e-9)) + 1;
+					for (size_t i = 0; i < n; ++i)
+					{
+						frequencies.push_back(low + static_cast<double>(i) * step);
+					}
+				}
+			}
+			const double order = c.number_or("order", 16);
+			const std::string output = c.string_or("output", "psd");
+			if (frequencies.empty() || order < 1 || (output != "psd" && output != "peak"))
+			{
+				error = "ar_spectrum needs \"frequencies\" or \"low_hz\" < \"high_hz\" (and \"step_hz\" > 0), \"order\" >= 1 and \"output\" of psd "
+						"or peak";
+				return nullptr;
+			}
+			return std::make_unique<ar_spectrum_stage>(std::move(frequencies), static_cast<size_t>(order), output == "peak");
+		};
+
+		registry["connectivity"] = [](const json_value& c, const stage_context&, std::string& error) -> std::unique_ptr<pipeline_stage> {
+			connectivity_options opts;
+			opts.low_hz = c.number_or("low_hz", opts.low_hz);
+			opts.high_hz = c.number_or("high_hz", opts.high_hz);
+			const double windows = c.number_or("windows", static_cast<double>(opts.windows));
+			const double threads = c.number_or("threads", 1);
+			if (opts.low_hz < 0 || opts.high_hz <= opts.low_hz || windows < 1 || threads < 1)
+			{
+				error = "connectivity needs 0 <= \"low_hz\" < \"high_hz\", \"windows\" >= 1 and \"threads\" >= 1";
+				return nullptr;
+			}
+			opts.windows = static_cast<size_t>(windows);
+			opts.threads = static_cast<size_t>(threads);
+			return std::make_unique<connectivity_stage>(opts);
+		};
+
+		registry["entropy"] = [](const json_value& c, const stage_context&, std::string& error) -> std::unique_ptr<pipeline_stage> {
+			entropy_options opts;
+			const double m = c.number_or("m", static_cast<double>(opts.m));
+			opts.r = c.number_or("r", opts.r);
+			const double threads = c.number_or("threads", 1);
+			if (m < 1 || opts.r < 0 || threads < 1)
+			{
+				error = "entropy needs \"m\" >= 1, \"r\" >= 0 and \"threads\" >= 1";
+				return nullptr;
+			}
+			opts.m = static_cast<size_t>(m);
+			opts.threads = static_cast<size_t>(threads);
+			return std::make_unique<entropy_stage>(opts);
+		};
+
+		registry["ica"] = [](const json_value& c, const stage_context&, std::string& error) -> std::unique_ptr<pipeline_stage> {
+			const std::string path = c.string_or("model", "");
+			const std::string output = c.string_or("output", "clean");
+			if (path.empty() || (output != "clean" && output != "sources"))
+			{
+				error = "ica needs a \"model\" file and \"output\" of clean or sources";
+				return nullptr;
+			}
+			ica_model model;
+			if (!model.load(path, &error))
+			{
+				return nullptr;
+			}
+			if (const json_value* remove = c.find("remove"))
+			{
+				std::vector<size_t> components;
+				for (double x : numbers(remove))
+				{
+					if (x < 0 || x >= static_cast<double>(model.n_components()))
+					{
+						error = "ica \"remove\" index out of range for " + std::to_string(model.n_components()) + " components";
+						return nullptr;
+					}
+					components.push_back(static_cast<size_t>(x));
+				}
+				model.set_removed(components);
+			}
+			return std::make_unique<ica_stage>(std::move(model), output == "sources");
+		};
+
+		registry["quality"] = [](const json_value&, const stage_context&, std::string&) -> std::unique_ptr<pipeline_stage> {
+			return std::make_unique<quality_stage>();
+		};
+
+		registry["ssvep"] = [](const json_value& c, const stage_context&, std::string& error) -> std::unique_ptr<pipeline_stage> {
+			std::vector<double> freqs = numbers(c.find("frequencies"));
+			if (freqs.size() < 2)
+			{
+				error = "ssvep needs at least two \"frequencies\"";
+				return nullptr;
+			}
+			return std::make_unique<ssvep_stage>(std::move(freqs));
+		};
+
+		registry["p300"] = [](const json_value& c, const stage_context& ctx, std::string& error) -> std::unique_ptr<pipeline_stage> {
+			p300_model model;
+			const ba_bci_connect_error err = model.init(static_cast<uint8_t>(c.number_or("model", 0)), ctx.owner);
+			if (err != BA_BCI_CONNECT_ERROR_OK)
+			{
+				error = "p300 model failed to load (error " + std::to_string(static_cast<int>(err)) + ")";
+				return nullptr;
+			}
+			return std::make_unique<p300_stage>(std::move(model));
+		};
+
+		registry["recorder"] = [](const json_value& c, const stage_context&, std::string& error) -> std::unique_ptr<pipeline_stage> {
+			const std::string path = c.string_or("path", "");
+			if (path.empty())
+			{
+				error = "recorder needs a \"path\"";
+				return nullptr;
+			}
+			std::vector<std::string> labels;
+			if (const json_value* l = c.find("labels"))
+			{
+				for (const json_value& x : l->items())
+				{
+					labels.push_back(x.as_string());
+				}
+			}
+			double count_scale = 0;
+			if (c.find("gain"))
+			{
+				count_scale = adc_microvolts_per_count(ba_multiplier_to_gain_mode(static_cast<int>(c.number_or("gain", 0))));
+				if (count_scale <= 0)
+				{
+					error = "recorder \"gain\" must be 4, 6, 8 or 12";
+					return nullptr;
+				}
+			}
+			return std::make_unique<recorder_stage>(path, std::move(labels), count_scale, c.bool_or("pyramid", false));
+		};
+
+		registry["arrow"] = [](const json_value& c, const stage_context&, std::string& error) -> std::unique_ptr<pipeline_stage> {
+			const std::string path = c.string_or("path", "");
+			if (path.empty())
+			{
+				error = "arrow needs a \"path\"";
+				return nullptr;
+			}
+			std::vector<std::string> labels;
+			if (const json_value* l = c.find("labels"))
+			{
+				for (const json_value& x : l->items())
+				{
+					labels.push_back(x.as_string());
+				}
+			}
+			return std::make_unique<arrow_stage>(path, std::move(labels), c.bool_or("stream", false));
+		};
+
+		registry["sink"] = [](const json_value&, const stage_context& ctx, std::string&) -> std::unique_ptr<pipeline_stage> {
+			return std::make_unique<sink_stage>(ctx.sink);
+		};
+	}
+} // namespace eeg
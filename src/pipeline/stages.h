@@ -0,0 +1,96 @@
+/**
+ * @file stages.h
+ * @brief Built-in pipeline stage types
+ */
+
+#pragma once
+
+#include "pipeline/pipeline.h"
+
+#include <map>
+#include <string>
+
+namespace eeg
+{
+	/**
+	 * @brief Adds the built-in stage types to a registry
+	 *
+	 * @details Types and their settings:
+	 *
+	 * - `window`: `window_s`/`hop_s` (or `window`/`hop` in samples); cuts
+	 *   overlapping windows from a continuous stream, restarting after a gap
+	 *   in sample numbers; windows start at sample numbers that are
+	 *   multiples of the hop. A window has the sequence of the block that
+	 *   completes it, so window outputs only join with branches windowed
+	 *   the same way
+	 * - `select`: `channels`, array of channel indices to keep
+	 * - processor.h operations on each block: `detrend`, `demean`,
+	 *   `standardize`, `ewma` (`alpha`), `ewma_standardize` (`alpha`,
+	 *   `epsilon`), `lowpass`/`highpass` (`cutoff_hz`), `bandpass`
+	 *   (`low_hz`, `high_hz`), `notch` (`center_hz`, `width_hz`)
+	 * - streaming filters whose state carries over between blocks, built on
+	 *   the fused.h kernels: `iir_notch` (`center_hz`, `width_hz`),
+	 *   `iir_bandpass` (`low_hz`, `high_hz`), `decimate` (`factor`) and
+	 *   `band_power` (`window` samples from sample numbers that are
+	 *   multiples of it; per-channel mean power in `values`)
+	 * - `hilbert`: analytic signal for instantaneous phase and envelope
+	 *   through an FIR Hilbert transformer of `taps` (odd), or by default
+	 *   the shortest one accurate from `low_hz` (default 4) up. Its delay is
+	 *   `(taps - 1) / 2` samples, about `0.82 / low_hz` seconds, and output
+	 *   blocks carry the sample numbers they describe. `output` is
+	 *   `analytic` (real then imaginary parts, 2 x channels), `envelope`,
+	 *   `phase` (radians) or `polar` (envelopes then phases). Band-limit the
+	 *   input first, e.g. with `iir_bandpass`
+	 * - `asr`: Artifact Subspace Reconstruction (asr.h) of large
+	 *   transients, calibrated on the first `calibration_s` seconds
+	 *   (default 60), which should be clean and pass through unchanged.
+	 *   Components whose variance over `window_s` (default 0.5) exceeds
+	 *   `cutoff` (default 20) calibration standard deviations are
+	 *   reconstructed, at most `max_dims` (default 0.66) of the channels,
+	 *   updated every `step` samples (default 32). Output lags by
+	 *   `lookahead_s` (default `window_s / 2`) and carries the sample
+	 *   numbers it describes. Highpass the input first, e.g. with
+	 *   `iir_bandpass`
+	 * - `quality`: signal quality per channel in `values`
+	 * - `ar_spectrum`: on windows, Burg autoregressive spectra of `order`
+	 *   (default 16) evaluated only at `frequencies`, or on a grid from
+	 *   `low_hz` to `high_hz` every `step_hz` (default 0.1), for peak
+	 *   tracking on windows too short for FFT resolution
+	 *   (ar_spectrum.h). `values` holds the densities channel by channel,
+	 *   or with `output` `peak` each channel's frequency of highest density
+	 * - `connectivity`: on windows, coherence, phase-locking value and
+	 *   correlation of every channel pair between `low_hz` and `high_hz`
+	 *   (default 8 to 12), averaged over the last `windows` windows
+	 *   (default 8) and updated incrementally (connectivity.h). `values`
+	 *   holds the coherences of pairs (0, 1), (0, 2), ..., (1, 2), ...,
+	 *   then the phase-locking values and correlations in the same order.
+	 *   `threads` workers share the pairs
+	 * - `entropy`: on windows, sample and approximate entropy of each
+	 *   channel with templates of `m` samples (default 2) matching within
+	 *   `r` (default 0.2) standard deviations of the window, found by a
+	 *   grid neighbour search (entropy.h). `values` holds the sample
+	 *   entropies, then the approximate entropies. `threads` workers share
+	 *   the channels
+	 * - `ica`: `model`, a file written by `eeg_app ica` (ica.h); subtracts
+	 *   the model's removed components from each block, or those listed in
+	 *   `remove`, with one precomputed channel-by-channel projection.
+	 *   `output` `sources` emits the component time courses instead. Blocks
+	 *   whose channel count differs from the model's are dropped
+	 * - `ssvep`: `frequencies`; `values` holds the class index and score
+	 * - `p300`: `model`; input must match the model's input size,
+	 *   `values` holds the prediction
+	 * - `recorder`: `path`, optional `labels`; writes data blocks to a
+	 *   recording file (recording.h), as int32 ADC counts when the channel
+	 *   `gain` multiplier is given (adc_counts.h) and the samples are on
+	 *   that gain's count grid, as raw device samples are; other blocks,
+	 *   e.g. filtered ones, stay float64. `pyramid` also builds
+	 *   the min/max pyramid while recording and writes its sidecar file
+	 *   (pyramid.h) when the pipeline stops
+	 * - `arrow`: `path`, optional `labels`; writes data blocks as Arrow
+	 *   record batches (arrow_ipc.h) in the IPC file format, or the
+	 *   streaming format when `stream` is true, e.g. into a named pipe
+	 * - `sink`: hands its inputs to the callback set with
+	 *   `pipeline::set_sink()`
+	 */
+	void register_builtin_stages(std::map<std::string, stage_factory>& registry);
+} // namespace eeg
@@ -0,0 +1,153 @@
+"""Throughput of the eeg extension's buffer-protocol paths against copying
+chunks into Python lists.
+
+    python bench_bindings.py [--chans 8] [--hop 250] [--window 500] [--seconds 1] [--json out.json]
+
+Cases:
+  ring/lists      read a hop and convert it to lists, as scripts did before
+  ring/read       read a hop into an owned Block (one copy in C++)
+  ring/peek       zero-copy views of ring memory, then skip
+  filter/lists    bandpass a window held in lists (convert in and out)
+  filter/buffer   bandpass a window in place through the buffer protocol
+  gil/threads:N   fft of a window on N threads; scales only because the
+                  GIL is released inside the kernel
+
+NumPy is used for an extra ring/numpy case when it is installed.
+"""
+
+import argparse
+import array
+import json
+import threading
+import time
+
+import eeg
+
+try:
+    import numpy
+except ImportError:
+    numpy = None
+
+
+def matrix(values, n_chans):
+    """2-D float64 memoryview over an array('d')."""
+    return memoryview(values).cast("B").cast("d", (n_chans, len(values) // n_chans))
+
+
+def measure(name, seconds, samples_per_op, op):
+    op()
+    count = 0
+    start = time.perf_counter()
+    end = start + seconds
+    while time.perf_counter() < end:
+        op()
+        count += 1
+    elapsed = time.perf_counter() - start
+    return {"name": name, "ops": count, "us_per_op": elapsed / count * 1e6, "samples_per_s": count * samples_per_op / elapsed}
+
+
+def ring_cases(args):
+    chunk = array.array("d", (float(i % 97) for i in range(args.chans * args.hop)))
+    chunk_view = matrix(chunk, args.chans)
+    ring = eeg.Ring(args.chans, args.hop * 4)
+
+    def produce():
+        ring.write(chunk_view)
+
+    def lists():
+        produce()
+        rows = memoryview(ring.read(args.hop)).tolist()
+        return sum(row[-1] for row in rows)
+
+    def read():
+        produce()
+        return ring.read(args.hop)
+
+    def peek():
+        produce()
+        views = ring.peek(args.hop)
+        last = views[-1]
+        ring.skip(args.hop)
+        return last
+
+    cases = [("ring/lists", lists), ("ring/read", read), ("ring/peek", peek)]
+    if numpy is not None:
+
+        def to_numpy():
+            produce()
+            parts = [numpy.asarray(v) for v in ring.peek(args.hop)]
+            total = sum(float(p[:, -1].sum()) for p in parts)
+            ring.skip(args.hop)
+            return total
+
+        cases.append(("ring/numpy", to_numpy))
+    return [measure(name, args.seconds, args.hop, op) for name, op in cases]
+
+
+def filter_cases(args):
+    values = array.array("d", (float(i % 50) for i in range(args.chans * args.window)))
+    rows = matrix(values, args.chans).tolist()
+    buffer = matrix(array.array("d", values), args.chans)
+
+    def lists():
+        flat = array.array("d")
+        for row in rows:
+            flat.extend(row)
+        view = matrix(flat, args.chans)
+        eeg.bandpass(view, args.rate, 1, 40)
+        return view.tolist()
+
+    def in_place():
+        eeg.bandpass(buffer, args.rate, 1, 40)
+
+    return [measure("filter/lists", args.seconds, args.window, lists), measure("filter/buffer", args.seconds, args.window, in_place)]
+
+
+def gil_cases(args):
+    values = matrix(array.array("d", (float(i % 50) for i in range(args.chans * args.window))), args.chans)
+    results = []
+    for n_threads in (1, 2, 4):
+        counts = [0] * n_threads
+        end = time.perf_counter() + args.seconds
+
+        def work(index):
+            while time.perf_counter() < end:
+                eeg.fft(values, args.rate)
+                counts[index] += 1
+
+        start = time.perf_counter()
+        threads = [threading.Thread(target=work, args=(i,)) for i in range(n_threads)]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+        elapsed = time.perf_counter() - start
+        total = sum(counts)
+        results.append({"name": "gil/threads:%d" % n_threads, "ops": total, "us_per_op": elapsed / total * 1e6,
+                        "samples_per_s": total * args.window / elapsed})
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--chans", type=int, default=8)
+    parser.add_argument("--hop", type=int, default=250, help="samples consumed from the ring per operation")
+    parser.add_argument("--window", type=int, default=500, help="samples per processed window")
+    parser.add_argument("--rate", type=float, default=250)
+    parser.add_argument("--seconds", type=float, default=1, help="time per case")
+    parser.add_argument("--json", help="write results to this file")
+    args = parser.parse_args()
+
+    results = ring_cases(args) + filter_cases(args) + gil_cases(args)
+    print("%-16s %10s %12s %16s" % ("case", "ops", "us/op", "samples/s"))
+    for r in results:
+        print("%-16s %10d %12.2f %16.0f" % (r["name"], r["ops"], r["us_per_op"], r["samples_per_s"]))
+
+    if args.json:
+        with open(args.json, "w") as out:
+            json.dump({"config": vars(args), "results": results}, out, indent=2)
+            out.write("\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,1336 @@
+/**
+ * @file eeg_module.cpp
+ * @brief CPython extension exposing stream rings, recordings and the
+ * bciconnect processing functions through the buffer protocol
+ *
+ * @details Signals cross the boundary as `eeg.Block` objects, which export
+ * their memory with the buffer protocol: `numpy.asarray(block)` and
+ * `memoryview(block)` are views, not copies. Blocks either own their
+ * storage (results, loaded recordings) or borrow ring memory and keep the
+ * ring alive. Functions accept any C-contiguous float64 buffer shaped
+ * `(n_chans, n_samples)`, or 1-D for a single channel, which is the
+ * channel-major layout processor.h expects, so NumPy arrays are passed
+ * without conversion. The GIL is released while bciconnect kernels run.
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "bci/ar_spectrum.h"
+#include "bci/connectivity.h"
+#include "bci/entropy.h"
+#include "bci/erp_average.h"
+#include "bci/p300_model.h"
+#include "processor.h"
+#include "ssvep_classifier.h"
+#include "stream/recording.h"
+#include "stream/simulated_device.h"
+#include "stream/stream_ring.h"
+
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// ---------------------------------------------------------------- Block
+
+	struct block_object
+	{
+		PyObject_HEAD
+		std::vector<double>* storage; ///< Owned, null when borrowing
+		PyObject* base;               ///< Keeps borrowed memory alive
+		double* data;
+		int ndim;
+		Py_ssize_t shape[2];
+		Py_ssize_t strides[2];
+		int readonly;
+	};
+
+	PyTypeObject block_type = {PyVarObject_HEAD_INIT(nullptr, 0)};
+
+	PyObject* new_block(std::vector<double>&& values, Py_ssize_t rows, Py_ssize_t cols, int ndim = 2)
+	{
+		block_object* b = PyObject_New(block_object, &block_type);
+		if (!b)
+		{
+			return nullptr;
+		}
+		b->storage = new std::vector<double>(std::move(values));
+		b->base = nullptr;
+		b->data = b->storage->data();
+		b->ndim = ndim;
+		b->shape[0] = ndim == 2 ? rows : cols;
+		b->shape[1] = cols;
+		b->strides[0] = ndim == 2 ? cols * static_cast<Py_ssize_t>(sizeof(double)) : static_cast<Py_ssize_t>(sizeof(double));
+		b->strides[1] = sizeof(double);
+		b->readonly = 0;
+		return reinterpret_cast<PyObject*>(b);
+	}
+
+	/**
+	 * Read-only block over memory owned by `base`; rows `stride` doubles apart.
+	 */
+	PyObject* borrowed_block(PyObject* base, const double* data, Py_ssize_t rows, Py_ssize_t cols, Py_ssize_t stride)
+	{
+		block_object* b = PyObject_New(block_object, &block_type);
+		if (!b)
+		{
+			return nullptr;
+		}
+		Py_INCREF(base);
+		b->storage = nullptr;
+		b->base = base;
+		b->data = const_cast<double*>(data);
+		b->ndim = 2;
+		b->shape[0] = rows;
+		b->shape[1] = cols;
+		b->strides[0] = stride * static_cast<Py_ssize_t>(sizeof(double));
+		b->strides[1] = sizeof(double);
+		b->readonly = 1;
+		return reinterpret_cast<PyObject*>(b);
+	}
+
+	void block_dealloc(PyObject* self)
+	{
+		block_object* b = reinterpret_cast<block_object*>(self);
+		delete b->storage;
+		Py_XDECREF(b->base);
+		PyObject_Free(self);
+	}
+
+	bool block_contiguous(const block_object* b)
+	{
+		return b->ndim == 1 || b->shape[0] <= 1 || b->strides[0] == b->shape[1] * static_cast<Py_ssize_t>(sizeof(double));
+	}
+
+	int block_getbuffer(PyObject* self, Py_buffer* view, int flags)
+	{
+		block_object* b = reinterpret_cast<block_object*>(self);
+		if ((flags & PyBUF_WRITABLE) == PyBUF_WRITABLE && b->readonly)
+		{
+			PyErr_SetString(PyExc_BufferError, "block is read-only");
+			return -1;
+		}
+		if ((flags & PyBUF_STRIDES) != PyBUF_STRIDES && !block_contiguous(b))
+		{
+			PyErr_SetString(PyExc_BufferError, "block is strided; request a strided buffer or copy it");
+			return -1;
+		}
+		view->obj = self;
+		Py_INCREF(self);
+		view->buf = b->data;
+		view->len = (b->ndim == 2 ? b->shape[0] * b->shape[1] : b->shape[0]) * static_cast<Py_ssize_t>(sizeof(double));
+		view->readonly = b->readonly;
+		view->itemsize = sizeof(double);
+		view->format = (flags & PyBUF_FORMAT) == PyBUF_FORMAT ? const_cast<char*>("d") : nullptr;
+		view->ndim = b->ndim;
+		view->shape = (flags & PyBUF_ND) == PyBUF_ND ? b->shape : nullptr;
+		view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? b->strides : nullptr;
+		view->suboffsets = nullptr;
+		view->internal = nullptr;
+		return 0;
+	}
+
+	PyBufferProcs block_buffer = {block_getbuffer, nullptr};
+
+	PyObject* block_shape(PyObject* self, void*)
+	{
+		block_object* b = reinterpret_cast<block_object*>(self);
+		return b->ndim == 2 ? Py_BuildValue("(nn)", b->shape[0], b->shape[1]) : Py_BuildValue("(n)", b->shape[0]);
+	}
+
+	PyObject* block_readonly(PyObject* self, void*)
+	{
+		return PyBool_FromLong(reinterpret_cast<block_object*>(self)->readonly);
+	}
+
+	PyGetSetDef block_getset[] = {
+		{"shape", block_shape, nullptr, "(n_chans, n_samples), or (n,) for per-channel results", nullptr},
+		{"readonly", block_readonly, nullptr, "True for views into ring memory", nullptr},
+		{nullptr, nullptr, nullptr, nullptr, nullptr},
+	};
+
+	// ------------------------------------------------------- Buffer inputs
+
+	/**
+	 * Borrowed float64 signal, released on destruction.
+	 */
+	struct signal_arg
+	{
+		Py_buffer view{};
+		bool held = false;
+		double* data = nullptr;
+		size_t n_chans = 0;
+		size_t n_samples = 0;
+
+		signal_arg() = default;
+		signal_arg(const signal_arg&) = delete;
+		signal_arg& operator=(const signal_arg&) = delete;
+		~signal_arg()
+		{
+			if (held)
+			{
+				PyBuffer_Release(&view);
+			}
+		}
+
+		size_t size() const { return n_chans * n_samples; }
+	};
+
+	bool is_float64(const char* format)
+	{
+		if (!format)
+		{
+			return true;
+		}
+		if (*format == '@' || *format == '=' || *format == '<')
+		{
+			++format;
+		}
+		return std::strcmp(format, "d") == 0;
+	}
+
+	/**
+	 * Gets a C-contiguous float64 buffer shaped (n_chans, n_samples) or (n_samples,).
+	 */
+	bool get_signal(PyObject* obj, bool writable, signal_arg& out)
+	{
+		const int flags = PyBUF_C_CONTIGUOUS | PyBUF_FORMAT | (writable ? PyBUF_WRITABLE : 0);
+		if (PyObject_GetBuffer(obj, &out.view, flags) != 0)
+		{
+			return false;
+		}
+		out.held = true;
+		if (!is_float64(out.view.format) || out.view.itemsize != sizeof(double))
+		{
+			PyErr_SetString(PyExc_TypeError, "signals must be float64");
+			return false;
+		}
+		if (out.view.ndim == 1)
+		{
+			out.n_chans = 1;
+			out.n_samples = static_cast<size_t>(out.view.shape[0]);
+		}
+		else if (out.view.ndim == 2)
+		{
+			out.n_chans = static_cast<size_t>(out.view.shape[0]);
+			out.n_samples = static_cast<size_t>(out.view.shape[1]);
+		}
+		else
+		{
+			PyErr_SetString(PyExc_ValueError, "signals must be shaped (n_chans, n_samples) or (n_samples,)");
+			return false;
+		}
+		if (out.size() == 0)
+		{
+			PyErr_SetString(PyExc_ValueError, "signal is empty");
+			return false;
+		}
+		out.data = static_cast<double*>(out.view.buf);
+		return true;
+	}
+
+	// ------------------------------------------------------------- Ring
+
+	/**
+	 * Ring with an optional simulated device as its producer.
+	 */
+	struct ring_state
+	{
+		std::unique_ptr<eeg::stream_ring> ring;
+		std::unique_ptr<eeg::simulated_device> device;
+		size_t sample_number_index = 0;
+		std::vector<size_t> electrode_index;
+		std::vector<const double*> channels;
+
+		static void on_chunk(const void* const* data, size_t size, void* user_data)
+		{
+			ring_state& s = *static_cast<ring_state*>(user_data);
+			for (size_t i = 0; i < s.electrode_index.size(); ++i)
+			{
+				s.channels[i] = static_cast<const double*>(data[s.electrode_index[i]]);
+			}
+			s.ring->write(s.channels.data(), size, static_cast<const size_t*>(data[s.sample_number_index]));
+		}
+
+		void stop()
+		{
+			if (device)
+			{
+				device->stop_stream();
+				device.reset();
+			}
+		}
+	};
+
+	struct ring_object
+	{
+		PyObject_HEAD
+		ring_state* state;
+	};
+
+	PyTypeObject ring_type = {PyVarObject_HEAD_INIT(nullptr, 0)};
+
+	int ring_init(PyObject* self, PyObject* args, PyObject* kwargs)
+	{
+		static const char* keywords[] = {"n_chans", "capacity", nullptr};
+		Py_ssize_t n_chans = 0;
+		Py_ssize_t capacity = 0;
+		if (!PyArg_ParseTupleAndKeywords(args, kwargs, "nn", const_cast<char**>(keywords), &n_chans, &capacity))
+		{
+			return -1;
+		}
+		if (n_chans <= 0 || capacity <= 0)
+		{
+			PyErr_SetString(PyExc_ValueError, "n_chans and capacity must be positive");
+			return -1;
+		}
+		ring_object* r = reinterpret_cast<ring_object*>(self);
+		if (r->state)
+		{
+			// Blocks from peek() keep the ring object alive but point into its
+			// memory, which a second __init__ would free
+			PyErr_SetString(PyExc_RuntimeError, "ring is already initialized");
+			return -1;
+		}
+		r->state = new ring_state();
+		r->state->ring = std::make_unique<eeg::stream_ring>(static_cast<size_t>(n_chans), static_cast<size_t>(capacity));
+		return 0;
+	}
+
+	void ring_dealloc(PyObject* self)
+	{
+		ring_object* r = reinterpret_cast<ring_object*>(self);
+		if (r->state)
+		{
+			Py_BEGIN_ALLOW_THREADS
+			r->state->stop();
+			Py_END_ALLOW_THREADS
+			delete r->state;
+		}
+		Py_TYPE(self)->tp_free(self);
+	}
+
+	ring_state* ring_of(PyObject* self)
+	{
+		ring_state* s = reinterpret_cast<ring_object*>(self)->state;
+		if (!s)
+		{
+			PyErr_SetString(PyExc_RuntimeError, "ring is not initialized");
+		}
+		return s;
+	}
+
+	PyObject* ring_write(PyObject* self, PyObject* arg)
+	{
+		ring_state* s = ring_of(self);
+		if (!s)
+		{
+			return nullptr;
+		}
+		if (s->device)
+		{
+			PyErr_SetString(PyExc_RuntimeError, "ring is fed by a simulated device");
+			return nullptr;
+		}
+		signal_arg x;
+		if (!get_signal(arg, false, x))
+		{
+			return nullptr;
+		}
+		if (x.n_chans != s->ring->n_chans())
+		{
+			PyErr_Format(PyExc_ValueError, "expected %zu channels, got %zu", s->ring->n_chans(), x.n_chans);
+			return nullptr;
+		}
+		std::vector<const double*> channels(x.n_chans);
+		for (size_t c = 0; c < x.n_chans; ++c)
+		{
+			channels[c] = x.data + c * x.n_samples;
+		}
+		return PyLong_FromSize_t(s->ring->write(channels.data(), x.n_samples));
+	}
+
+	PyObject* ring_peek(PyObject* self, PyObject* args, PyObject* kwargs)
+	{
+		static const char* keywords[] = {"n", "offset", nullptr};
+		Py_ssize_t n = 0;
+		Py_ssize_t offset = 0;
+		if (!PyArg_ParseTupleAndKeywords(args, kwargs, "n|n", const_cast<char**>(keywords), &n, &offset))
+		{
+			return nullptr;
+		}
+		ring_state* s = ring_of(self);
+		if (!s)
+		{
+			return nullptr;
+		}
+		eeg::stream_ring_span first;
+		eeg::stream_ring_span second;
+		if (n <= 0 || offset < 0 || !s->ring->view(static_cast<size_t>(n), static_cast<size_t>(offset), first, second))
+		{
+			PyErr_SetString(PyExc_ValueError, "not enough samples available");
+			return nullptr;
+		}
+		const Py_ssize_t chans = static_cast<Py_ssize_t>(s->ring->n_chans());
+		PyObject* a = borrowed_block(self, first.data, chans, static_cast<Py_ssize_t>(first.n_samples), static_cast<Py_ssize_t>(first.stride));
+		if (!a || second.n_samples == 0)
+		{
+			return a ? PyTuple_Pack(1, a) : nullptr;
+		}
+		PyObject* b = borrowed_block(self, second.data, chans, static_cast<Py_ssize_t>(second.n_samples), static_cast<Py_ssize_t>(second.stride));
+		PyObject* result = b ? PyTuple_Pack(2, a, b) : nullptr;
+		Py_DECREF(a);
+		Py_XDECREF(b);
+		return result;
+	}
+
+	PyObject* ring_sample_numbers(PyObject* self, PyObject* args, PyObject* kwargs)
+	{
+		static const char* keywords[] = {"n", "offset", nullptr};
+		Py_ssize_t n = 0;
+		Py_ssize_t offset = 0;
+		if (!PyArg_ParseTupleAndKeywords(args, kwargs, "n|n", const_cast<char**>(keywords), &n, &offset))
+		{
+			return nullptr;
+		}
+		ring_state* s = ring_of(self);
+		if (!s)
+		{
+			return nullptr;
+		}
+		std::vector<uint64_t> numbers(static_cast<size_t>(std::max<Py_ssize_t>(n, 0)));
+		if (n < 0 || offset < 0 || !s->ring->peek_sample_numbers(numbers.data(), numbers.size(), static_cast<size_t>(offset)))
+		{
+			PyErr_SetString(PyExc_ValueError, "not enough samples available");
+			return nullptr;
+		}
+		PyObject* list = PyList_New(n);
+		for (Py_ssize_t i = 0; list && i < n; ++i)
+		{
+			PyList_SET_ITEM(list, i, PyLong_FromUnsignedLongLong(numbers[static_cast<size_t>(i)]));
+		}
+		return list;
+	}
+
+	PyObject* ring_skip(PyObject* self, PyObject* arg)
+	{
+		ring_state* s = ring_of(self);
+		const Py_ssize_t n = PyLong_AsSsize_t(arg);
+		if (!s || PyErr_Occurred())
+		{
+			return nullptr;
+		}
+		if (n < 0 || !s->ring->skip(static_cast<size_t>(n)))
+		{
+			PyErr_SetString(PyExc_ValueError, "not enough samples available");
+			return nullptr;
+		}
+		Py_RETURN_NONE;
+	}
+
+	PyObject* ring_read(PyObject* self, PyObject* arg)
+	{
+		ring_state* s = ring_of(self);
+		const Py_ssize_t n = PyLong_AsSsize_t(arg);
+		if (!s || PyErr_Occurred())
+		{
+			return nullptr;
+		}
+		const size_t chans = s->ring->n_chans();
+		std::vector<double> out(chans * static_cast<size_t>(std::max<Py_ssize_t>(n, 0)));
+		if (n <= 0 || !s->ring->read(out.data(), static_cast<size_t>(n)))
+		{
+			PyErr_SetString(PyExc_ValueError, "not enough samples available");
+			return nullptr;
+		}
+		return new_block(std::move(out), static_cast<Py_ssize_t>(chans), n);
+	}
+
+	PyObject* ring_simulate(PyObject* self, PyObject* args, PyObject* kwargs)
+	{
+		static const char* keywords[] = {"sampling_rate", "acceleration", "chunk_size", nullptr};
+		eeg::simulated_device_config config;
+		Py_ssize_t chunk_size = static_cast<Py_ssize_t>(config.chunk_size);
+		if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|ddn", const_cast<char**>(keywords), &config.sampling_rate, &config.acceleration, &chunk_size))
+		{
+			return nullptr;
+		}
+		ring_state* s = ring_of(self);
+		if (!s)
+		{
+			return nullptr;
+		}
+		if (s->device)
+		{
+			PyErr_SetString(PyExc_RuntimeError, "already simulating");
+			return nullptr;
+		}
+		if (config.sampling_rate <= 0 || config.acceleration <= 0 || chunk_size <= 0)
+		{
+			PyErr_SetString(PyExc_ValueError, "sampling_rate, acceleration and chunk_size must be positive");
+			return nullptr;
+		}
+		config.n_electrodes = s->ring->n_chans();
+		config.chunk_size = static_cast<size_t>(chunk_size);
+		s->device = std::make_unique<eeg::simulated_device>(config);
+		s->sample_number_index = s->device->channel_index(BA_EEG_CHANNEL_ID_SAMPLE_NUMBER);
+		s->electrode_index.clear();
+		for (size_t i = 0; i < config.n_electrodes; ++i)
+		{
+			s->electrode_index.push_back(s->device->channel_index(static_cast<ba_eeg_channel>(BA_EEG_CHANNEL_ID_ELECTRODE_MEASUREMENT + i)));
+		}
+		s->channels.assign(config.n_electrodes, nullptr);
+		s->device->set_callback_chunk(&ring_state::on_chunk, s);
+		s->device->start_stream();
+		Py_RETURN_NONE;
+	}
+
+	PyObject* ring_stop(PyObject* self, PyObject*)
+	{
+		ring_state* s = ring_of(self);
+		if (!s)
+		{
+			return nullptr;
+		}
+		Py_BEGIN_ALLOW_THREADS
+		s->stop();
+		Py_END_ALLOW_THREADS
+		Py_RETURN_NONE;
+	}
+
+	PyMethodDef ring_methods[] = {
+		{"write", ring_write, METH_O, "write(x) -> int\n\nAppends a (n_chans, n) float64 buffer; returns samples stored."},
+		{"peek", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)(void)>(ring_peek)), METH_VARARGS | METH_KEYWORDS,
+		 "peek(n, offset=0) -> tuple of Block\n\nRead-only views of ring memory, two when the samples wrap around.\n"
+		 "Valid until the samples are skipped."},
+		{"sample_numbers", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)(void)>(ring_sample_numbers)), METH_VARARGS | METH_KEYWORDS,
+		 "sample_numbers(n, offset=0) -> list of int\n\nDevice sample numbers of the samples peek(n, offset) returns."},
+		{"skip", ring_skip, METH_O, "skip(n)\n\nConsumes n samples."},
+		{"read", ring_read, METH_O, "read(n) -> Block\n\nCopies and consumes n samples."},
+		{"simulate", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)(void)>(ring_simulate)), METH_VARARGS | METH_KEYWORDS,
+		 "simulate(sampling_rate=250, acceleration=1, chunk_size=...)\n\nFeeds the ring from a simulated device's chunk callback."},
+		{"stop", ring_stop, METH_NOARGS, "stop()\n\nStops the simulated device."},
+		{nullptr, nullptr, 0, nullptr},
+	};
+
+	PyObject* ring_available(PyObject* self, void*)
+	{
+		ring_state* s = ring_of(self);
+		return s ? PyLong_FromSize_t(s->ring->available()) : nullptr;
+	}
+
+	PyObject* ring_n_chans(PyObject* self, void*)
+	{
+		ring_state* s = ring_of(self);
+		return s ? PyLong_FromSize_t(s->ring->n_chans()) : nullptr;
+	}
+
+	PyObject* ring_capacity(PyObject* self, void*)
+	{
+		ring_state* s = ring_of(self);
+		return s ? PyLong_FromSize_t(s->ring->capacity()) : nullptr;
+	}
+
+	PyObject* ring_dropped(PyObject* self, void*)
+	{
+		ring_state* s = ring_of(self);
+		return s ? PyLong_FromUnsignedLongLong(s->ring->dropped()) : nullptr;
+	}
+
+	PyObject* ring_total_written(PyObject* self, void*)
+	{
+		ring_state* s = ring_of(self);
+		return s ? PyLong_FromUnsignedLongLong(s->ring->total_written()) : nullptr;
+	}
+
+	PyGetSetDef ring_getset[] = {
+		{"available", ring_available, nullptr, "Samples ready to be read", nullptr},
+		{"n_chans", ring_n_chans, nullptr, nullptr, nullptr},
+		{"capacity", ring_capacity, nullptr, nullptr, nullptr},
+		{"dropped", ring_dropped, nullptr, "Samples dropped because the ring was full", nullptr},
+		{"total_written", ring_total_written, nullptr, nullptr, nullptr},
+		{nullptr, nullptr, nullptr, nullptr, nullptr},
+	};
+
+	// ------------------------------------------------------------- P300
+
+	struct p300_object
+	{
+		PyObject_HEAD
+		eeg::p300_model* model;
+		std::mutex* mutex; ///< predict() runs without the GIL
+	};
+
+	PyTypeObject p300_type = {PyVarObject_HEAD_INIT(nullptr, 0)};
+
+	int p300_init(PyObject* self, PyObject* args, PyObject* kwargs)
+	{
+		static const char* keywords[] = {"model_number", nullptr};
+		unsigned char number = 0;
+		if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|b", const_cast<char**>(keywords), &number))
+		{
+			return -1;
+		}
+		p300_object* p = reinterpret_cast<p300_object*>(self);
+		if (!p->model)
+		{
+			p->model = new eeg::p300_model();
+			p->mutex = new std::mutex();
+		}
+		const ba_bci_connect_error err = p->model->init(number);
+		if (err != BA_BCI_CONNECT_ERROR_OK)
+		{
+			PyErr_Format(PyExc_RuntimeError, "P300 model %d failed to load (error %d)", static_cast<int>(number), static_cast<int>(err));
+			return -1;
+		}
+		return 0;
+	}
+
+	void p300_dealloc(PyObject* self)
+	{
+		p300_object* p = reinterpret_cast<p300_object*>(self);
+		delete p->model;
+		delete p->mutex;
+		Py_TYPE(self)->tp_free(self);
+	}
+
+	PyObject* p300_predict(PyObject* self, PyObject* arg)
+	{
+		p300_object* p = reinterpret_cast<p300_object*>(self);
+		if (!p->model || !p->model->valid())
+		{
+			PyErr_SetString(PyExc_RuntimeError, "no model loaded");
+			return nullptr;
+		}
+		signal_arg x;
+		if (!get_signal(arg, false, x))
+		{
+			return nullptr;
+		}
+		if (x.size() != p->model->spec().input_size())
+		{
+			PyErr_Format(PyExc_ValueError, "model expects %zu values, got %zu", p->model->spec().input_size(), x.size());
+			return nullptr;
+		}
+		double result = 0;
+		ba_bci_connect_error err;
+		Py_BEGIN_ALLOW_THREADS
+		std::lock_guard<std::mutex> lock(*p->mutex);
+		err = p->model->predict(x.data, &result);
+		Py_END_ALLOW_THREADS
+		if (err != BA_BCI_CONNECT_ERROR_OK)
+		{
+			PyErr_Format(PyExc_RuntimeError, "P300 prediction failed (error %d)", static_cast<int>(err));
+			return nullptr;
+		}
+		return PyFloat_FromDouble(result);
+	}
+
+	PyObject* p300_input_shape(PyObject* self, void*)
+	{
+		p300_object* p = reinterpret_cast<p300_object*>(self);
+		if (!p->model || !p->model->valid())
+		{
+			Py_RETURN_NONE;
+		}
+		const eeg::p300_model_spec& spec = p->model->spec();
+		return Py_BuildValue("(nn)", static_cast<Py_ssize_t>(spec.n_chans), static_cast<Py_ssize_t>(spec.repetitions * eeg::p300_samples_per_repetition));
+	}
+
+	PyMethodDef p300_methods[] = {
+		{"predict", p300_predict, METH_O, "predict(x) -> float\n\nP300 probability; x holds the model's input_shape values."},
+		{nullptr, nullptr, 0, nullptr},
+	};
+
+	PyGetSetDef p300_getset[] = {
+		{"input_shape", p300_input_shape, nullptr, "(n_chans, repetitions * 176), repetitions within a channel", nullptr},
+		{nullptr, nullptr, nullptr, nullptr, nullptr},
+	};
+
+	// ----------------------------------------------------------- ErpAverager
+
+	struct erp_object
+	{
+		PyObject_HEAD
+		eeg::erp_averager* averager;
+	};
+
+	PyTypeObject erp_type = {PyVarObject_HEAD_INIT(nullptr, 0)};
+
+	int erp_init(PyObject* self, PyObject* args, PyObject* kwargs)
+	{
+		static const char* keywords[] = {"n_chans", "n_samples", "baseline", "reject", nullptr};
+		Py_ssize_t n_chans = 0;
+		Py_ssize_t n_samples = 0;
+		Py_ssize_t baseline = 0;
+		double reject = 0;
+		if (!PyArg_ParseTupleAndKeywords(args, kwargs, "nn|nd", const_cast<char**>(keywords), &n_chans, &n_samples, &baseline, &reject))
+		{
+			return -1;
+		}
+		if (n_chans <= 0 || n_samples <= 0 || baseline < 0)
+		{
+			PyErr_SetString(PyExc_ValueError, "n_chans and n_samples must be positive, baseline non-negative");
+			return -1;
+		}
+		erp_object* e = reinterpret_cast<erp_object*>(self);
+		if (!e->averager)
+		{
+			e->averager = new eeg::erp_averager();
+		}
+		eeg::erp_options opts;
+		opts.baseline = static_cast<size_t>(baseline);
+		opts.reject = reject;
+		std::string error;
+		if (!e->averager->init(static_cast<size_t>(n_chans), static_cast<size_t>(n_samples), opts, &error))
+		{
+			PyErr_SetString(PyExc_ValueError, error.c_str());
+			return -1;
+		}
+		return 0;
+	}
+
+	void erp_dealloc(PyObject* self)
+	{
+		delete reinterpret_cast<erp_object*>(self)->averager;
+		Py_TYPE(self)->tp_free(self);
+	}
+
+	/**
+	 * The averager of `self` and the class named by the single string
+	 * argument, or nullptr with an exception set.
+	 */
+	const eeg::erp_class* erp_class_arg(PyObject* self, PyObject* args)
+	{
+		const char* label = nullptr;
+		if (!PyArg_ParseTuple(args, "s", &label))
+		{
+			return nullptr;
+		}
+		const eeg::erp_averager* a = reinterpret_cast<erp_object*>(self)->averager;
+		const eeg::erp_class* c = a ? a->find(label) : nullptr;
+		if (!c)
+		{
+			PyErr_Format(PyExc_KeyError, "no epochs labelled '%s'", label);
+		}
+		return c;
+	}
+
+	PyObject* erp_add(PyObject* self, PyObject* args)
+	{
+		const char* label = nullptr;
+		PyObject* obj = nullptr;
+		if (!PyArg_ParseTuple(args, "sO", &label, &obj))
+		{
+			return nullptr;
+		}
+		eeg::erp_averager* a = reinterpret_cast<erp_object*>(self)->averager;
+		if (!a)
+		{
+			PyErr_SetString(PyExc_RuntimeError, "ErpAverager not initialised");
+			return nullptr;
+		}
+		signal_arg x;
+		if (!get_signal(obj, false, x))
+		{
+			return nullptr;
+		}
+		if (x.size() != a->n_chans() * a->n_samples())
+		{
+			PyErr_Format(PyExc_ValueError, "epochs hold %zu values, got %zu", a->n_chans() * a->n_samples(), x.size());
+			return nullptr;
+		}
+		return PyBool_FromLong(a->add(label, x.data) ? 1 : 0);
+	}
+
+	PyObject* erp_mean(PyObject* self, PyObject* args)
+	{
+		const eeg::erp_class* c = erp_class_arg(self, args);
+		if (!c)
+		{
+			return nullptr;
+		}
+		const eeg::erp_averager* a = reinterpret_cast<erp_object*>(self)->averager;
+		std::vector<double> mean = c->mean;
+		return new_block(std::move(mean), static_cast<Py_ssize_t>(a->n_chans()), static_cast<Py_ssize_t>(a->n_samples()));
+	}
+
+	PyObject* erp_variance(PyObject* self, PyObject* args)
+	{
+		const eeg::erp_class* c = erp_class_arg(self, args);
+		if (!c)
+		{
+			return nullptr;
+		}
+		const eeg::erp_averager* a = reinterpret_cast<erp_object*>(self)->averager;
+		std::vector<double> variance;
+		a->variance(*c, variance);
+		return new_block(std::move(variance), static_cast<Py_ssize_t>(a->n_chans()), static_cast<Py_ssize_t>(a->n_samples()));
+	}
+
+	PyObject* erp_counts(PyObject* self, PyObject* args)
+	{
+		const eeg::erp_class* c = erp_class_arg(self, args);
+		if (!c)
+		{
+			return nullptr;
+		}
+		return Py_BuildValue("(nn)", static_cast<Py_ssize_t>(c->count), static_cast<Py_ssize_t>(c->rejected));
+	}
+
+	PyObject* erp_clear(PyObject* self, PyObject*)
+	{
+		if (eeg::erp_averager* a = reinterpret_cast<erp_object*>(self)->averager)
+		{
+			a->clear();
+		}
+		Py_RETURN_NONE;
+	}
+
+	PyObject* erp_labels(PyObject* self, void*)
+	{
+		PyObject* labels = PyList_New(0);
+		if (const eeg::erp_averager* a = reinterpret_cast<erp_object*>(self)->averager)
+		{
+			for (const eeg::erp_class& c : a->classes())
+			{
+				PyObject* s = PyUnicode_DecodeUTF8(c.label.data(), static_cast<Py_ssize_t>(c.label.size()), "replace");
+				PyList_Append(labels, s);
+				Py_XDECREF(s);
+			}
+		}
+		return labels;
+	}
+
+	PyMethodDef erp_methods[] = {
+		{"add", erp_add, METH_VARARGS, "add(label, x) -> bool\n\nAdds an (n_chans, n_samples) epoch to its class; False if rejected."},
+		{"mean", erp_mean, METH_VARARGS, "mean(label) -> Block\n\nRunning average of the class's accepted epochs."},
+		{"variance", erp_variance, METH_VARARGS, "variance(label) -> Block\n\nUnbiased variance per channel and time point."},
+		{"counts", erp_counts, METH_VARARGS, "counts(label) -> (accepted, rejected)"},
+		{"clear", erp_clear, METH_NOARGS, "clear()\n\nForgets every class."},
+		{nullptr, nullptr, 0, nullptr},
+	};
+
+	PyGetSetDef erp_getset[] = {
+		{"labels", erp_labels, nullptr, "Classes in the order first seen", nullptr},
+		{nullptr, nullptr, nullptr, nullptr, nullptr},
+	};
+
+	// ------------------------------------------------- processor.h functions
+
+	using inplace_filter = void (*)(double* x, size_t n_chans, size_t n, const double* params);
+
+	/**
+	 * Filters a writable signal in place with the GIL released.
+	 */
+	PyObject* filter_in_place(PyObject* args, const char* format, inplace_filter filter)
+	{
+		PyObject* obj = nullptr;
+		double p[3] = {0, 0, 0};
+		if (!PyArg_ParseTuple(args, format, &obj, &p[0], &p[1], &p[2]))
+		{
+			return nullptr;
+		}
+		signal_arg x;
+		if (!get_signal(obj, true, x))
+		{
+			return nullptr;
+		}
+		Py_BEGIN_ALLOW_THREADS
+		filter(x.data, x.n_chans, x.n_samples, p);
+		Py_END_ALLOW_THREADS
+		Py_RETURN_NONE;
+	}
+
+	PyObject* py_lowpass(PyObject*, PyObject* args)
+	{
+		return filter_in_place(args, "Odd", [](double* x, size_t c, size_t n, const double* p) { ba_bci_connect_filter_lowpass(x, c, n, p[0], p[1]); });
+	}
+
+	PyObject* py_highpass(PyObject*, PyObject* args)
+	{
+		return filter_in_place(args, "Odd", [](double* x, size_t c, size_t n, const double* p) { ba_bci_connect_filter_highpass(x, c, n, p[0], p[1]); });
+	}
+
+	PyObject* py_bandpass(PyObject*, PyObject* args)
+	{
+		return filter_in_place(args, "Oddd", [](double* x, size_t c, size_t n, const double* p) { ba_bci_connect_filter_bandpass(x, c, n, p[0], p[1], p[2]); });
+	}
+
+	PyObject* py_notch(PyObject*, PyObject* args)
+	{
+		return filter_in_place(args, "Oddd", [](double* x, size_t c, size_t n, const double* p) { ba_bci_connect_filter_notch(x, c, n, p[0], p[1], p[2]); });
+	}
+
+	using signal_kernel = void (*)(const signal_arg& x, double* scratch, double* out, const double* params);
+
+	/**
+	 * Runs a kernel producing `out_per_chan` values per channel (0 for the
+	 * input's shape) with the GIL released. Kernels whose C signature takes
+	 * a mutable input get a scratch copy so the caller's buffer is untouched.
+	 * `p0` and `p1` are the defaults of optional parameters.
+	 */
+	PyObject* compute(PyObject* args, const char* format, size_t out_per_chan, bool needs_scratch, signal_kernel kernel, double p0 = 0, double p1 = 0)
+	{
+		PyObject* obj = nullptr;
+		double p[2] = {p0, p1};
+		if (!PyArg_ParseTuple(args, format, &obj, &p[0], &p[1]))
+		{
+			return nullptr;
+		}
+		signal_arg x;
+		if (!get_signal(obj, false, x))
+		{
+			return nullptr;
+		}
+		std::vector<double> out(out_per_chan ? x.n_chans * out_per_chan : x.size());
+		Py_BEGIN_ALLOW_THREADS
+		std::vector<double> scratch;
+		if (needs_scratch)
+		{
+			scratch.assign(x.data, x.data + x.size());
+		}
+		kernel(x, scratch.data(), out.data(), p);
+		Py_END_ALLOW_THREADS
+		if (out_per_chan == 1)
+		{
+			return new_block(std::move(out), 1, static_cast<Py_ssize_t>(x.n_chans), 1);
+		}
+		// Same shape as the input
+		return new_block(std::move(out), static_cast<Py_ssize_t>(x.n_chans), static_cast<Py_ssize_t>(x.n_samples), x.view.ndim);
+	}
+
+	PyObject* py_detrend(PyObject*, PyObject* args)
+	{
+		return compute(args, "O", 0, true, [](const signal_arg& x, double* s, double* out, const double*) { ba_bci_connect_detrend(s, x.n_chans, x.n_samples, out); });
+	}
+
+	PyObject* py_demean(PyObject*, PyObject* args)
+	{
+		return compute(args, "O", 0, false, [](const signal_arg& x, double*, double* out, const double*) { ba_bci_connect_demean(x.data, x.n_chans, x.n_samples, out); });
+	}
+
+	PyObject* py_standardize(PyObject*, PyObject* args)
+	{
+		return compute(args, "O", 0, false,
+					   [](const signal_arg& x, double*, double* out, const double*) { ba_bci_connect_standartize(x.data, x.n_chans, x.n_samples, out); });
+	}
+
+	PyObject* py_ewma_standardize(PyObject*, PyObject* args)
+	{
+		return compute(
+			args, "O|dd", 0, false,
+			[](const signal_arg& x, double*, double* out, const double* p) { ba_bci_connect_ewma_standartize(x.data, x.n_chans, x.n_samples, p[0], p[1], out); },
+			0.001, 1e-4);
+	}
+
+	PyObject* py_mean(PyObject*, PyObject* args)
+	{
+		return compute(args, "O", 1, false, [](const signal_arg& x, double*, double* out, const double*) { ba_bci_connect_mean(x.data, x.n_chans, x.n_samples, out); });
+	}
+
+	PyObject* py_std(PyObject*, PyObject* args)
+	{
+		return compute(args, "O", 1, false, [](const signal_arg& x, double*, double* out, const double*) { ba_bci_connect_std(x.data, x.n_chans, x.n_samples, out); });
+	}
+
+	PyObject* py_median(PyObject*, PyObject* args)
+	{
+		return compute(args, "O", 1, true, [](const signal_arg& x, double* s, double* out, const double*) { ba_bci_connect_median(s, x.n_chans, x.n_samples, out); });
+	}
+
+	PyObject* py_mad(PyObject*, PyObject* args)
+	{
+		return compute(args, "O", 1, true, [](const signal_arg& x, double* s, double* out, const double*) { ba_bci_connect_mad(s, x.n_chans, x.n_samples, out); });
+	}
+
+	PyObject* py_ewma(PyObject*, PyObject* args)
+	{
+		return compute(args, "Od", 1, false,
+					   [](const signal_arg& x, double*, double* out, const double* p) { ba_bci_connect_ewma(x.data, x.n_chans, x.n_samples, p[0], out); });
+	}
+
+	PyObject* py_quality(PyObject*, PyObject* args)
+	{
+		return compute(args, "Od", 1, true, [](const signal_arg& x, double* s, double* out, const double* p) {
+			ba_bci_connect_get_signal_quality(s, x.n_chans, x.n_samples, p[0], out);
+		});
+	}
+
+	PyObject* py_minmax(PyObject*, PyObject* args)
+	{
+		PyObject* obj = nullptr;
+		if (!PyArg_ParseTuple(args, "O", &obj))
+		{
+			return nullptr;
+		}
+		signal_arg x;
+		if (!get_signal(obj, false, x))
+		{
+			return nullptr;
+		}
+		std::vector<double> lo(x.n_chans);
+		std::vector<double> hi(x.n_chans);
+		Py_BEGIN_ALLOW_THREADS
+		std::vector<double> scratch(x.data, x.data + x.size());
+		ba_bci_connect_minmax(scratch.data(), x.n_chans, x.n_samples, lo.data(), hi.data());
+		Py_END_ALLOW_THREADS
+		const Py_ssize_t n = static_cast<Py_ssize_t>(x.n_chans);
+		return Py_BuildValue("(NN)", new_block(std::move(lo), 1, n, 1), new_block(std::move(hi), 1, n, 1));
+	}
+
+	PyObject* py_fft(PyObject*, PyObject* args)
+	{
+		PyObject* obj = nullptr;
+		double fs = 0;
+		if (!PyArg_ParseTuple(args, "Od", &obj, &fs))
+		{
+			return nullptr;
+		}
+		signal_arg x;
+		if (!get_signal(obj, false, x))
+		{
+			return nullptr;
+		}
+		const size_t bins = (x.n_samples - (x.n_samples % 2)) / 2 + 1;
+		std::vector<double> magnitudes(x.n_chans * bins);
+		std::vector<double> phases(x.n_chans * bins);
+		Py_BEGIN_ALLOW_THREADS
+		ba_bci_connect_fft(x.data, x.n_chans, x.n_samples, fs, magnitudes.data(), phases.data());
+		Py_END_ALLOW_THREADS
+		const Py_ssize_t c = static_cast<Py_ssize_t>(x.n_chans);
+		const Py_ssize_t b = static_cast<Py_ssize_t>(bins);
+		return Py_BuildValue("(NN)", new_block(std::move(magnitudes), c, b), new_block(std::move(phases), c, b));
+	}
+
+	PyObject* py_ssvep_classify(PyObject*, PyObject* args)
+	{
+		PyObject* obj = nullptr;
+		double fs = 0;
+		PyObject* freq_obj = nullptr;
+		if (!PyArg_ParseTuple(args, "OdO", &obj, &fs, &freq_obj))
+		{
+			return nullptr;
+		}
+		signal_arg x;
+		if (!get_signal(obj, false, x))
+		{
+			return nullptr;
+		}
+		PyObject* seq = PySequence_Fast(freq_obj, "frequencies must be a sequence");
+		if (!seq)
+		{
+			return nullptr;
+		}
+		std::vector<double> freqs;
+		for (Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(seq); ++i)
+		{
+			freqs.push_back(PyFloat_AsDouble(PySequence_Fast_GET_ITEM(seq, i)));
+		}
+		Py_DECREF(seq);
+		if (PyErr_Occurred())
+		{
+			return nullptr;
+		}
+		if (freqs.empty())
+		{
+			PyErr_SetString(PyExc_ValueError, "no frequencies");
+			return nullptr;
+		}
+		size_t index = 0;
+		double score = 0;
+		Py_BEGIN_ALLOW_THREADS
+		index = ba_bci_connect_ssvep_classify(x.data, x.n_samples, x.n_chans, fs, freqs.data(), freqs.size(), &score);
+		Py_END_ALLOW_THREADS
+		return Py_BuildValue("(nd)", static_cast<Py_ssize_t>(index), score);
+	}
+
+	PyObject* py_connectivity(PyObject*, PyObject* args, PyObject* kwargs)
+	{
+		static const char* keywords[] = {"x", "sampling_rate", "window", "hop", "low_hz", "high_hz", "threads", nullptr};
+		PyObject* obj = nullptr;
+		double fs = 0;
+		Py_ssize_t window = 0;
+		Py_ssize_t hop = 0;
+		eeg::connectivity_options opts;
+		Py_ssize_t threads = 1;
+		if (!PyArg_ParseTupleAndKeywords(args, kwargs, "Odnn|ddn", const_cast<char**>(keywords), &obj, &fs, &window, &hop, &opts.low_hz, &opts.high_hz,
+										 &threads))
+		{
+			return nullptr;
+		}
+		signal_arg x;
+		if (!get_signal(obj, false, x))
+		{
+			return nullptr;
+		}
+		if (window <= 0 || hop <= 0 || threads <= 0)
+		{
+			PyErr_SetString(PyExc_ValueError, "window, hop and threads must be positive");
+			return nullptr;
+		}
+		opts.threads = static_cast<size_t>(threads);
+		eeg::connectivity_matrices m;
+		std::string error;
+		bool ok = false;
+		Py_BEGIN_ALLOW_THREADS
+		ok = eeg::compute_connectivity(x.data, x.n_chans, x.n_samples, fs, static_cast<size_t>(window), static_cast<size_t>(hop), opts, m, &error);
+		Py_END_ALLOW_THREADS
+		if (!ok)
+		{
+			PyErr_SetString(PyExc_ValueError, error.c_str());
+			return nullptr;
+		}
+		const Py_ssize_t c = static_cast<Py_ssize_t>(m.n_chans);
+		return Py_BuildValue("(NNN)", new_block(std::move(m.coherence), c, c), new_block(std::move(m.plv), c, c), new_block(std::move(m.correlation), c, c));
+	}
+
+	PyObject* py_ar_spectrum(PyObject*, PyObject* args, PyObject* kwargs)
+	{
+		static const char* keywords[] = {"x", "sampling_rate", "frequencies", "order", nullptr};
+		PyObject* obj = nullptr;
+		double fs = 0;
+		PyObject* freq_obj = nullptr;
+		Py_ssize_t order = 16;
+		if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OdO|n", const_cast<char**>(keywords), &obj, &fs, &freq_obj, &order))
+		{
+			return nullptr;
+		}
+		signal_arg x;
+		if (!get_signal(obj, false, x))
+		{
+			return nullptr;
+		}
+		PyObject* seq = PySequence_Fast(freq_obj, "frequencies must be a sequence");
+		if (!seq)
+		{
+			return nullptr;
+		}
+		std::vector<double> freqs;
+		for (Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(seq); ++i)
+		{
+			freqs.push_back(PyFloat_AsDouble(PySequence_Fast_GET_ITEM(seq, i)));
+		}
+		Py_DECREF(seq);
+		if (PyErr_Occurred())
+		{
+			return nullptr;
+		}
+		if (order <= 0)
+		{
+			PyErr_SetString(PyExc_ValueError, "order must be positive");
+			return nullptr;
+		}
+		std::vector<double> out;
+		std::string error;
+		bool ok = false;
+		Py_BEGIN_ALLOW_THREADS
+		ok = eeg::compute_ar_spectrum(x.data, x.n_chans, x.n_samples, fs, freqs, static_cast<size_t>(order), out, &error);
+		Py_END_ALLOW_THREADS
+		if (!ok)
+		{
+			PyErr_SetString(PyExc_ValueError, error.c_str());
+			return nullptr;
+		}
+		return new_block(std::move(out), static_cast<Py_ssize_t>(x.n_chans), static_cast<Py_ssize_t>(freqs.size()));
+	}
+
+	PyObject* py_entropy(PyObject*, PyObject* args, PyObject* kwargs)
+	{
+		static const char* keywords[] = {"x", "m", "r", "threads", nullptr};
+		PyObject* obj = nullptr;
+		Py_ssize_t m = 2;
+		eeg::entropy_options opts;
+		Py_ssize_t threads = 1;
+		if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|ndn", const_cast<char**>(keywords), &obj, &m, &opts.r, &threads))
+		{
+			return nullptr;
+		}
+		signal_arg x;
+		if (!get_signal(obj, false, x))
+		{
+			return nullptr;
+		}
+		if (m <= 0 || threads <= 0 || opts.r < 0)
+		{
+			PyErr_SetString(PyExc_ValueError, "m and threads must be positive and r not negative");
+			return nullptr;
+		}
+		opts.m = static_cast<size_t>(m);
+		opts.threads = static_cast<size_t>(threads);
+		eeg::entropy_values values;
+		bool ok = false;
+		Py_BEGIN_ALLOW_THREADS
+		eeg::entropy_engine engine;
+		ok = engine.init(x.n_chans, opts) && engine.compute(x.data, x.n_samples, values);
+		Py_END_ALLOW_THREADS
+		if (!ok)
+		{
+			PyErr_SetString(PyExc_ValueError, "entropy needs m + 2 or more samples per channel");
+			return nullptr;
+		}
+		const Py_ssize_t c = static_cast<Py_ssize_t>(x.n_chans);
+		return Py_BuildValue("(NN)", new_block(std::move(values.sample), 1, c, 1), new_block(std::move(values.approximate), 1, c, 1));
+	}
+
+	// ------------------------------------------------------- Recordings
+
+	PyObject* py_load_recording(PyObject*, PyObject* args)
+	{
+		const char* path = nullptr;
+		if (!PyArg_ParseTuple(args, "s", &path))
+		{
+			return nullptr;
+		}
+		eeg::recording_contents contents;
+		std::string error;
+		bool ok = false;
+		Py_BEGIN_ALLOW_THREADS
+		ok = eeg::load_recording(path, contents, &error);
+		Py_END_ALLOW_THREADS
+		if (!ok)
+		{
+			PyErr_SetString(PyExc_OSError, error.c_str());
+			return nullptr;
+		}
+
+		PyObject* labels = PyList_New(0);
+		for (const std::string& label : contents.header.labels)
+		{
+			PyObject* s = PyUnicode_DecodeUTF8(label.data(), static_cast<Py_ssize_t>(label.size()), "replace");
+			PyList_Append(labels, s);
+			Py_XDECREF(s);
+		}
+		PyObject* annotations = PyList_New(0);
+		for (const eeg::stream_annotation& a : contents.annotations)
+		{
+			PyObject* text = PyUnicode_DecodeUTF8(a.text.data(), static_cast<Py_ssize_t>(a.text.size()), "replace");
+			PyObject* item = text ? Py_BuildValue("(KN)", static_cast<unsigned long long>(a.sample), text) : nullptr;
+			PyList_Append(annotations, item);
+			Py_XDECREF(item);
+		}
+		PyObject* gaps = PyList_New(0);
+		for (const eeg::sample_gap& g : contents.gaps)
+		{
+			PyObject* item = Py_BuildValue("(nK)", static_cast<Py_ssize_t>(g.index), static_cast<unsigned long long>(g.sample));
+			PyList_Append(gaps, item);
+			Py_XDECREF(item);
+		}
+		const Py_ssize_t chans = static_cast<Py_ssize_t>(contents.header.n_chans);
+		const Py_ssize_t samples = static_cast<Py_ssize_t>(contents.n_samples);
+		return Py_BuildValue("{s:N,s:d,s:K,s:N,s:N,s:N}", "labels", labels, "sampling_rate", contents.header.sampling_rate, "first_sample",
+							 static_cast<unsigned long long>(contents.first_sample), "data", new_block(std::move(contents.data), chans, samples),
+							 "annotations", annotations, "gaps", gaps);
+	}
+
+	// ----------------------------------------------------------- Module
+
+	PyMethodDef module_methods[] = {
+		{"lowpass", py_lowpass, METH_VARARGS, "lowpass(x, sampling_rate, cutoff_hz)\n\nFilters x in place."},
+		{"highpass", py_highpass, METH_VARARGS, "highpass(x, sampling_rate, cutoff_hz)\n\nFilters x in place."},
+		{"bandpass", py_bandpass, METH_VARARGS, "bandpass(x, sampling_rate, low_hz, high_hz)\n\nFilters x in place."},
+		{"notch", py_notch, METH_VARARGS, "notch(x, sampling_rate, center_hz, width_hz)\n\nFilters x in place."},
+		{"detrend", py_detrend, METH_VARARGS, "detrend(x) -> Block"},
+		{"demean", py_demean, METH_VARARGS, "demean(x) -> Block"},
+		{"standardize", py_standardize, METH_VARARGS, "standardize(x) -> Block"},
+		{"ewma_standardize", py_ewma_standardize, METH_VARARGS, "ewma_standardize(x, alpha=0.001, epsilon=1e-4) -> Block"},
+		{"mean", py_mean, METH_VARARGS, "mean(x) -> Block of n_chans"},
+		{"std", py_std, METH_VARARGS, "std(x) -> Block of n_chans"},
+		{"median", py_median, METH_VARARGS, "median(x) -> Block of n_chans"},
+		{"mad", py_mad, METH_VARARGS, "mad(x) -> Block of n_chans"},
+		{"ewma", py_ewma, METH_VARARGS, "ewma(x, alpha) -> Block of n_chans"},
+		{"quality", py_quality, METH_VARARGS, "quality(x, sampling_rate) -> Block of n_chans, values 0 to 2"},
+		{"minmax", py_minmax, METH_VARARGS, "minmax(x) -> (Block, Block)"},
+		{"fft", py_fft, METH_VARARGS, "fft(x, sampling_rate) -> (magnitudes, phases), each (n_chans, n_samples // 2 + 1)"},
+		{"ssvep_classify", py_ssvep_classify, METH_VARARGS, "ssvep_classify(x, sampling_rate, frequencies) -> (index, score)"},
+		{"connectivity", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)(void)>(py_connectivity)), METH_VARARGS | METH_KEYWORDS,
+		 "connectivity(x, sampling_rate, window, hop, low_hz=8, high_hz=12, threads=1) -> (coherence, plv, correlation)\n\nChannel-pair "
+		 "measures in a band, averaged over every window of x, each (n_chans, n_chans)."},
+		{"ar_spectrum", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)(void)>(py_ar_spectrum)), METH_VARARGS | METH_KEYWORDS,
+		 "ar_spectrum(x, sampling_rate, frequencies, order=16) -> Block\n\nBurg autoregressive power spectral density of each channel at "
+		 "the given frequencies, (n_chans, len(frequencies))."},
+		{"entropy", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)(void)>(py_entropy)), METH_VARARGS | METH_KEYWORDS,
+		 "entropy(x, m=2, r=0.2, threads=1) -> (sample, approximate)\n\nSample and approximate entropy of each channel with templates of m "
+		 "samples matching within r standard deviations, each (n_chans,)."},
+		{"load_recording", py_load_recording, METH_VARARGS,
+		 "load_recording(path) -> dict\n\nKeys labels, sampling_rate, first_sample, data (Block), annotations ((sample, text) list) and gaps ((index, sample) "
+		 "list of places where sample numbers jump)."},
+		{nullptr, nullptr, 0, nullptr},
+	};
+
+	PyModuleDef module_def = {PyModuleDef_HEAD_INIT, "eeg", "BrainAccess stream rings, recordings and signal processing over the buffer protocol", -1,
+							  module_methods};
+
+	bool add_type(PyObject* module, PyTypeObject& type, const char* name)
+	{
+		if (PyType_Ready(&type) < 0)
+		{
+			return false;
+		}
+		Py_INCREF(&type);
+		if (PyModule_AddObject(module, name, reinterpret_cast<PyObject*>(&type)) < 0)
+		{
+			Py_DECREF(&type);
+			return false;
+		}
+		return true;
+	}
+} // namespace
+
+PyMODINIT_FUNC PyInit_eeg()
+{
+	block_type.tp_name = "eeg.Block";
+	block_type.tp_basicsize = sizeof(block_object);
+	block_type.tp_dealloc = block_dealloc;
+	block_type.tp_as_buffer = &block_buffer;
+	block_type.tp_flags = Py_TPFLAGS_DEFAULT;
+	block_type.tp_doc = "Float64 signal exported through the buffer protocol; numpy.asarray(block) is a view";
+	block_type.tp_getset = block_getset;
+
+	ring_type.tp_name = "eeg.Ring";
+	ring_type.tp_basicsize = sizeof(ring_object);
+	ring_type.tp_dealloc = ring_dealloc;
+	ring_type.tp_flags = Py_TPFLAGS_DEFAULT;
+	ring_type.tp_doc = "Ring(n_chans, capacity)\n\nSingle-producer, single-consumer sample ring (stream_ring.h)";
+	ring_type.tp_methods = ring_methods;
+	ring_type.tp_getset = ring_getset;
+	ring_type.tp_init = ring_init;
+	ring_type.tp_new = PyType_GenericNew;
+
+	p300_type.tp_name = "eeg.P300";
+	p300_type.tp_basicsize = sizeof(p300_object);
+	p300_type.tp_dealloc = p300_dealloc;
+	p300_type.tp_flags = Py_TPFLAGS_DEFAULT;
+	p300_type.tp_doc = "P300(model_number=0)\n\nModel from the bciconnect P300 zoo";
+	p300_type.tp_methods = p300_methods;
+	p300_type.tp_getset = p300_getset;
+	p300_type.tp_init = p300_init;
+	p300_type.tp_new = PyType_GenericNew;
+
+	erp_type.tp_name = "eeg.ErpAverager";
+	erp_type.tp_basicsize = sizeof(erp_object);
+	erp_type.tp_dealloc = erp_dealloc;
+	erp_type.tp_flags = Py_TPFLAGS_DEFAULT;
+	erp_type.tp_doc = "ErpAverager(n_chans, n_samples, baseline=0, reject=0)\n\nRunning ERP mean and variance per stimulus class (erp_average.h)";
+	erp_type.tp_methods = erp_methods;
+	erp_type.tp_getset = erp_getset;
+	erp_type.tp_init = erp_init;
+	erp_type.tp_new = PyType_GenericNew;
+
+	PyObject* module = PyModule_Create(&module_def);
+	if (!module)
+	{
+		return nullptr;
+	}
+	if (!add_type(module, block_type, "Block") || !add_type(module, ring_type, "Ring") || !add_type(module, p300_type, "P300")
+		|| !add_type(module, erp_type, "ErpAverager"))
+	{
+		Py_DECREF(module);
+		return nullptr;
+	}
+	return module;
+}
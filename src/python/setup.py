@@ -0,0 +1,75 @@
+"""Builds the eeg extension module.
+
+    python setup.py build_ext --inplace
+
+Links against the BrainAccess libraries in lib/ (override with
+BRAINACCESS_LIB_DIR). On Windows build with MinGW, like the VS Code tasks:
+
+    python setup.py build_ext --inplace --compiler=mingw32
+"""
+
+import os
+import sys
+
+from setuptools import Extension, setup
+from setuptools.command.build_ext import build_ext
+
+here = os.path.dirname(os.path.abspath(__file__))
+root = os.path.normpath(os.path.join(here, "..", ".."))
+lib_dir = os.environ.get("BRAINACCESS_LIB_DIR", os.path.join(root, "lib"))
+
+
+def src(path):
+    return os.path.relpath(os.path.join(root, "src", path), here)
+
+
+sources = [
+    "eeg_module.cpp",
+    src("bci/ar_spectrum.cpp"),
+    src("bci/connectivity.cpp"),
+    src("bci/entropy.cpp"),
+    src("bci/erp_average.cpp"),
+    src("bci/p300_model.cpp"),
+    src("stream/adc_counts.cpp"),
+    src("stream/recording.cpp"),
+    src("stream/sample_numbers.cpp"),
+    src("stream/simulated_device.cpp"),
+    src("stream/stream_ring.cpp"),
+    src("util/bit_pack.cpp"),
+    src("util/json_writer.cpp"),
+    src("util/memory_accounting.cpp"),
+    src("util/process_stats.cpp"),
+    src("util/synthetic_signal.cpp"),
+    src("util/work_pool.cpp"),
+]
+
+if sys.platform == "win32":
+    link = dict(extra_objects=[os.path.join(lib_dir, "bacore.lib"), os.path.join(lib_dir, "babciconnect.dll")])
+else:
+    link = dict(library_dirs=[lib_dir], libraries=["bacore", "babciconnect"], runtime_library_dirs=[lib_dir])
+
+
+class build_ext_cpp17(build_ext):
+    def build_extensions(self):
+        flag = "/std:c++17" if self.compiler.compiler_type == "msvc" else "-std=c++17"
+        for ext in self.extensions:
+            ext.extra_compile_args = [flag]
+        super().build_extensions()
+
+
+setup(
+    name="eeg",
+    version="1.0.0",
+    description="BrainAccess stream rings, recordings and signal processing over the buffer protocol",
+    ext_modules=[
+        Extension(
+            "eeg",
+            sources=sources,
+            include_dirs=[os.path.join(root, "include"), os.path.join(root, "include", "core"),
+                          os.path.join(root, "include", "bciconnect"), os.path.join(root, "src")],
+            language="c++",
+            **link,
+        )
+    ],
+    cmdclass={"build_ext": build_ext_cpp17},
+)
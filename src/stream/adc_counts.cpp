@@ -0,0 +1,100 @@
+#include "stream/adc_counts.h"
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EEG_ADC_COUNTS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace eeg
+{
+	namespace
+	{
+		constexpr double count_min = -2147483648.0;
+		constexpr double count_max = 2147483647.0;
+
+		/**
+		 * Clamps like `maxpd`/`minpd`, which also send NaN to `count_min`,
+		 * and rounds in the current mode like `cvtpd2dq`.
+		 */
+		int32_t to_count(double v)
+		{
+			v = v > count_min ? v : count_min;
+			v = v < count_max ? v : count_max;
+			return static_cast<int32_t>(std::nearbyint(v));
+		}
+	} // namespace
+
+	double adc_microvolts_per_count(ba_gain_mode g)
+	{
+		const int gain = ba_gain_mode_to_multiplier(g);
+		if (gain <= 0)
+		{
+			return 0;
+		}
+		return adc_reference_volts / static_cast<double>((1u << (adc_bits - 1)) - 1) / gain * 1e6;
+	}
+
+	bool counts_exact(const double* x, const int32_t* counts, size_t n, double scale)
+	{
+		const double tolerance = scale * 1e-6;
+		bool exact = true;
+		for (size_t i = 0; i < n; ++i)
+		{
+			exact &= std::abs(x[i] - counts[i] * scale) <= tolerance;
+		}
+		return exact;
+	}
+
+	void to_counts_scalar(const double* x, size_t n, double scale, int32_t* counts)
+	{
+		const double inv = 1 / scale;
+		for (size_t i = 0; i < n; ++i)
+		{
+			counts[i] = to_count(x[i] * inv);
+		}
+	}
+
+	void from_counts_scalar(const int32_t* counts, size_t n, double scale, double* x)
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			x[i] = counts[i] * scale;
+		}
+	}
+
+	void to_counts(const double* x, size_t n, double scale, int32_t* counts)
+	{
+		size_t i = 0;
+#ifdef EEG_ADC_COUNTS_SSE2
+		const double inv = 1 / scale;
+		const __m128d k = _mm_set1_pd(inv);
+		const __m128d lo = _mm_set1_pd(count_min);
+		const __m128d hi = _mm_set1_pd(count_max);
+		for (; i + 4 <= n; i += 4)
+		{
+			const __m128d a = _mm_min_pd(_mm_max_pd(_mm_mul_pd(_mm_loadu_pd(x + i), k), lo), hi);
+			const __m128d b = _mm_min_pd(_mm_max_pd(_mm_mul_pd(_mm_loadu_pd(x + i + 2), k), lo), hi);
+			const __m128i packed = _mm_unpacklo_epi64(_mm_cvtpd_epi32(a), _mm_cvtpd_epi32(b));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(counts + i), packed);
+		}
+#endif
+		to_counts_scalar(x + i, n - i, scale, counts + i);
+	}
+
+	void from_counts(const int32_t* counts, size_t n, double scale, double* x)
+	{
+		size_t i = 0;
+#ifdef EEG_ADC_COUNTS_SSE2
+		const __m128d k = _mm_set1_pd(scale);
+		for (; i + 4 <= n; i += 4)
+		{
+			const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(counts + i));
+			_mm_storeu_pd(x + i, _mm_mul_pd(_mm_cvtepi32_pd(c), k));
+			_mm_storeu_pd(x + i + 2, _mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(c, 8)), k));
+		}
+#endif
+		from_counts_scalar(counts + i, n - i, scale, x + i);
+	}
+} // namespace eeg
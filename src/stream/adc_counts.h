@@ -0,0 +1,59 @@
+/**
+ * @file adc_counts.h
+ * @brief Electrode samples as integer ADC counts with per-channel scales
+ */
+
+#pragma once
+
+#include "gain_mode.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace eeg
+{
+	constexpr double adc_reference_volts = 4.5; ///< ADC reference voltage, assumed
+	constexpr unsigned adc_bits = 24;           ///< ADC resolution, signed, assumed
+
+	/**
+	 * @brief Microvolts per ADC count for a channel at gain `g`
+	 *
+	 * @details Samples arrive in microvolts with the gain set by
+	 * `ba_eeg_manager_set_channel_gain` already applied. Assuming a 4.5 V
+	 * reference and a 24-bit converter, which the SDK headers do not
+	 * state, one count is `adc_reference_volts / (2^23 - 1) / gain` volts
+	 * and device samples are whole multiples of it. Callers storing counts
+	 * should check that with `counts_exact()` rather than rely on it.
+	 *
+	 * @return 0 for gains `ba_gain_mode_to_multiplier` does not know
+	 */
+	double adc_microvolts_per_count(ba_gain_mode g);
+
+	/**
+	 * @brief Rounds `n` samples to the nearest multiple of `scale`, as counts
+	 *
+	 * @details Values outside the int32 range saturate. Uses SSE2 where the
+	 * target has it; `to_counts_scalar()` gives identical results.
+	 */
+	void to_counts(const double* x, size_t n, double scale, int32_t* counts);
+
+	/**
+	 * @brief Whether `counts[i] * scale` gives back every `x[i]`, to within
+	 * a millionth of a count for the rounding of the library's own scale
+	 *
+	 * @details False for samples off the grid of `scale`, such as filtered
+	 * data or a wrong scale, which counts would store lossily.
+	 */
+	bool counts_exact(const double* x, const int32_t* counts, size_t n, double scale);
+
+	/**
+	 * @brief `counts[i] * scale` for `n` samples
+	 */
+	void from_counts(const int32_t* counts, size_t n, double scale, double* x);
+
+	/**
+	 * @brief Scalar references for the kernels above
+	 */
+	void to_counts_scalar(const double* x, size_t n, double scale, int32_t* counts);
+	void from_counts_scalar(const int32_t* counts, size_t n, double scale, double* x);
+} // namespace eeg
@@ -0,0 +1,89 @@
+#include "stream/annotation_store.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace eeg
+{
+	annotation_store::annotation_store(memory_owner owner)
+		: entries_(tracked_allocator<entry>(owner, memory_category::annotations)),
+		  text_(tracked_allocator<char>(owner, memory_category::annotations))
+	{
+	}
+
+	void annotation_store::add(size_t sample, const std::string& text)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		const entry e{sample, text_.size(), text.size()};
+		text_.insert(text_.end(), text.begin(), text.end());
+		// Annotations almost always arrive in order, making this an append
+		const auto pos = std::upper_bound(entries_.begin(), entries_.end(), sample, [](size_t s, const entry& x) { return s < x.sample; });
+		entries_.insert(pos, e);
+	}
+
+	size_t annotation_store::import(const ba_annotation* annotations, size_t annotations_size)
+	{
+		size_t first = 0;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			first = imported_;
+			imported_ = std::max(imported_, annotations_size);
+		}
+		for (size_t i = first; i < annotations_size; ++i)
+		{
+			const char* text = annotations[i].annotation ? annotations[i].annotation : "";
+			add(annotations[i].timestamp, std::string(text, std::strlen(text)));
+		}
+		return annotations_size > first ? annotations_size - first : 0;
+	}
+
+	void annotation_store::reset_import()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		imported_ = 0;
+	}
+
+	stream_annotation annotation_store::make(const entry& e) const
+	{
+		return stream_annotation{e.sample, std::string(text_.data() + e.text_offset, e.text_size)};
+	}
+
+	std::vector<stream_annotation> annotation_store::range(size_t from, size_t to) const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		std::vector<stream_annotation> out;
+		auto it = std::lower_bound(entries_.begin(), entries_.end(), from, [](const entry& x, size_t s) { return x.sample < s; });
+		for (; it != entries_.end() && it->sample < to; ++it)
+		{
+			out.push_back(make(*it));
+		}
+		return out;
+	}
+
+	std::vector<stream_annotation> annotation_store::all() const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		std::vector<stream_annotation> out;
+		out.reserve(entries_.size());
+		for (const entry& e : entries_)
+		{
+			out.push_back(make(e));
+		}
+		return out;
+	}
+
+	size_t annotation_store::size() const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return entries_.size();
+	}
+
+	void annotation_store::clear()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		entries_.clear();
+		entries_.shrink_to_fit();
+		text_.clear();
+		text_.shrink_to_fit();
+	}
+} // namespace eeg
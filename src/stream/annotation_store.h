@@ -0,0 +1,89 @@
+/**
+ * @file annotation_store.h
+ * @brief Application-side store of annotations and stream events
+ */
+
+#pragma once
+
+#include "annotation.h"
+#include "util/memory_accounting.h"
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace eeg
+{
+	/**
+	 * @brief Annotation with its sample number
+	 */
+	struct stream_annotation
+	{
+		size_t sample; ///< Sample number the annotation refers to
+		std::string text;
+	};
+
+	/**
+	 * @brief Thread-safe, sample-ordered annotation storage
+	 *
+	 * @details Keeps annotations copied from the manager (which clears its own
+	 * on disconnect) together with events generated by the application.
+	 * Storage is accounted to `owner` under `memory_category::annotations`.
+	 */
+	class annotation_store
+	{
+	public:
+		explicit annotation_store(memory_owner owner = nullptr);
+
+		/**
+		 * @brief Adds an annotation, keeping the store ordered by sample
+		 */
+		void add(size_t sample, const std::string& text);
+
+		/**
+		 * @brief Copies annotations not yet imported from an array returned by
+		 * `ba_eeg_manager_get_annotations`
+		 *
+		 * @details The manager returns everything accumulated since connect, so
+		 * only entries past the previously imported count are added. Call
+		 * `reset_import()` after the manager's annotations are cleared.
+		 *
+		 * @return Number of annotations added
+		 */
+		size_t import(const ba_annotation* annotations, size_t annotations_size);
+
+		/**
+		 * @brief Forgets how many manager annotations were imported
+		 */
+		void reset_import();
+
+		/**
+		 * @brief Annotations with `from <= sample < to`, in sample order
+		 */
+		std::vector<stream_annotation> range(size_t from, size_t to) const;
+
+		/**
+		 * @brief All annotations in sample order
+		 */
+		std::vector<stream_annotation> all() const;
+
+		size_t size() const;
+		void clear();
+
+	private:
+		struct entry
+		{
+			size_t sample;
+			size_t text_offset;
+			size_t text_size;
+		};
+
+		stream_annotation make(const entry& e) const;
+
+		mutable std::mutex mutex_;
+		tracked_vector<entry> entries_;
+		tracked_vector<char> text_; ///< Texts packed back to back
+		size_t imported_ = 0;
+	};
+} // namespace eeg
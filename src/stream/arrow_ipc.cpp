@@ -0,0 +1,612 @@
+#include "stream/arrow_ipc.h"
+
+#include "util/bit_pack.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+namespace eeg
+{
+	namespace
+	{
+		/**
+		 * Flatbuffer builder covering what Arrow's Schema, Message and
+		 * Footer tables need. Like the reference builder it writes back to
+		 * front, so an object is referred to by its distance from the end.
+		 */
+		class flat_builder
+		{
+		public:
+			using ref = uint32_t;
+
+			ref size() const { return static_cast<ref>(buf_.size() - head_); }
+
+			void prep(size_t align, size_t additional)
+			{
+				minalign_ = std::max(minalign_, align);
+				pad((~(size() + additional) + 1) & (align - 1));
+			}
+
+			template <typename T>
+			ref push(T v)
+			{
+				prep(sizeof(T), 0);
+				put(v);
+				return size();
+			}
+
+			ref push_offset(ref target)
+			{
+				prep(sizeof(uint32_t), 0);
+				put<uint32_t>(size() + sizeof(uint32_t) - target);
+				return size();
+			}
+
+			ref string(const std::string& s)
+			{
+				prep(sizeof(uint32_t), s.size() + 1);
+				put<uint8_t>(0);
+				put_bytes(s.data(), s.size());
+				put<uint32_t>(static_cast<uint32_t>(s.size()));
+				return size();
+			}
+
+			ref offset_vector(const std::vector<ref>& items)
+			{
+				prep(sizeof(uint32_t), items.size() * sizeof(uint32_t));
+				for (size_t i = items.size(); i-- > 0;)
+				{
+					put<uint32_t>(size() + sizeof(uint32_t) - items[i]);
+				}
+				put<uint32_t>(static_cast<uint32_t>(items.size()));
+				return size();
+			}
+
+			/**
+			 * Vector of `n` structs, laid out as flatbuffers lays them out.
+			 */
+			ref struct_vector(const void* items, size_t n, size_t item_size, size_t align)
+			{
+				prep(sizeof(uint32_t), n * item_size);
+				prep(align, n * item_size);
+				put_bytes(items, n * item_size);
+				put<uint32_t>(static_cast<uint32_t>(n));
+				return size();
+			}
+
+			void start_table()
+			{
+				fields_.clear();
+				table_start_ = size();
+			}
+
+			template <typename T>
+			void field(uint16_t slot, T v)
+			{
+				fields_.push_back({slot, push(v)});
+			}
+
+			void field_offset(uint16_t slot, ref target)
+			{
+				fields_.push_back({slot, push_offset(target)});
+			}
+
+			/**
+			 * Writes the table's offset to its vtable, then the vtable: its
+			 * size, the table's size and each slot's field position, 0 for
+			 * absent fields.
+			 */
+			ref end_table()
+			{
+				const ref table = push<int32_t>(0);
+				uint16_t n_slots = 0;
+				for (const table_field& f : fields_)
+				{
+					n_slots = std::max<uint16_t>(n_slots, f.slot + 1);
+				}
+				std::vector<uint16_t> slots(n_slots, 0);
+				for (const table_field& f : fields_)
+				{
+					slots[f.slot] = static_cast<uint16_t>(table - f.at);
+				}
+				for (size_t i = slots.size(); i-- > 0;)
+				{
+					put(slots[i]);
+				}
+				put<uint16_t>(static_cast<uint16_t>(table - table_start_));
+				put<uint16_t>(static_cast<uint16_t>((n_slots + 2) * sizeof(uint16_t)));
+				const int32_t vtable = static_cast<int32_t>(size()) - static_cast<int32_t>(table);
+				std::memcpy(&buf_[buf_.size() - table], &vtable, sizeof(vtable));
+				fields_.clear();
+				return table;
+			}
+
+			/**
+			 * Writes the root offset and returns the finished buffer.
+			 */
+			std::vector<uint8_t> finish(ref root)
+			{
+				prep(std::max(minalign_, sizeof(uint32_t)), sizeof(uint32_t));
+				push_offset(root);
+				return std::vector<uint8_t>(buf_.begin() + static_cast<std::ptrdiff_t>(head_), buf_.end());
+			}
+
+		private:
+			struct table_field
+			{
+				uint16_t slot;
+				ref at;
+			};
+
+			void reserve(size_t n)
+			{
+				if (head_ >= n)
+				{
+					return;
+				}
+				const size_t used = size();
+				const size_t capacity = std::max(buf_.size() * 2, used + n + 256);
+				std::vector<uint8_t> grown(capacity);
+				if (used > 0)
+				{
+					std::memcpy(grown.data() + capacity - used, buf_.data() + head_, used);
+				}
+				buf_.swap(grown);
+				head_ = capacity - used;
+			}
+
+			void pad(size_t n)
+			{
+				reserve(n);
+				head_ -= n;
+				if (n > 0)
+				{
+					std::memset(&buf_[head_], 0, n);
+				}
+			}
+
+			void put_bytes(const void* data, size_t n)
+			{
+				reserve(n);
+				head_ -= n;
+				if (n > 0)
+				{
+					std::memcpy(&buf_[head_], data, n);
+				}
+			}
+
+			template <typename T>
+			void put(T v)
+			{
+				put_bytes(&v, sizeof(T));
+			}
+
+			std::vector<uint8_t> buf_;
+			size_t head_ = 0;
+			size_t minalign_ = 1;
+			size_t table_start_ = 0;
+			std::vector<table_field> fields_;
+		};
+
+		// Schema.fbs, Message.fbs and File.fbs
+		constexpr int16_t metadata_v5 = 4;
+		constexpr uint8_t type_int = 2;
+		constexpr uint8_t type_floating_point = 3;
+		constexpr uint8_t type_utf8 = 5;
+		constexpr uint8_t type_bool = 6;
+		constexpr int16_t precision_single = 1;
+		constexpr int16_t precision_double = 2;
+		constexpr uint8_t header_schema = 1;
+		constexpr uint8_t header_record_batch = 3;
+
+		const char file_magic[8] = {'A', 'R', 'R', 'O', 'W', '1', 0, 0};
+		const uint32_t continuation = 0xFFFFFFFFu;
+
+		struct field_node
+		{
+			int64_t length;
+			int64_t null_count;
+		};
+
+		struct buffer_ref
+		{
+			int64_t offset;
+			int64_t length;
+		};
+
+		struct footer_block
+		{
+			int64_t offset;
+			int32_t metadata_length;
+			int32_t padding;
+			int64_t body_length;
+		};
+
+		size_t padded8(size_t n)
+		{
+			return (n + 7) & ~size_t(7);
+		}
+
+		/**
+		 * Bytes a column of `length` values must have.
+		 */
+		size_t expected_bytes(arrow_type type, size_t length)
+		{
+			switch (type)
+			{
+			case arrow_type::boolean:
+				return (length + 7) / 8;
+			case arrow_type::int32:
+			case arrow_type::float32:
+				return length * 4;
+			case arrow_type::uint64:
+			case arrow_type::float64:
+				return length * 8;
+			case arrow_type::utf8:
+				break;
+			}
+			return 0;
+		}
+
+		flat_builder::ref type_table(flat_builder& b, arrow_type type)
+		{
+			b.start_table();
+			switch (type)
+			{
+			case arrow_type::int32:
+				b.field<int32_t>(0, 32);
+				b.field<uint8_t>(1, 1);
+				break;
+			case arrow_type::uint64:
+				b.field<int32_t>(0, 64);
+				b.field<uint8_t>(1, 0);
+				break;
+			case arrow_type::float32:
+				b.field<int16_t>(0, precision_single);
+				break;
+			case arrow_type::float64:
+				b.field<int16_t>(0, precision_double);
+				break;
+			case arrow_type::boolean:
+			case arrow_type::utf8:
+				break;
+			}
+			return b.end_table();
+		}
+
+		uint8_t type_code(arrow_type type)
+		{
+			switch (type)
+			{
+			case arrow_type::boolean:
+				return type_bool;
+			case arrow_type::int32:
+			case arrow_type::uint64:
+				return type_int;
+			case arrow_type::float32:
+			case arrow_type::float64:
+				return type_floating_point;
+			case arrow_type::utf8:
+				break;
+			}
+			return type_utf8;
+		}
+
+		flat_builder::ref schema_table(flat_builder& b, const arrow_schema& schema)
+		{
+			std::vector<flat_builder::ref> fields;
+			for (const arrow_field& f : schema.fields)
+			{
+				const flat_builder::ref name = b.string(f.name);
+				const flat_builder::ref type = type_table(b, f.type);
+				const flat_builder::ref children = b.offset_vector({});
+				b.start_table();
+				b.field_offset(0, name);
+				b.field<uint8_t>(1, 0);
+				b.field<uint8_t>(2, type_code(f.type));
+				b.field_offset(3, type);
+				b.field_offset(5, children);
+				fields.push_back(b.end_table());
+			}
+			std::vector<flat_builder::ref> metadata;
+			for (const auto& kv : schema.metadata)
+			{
+				const flat_builder::ref key = b.string(kv.first);
+				const flat_builder::ref value = b.string(kv.second);
+				b.start_table();
+				b.field_offset(0, key);
+				b.field_offset(1, value);
+				metadata.push_back(b.end_table());
+			}
+			const flat_builder::ref field_vector = b.offset_vector(fields);
+			const flat_builder::ref metadata_vector = b.offset_vector(metadata);
+			b.start_table();
+			b.field<int16_t>(0, 0); // little-endian
+			b.field_offset(1, field_vector);
+			b.field_offset(2, metadata_vector);
+			return b.end_table();
+		}
+
+		std::vector<uint8_t> message(flat_builder& b, uint8_t header_type, flat_builder::ref header, int64_t body_length)
+		{
+			b.start_table();
+			b.field<int64_t>(3, body_length);
+			b.field_offset(2, header);
+			b.field<int16_t>(0, metadata_v5);
+			b.field<uint8_t>(1, header_type);
+			return b.finish(b.end_table());
+		}
+	} // namespace
+
+	void arrow_batch::add_view(const void* values, size_t value_bytes, const int32_t* offsets)
+	{
+		columns_.push_back({values, value_bytes, offsets});
+	}
+
+	void* arrow_batch::add_column(size_t value_bytes)
+	{
+		owned_.emplace_back(value_bytes);
+		void* values = owned_.back().data();
+		columns_.push_back({values, value_bytes, nullptr});
+		return values;
+	}
+
+	void arrow_batch::add_strings(const std::vector<std::string>& values)
+	{
+		owned_.emplace_back((length_ + 1) * sizeof(int32_t));
+		int32_t* offsets = reinterpret_cast<int32_t*>(owned_.back().data());
+		std::vector<uint8_t> text;
+		offsets[0] = 0;
+		for (size_t i = 0; i < length_; ++i)
+		{
+			const std::string& s = i < values.size() ? values[i] : std::string();
+			text.insert(text.end(), s.begin(), s.end());
+			offsets[i + 1] = static_cast<int32_t>(text.size());
+		}
+		owned_.push_back(std::move(text));
+		columns_.push_back({owned_.back().data(), owned_.back().size(), offsets});
+	}
+
+	void arrow_batch::add_bools(const bool* values)
+	{
+		// Arrow bitmaps are bit i of byte i / 8, which packed little-endian
+		// words already are
+		owned_.emplace_back(packed_words(length_) * sizeof(uint64_t));
+		pack_bools(values, length_, reinterpret_cast<uint64_t*>(owned_.back().data()));
+		columns_.push_back({owned_.back().data(), (length_ + 7) / 8, nullptr});
+	}
+
+	bool arrow_stream_writer::put(const void* data, size_t n)
+	{
+		out_.write(static_cast<const char*>(data), static_cast<std::streamsize>(n));
+		position_ += static_cast<int64_t>(n);
+		return static_cast<bool>(out_);
+	}
+
+	bool arrow_stream_writer::put_message(const std::vector<uint8_t>& metadata, const arrow_batch* body, int64_t body_length, block* where)
+	{
+		static const uint8_t zeros[8] = {};
+		const size_t padded = padded8(metadata.size());
+		const int32_t length = static_cast<int32_t>(padded);
+		if (where)
+		{
+			*where = block{position_, static_cast<int32_t>(padded + 8), body_length};
+		}
+		put(&continuation, sizeof(continuation));
+		put(&length, sizeof(length));
+		put(metadata.data(), metadata.size());
+		put(zeros, padded - metadata.size());
+		if (body)
+		{
+			for (const arrow_column& c : body->columns())
+			{
+				if (c.offsets)
+				{
+					const size_t n = (body->length() + 1) * sizeof(int32_t);
+					put(c.offsets, n);
+					put(zeros, padded8(n) - n);
+				}
+				put(c.values, c.value_bytes);
+				put(zeros, padded8(c.value_bytes) - c.value_bytes);
+			}
+		}
+		return static_cast<bool>(out_);
+	}
+
+	bool arrow_stream_writer::begin(const arrow_schema& schema)
+	{
+		schema_ = schema;
+		begun_ = true;
+		flat_builder b;
+		const flat_builder::ref header = schema_table(b, schema_);
+		return put_message(message(b, header_schema, header, 0), nullptr, 0, nullptr);
+	}
+
+	bool arrow_stream_writer::write(const arrow_batch& batch)
+	{
+		const std::vector<arrow_column>& columns = batch.columns();
+		if (!begun_ || columns.size() != schema_.fields.size())
+		{
+			return false;
+		}
+		const size_t length = batch.length();
+		std::vector<field_node> nodes;
+		std::vector<buffer_ref> buffers;
+		int64_t offset = 0;
+		auto add_buffer = [&](size_t n)
+		{
+			buffers.push_back({offset, static_cast<int64_t>(n)});
+			offset += static_cast<int64_t>(padded8(n));
+		};
+		for (size_t i = 0; i < columns.size(); ++i)
+		{
+			const arrow_column& c = columns[i];
+			const arrow_type type = schema_.fields[i].type;
+			if (type == arrow_type::utf8)
+			{
+				if (!c.offsets || static_cast<size_t>(c.offsets[length]) != c.value_bytes)
+				{
+					return false;
+				}
+			}
+			else if (c.offsets || c.value_bytes != expected_bytes(type, length))
+			{
+				return false;
+			}
+			nodes.push_back({static_cast<int64_t>(length), 0});
+			add_buffer(0); // no validity bitmap: nothing is null
+			if (c.offsets)
+			{
+				add_buffer((length + 1) * sizeof(int32_t));
+			}
+			add_buffer(c.value_bytes);
+		}
+
+		flat_builder b;
+		const flat_builder::ref node_vector = b.struct_vector(nodes.data(), nodes.size(), sizeof(field_node), alignof(int64_t));
+		const flat_builder::ref buffer_vector = b.struct_vector(buffers.data(), buffers.size(), sizeof(buffer_ref), alignof(int64_t));
+		b.start_table();
+		b.field<int64_t>(0, static_cast<int64_t>(length));
+		b.field_offset(1, node_vector);
+		b.field_offset(2, buffer_vector);
+		const flat_builder::ref header = b.end_table();
+		block where;
+		if (!put_message(message(b, header_record_batch, header, offset), &batch, offset, &where))
+		{
+			return false;
+		}
+		batches_.push_back(where);
+		return true;
+	}
+
+	bool arrow_stream_writer::end()
+	{
+		const uint32_t eos[2] = {continuation, 0};
+		put(eos, sizeof(eos));
+		out_.flush();
+		return static_cast<bool>(out_);
+	}
+
+	bool arrow_file_writer::open(const std::string& path, const arrow_schema& schema, std::string* error)
+	{
+		close();
+		file_.open(path, std::ios::binary | std::ios::trunc);
+		position_ = 0;
+		batches_.clear();
+		if (!file_ || !put(file_magic, sizeof(file_magic)) || !begin(schema))
+		{
+			if (error)
+			{
+				*error = path + ": cannot create";
+			}
+			file_.close();
+			return false;
+		}
+		return true;
+	}
+
+	bool arrow_file_writer::close()
+	{
+		if (!file_.is_open())
+		{
+			return true;
+		}
+		end();
+
+		std::vector<footer_block> blocks;
+		for (const block& w : batches_)
+		{
+			blocks.push_back({w.offset, w.metadata_length, 0, w.body_length});
+		}
+		flat_builder b;
+		const flat_builder::ref schema = schema_table(b, schema_);
+		const flat_builder::ref dictionaries = b.struct_vector(nullptr, 0, sizeof(footer_block), alignof(int64_t));
+		const flat_builder::ref record_batches = b.struct_vector(blocks.data(), blocks.size(), sizeof(footer_block), alignof(int64_t));
+		b.start_table();
+		b.field_offset(1, schema);
+		b.field_offset(2, dictionaries);
+		b.field_offset(3, record_batches);
+		b.field<int16_t>(0, metadata_v5);
+		const std::vector<uint8_t> footer = b.finish(b.end_table());
+		const int32_t footer_length = static_cast<int32_t>(footer.size());
+		put(footer.data(), footer.size());
+		put(&footer_length, sizeof(footer_length));
+		put(file_magic, 6);
+
+		const bool ok = static_cast<bool>(file_);
+		file_.close();
+		begun_ = false;
+		return ok;
+	}
+
+	arrow_schema samples_arrow_schema(const recording_header& header, const arrow_metadata& metadata)
+	{
+		arrow_schema schema;
+		schema.fields.push_back({"sample_number", arrow_type::uint64});
+		for (size_t n = 0; n < header.n_chans; ++n)
+		{
+			const std::string label = n < header.labels.size() ? header.labels[n] : std::string();
+			schema.fields.push_back({label.empty() ? "ch" + std::to_string(n) : label, arrow_type::float64});
+		}
+		std::ostringstream rate;
+		rate << header.sampling_rate;
+		schema.metadata.emplace_back("sampling_rate", rate.str());
+		schema.metadata.insert(schema.metadata.end(), metadata.begin(), metadata.end());
+		return schema;
+	}
+
+	arrow_batch samples_arrow_batch(const double* x, size_t n_chans, size_t stride, size_t n_samples, uint64_t first_sample)
+	{
+		arrow_batch batch(n_samples);
+		uint64_t* sample_numbers = static_cast<uint64_t*>(batch.add_column(n_samples * sizeof(uint64_t)));
+		for (size_t i = 0; i < n_samples; ++i)
+		{
+			sample_numbers[i] = first_sample + i;
+		}
+		for (size_t n = 0; n < n_chans; ++n)
+		{
+			batch.add_view(x + n * stride, n_samples * sizeof(double));
+		}
+		return batch;
+	}
+
+	arrow_schema annotations_arrow_schema(const arrow_metadata& metadata)
+	{
+		arrow_schema schema;
+		schema.fields.push_back({"sample", arrow_type::uint64});
+		schema.fields.push_back({"text", arrow_type::utf8});
+		schema.metadata = metadata;
+		return schema;
+	}
+
+	arrow_batch annotations_arrow_batch(const std::vector<stream_annotation>& annotations)
+	{
+		arrow_batch batch(annotations.size());
+		uint64_t* samples = static_cast<uint64_t*>(batch.add_column(annotations.size() * sizeof(uint64_t)));
+		std::vector<std::string> texts;
+		texts.reserve(annotations.size());
+		for (size_t i = 0; i < annotations.size(); ++i)
+		{
+			samples[i] = annotations[i].sample;
+			texts.push_back(annotations[i].text);
+		}
+		batch.add_strings(texts);
+		return batch;
+	}
+
+	arrow_metadata device_arrow_metadata(const ba_device_info& info)
+	{
+		auto version = [](const ba_version& v)
+		{
+			return std::to_string(v.major) + "." + std::to_string(v.minor) + "." + std::to_string(v.patch);
+		};
+		return {
+			{"device_model", std::to_string(info.id)},
+			{"hardware_version", version(info.hardware_version)},
+			{"firmware_version", version(info.firmware_version)},
+			{"serial_number", std::to_string(info.serial_number)},
+			{"samples_per_packet", std::to_string(info.sample_per_packet)},
+		};
+	}
+} // namespace eeg
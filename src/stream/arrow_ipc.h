@@ -0,0 +1,214 @@
+/**
+ * @file arrow_ipc.h
+ * @brief Apache Arrow record batches and IPC stream and file writers
+ */
+
+#pragma once
+
+#include "device_info.h"
+#include "stream/annotation_store.h"
+#include "stream/recording.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace eeg
+{
+	/**
+	 * @brief Column types written; all columns are non-nullable
+	 */
+	enum class arrow_type : uint8_t
+	{
+		boolean, ///< Bitmap, bit i of byte i / 8 (as `pack_bools()` produces)
+		int32,
+		uint64,
+		float32,
+		float64,
+		utf8, ///< int32 offsets, `length + 1` of them, into UTF-8 bytes
+	};
+
+	struct arrow_field
+	{
+		std::string name;
+		arrow_type type = arrow_type::float64;
+	};
+
+	using arrow_metadata = std::vector<std::pair<std::string, std::string>>;
+
+	/**
+	 * @brief Columns of a stream or file, with key-value metadata such as
+	 * the sampling rate and device
+	 */
+	struct arrow_schema
+	{
+		std::vector<arrow_field> fields;
+		arrow_metadata metadata;
+	};
+
+	/**
+	 * @brief Buffers of one column of a record batch
+	 */
+	struct arrow_column
+	{
+		const void* values = nullptr; ///< Fixed-width values, a bitmap or UTF-8 bytes
+		size_t value_bytes = 0;
+		const int32_t* offsets = nullptr; ///< utf8 columns only
+	};
+
+	/**
+	 * @brief Record batch whose columns point at existing memory where its
+	 * layout already matches Arrow's
+	 *
+	 * @details A channel of a channel-major block is exactly an Arrow
+	 * float64 column, so `add_view()` references it and the writers copy
+	 * it straight to the output: nothing is converted or gathered into an
+	 * intermediate buffer. Columns with no such layout in memory, such as
+	 * sample numbers kept as a first value and gaps, are built by the
+	 * `add_*` functions and owned by the batch. Views must outlive the
+	 * writes of the batch.
+	 */
+	class arrow_batch
+	{
+	public:
+		explicit arrow_batch(size_t length = 0) : length_(length) {}
+
+		size_t length() const { return length_; }
+		const std::vector<arrow_column>& columns() const { return columns_; }
+
+		/**
+		 * @brief Adds a column over existing buffers, without copying
+		 */
+		void add_view(const void* values, size_t value_bytes, const int32_t* offsets = nullptr);
+
+		/**
+		 * @brief Adds a zeroed column owned by the batch
+		 *
+		 * @return The column's values, to be filled in
+		 */
+		void* add_column(size_t value_bytes);
+
+		void add_strings(const std::vector<std::string>& values);
+
+		/**
+		 * @brief Adds a boolean column of `length()` values, packed into bits
+		 */
+		void add_bools(const bool* values);
+
+	private:
+		size_t length_;
+		std::vector<arrow_column> columns_;
+		std::deque<std::vector<uint8_t>> owned_; ///< Built columns; a deque so their buffers never move
+	};
+
+	/**
+	 * @brief Encapsulated-message writer for the Arrow IPC streaming format
+	 *
+	 * @details Writes a schema message, then one message per record batch
+	 * and an end-of-stream marker, to any `std::ostream` such as a pipe or
+	 * socket stream. Metadata is encoded with a minimal built-in
+	 * flatbuffers encoder, so there is no dependency on the Arrow or
+	 * flatbuffers libraries. Values are written in native byte order and
+	 * the schema declares little-endian.
+	 */
+	class arrow_stream_writer
+	{
+	public:
+		explicit arrow_stream_writer(std::ostream& out) : out_(out) {}
+
+		bool begin(const arrow_schema& schema);
+
+		/**
+		 * @return false if the batch does not match the schema's columns or
+		 * the write failed
+		 */
+		bool write(const arrow_batch& batch);
+
+		/**
+		 * @brief Writes the end-of-stream marker and flushes
+		 */
+		bool end();
+
+	protected:
+		/**
+		 * Where a message went, for the file footer.
+		 */
+		struct block
+		{
+			int64_t offset = 0;
+			int32_t metadata_length = 0;
+			int64_t body_length = 0;
+		};
+
+		bool put(const void* data, size_t n);
+
+		/**
+		 * Writes a flatbuffer message, padded to 8 bytes, and the batch's
+		 * buffers as its body.
+		 */
+		bool put_message(const std::vector<uint8_t>& metadata, const arrow_batch* body, int64_t body_length, block* where);
+
+		std::ostream& out_;
+		arrow_schema schema_;
+		bool begun_ = false;
+		int64_t position_ = 0; ///< Bytes written since the stream began
+		std::vector<block> batches_;
+	};
+
+	/**
+	 * @brief Writer for the Arrow IPC file format ("Feather v2"): the
+	 * streaming format between `ARROW1` magic bytes, followed by a footer
+	 * indexing the record batches for random access and memory mapping
+	 */
+	class arrow_file_writer : public arrow_stream_writer
+	{
+	public:
+		arrow_file_writer() : arrow_stream_writer(file_) {}
+		~arrow_file_writer() { close(); }
+		arrow_file_writer(const arrow_file_writer&) = delete;
+		arrow_file_writer& operator=(const arrow_file_writer&) = delete;
+
+		bool open(const std::string& path, const arrow_schema& schema, std::string* error = nullptr);
+
+		/**
+		 * @brief Writes the footer and closes the file
+		 */
+		bool close();
+
+	private:
+		std::ofstream file_;
+	};
+
+	/**
+	 * @brief Schema of `samples_arrow_batch()`: a uint64 `sample_number`
+	 * column, then a float64 column per channel named by its label (`ch<n>`
+	 * when empty), with the sampling rate in the metadata
+	 */
+	arrow_schema samples_arrow_schema(const recording_header& header, const arrow_metadata& metadata = {});
+
+	/**
+	 * @brief Record batch of `n_samples` samples of a channel-major block
+	 * (channel n at `x[n * stride]`) with consecutive sample numbers from
+	 * `first_sample`; the channels are referenced in place
+	 */
+	arrow_batch samples_arrow_batch(const double* x, size_t n_chans, size_t stride, size_t n_samples, uint64_t first_sample);
+
+	/**
+	 * @brief Schema of `annotations_arrow_batch()`: uint64 `sample` and utf8
+	 * `text`
+	 */
+	arrow_schema annotations_arrow_schema(const arrow_metadata& metadata = {});
+
+	arrow_batch annotations_arrow_batch(const std::vector<stream_annotation>& annotations);
+
+	/**
+	 * @brief Model, versions, serial number and samples per packet of a
+	 * device as schema metadata
+	 */
+	arrow_metadata device_arrow_metadata(const ba_device_info& info);
+} // namespace eeg
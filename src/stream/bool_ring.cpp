@@ -0,0 +1,136 @@
+#include "stream/bool_ring.h"
+
+#include "util/bit_pack.h"
+
+#include <algorithm>
+
+namespace eeg
+{
+	bool_ring::bool_ring(size_t n_chans, size_t capacity, memory_owner owner)
+		: n_chans_(n_chans), capacity_(packed_words(capacity) * 64), words_per_chan_(packed_words(capacity)),
+		  words_(n_chans * packed_words(capacity), tracked_allocator<std::atomic<uint64_t>>(owner, memory_category::ring_buffers))
+	{
+	}
+
+	size_t bool_ring::write(const bool* const* channels, size_t n)
+	{
+		const uint64_t w = write_pos_.load(std::memory_order_relaxed);
+		const uint64_t r = read_pos_.load(std::memory_order_acquire);
+		const size_t space = capacity_ - static_cast<size_t>(w - r);
+		const size_t count = std::min(n, space);
+		if (count < n)
+		{
+			dropped_.fetch_add(n - count, std::memory_order_relaxed);
+		}
+
+		for (size_t c = 0; c < n_chans_; ++c)
+		{
+			std::atomic<uint64_t>* dst = words_.data() + c * words_per_chan_;
+			// Pack up to 64 samples into a local word and merge it into the
+			// one or two ring words it lands on
+			for (size_t i = 0; i < count; i += 64)
+			{
+				const size_t piece = std::min<size_t>(64, count - i);
+				uint64_t packed = 0;
+				pack_bools(channels[c] + i, piece, &packed);
+				size_t pos = static_cast<size_t>((w + i) % capacity_);
+				size_t done = 0;
+				while (done < piece)
+				{
+					const size_t shift = pos % 64;
+					const size_t take = std::min(piece - done, 64 - shift);
+					const uint64_t mask = (take == 64 ? ~uint64_t(0) : (uint64_t(1) << take) - 1) << shift;
+					std::atomic<uint64_t>& word = dst[pos / 64];
+					const uint64_t old = word.load(std::memory_order_relaxed);
+					word.store((old & ~mask) | (((packed >> done) << shift) & mask), std::memory_order_relaxed);
+					done += take;
+					pos = (pos + take) % capacity_;
+				}
+			}
+		}
+
+		write_pos_.store(w + count, std::memory_order_release);
+		return count;
+	}
+
+	size_t bool_ring::available() const
+	{
+		return static_cast<size_t>(write_pos_.load(std::memory_order_acquire) - read_pos_.load(std::memory_order_relaxed));
+	}
+
+	template <typename F>
+	bool bool_ring::for_each_word(size_t channel, size_t n, size_t offset, F f) const
+	{
+		if (available() < offset + n)
+		{
+			return false;
+		}
+		const std::atomic<uint64_t>* src = words_.data() + channel * words_per_chan_;
+		size_t pos = static_cast<size_t>((read_pos_.load(std::memory_order_relaxed) + offset) % capacity_);
+		size_t done = 0;
+		while (done < n)
+		{
+			const size_t from = pos % 64;
+			const size_t to = std::min<size_t>(64, from + n - done);
+			if (!f(src[pos / 64].load(std::memory_order_relaxed), from, to, done))
+			{
+				break;
+			}
+			done += to - from;
+			pos = (pos + to - from) % capacity_;
+		}
+		return true;
+	}
+
+	bool bool_ring::peek(bool* out, size_t n, size_t offset) const
+	{
+		if (available() < offset + n)
+		{
+			return false;
+		}
+		for (size_t c = 0; c < n_chans_; ++c)
+		{
+			bool* dst = out + c * n;
+			for_each_word(c, n, offset, [dst](uint64_t word, size_t from, size_t to, size_t done) {
+				unpack_bools(&word, from, to - from, dst + done);
+				return true;
+			});
+		}
+		return true;
+	}
+
+	bool bool_ring::skip(size_t n)
+	{
+		if (available() < n)
+		{
+			return false;
+		}
+		read_pos_.fetch_add(n, std::memory_order_release);
+		return true;
+	}
+
+	bool bool_ring::read(bool* out, size_t n)
+	{
+		return peek(out, n) && skip(n);
+	}
+
+	size_t bool_ring::count_set(size_t channel, size_t n, size_t offset) const
+	{
+		size_t count = 0;
+		for_each_word(channel, n, offset, [&count](uint64_t word, size_t from, size_t to, size_t) {
+			count += eeg::count_set(&word, from, to);
+			return true;
+		});
+		return count;
+	}
+
+	bool bool_ring::all_set(size_t channel, size_t n, size_t offset) const
+	{
+		bool all = true;
+		const bool ok = for_each_word(channel, n, offset, [&all](uint64_t word, size_t from, size_t to, size_t) {
+			all = eeg::all_set(&word, from, to);
+			return all;
+		});
+		return ok && all;
+	}
+} // namespace eeg
@@ -0,0 +1,123 @@
+/**
+ * @file bool_ring.h
+ * @brief Bit-packed ring for `bool` chunk channels
+ */
+
+#pragma once
+
+#include "util/memory_accounting.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace eeg
+{
+	/**
+	 * @brief Single-producer, single-consumer ring of `bool` channels stored
+	 * one bit per sample
+	 *
+	 * @details Opt-in counterpart of `stream_ring` for the contact, digital
+	 * input and streaming channels, which the chunk callback delivers as one
+	 * `bool` byte per sample: a 32-channel bipolar device has 64 contact
+	 * channels, as many bytes per sample as eight `double` electrodes, and
+	 * this keeps them in 8 bytes. Channel c is a bit stream of `capacity()`
+	 * bits in 64-bit words (see bit_pack.h).
+	 *
+	 * Writing follows `stream_ring`: it never blocks, and samples that do not
+	 * fit are dropped and counted. The producer updates whole words while the
+	 * consumer may be reading other bits of them, so words are atomics
+	 * accessed with relaxed ordering, ordered by the read and write
+	 * positions.
+	 *
+	 * `count_set()` and `all_set()` answer window questions such as "was
+	 * every contact good over the last second" with a popcount per 64
+	 * samples instead of reading each sample.
+	 */
+	class bool_ring
+	{
+	public:
+		/**
+		 * @param capacity Samples per channel, rounded up to a multiple of 64
+		 * @param owner Manager the ring's memory is accounted to under
+		 * `memory_category::ring_buffers`
+		 */
+		bool_ring(size_t n_chans, size_t capacity, memory_owner owner = nullptr);
+
+		size_t n_chans() const { return n_chans_; }
+		size_t capacity() const { return capacity_; }
+
+		/**
+		 * @brief Ring memory in bytes, for comparison with a byte per sample
+		 */
+		size_t bytes() const { return words_.size() * sizeof(uint64_t); }
+
+		/**
+		 * @brief Appends `n` samples per channel (producer side)
+		 *
+		 * @param channels `n_chans()` pointers, each to `n` values
+		 * @return Samples stored; fewer than `n` when the ring is full
+		 */
+		size_t write(const bool* const* channels, size_t n);
+
+		/**
+		 * @brief Samples ready to be read (consumer side)
+		 */
+		size_t available() const;
+
+		/**
+		 * @brief Expands `n` samples starting `offset` samples after the read
+		 * position into a channel-major block (channel c at `out[c * n]`)
+		 * without consuming them
+		 *
+		 * @return false if fewer than `offset + n` samples are available
+		 */
+		bool peek(bool* out, size_t n, size_t offset = 0) const;
+
+		/**
+		 * @brief Consumes `n` samples; false if fewer are available
+		 */
+		bool skip(size_t n);
+
+		/**
+		 * @brief `peek` followed by `skip`
+		 */
+		bool read(bool* out, size_t n);
+
+		/**
+		 * @brief Samples of `channel` that are true among `n` samples
+		 * starting `offset` samples after the read position
+		 *
+		 * @return 0 if fewer than `offset + n` samples are available
+		 */
+		size_t count_set(size_t channel, size_t n, size_t offset = 0) const;
+
+		/**
+		 * @brief True if `channel` is true over the whole window; false if
+		 * fewer than `offset + n` samples are available
+		 */
+		bool all_set(size_t channel, size_t n, size_t offset = 0) const;
+
+		uint64_t total_written() const { return write_pos_.load(std::memory_order_acquire); }
+		uint64_t total_read() const { return read_pos_.load(std::memory_order_acquire); }
+		uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+	private:
+		/**
+		 * Calls `f(word, from, to, done)` for each word of `channel` holding
+		 * the window, with `[from, to)` the window's bits in the word and
+		 * `done` the window samples before them; stops when `f` returns
+		 * false. False if the window is not available.
+		 */
+		template <typename F>
+		bool for_each_word(size_t channel, size_t n, size_t offset, F f) const;
+
+		size_t n_chans_;
+		size_t capacity_;
+		size_t words_per_chan_;
+		tracked_vector<std::atomic<uint64_t>> words_; ///< Channel c occupies words [c * words_per_chan, (c + 1) * words_per_chan)
+		std::atomic<uint64_t> write_pos_{0};
+		std::atomic<uint64_t> read_pos_{0};
+		std::atomic<uint64_t> dropped_{0};
+	};
+} // namespace eeg
@@ -0,0 +1,209 @@
+#include "stream/chunk_controller.h"
+
+#include "util/json_writer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace eeg
+{
+	namespace
+	{
+		constexpr uint64_t warmup_blocks = 5;
+
+		std::string format(const char* fmt, double a, double b = 0, double c = 0)
+		{
+			char buf[160];
+			std::snprintf(buf, sizeof(buf), fmt, a, b, c);
+			return buf;
+		}
+	} // namespace
+
+	chunk_controller::chunk_controller(const chunk_controller_config& config) : config_(config)
+	{
+		config_.min_chunk = std::max<size_t>(1, config_.min_chunk);
+		config_.max_chunk = std::max(config_.min_chunk, config_.max_chunk);
+		metrics_.chunk_size = std::min(std::max(config_.initial_chunk, config_.min_chunk), config_.max_chunk);
+		metrics_.latency_target_ms = config_.latency_target_ms;
+		metrics_.rationale = "initial chunk size, waiting for measurements";
+	}
+
+	void chunk_controller::record_callback(double ns)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		callback_ns_ = have_callback_ ? callback_ns_ + config_.smoothing * (ns - callback_ns_) : ns;
+		have_callback_ = true;
+	}
+
+	void chunk_controller::record_block(size_t n_samples, double processing_ns, double queue_ns)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		const double s = config_.smoothing;
+		const double x = static_cast<double>(n_samples);
+		w_ = (1 - s) * w_ + s;
+		sx_ = (1 - s) * sx_ + s * x;
+		sy_ = (1 - s) * sy_ + s * processing_ns;
+		sxx_ = (1 - s) * sxx_ + s * x * x;
+		sxy_ = (1 - s) * sxy_ + s * x * processing_ns;
+		queue_ns_ = have_queue_ ? queue_ns_ + s * (queue_ns - queue_ns_) : queue_ns;
+		have_queue_ = true;
+		++metrics_.blocks_observed;
+		++blocks_since_change_;
+	}
+
+	double chunk_controller::processing_ns(size_t n) const
+	{
+		if (w_ <= 0)
+		{
+			return 0;
+		}
+		const double mx = sx_ / w_;
+		const double my = sy_ / w_;
+		const double var = sxx_ / w_ - mx * mx;
+		const double x = static_cast<double>(n);
+		if (var > 0.01 * mx * mx)
+		{
+			const double b = (sxy_ / w_ - mx * my) / var;
+			const double a = my - b * mx;
+			if (a >= 0 && b >= 0)
+			{
+				return a + b * x;
+			}
+		}
+		// Only one chunk size observed so far, so fixed and per-sample cost
+		// cannot be told apart: assume whichever is worse for this n
+		return my * std::max(1.0, x / std::max(mx, 1.0));
+	}
+
+	double chunk_controller::predicted_latency_ms(size_t n) const
+	{
+		const double fill_ms = 1e3 * static_cast<double>(n) / config_.sampling_rate;
+		return fill_ms + queue_ns_ * 1e-6 + processing_ns(n) * 1e-6;
+	}
+
+	double chunk_controller::consumer_load(size_t n) const
+	{
+		return processing_ns(n) * 1e-9 * config_.sampling_rate / static_cast<double>(n);
+	}
+
+	bool chunk_controller::update()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (metrics_.blocks_observed < warmup_blocks)
+		{
+			refresh_metrics();
+			return false;
+		}
+
+		const double budget = config_.latency_target_ms * (1 - config_.headroom);
+		const size_t current = metrics_.chunk_size;
+
+		size_t n = 0;
+		for (size_t k = config_.max_chunk; k >= config_.min_chunk; --k)
+		{
+			if (predicted_latency_ms(k) <= budget)
+			{
+				n = k;
+				break;
+			}
+		}
+
+		std::string rationale;
+		if (n == 0)
+		{
+			n = config_.min_chunk;
+			rationale = format("latency target unreachable: smallest chunk predicts %.1f ms against a %.1f ms budget", predicted_latency_ms(n),
+							   budget);
+		}
+		else
+		{
+			rationale = format("largest chunk meeting the %.1f ms budget (predicted %.1f ms)", budget, predicted_latency_ms(n));
+		}
+
+		if (consumer_load(n) > config_.max_consumer_load)
+		{
+			size_t k = n;
+			while (k < config_.max_chunk && consumer_load(k) > config_.max_consumer_load)
+			{
+				++k;
+			}
+			n = k;
+			rationale = consumer_load(n) > config_.max_consumer_load
+							? format("consumer saturated: load %.2f even at the largest chunk", consumer_load(n))
+							: format("consumer load limits chunk to >= %.0f samples (load %.2f), latency target not met", static_cast<double>(n),
+									 consumer_load(n));
+		}
+
+		// Hysteresis: keep a chunk that still satisfies the constraints unless
+		// the better choice differs enough and enough blocks have passed
+		const bool current_ok = predicted_latency_ms(current) <= budget && consumer_load(current) <= config_.max_consumer_load;
+		const double change = std::fabs(static_cast<double>(n) - static_cast<double>(current)) / static_cast<double>(current);
+		bool changed = false;
+		if (n != current && (!current_ok || (change >= config_.min_change && blocks_since_change_ >= config_.min_blocks_between_changes)))
+		{
+			metrics_.chunk_size = n;
+			++metrics_.adjustments;
+			blocks_since_change_ = 0;
+			changed = true;
+		}
+		else if (n != current)
+		{
+			rationale = "within hysteresis of " + std::to_string(n) + ", the " + rationale;
+		}
+		metrics_.rationale = rationale;
+		refresh_metrics();
+		return changed;
+	}
+
+	void chunk_controller::refresh_metrics()
+	{
+		const size_t n = metrics_.chunk_size;
+		metrics_.fill_ms = 1e3 * static_cast<double>(n) / config_.sampling_rate;
+		metrics_.queue_ms = queue_ns_ * 1e-6;
+		metrics_.processing_ms = processing_ns(n) * 1e-6;
+		metrics_.predicted_latency_ms = predicted_latency_ms(n);
+		metrics_.callback_us = callback_ns_ * 1e-3;
+		metrics_.consumer_load = consumer_load(n);
+
+		// Fixed per-chunk cost: the callback plus the intercept of the fit
+		const double per_sample = processing_ns(n + 1) - processing_ns(n);
+		const double fixed_ns = callback_ns_ + std::max(0.0, processing_ns(n) - per_sample * static_cast<double>(n));
+		metrics_.overhead_share = fixed_ns * 1e-9 * config_.sampling_rate / static_cast<double>(n);
+	}
+
+	size_t chunk_controller::chunk_size() const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return metrics_.chunk_size;
+	}
+
+	chunk_controller_metrics chunk_controller::metrics() const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return metrics_;
+	}
+
+	ba_init_error chunk_controller::apply_to_core() const
+	{
+		return ba_core_config_set_chunk_size(static_cast<int>(chunk_size()));
+	}
+
+	void write_chunk_metrics(json_writer& w, const chunk_controller_metrics& m)
+	{
+		w.begin_object();
+		w.member("chunk_size", static_cast<uint64_t>(m.chunk_size));
+		w.member("latency_target_ms", m.latency_target_ms);
+		w.member("predicted_latency_ms", m.predicted_latency_ms);
+		w.member("fill_ms", m.fill_ms);
+		w.member("queue_ms", m.queue_ms);
+		w.member("processing_ms", m.processing_ms);
+		w.member("callback_us", m.callback_us);
+		w.member("consumer_load", m.consumer_load);
+		w.member("overhead_share", m.overhead_share);
+		w.member("blocks_observed", m.blocks_observed);
+		w.member("adjustments", m.adjustments);
+		w.member("rationale", m.rationale);
+		w.end_object();
+	}
+} // namespace eeg
@@ -0,0 +1,137 @@
+/**
+ * @file chunk_controller.h
+ * @brief Adaptive chunk size selection against a latency target
+ */
+
+#pragma once
+
+#include "bacore.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace eeg
+{
+	class json_writer;
+
+	struct chunk_controller_config
+	{
+		double sampling_rate = 250;
+		double latency_target_ms = 100; ///< Sample arrival to end of processing
+		size_t min_chunk = 1;
+		size_t max_chunk = 250;
+		size_t initial_chunk = BA_CONFIG_DEFAULT_CHUNK_SIZE;
+		double max_consumer_load = 0.8; ///< Share of one core the consumer may use
+		double headroom = 0.2;          ///< Share of the target kept free for jitter
+		double smoothing = 0.05;        ///< Weight of each new measurement
+		double min_change = 0.2;        ///< Relative change needed before switching
+		size_t min_blocks_between_changes = 20;
+	};
+
+	/**
+	 * @brief Current decision and the measurements behind it
+	 */
+	struct chunk_controller_metrics
+	{
+		size_t chunk_size = 0;
+		double latency_target_ms = 0;
+		double predicted_latency_ms = 0; ///< Fill time plus queueing plus processing at `chunk_size`
+		double fill_ms = 0;              ///< Time to collect a chunk at the sampling rate
+		double queue_ms = 0;             ///< Smoothed wait between chunk completion and processing start
+		double processing_ms = 0;        ///< Predicted processing time of one chunk
+		double callback_us = 0;          ///< Smoothed cost of one chunk callback
+		double consumer_load = 0;        ///< Predicted share of a core spent processing
+		double overhead_share = 0;       ///< Predicted share of a core spent on fixed per-chunk costs
+		uint64_t blocks_observed = 0;
+		uint64_t adjustments = 0;
+		std::string rationale;
+	};
+
+	/**
+	 * @brief Chooses the chunk size that meets a latency target with the
+	 * least per-chunk overhead
+	 *
+	 * @details Small chunks cut latency but multiply the fixed cost paid per
+	 * chunk (callback, locking, per-block processing setup); large chunks do
+	 * the opposite. The controller models processing time as `a + b * n`
+	 * from the blocks it observes, adds the fill time `n / fs` and the
+	 * observed queueing, and picks the largest chunk whose predicted latency
+	 * stays within the target minus headroom. If even that chunk would load
+	 * the consumer beyond `max_consumer_load`, it grows the chunk until the
+	 * load fits and reports that the target cannot be met.
+	 *
+	 * `ba_core_config_set_chunk_size` only takes effect before streaming, so
+	 * the decision applies live to application-side blocking (the hop at
+	 * which a `stream_ring` is consumed) and to the core through
+	 * `apply_to_core()` at the next stream start.
+	 *
+	 * Thread-safe: callbacks and consumers may record concurrently.
+	 */
+	class chunk_controller
+	{
+	public:
+		explicit chunk_controller(const chunk_controller_config& config);
+
+		/**
+		 * @brief Records the cost of one chunk callback (producer side)
+		 */
+		void record_callback(double ns);
+
+		/**
+		 * @brief Records one processed block (consumer side)
+		 *
+		 * @param n_samples Samples per channel in the block
+		 * @param processing_ns Time spent processing it
+		 * @param queue_ns Time between the block becoming complete and its
+		 * processing starting
+		 */
+		void record_block(size_t n_samples, double processing_ns, double queue_ns);
+
+		/**
+		 * @brief Re-evaluates the decision
+		 *
+		 * @return true if `chunk_size()` changed
+		 */
+		bool update();
+
+		size_t chunk_size() const;
+		chunk_controller_metrics metrics() const;
+
+		/**
+		 * @brief Sets the core chunk size to the current decision; call after
+		 * `ba_core_init()` and before starting a stream
+		 */
+		ba_init_error apply_to_core() const;
+
+	private:
+		double processing_ns(size_t n) const;
+		double predicted_latency_ms(size_t n) const;
+		double consumer_load(size_t n) const;
+		void refresh_metrics();
+
+		chunk_controller_config config_;
+		mutable std::mutex mutex_;
+
+		// Exponentially weighted sums for the a + b * n processing fit
+		double w_ = 0;
+		double sx_ = 0;
+		double sy_ = 0;
+		double sxx_ = 0;
+		double sxy_ = 0;
+
+		double callback_ns_ = 0;
+		double queue_ns_ = 0;
+		bool have_callback_ = false;
+		bool have_queue_ = false;
+		uint64_t blocks_since_change_ = 0;
+
+		chunk_controller_metrics metrics_;
+	};
+
+	/**
+	 * @brief Writes controller metrics as a JSON object
+	 */
+	void write_chunk_metrics(json_writer& w, const chunk_controller_metrics& m);
+} // namespace eeg
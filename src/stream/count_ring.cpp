@@ -0,0 +1,96 @@
+#include "stream/count_ring.h"
+
+#include "stream/adc_counts.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace eeg
+{
+	count_ring::count_ring(std::vector<double> scales, size_t capacity, memory_owner owner)
+		: scales_(std::move(scales)), capacity_(capacity),
+		  data_(scales_.size() * capacity, tracked_allocator<int32_t>(owner, memory_category::ring_buffers))
+	{
+	}
+
+	size_t count_ring::write(const double* const* channels, size_t n)
+	{
+		const uint64_t w = write_pos_.load(std::memory_order_relaxed);
+		const uint64_t r = read_pos_.load(std::memory_order_acquire);
+		const size_t space = capacity_ - static_cast<size_t>(w - r);
+		const size_t count = std::min(n, space);
+		if (count < n)
+		{
+			dropped_.fetch_add(n - count, std::memory_order_relaxed);
+		}
+
+		const size_t start = static_cast<size_t>(w % capacity_);
+		const size_t first = std::min(count, capacity_ - start);
+		for (size_t c = 0; c < scales_.size(); ++c)
+		{
+			int32_t* dst = data_.data() + c * capacity_;
+			to_counts(channels[c], first, scales_[c], dst + start);
+			to_counts(channels[c] + first, count - first, scales_[c], dst);
+		}
+
+		write_pos_.store(w + count, std::memory_order_release);
+		return count;
+	}
+
+	size_t count_ring::available() const
+	{
+		return static_cast<size_t>(write_pos_.load(std::memory_order_acquire) - read_pos_.load(std::memory_order_relaxed));
+	}
+
+	bool count_ring::peek(double* out, size_t n, size_t offset) const
+	{
+		if (available() < offset + n)
+		{
+			return false;
+		}
+
+		const size_t start = static_cast<size_t>((read_pos_.load(std::memory_order_relaxed) + offset) % capacity_);
+		const size_t first = std::min(n, capacity_ - start);
+		for (size_t c = 0; c < scales_.size(); ++c)
+		{
+			const int32_t* src = data_.data() + c * capacity_;
+			from_counts(src + start, first, scales_[c], out + c * n);
+			from_counts(src, n - first, scales_[c], out + c * n + first);
+		}
+		return true;
+	}
+
+	bool count_ring::peek_counts(int32_t* out, size_t n, size_t offset) const
+	{
+		if (available() < offset + n)
+		{
+			return false;
+		}
+
+		const size_t start = static_cast<size_t>((read_pos_.load(std::memory_order_relaxed) + offset) % capacity_);
+		const size_t first = std::min(n, capacity_ - start);
+		for (size_t c = 0; c < scales_.size(); ++c)
+		{
+			const int32_t* src = data_.data() + c * capacity_;
+			std::memcpy(out + c * n, src + start, first * sizeof(int32_t));
+			std::memcpy(out + c * n + first, src, (n - first) * sizeof(int32_t));
+		}
+		return true;
+	}
+
+	bool count_ring::skip(size_t n)
+	{
+		if (available() < n)
+		{
+			return false;
+		}
+		read_pos_.fetch_add(n, std::memory_order_release);
+		return true;
+	}
+
+	bool count_ring::read(double* out, size_t n)
+	{
+		return peek(out, n) && skip(n);
+	}
+} // namespace eeg
@@ -0,0 +1,92 @@
+/**
+ * @file count_ring.h
+ * @brief Multichannel sample ring stored as int32 ADC counts
+ */
+
+#pragma once
+
+#include "util/memory_accounting.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace eeg
+{
+	/**
+	 * @brief Single-producer, single-consumer ring with the interface of
+	 * `stream_ring`, storing each sample as an int32 count of its channel's
+	 * scale
+	 *
+	 * @details Opt-in alternative to `stream_ring` for electrode channels,
+	 * using half the memory. Writes round each value to a count with
+	 * `to_counts()`; reads scale back with `from_counts()`, so the
+	 * conversion is paid once per sample read rather than stored. With
+	 * scales from `adc_microvolts_per_count()` the round trip is exact for
+	 * samples from the device. A scale of 1 keeps integer channels such as
+	 * the sample number exact below 2^31.
+	 */
+	class count_ring
+	{
+	public:
+		/**
+		 * @param scales One per channel, > 0
+		 * @param owner Manager the ring's memory is accounted to under
+		 * `memory_category::ring_buffers`
+		 */
+		count_ring(std::vector<double> scales, size_t capacity, memory_owner owner = nullptr);
+
+		size_t n_chans() const { return scales_.size(); }
+		size_t capacity() const { return capacity_; }
+		const std::vector<double>& scales() const { return scales_; }
+
+		/**
+		 * @brief Appends `n` samples per channel (producer side)
+		 *
+		 * @param channels `n_chans()` pointers, each to `n` values
+		 * @return Samples stored; fewer than `n` when the ring is full
+		 */
+		size_t write(const double* const* channels, size_t n);
+
+		/**
+		 * @brief Samples ready to be read (consumer side)
+		 */
+		size_t available() const;
+
+		/**
+		 * @brief Scales `n` samples starting `offset` samples after the read
+		 * position into a channel-major block without consuming them
+		 *
+		 * @return false if fewer than `offset + n` samples are available
+		 */
+		bool peek(double* out, size_t n, size_t offset = 0) const;
+
+		/**
+		 * @brief As `peek()`, copying the counts unscaled
+		 */
+		bool peek_counts(int32_t* out, size_t n, size_t offset = 0) const;
+
+		/**
+		 * @brief Consumes `n` samples; false if fewer are available
+		 */
+		bool skip(size_t n);
+
+		/**
+		 * @brief `peek` followed by `skip`
+		 */
+		bool read(double* out, size_t n);
+
+		uint64_t total_written() const { return write_pos_.load(std::memory_order_acquire); }
+		uint64_t total_read() const { return read_pos_.load(std::memory_order_acquire); }
+		uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+	private:
+		std::vector<double> scales_;
+		size_t capacity_;
+		tracked_vector<int32_t> data_; ///< Channel c occupies [c * capacity, (c + 1) * capacity)
+		std::atomic<uint64_t> write_pos_{0};
+		std::atomic<uint64_t> read_pos_{0};
+		std::atomic<uint64_t> dropped_{0};
+	};
+} // namespace eeg
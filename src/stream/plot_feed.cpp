@@ -0,0 +1,198 @@
+#include "stream/plot_feed.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace eeg
+{
+	namespace
+	{
+		uint64_t pack(float min, float max)
+		{
+			uint32_t lo = 0;
+			uint32_t hi = 0;
+			std::memcpy(&lo, &min, sizeof(lo));
+			std::memcpy(&hi, &max, sizeof(hi));
+			return static_cast<uint64_t>(lo) | (static_cast<uint64_t>(hi) << 32);
+		}
+
+		plot_bin unpack(uint64_t v)
+		{
+			const uint32_t lo = static_cast<uint32_t>(v);
+			const uint32_t hi = static_cast<uint32_t>(v >> 32);
+			plot_bin b;
+			std::memcpy(&b.min, &lo, sizeof(lo));
+			std::memcpy(&b.max, &hi, sizeof(hi));
+			return b;
+		}
+
+		std::vector<size_t> nested(std::vector<size_t> sizes)
+		{
+			sizes.erase(std::remove(sizes.begin(), sizes.end(), size_t{0}), sizes.end());
+			if (sizes.empty())
+			{
+				sizes.push_back(1);
+			}
+			std::sort(sizes.begin(), sizes.end());
+			for (size_t i = 1; i < sizes.size(); ++i)
+			{
+				const size_t below = sizes[i - 1];
+				sizes[i] = std::max(below, (sizes[i] + below - 1) / below * below);
+			}
+			sizes.erase(std::unique(sizes.begin(), sizes.end()), sizes.end());
+			return sizes;
+		}
+	} // namespace
+
+	plot_feed::plot_feed(size_t n_chans, std::vector<size_t> bin_sizes, size_t history, memory_owner owner)
+		: n_chans_(n_chans), bin_sizes_(nested(std::move(bin_sizes))), history_(std::max<size_t>(history, 1)),
+		  bins_(bin_sizes_.size() * n_chans * history_, tracked_allocator<std::atomic<uint64_t>>(owner, memory_category::ring_buffers)),
+		  pending_(bin_sizes_.size() * n_chans)
+	{
+	}
+
+	void plot_feed::push(const double* const* channels, size_t n)
+	{
+		if (n == 0)
+		{
+			return;
+		}
+		// Announce the bins this push completes before overwriting any; the
+		// fence orders the announcement before the bin stores
+		reserved_.store(pushed_ + n, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		const size_t base = bin_sizes_[0];
+		for (size_t c = 0; c < n_chans_; ++c)
+		{
+			const double* x = channels[c];
+			accumulator a = pending_[c];
+			for (size_t i = 0; i < n; ++i)
+			{
+				const double v = x[i];
+				if (a.parts == 0)
+				{
+					a.min = a.max = v;
+				}
+				else
+				{
+					a.min = std::min(a.min, v);
+					a.max = std::max(a.max, v);
+				}
+				if (++a.parts == base)
+				{
+					emit(0, c, pushed_ + i + 1, a.min, a.max);
+					a.parts = 0;
+				}
+			}
+			pending_[c] = a;
+		}
+		pushed_ += n;
+		samples_.store(pushed_, std::memory_order_release);
+	}
+
+	void plot_feed::emit(size_t level, size_t channel, uint64_t end, double min, double max)
+	{
+		// Bins are aligned to sample 0, so the bin ending at `end` is known
+		const uint64_t index = end / bin_sizes_[level] - 1;
+		bins_[(level * n_chans_ + channel) * history_ + static_cast<size_t>(index % history_)].store(
+			pack(static_cast<float>(min), static_cast<float>(max)), std::memory_order_relaxed);
+
+		if (level + 1 == bin_sizes_.size())
+		{
+			return;
+		}
+		accumulator& up = pending_[(level + 1) * n_chans_ + channel];
+		if (up.parts == 0)
+		{
+			up.min = min;
+			up.max = max;
+		}
+		else
+		{
+			up.min = std::min(up.min, min);
+			up.max = std::max(up.max, max);
+		}
+		if (++up.parts == bin_sizes_[level + 1] / bin_sizes_[level])
+		{
+			up.parts = 0;
+			emit(level + 1, channel, end, up.min, up.max);
+		}
+	}
+
+	size_t plot_feed::level_for(double samples_per_pixel) const
+	{
+		size_t level = 0;
+		while (level + 1 < bin_sizes_.size() && static_cast<double>(bin_sizes_[level + 1]) <= samples_per_pixel)
+		{
+			++level;
+		}
+		return level;
+	}
+
+	size_t plot_feed::read(size_t level, size_t channel, size_t n, plot_bin* out, uint64_t* first) const
+	{
+		if (level >= bin_sizes_.size() || channel >= n_chans_)
+		{
+			return 0;
+		}
+		const uint64_t size = bin_sizes_[level];
+		const uint64_t complete = samples_.load(std::memory_order_acquire) / size;
+		const uint64_t start = complete - std::min<uint64_t>({n, complete, history_});
+		const std::atomic<uint64_t>* ring = bins_.data() + (level * n_chans_ + channel) * history_;
+		for (uint64_t i = start; i < complete; ++i)
+		{
+			out[i - start] = unpack(ring[i % history_].load(std::memory_order_relaxed));
+		}
+
+		// Bins the producer may have started overwriting while they were
+		// copied are dropped from the front
+		std::atomic_thread_fence(std::memory_order_acquire);
+		const uint64_t reserved = reserved_.load(std::memory_order_relaxed) / size;
+		const uint64_t oldest = reserved > history_ ? reserved - history_ : 0;
+		uint64_t valid = start;
+		if (oldest > start)
+		{
+			valid = std::min(oldest, complete);
+			std::copy(out + (valid - start), out + (complete - start), out);
+		}
+		if (first)
+		{
+			*first = valid;
+		}
+		return static_cast<size_t>(complete - valid);
+	}
+
+	size_t plot_feed::draw(size_t channel, uint64_t samples, size_t pixels, plot_bin* out) const
+	{
+		if (pixels == 0 || samples == 0)
+		{
+			return 0;
+		}
+		const size_t level = level_for(static_cast<double>(samples) / static_cast<double>(pixels));
+		const size_t size = bin_sizes_[level];
+		const size_t wanted = static_cast<size_t>(std::min<uint64_t>((samples + size - 1) / size, history_));
+		std::vector<plot_bin> bins(wanted);
+		const size_t got = read(level, channel, wanted, bins.data());
+		if (got == 0)
+		{
+			return 0;
+		}
+
+		// Keep the columns' width when history is short: fewer columns
+		const size_t columns = std::max<size_t>(1, static_cast<size_t>(static_cast<uint64_t>(pixels) * got / wanted));
+		for (size_t p = 0; p < columns; ++p)
+		{
+			const size_t a = p * got / columns;
+			const size_t b = std::max(a + 1, (p + 1) * got / columns);
+			plot_bin column = bins[a];
+			for (size_t i = a + 1; i < b; ++i)
+			{
+				column.min = std::min(column.min, bins[i].min);
+				column.max = std::max(column.max, bins[i].max);
+			}
+			out[p] = column;
+		}
+		return columns;
+	}
+} // namespace eeg
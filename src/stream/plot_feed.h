@@ -0,0 +1,132 @@
+/**
+ * @file plot_feed.h
+ * @brief Min/max decimated views of a live stream shared by any number of
+ * plots
+ */
+
+#pragma once
+
+#include "util/memory_accounting.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace eeg
+{
+	/**
+	 * @brief Range of a channel over one bin or one plotted column
+	 */
+	struct plot_bin
+	{
+		float min = 0;
+		float max = 0;
+	};
+
+	/**
+	 * @brief Live min/max decimation at a few fixed resolutions, written once
+	 * per chunk and read by any number of plots
+	 *
+	 * @details Each level keeps the last `history()` bins of every channel,
+	 * a bin being the min and max of `bin_size(level)` samples. Levels are
+	 * built from the level below as its bins complete, so a chunk costs one
+	 * comparison pair per sample whatever the number of plots; each plot
+	 * then reads the level nearest its own samples per pixel instead of
+	 * decimating the raw stream itself.
+	 *
+	 * There is one producer, normally the chunk callback, and it never
+	 * blocks. Readers take no locks either: bins are 64-bit atomics, and a
+	 * reader that races the producer around the ring drops the bins that
+	 * were overwritten under it, so reads always return consistent bins,
+	 * possibly fewer than asked for.
+	 *
+	 * Bins are aligned to the first sample pushed and appear when complete,
+	 * so the newest column of a plot lags the stream by up to one bin.
+	 */
+	class plot_feed
+	{
+	public:
+		/**
+		 * @param bin_sizes Samples per bin of each level, ascending; each is
+		 * rounded up to a multiple of the one before
+		 * @param history Bins kept per level and channel
+		 * @param owner Manager the bins are accounted to under
+		 * `memory_category::ring_buffers`
+		 */
+		plot_feed(size_t n_chans, std::vector<size_t> bin_sizes = {4, 16, 64, 256}, size_t history = 4096, memory_owner owner = nullptr);
+
+		size_t n_chans() const { return n_chans_; }
+		size_t n_levels() const { return bin_sizes_.size(); }
+		size_t history() const { return history_; }
+		size_t bin_size(size_t level) const { return bin_sizes_[level]; }
+
+		/**
+		 * @brief Samples pushed and visible to readers
+		 */
+		uint64_t n_samples() const { return samples_.load(std::memory_order_acquire); }
+
+		/**
+		 * @brief Bin memory in bytes
+		 */
+		size_t bytes() const { return bins_.size() * sizeof(uint64_t); }
+
+		/**
+		 * @brief Adds `n` samples per channel (producer side)
+		 *
+		 * @param channels `n_chans()` pointers, each to `n` values
+		 */
+		void push(const double* const* channels, size_t n);
+
+		/**
+		 * @brief Level for a plot showing `samples_per_pixel` samples per
+		 * column: the coarsest whose bins are no wider than a column, so no
+		 * column loses detail, or level 0 when every level is wider
+		 */
+		size_t level_for(double samples_per_pixel) const;
+
+		/**
+		 * @brief Copies the newest `n` complete bins of `channel` at `level`,
+		 * oldest first
+		 *
+		 * @param first If not null, receives the index of the first bin
+		 * copied; bin i covers samples `[i * bin_size(level), (i + 1) *
+		 * bin_size(level))` from the first pushed
+		 * @return Bins copied; fewer than `n` when less history is available
+		 */
+		size_t read(size_t level, size_t channel, size_t n, plot_bin* out, uint64_t* first = nullptr) const;
+
+		/**
+		 * @brief Decimates the newest `samples` samples of `channel` into
+		 * `pixels` columns from the level nearest `samples / pixels`
+		 *
+		 * @return Columns written, oldest first; fewer than `pixels` when
+		 * the level holds less than `samples` of history, with the same
+		 * samples per column
+		 */
+		size_t draw(size_t channel, uint64_t samples, size_t pixels, plot_bin* out) const;
+
+	private:
+		struct accumulator
+		{
+			double min = 0;
+			double max = 0;
+			size_t parts = 0; ///< Samples at level 0, bins above
+		};
+
+		void emit(size_t level, size_t channel, uint64_t end, double min, double max);
+
+		size_t n_chans_;
+		std::vector<size_t> bin_sizes_;
+		size_t history_;
+		tracked_vector<std::atomic<uint64_t>> bins_; ///< [level][channel][history] ring of packed plot_bin
+		std::vector<accumulator> pending_;           ///< [level][channel] unfinished bin, producer only
+		uint64_t pushed_ = 0;                        ///< Producer side copy of `samples_`
+
+		// The producer raises reserved_ before overwriting bins and samples_
+		// after publishing them; readers use reserved_ to tell which bins
+		// they copied may have been overwritten.
+		std::atomic<uint64_t> reserved_{0};
+		std::atomic<uint64_t> samples_{0};
+	};
+} // namespace eeg
@@ -0,0 +1,318 @@
+#include "stream/pyramid.h"
+
+#include "stream/recording.h"
+
+#include <algorithm>
+#include <fstream>
+#include <utility>
+
+namespace eeg
+{
+	namespace
+	{
+		const char magic[8] = {'B', 'A', 'P', 'Y', 'R', '\r', '\n', '\x1a'};
+		constexpr uint32_t pyramid_version = 1;
+
+		template <typename T>
+		void put(std::ostream& out, const T& v)
+		{
+			out.write(reinterpret_cast<const char*>(&v), sizeof(T));
+		}
+
+		template <typename T>
+		bool get(std::istream& in, T& v)
+		{
+			return static_cast<bool>(in.read(reinterpret_cast<char*>(&v), sizeof(T)));
+		}
+
+		void merge(pyramid_bin& into, const pyramid_bin& b, size_t merged)
+		{
+			if (merged == 0)
+			{
+				into = b;
+				return;
+			}
+			into.min = std::min(into.min, b.min);
+			into.max = std::max(into.max, b.max);
+			into.mean += (b.mean - into.mean) / static_cast<float>(merged + 1);
+		}
+	} // namespace
+
+	minmax_pyramid::minmax_pyramid(size_t n_chans, size_t base, size_t factor)
+		: n_chans_(n_chans), base_(std::max<size_t>(base, 1)), factor_(std::max<size_t>(factor, 2)), pending_(1, std::vector<accumulator>(n_chans))
+	{
+	}
+
+	uint64_t minmax_pyramid::bin_size(size_t level) const
+	{
+		uint64_t size = base_;
+		for (size_t i = 0; i < level; ++i)
+		{
+			size *= factor_;
+		}
+		return size;
+	}
+
+	const pyramid_bin* minmax_pyramid::bins(size_t level, size_t channel) const
+	{
+		return level < levels_.size() && channel < n_chans_ ? levels_[level][channel].data() : nullptr;
+	}
+
+	void minmax_pyramid::append(const double* x, size_t n_samples)
+	{
+		// A pyramid read back from a file has no accumulators to continue
+		if (pending_.empty())
+		{
+			return;
+		}
+		for (size_t c = 0; c < n_chans_; ++c)
+		{
+			const double* p = x + c * n_samples;
+			accumulator a = pending_[0][c];
+			for (size_t i = 0; i < n_samples; ++i)
+			{
+				const double v = p[i];
+				if (a.parts == 0)
+				{
+					a.min = a.max = a.sum = v;
+				}
+				else
+				{
+					a.min = std::min(a.min, v);
+					a.max = std::max(a.max, v);
+					a.sum += v;
+				}
+				++a.count;
+				if (++a.parts == base_)
+				{
+					emit(0, c, a);
+					a = accumulator();
+				}
+			}
+			pending_[0][c] = a;
+		}
+		n_samples_ += n_samples;
+	}
+
+	void minmax_pyramid::emit(size_t level, size_t channel, const accumulator& a)
+	{
+		if (level == levels_.size())
+		{
+			levels_.emplace_back(n_chans_);
+		}
+		levels_[level][channel].push_back(
+			pyramid_bin{static_cast<float>(a.min), static_cast<float>(a.max), static_cast<float>(a.sum / static_cast<double>(a.count))});
+
+		if (level + 1 == pending_.size())
+		{
+			pending_.emplace_back(n_chans_);
+		}
+		accumulator& up = pending_[level + 1][channel];
+		if (up.parts == 0)
+		{
+			up.min = a.min;
+			up.max = a.max;
+		}
+		else
+		{
+			up.min = std::min(up.min, a.min);
+			up.max = std::max(up.max, a.max);
+		}
+		up.sum += a.sum;
+		up.count += a.count;
+		if (++up.parts == factor_)
+		{
+			// Copy first: emitting can grow pending_
+			const accumulator done = up;
+			up = accumulator();
+			emit(level + 1, channel, done);
+		}
+	}
+
+	size_t minmax_pyramid::query(size_t channel, uint64_t from, uint64_t to, size_t pixels, pyramid_bin* out) const
+	{
+		if (channel >= n_chans_ || pixels == 0 || to <= from || levels_.empty())
+		{
+			return 0;
+		}
+		const double span = static_cast<double>(to - from) / static_cast<double>(pixels);
+		if (span < static_cast<double>(base_))
+		{
+			return 0;
+		}
+		size_t top = 0;
+		while (top + 1 < levels_.size() && static_cast<double>(bin_size(top + 1)) <= span)
+		{
+			++top;
+		}
+
+		for (size_t p = 0; p < pixels; ++p)
+		{
+			const uint64_t a = from + static_cast<uint64_t>(static_cast<double>(p) * span);
+			const uint64_t b = from + static_cast<uint64_t>(static_cast<double>(p + 1) * span);
+			// Coarse levels finish their bins later than fine ones, so the
+			// newest pixels may have to come from further down
+			size_t level = top;
+			uint64_t size = bin_size(level);
+			while (level > 0 && (b + size - 1) / size > levels_[level][channel].size())
+			{
+				--level;
+				size /= factor_;
+			}
+			const std::vector<pyramid_bin>& bins = levels_[level][channel];
+			const size_t first = static_cast<size_t>(a / size);
+			const size_t last = std::min(static_cast<size_t>((b + size - 1) / size), bins.size());
+			if (first >= last)
+			{
+				return p;
+			}
+			for (size_t i = first; i < last; ++i)
+			{
+				merge(out[p], bins[i], i - first);
+			}
+		}
+		return pixels;
+	}
+
+	size_t minmax_pyramid::bytes() const
+	{
+		size_t bins = 0;
+		for (const auto& level : levels_)
+		{
+			for (const auto& channel : level)
+			{
+				bins += channel.size();
+			}
+		}
+		return bins * sizeof(pyramid_bin);
+	}
+
+	std::string pyramid_path(const std::string& recording_path)
+	{
+		return recording_path + ".pyr";
+	}
+
+	bool write_pyramid(const std::string& path, const minmax_pyramid& pyramid, std::string* error)
+	{
+		std::ofstream out(path, std::ios::binary | std::ios::trunc);
+		if (!out)
+		{
+			if (error)
+			{
+				*error = path + ": cannot create";
+			}
+			return false;
+		}
+		out.write(magic, sizeof(magic));
+		put(out, pyramid_version);
+		put(out, static_cast<uint32_t>(pyramid.n_chans()));
+		put(out, static_cast<uint32_t>(pyramid.base()));
+		put(out, static_cast<uint32_t>(pyramid.factor()));
+		put(out, pyramid.n_samples());
+		put(out, static_cast<uint32_t>(pyramid.n_levels()));
+		for (size_t level = 0; level < pyramid.n_levels(); ++level)
+		{
+			const uint64_t n = pyramid.n_bins(level);
+			put(out, n);
+			for (size_t c = 0; c < pyramid.n_chans(); ++c)
+			{
+				out.write(reinterpret_cast<const char*>(pyramid.bins(level, c)), static_cast<std::streamsize>(n * sizeof(pyramid_bin)));
+			}
+		}
+		if (!out.flush())
+		{
+			if (error)
+			{
+				*error = path + ": write failed";
+			}
+			return false;
+		}
+		return true;
+	}
+
+	bool read_pyramid(const std::string& path, minmax_pyramid& out, std::string* error)
+	{
+		auto fail = [&](const std::string& what) {
+			if (error)
+			{
+				*error = path + ": " + what;
+			}
+			return false;
+		};
+		std::ifstream in(path, std::ios::binary);
+		if (!in)
+		{
+			return fail("cannot open");
+		}
+		char m[sizeof(magic)];
+		uint32_t version = 0;
+		uint32_t n_chans = 0;
+		uint32_t base = 0;
+		uint32_t factor = 0;
+		uint64_t n_samples = 0;
+		uint32_t n_levels = 0;
+		if (!in.read(m, sizeof(m)) || !std::equal(m, m + sizeof(m), magic))
+		{
+			return fail("not a pyramid file");
+		}
+		if (!get(in, version) || version != pyramid_version)
+		{
+			return fail("unsupported pyramid version");
+		}
+		if (!get(in, n_chans) || !get(in, base) || !get(in, factor) || !get(in, n_samples) || !get(in, n_levels))
+		{
+			return fail("truncated header");
+		}
+
+		minmax_pyramid p(n_chans, base, factor);
+		p.n_samples_ = n_samples;
+		p.pending_.clear();
+		p.levels_.assign(n_levels, std::vector<std::vector<pyramid_bin>>(n_chans));
+		for (auto& level : p.levels_)
+		{
+			uint64_t n = 0;
+			if (!get(in, n) || n > n_samples)
+			{
+				return fail("truncated level");
+			}
+			for (auto& channel : level)
+			{
+				channel.resize(static_cast<size_t>(n));
+				if (!in.read(reinterpret_cast<char*>(channel.data()), static_cast<std::streamsize>(n * sizeof(pyramid_bin))))
+				{
+					return fail("truncated level");
+				}
+			}
+		}
+		out = std::move(p);
+		return true;
+	}
+
+	bool build_recording_pyramid(const std::string& recording_path, minmax_pyramid& out, std::string* error, size_t base, size_t factor)
+	{
+		recording_reader reader;
+		if (!reader.open(recording_path, error))
+		{
+			return false;
+		}
+		minmax_pyramid p(reader.header().n_chans, base, factor);
+		recording_record r;
+		while (reader.next(r))
+		{
+			if (r.type == recording_record_type::data)
+			{
+				p.append(r.data.data(), r.n_samples);
+			}
+		}
+		if (reader.failed())
+		{
+			if (error)
+			{
+				*error = recording_path + ": truncated record";
+			}
+			return false;
+		}
+		out = std::move(p);
+		return true;
+	}
+} // namespace eeg
@@ -0,0 +1,153 @@
+/**
+ * @file pyramid.h
+ * @brief Multi-resolution min/max/mean summaries of long recordings
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace eeg
+{
+	/**
+	 * @brief Summary of a run of samples of one channel
+	 */
+	struct pyramid_bin
+	{
+		float min = 0;
+		float max = 0;
+		float mean = 0;
+	};
+
+	/**
+	 * @brief Per-channel min/max/mean pyramid for drawing any zoom level of a
+	 * recording in time proportional to its width in pixels
+	 *
+	 * @details Level 0 summarises every `base()` samples, and each level
+	 * above summarises `factor()` bins of the one below; a level appears
+	 * when its first bin completes. `append()` builds it incrementally while
+	 * streaming.
+	 * The unfinished bins at the end are kept as accumulators and do not
+	 * show in queries until complete. Positions are sample indices from the
+	 * start of the data, as `load_recording()` concatenates it; gaps in
+	 * sample numbers are not represented.
+	 *
+	 * Bins are stored as float32, 12 bytes per bin per channel, so with
+	 * the defaults the whole pyramid is about 12 % of the float64 samples.
+	 */
+	class minmax_pyramid
+	{
+	public:
+		minmax_pyramid() = default;
+
+		/**
+		 * @param base Samples per level-0 bin, >= 1
+		 * @param factor Bins merged per level, >= 2
+		 */
+		minmax_pyramid(size_t n_chans, size_t base = 16, size_t factor = 4);
+
+		size_t n_chans() const { return n_chans_; }
+		size_t base() const { return base_; }
+		size_t factor() const { return factor_; }
+		size_t n_levels() const { return levels_.size(); }
+
+		/**
+		 * @brief Samples appended so far
+		 */
+		uint64_t n_samples() const { return n_samples_; }
+
+		/**
+		 * @brief Samples per bin at `level`
+		 */
+		uint64_t bin_size(size_t level) const;
+
+		/**
+		 * @brief Complete bins at `level`
+		 */
+		size_t n_bins(size_t level) const { return level < levels_.size() && n_chans_ > 0 ? levels_[level][0].size() : 0; }
+
+		/**
+		 * @brief Bins of `channel` at `level`, `n_bins(level)` of them
+		 */
+		const pyramid_bin* bins(size_t level, size_t channel) const;
+
+		/**
+		 * @brief Adds a channel-major block (channel n at `x[n * n_samples]`)
+		 */
+		void append(const double* x, size_t n_samples);
+
+		/**
+		 * @brief Summarises samples `[from, to)` of `channel` into `pixels`
+		 * equal spans
+		 *
+		 * @details Reads the coarsest level whose bins fit within one span,
+		 * so each pixel merges at most `factor() + 1` bins. Span edges are
+		 * rounded out to bin edges, so a pixel can include up to one bin from
+		 * each neighbour.
+		 *
+		 * @return Pixels written, from the first; 0 when spans are shorter
+		 * than `base()` samples, in which case the samples themselves should
+		 * be drawn. Fewer than `pixels` when the range runs past the last
+		 * complete bin.
+		 */
+		size_t query(size_t channel, uint64_t from, uint64_t to, size_t pixels, pyramid_bin* out) const;
+
+		/**
+		 * @brief Memory held by the bins, in bytes
+		 */
+		size_t bytes() const;
+
+	private:
+		friend bool read_pyramid(const std::string& path, minmax_pyramid& out, std::string* error);
+
+		struct accumulator
+		{
+			double min = 0;
+			double max = 0;
+			double sum = 0;
+			uint64_t count = 0; ///< Samples
+			size_t parts = 0;   ///< Samples at level 0, bins above
+		};
+
+		void emit(size_t level, size_t channel, const accumulator& a);
+
+		size_t n_chans_ = 0;
+		size_t base_ = 16;
+		size_t factor_ = 4;
+		uint64_t n_samples_ = 0;
+		std::vector<std::vector<std::vector<pyramid_bin>>> levels_; ///< [level][channel] complete bins
+		std::vector<std::vector<accumulator>> pending_;            ///< [level][channel] unfinished bin
+	};
+
+	/**
+	 * @brief Sidecar file name for a recording's pyramid: the recording path
+	 * with `.pyr` appended
+	 */
+	std::string pyramid_path(const std::string& recording_path);
+
+	/**
+	 * @brief Writes the complete bins of a pyramid
+	 *
+	 * @details Layout, native little-endian: magic `"BAPYR\r\n\x1a"`, uint32
+	 * version, uint32 channel count, uint32 base, uint32 factor, uint64
+	 * samples, uint32 level count, then per level a uint64 bin count and the
+	 * bins of each channel in turn as float32 min, max, mean.
+	 */
+	bool write_pyramid(const std::string& path, const minmax_pyramid& pyramid, std::string* error = nullptr);
+
+	/**
+	 * @brief Reads a pyramid written by `write_pyramid()`; it can be
+	 * queried but not appended to
+	 */
+	bool read_pyramid(const std::string& path, minmax_pyramid& out, std::string* error = nullptr);
+
+	/**
+	 * @brief Builds the pyramid of an existing recording, one record at a
+	 * time
+	 */
+	bool build_recording_pyramid(const std::string& recording_path, minmax_pyramid& out, std::string* error = nullptr, size_t base = 16,
+								 size_t factor = 4);
+} // namespace eeg
@@ -0,0 +1,577 @@
+#include "stream/recording.h"
+
+#include "stream/adc_counts.h"
+#include "util/bit_pack.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <utility>
+
+namespace eeg
+{
+	namespace
+	{
+		const char magic[8] = {'B', 'A', 'R', 'E', 'C', '\r', '\n', '\x1a'};
+
+		template <typename T>
+		void put(std::vector<char>& buf, const T& v)
+		{
+			const char* p = reinterpret_cast<const char*>(&v);
+			buf.insert(buf.end(), p, p + sizeof(T));
+		}
+
+		template <typename T>
+		bool get(std::istream& in, T& v)
+		{
+			return static_cast<bool>(in.read(reinterpret_cast<char*>(&v), sizeof(T)));
+		}
+
+		template <typename T>
+		T take(const std::vector<char>& buf, size_t& pos)
+		{
+			T v{};
+			if (pos + sizeof(T) <= buf.size())
+			{
+				std::memcpy(&v, buf.data() + pos, sizeof(T));
+			}
+			pos += sizeof(T);
+			return v;
+		}
+	} // namespace
+
+	bool recording_writer::open(const std::string& path, const recording_header& header)
+	{
+		close();
+		out_.open(path, std::ios::binary | std::ios::trunc);
+		if (!out_)
+		{
+			return false;
+		}
+		header_ = header;
+		header_.version = recording_version;
+		header_.labels.resize(header_.n_chans);
+		samples_written_ = 0;
+
+		std::vector<char> buf(magic, magic + sizeof(magic));
+		put(buf, header_.version);
+		put(buf, static_cast<uint32_t>(header_.n_chans));
+		put(buf, header_.sampling_rate);
+		for (const std::string& label : header_.labels)
+		{
+			const uint16_t n = static_cast<uint16_t>(std::min<size_t>(label.size(), UINT16_MAX));
+			put(buf, n);
+			buf.insert(buf.end(), label.begin(), label.begin() + n);
+		}
+		out_.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+		return static_cast<bool>(out_);
+	}
+
+	bool recording_writer::append(const std::string& path, std::string* error)
+	{
+		close();
+		recording_reader reader;
+		if (!reader.open(path, error))
+		{
+			return false;
+		}
+		header_ = reader.header();
+		samples_written_ = 0;
+		out_.open(path, std::ios::binary | std::ios::app);
+		if (!out_)
+		{
+			if (error)
+			{
+				*error = path + ": cannot open for writing";
+			}
+			return false;
+		}
+		return true;
+	}
+
+	bool recording_writer::write_record(recording_record_type type, const std::vector<char>& payload)
+	{
+		if (!out_.is_open())
+		{
+			return false;
+		}
+		const uint8_t t = static_cast<uint8_t>(type);
+		const uint32_t size = static_cast<uint32_t>(payload.size());
+		out_.write(reinterpret_cast<const char*>(&t), sizeof(t));
+		out_.write(reinterpret_cast<const char*>(&size), sizeof(size));
+		out_.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+		return static_cast<bool>(out_);
+	}
+
+	bool recording_writer::set_counts(std::vector<double> scales)
+	{
+		if (!scales.empty() &&
+			(scales.size() != header_.n_chans || std::any_of(scales.begin(), scales.end(), [](double s) { return !(s > 0); })))
+		{
+			return false;
+		}
+		scales_ = std::move(scales);
+		return true;
+	}
+
+	bool recording_writer::write_block(const double* x, size_t n_samples, uint64_t first_sample)
+	{
+		return write_samples(x, n_samples, 0, n_samples, first_sample);
+	}
+
+	bool recording_writer::write_block(const double* x, size_t n_samples, const size_t* sample_numbers)
+	{
+		runs_.assign(sample_numbers, n_samples);
+		bool ok = true;
+		runs_.for_each_run([&](size_t offset, size_t n, uint64_t first) { ok = ok && write_samples(x, n_samples, offset, n, first); });
+		return ok;
+	}
+
+	bool recording_writer::write_samples(const double* x, size_t stride, size_t offset, size_t n_samples, uint64_t first_sample)
+	{
+		std::vector<char> payload;
+		bool counts = !scales_.empty();
+		if (counts)
+		{
+			counts_.resize(header_.n_chans * n_samples);
+			for (size_t c = 0; c < header_.n_chans && counts; ++c)
+			{
+				const double* channel = x + c * stride + offset;
+				to_counts(channel, n_samples, scales_[c], counts_.data() + c * n_samples);
+				counts = counts_exact(channel, counts_.data() + c * n_samples, n_samples, scales_[c]);
+			}
+			float_fallbacks_ += counts ? 0 : 1;
+		}
+		if (counts)
+		{
+			payload.reserve(12 + header_.n_chans * (sizeof(double) + n_samples * sizeof(int32_t)));
+			put(payload, first_sample);
+			put(payload, static_cast<uint32_t>(n_samples));
+			const char* s = reinterpret_cast<const char*>(scales_.data());
+			payload.insert(payload.end(), s, s + scales_.size() * sizeof(double));
+			const char* p = reinterpret_cast<const char*>(counts_.data());
+			payload.insert(payload.end(), p, p + counts_.size() * sizeof(int32_t));
+		}
+		else
+		{
+			payload.reserve(12 + header_.n_chans * n_samples * sizeof(double));
+			put(payload, first_sample);
+			put(payload, static_cast<uint32_t>(n_samples));
+			for (size_t c = 0; c < header_.n_chans; ++c)
+			{
+				const char* p = reinterpret_cast<const char*>(x + c * stride + offset);
+				payload.insert(payload.end(), p, p + n_samples * sizeof(double));
+			}
+		}
+		if (!write_record(counts ? recording_record_type::counts : recording_record_type::data, payload))
+		{
+			return false;
+		}
+		samples_written_ += n_samples;
+		return true;
+	}
+
+	bool recording_writer::write_annotation(uint64_t sample, const std::string& text)
+	{
+		std::vector<char> payload;
+		put(payload, sample);
+		payload.insert(payload.end(), text.begin(), text.end());
+		return write_record(recording_record_type::annotation, payload);
+	}
+
+	bool recording_writer::write_digital(const bool* const* channels, const std::vector<std::string>& labels, size_t n_samples, uint64_t first_sample)
+	{
+		std::vector<char> payload;
+		payload.reserve(14 + labels.size() * (2 + n_samples));
+		put(payload, first_sample);
+		put(payload, static_cast<uint32_t>(n_samples));
+		put(payload, static_cast<uint16_t>(labels.size()));
+		for (const std::string& label : labels)
+		{
+			const uint16_t n = static_cast<uint16_t>(std::min<size_t>(label.size(), UINT16_MAX));
+			put(payload, n);
+			payload.insert(payload.end(), label.begin(), label.begin() + n);
+		}
+		if (pack_digital_)
+		{
+			const size_t words = packed_words(n_samples);
+			const size_t pos = payload.size();
+			payload.resize(pos + labels.size() * words * sizeof(uint64_t));
+			std::vector<uint64_t> bits(words);
+			for (size_t c = 0; c < labels.size(); ++c)
+			{
+				pack_bools(channels[c], n_samples, bits.data());
+				std::memcpy(payload.data() + pos + c * words * sizeof(uint64_t), bits.data(), words * sizeof(uint64_t));
+			}
+			return write_record(recording_record_type::digital_packed, payload);
+		}
+		for (size_t c = 0; c < labels.size(); ++c)
+		{
+			for (size_t i = 0; i < n_samples; ++i)
+			{
+				payload.push_back(channels[c][i] ? 1 : 0);
+			}
+		}
+		return write_record(recording_record_type::digital, payload);
+	}
+
+	bool recording_writer::flush()
+	{
+		return out_.is_open() && static_cast<bool>(out_.flush());
+	}
+
+	void recording_writer::close()
+	{
+		if (out_.is_open())
+		{
+			out_.close();
+		}
+	}
+
+	bool recording_reader::open(const std::string& path, std::string* error)
+	{
+		auto fail = [&](const std::string& message) {
+			if (error)
+			{
+				*error = path + ": " + message;
+			}
+			failed_ = true;
+			return false;
+		};
+
+		failed_ = false;
+		in_.open(path, std::ios::binary);
+		if (!in_)
+		{
+			return fail("cannot open");
+		}
+		char m[sizeof(magic)];
+		if (!in_.read(m, sizeof(m)) || std::memcmp(m, magic, sizeof(magic)) != 0)
+		{
+			return fail("not a recording");
+		}
+		uint32_t n_chans = 0;
+		if (!get(in_, header_.version) || !get(in_, n_chans) || !get(in_, header_.sampling_rate))
+		{
+			return fail("truncated header");
+		}
+		if (header_.version > recording_version)
+		{
+			return fail("unsupported version " + std::to_string(header_.version));
+		}
+		header_.n_chans = n_chans;
+		header_.labels.assign(n_chans, std::string());
+		for (std::string& label : header_.labels)
+		{
+			uint16_t n = 0;
+			if (!get(in_, n))
+			{
+				return fail("truncated header");
+			}
+			label.resize(n);
+			if (n > 0 && !in_.read(&label[0], n))
+			{
+				return fail("truncated header");
+			}
+		}
+		return true;
+	}
+
+	bool recording_reader::next(recording_record& record)
+	{
+		while (true)
+		{
+			uint8_t type = 0;
+			uint32_t size = 0;
+			if (!get(in_, type))
+			{
+				return false; // clean end of file
+			}
+			if (!get(in_, size))
+			{
+				failed_ = true;
+				return false;
+			}
+			std::vector<char> payload(size);
+			if (size > 0 && !in_.read(payload.data(), size))
+			{
+				failed_ = true;
+				return false;
+			}
+
+			size_t pos = 0;
+			if (type == static_cast<uint8_t>(recording_record_type::data))
+			{
+				record.type = recording_record_type::data;
+				record.first_sample = take<uint64_t>(payload, pos);
+				record.n_samples = take<uint32_t>(payload, pos);
+				const size_t values = header_.n_chans * record.n_samples;
+				if (pos + values * sizeof(double) > payload.size())
+				{
+					failed_ = true;
+					return false;
+				}
+				record.data.resize(values);
+				std::memcpy(record.data.data(), payload.data() + pos, values * sizeof(double));
+				record.text.clear();
+				return true;
+			}
+			if (type == static_cast<uint8_t>(recording_record_type::counts))
+			{
+				record.type = recording_record_type::data;
+				record.first_sample = take<uint64_t>(payload, pos);
+				record.n_samples = take<uint32_t>(payload, pos);
+				const size_t values = header_.n_chans * record.n_samples;
+				if (pos + header_.n_chans * sizeof(double) + values * sizeof(int32_t) > payload.size())
+				{
+					failed_ = true;
+					return false;
+				}
+				std::vector<double> scales(header_.n_chans);
+				std::memcpy(scales.data(), payload.data() + pos, scales.size() * sizeof(double));
+				pos += scales.size() * sizeof(double);
+				std::vector<int32_t> counts(values);
+				std::memcpy(counts.data(), payload.data() + pos, values * sizeof(int32_t));
+				record.data.resize(values);
+				for (size_t c = 0; c < header_.n_chans; ++c)
+				{
+					from_counts(counts.data() + c * record.n_samples, record.n_samples, scales[c], record.data.data() + c * record.n_samples);
+				}
+				record.text.clear();
+				return true;
+			}
+			if (type == static_cast<uint8_t>(recording_record_type::annotation))
+			{
+				record.type = recording_record_type::annotation;
+				record.first_sample = take<uint64_t>(payload, pos);
+				record.n_samples = 0;
+				record.data.clear();
+				record.text.assign(payload.begin() + static_cast<std::ptrdiff_t>(std::min(pos, payload.size())), payload.end());
+				return true;
+			}
+			const bool packed = type == static_cast<uint8_t>(recording_record_type::digital_packed);
+			if (type == static_cast<uint8_t>(recording_record_type::digital) || packed)
+			{
+				record.type = recording_record_type::digital;
+				record.first_sample = take<uint64_t>(payload, pos);
+				record.n_samples = take<uint32_t>(payload, pos);
+				record.labels.resize(take<uint16_t>(payload, pos));
+				for (std::string& label : record.labels)
+				{
+					const uint16_t n = take<uint16_t>(payload, pos);
+					if (pos + n > payload.size())
+					{
+						failed_ = true;
+						return false;
+					}
+					label.assign(payload.data() + pos, n);
+					pos += n;
+				}
+				const size_t values = record.labels.size() * record.n_samples;
+				const size_t words = packed_words(record.n_samples);
+				if (pos + (packed ? record.labels.size() * words * sizeof(uint64_t) : values) > payload.size())
+				{
+					failed_ = true;
+					return false;
+				}
+				if (packed)
+				{
+					record.digital.resize(values);
+					std::vector<uint64_t> bits(words);
+					for (size_t c = 0; c < record.labels.size(); ++c)
+					{
+						std::memcpy(bits.data(), payload.data() + pos + c * words * sizeof(uint64_t), words * sizeof(uint64_t));
+						unpack_bools(bits.data(), 0, record.n_samples, reinterpret_cast<bool*>(record.digital.data() + c * record.n_samples));
+					}
+				}
+				else
+				{
+					record.digital.assign(payload.begin() + static_cast<std::ptrdiff_t>(pos), payload.begin() + static_cast<std::ptrdiff_t>(pos + values));
+				}
+				record.data.clear();
+				record.text.clear();
+				return true;
+			}
+			// Unknown record type: skip it
+		}
+	}
+
+	uint64_t recording_reader::position()
+	{
+		return static_cast<uint64_t>(in_.tellg());
+	}
+
+	bool recording_reader::seek(uint64_t position)
+	{
+		in_.clear();
+		failed_ = false;
+		return static_cast<bool>(in_.seekg(static_cast<std::streamoff>(position)));
+	}
+
+	bool recording_reader::scan(std::vector<recording_extent>& out)
+	{
+		while (true)
+		{
+			const uint64_t position = static_cast<uint64_t>(in_.tellg());
+			uint8_t type = 0;
+			uint32_t size = 0;
+			if (!get(in_, type))
+			{
+				return true;
+			}
+			if (!get(in_, size))
+			{
+				failed_ = true;
+				return false;
+			}
+			uint32_t skip = size;
+			if (type == static_cast<uint8_t>(recording_record_type::data) || type == static_cast<uint8_t>(recording_record_type::counts))
+			{
+				recording_extent e;
+				uint32_t n = 0;
+				if (size < sizeof(uint64_t) + sizeof(uint32_t) || !get(in_, e.first_sample) || !get(in_, n))
+				{
+					failed_ = true;
+					return false;
+				}
+				e.position = position;
+				e.n_samples = n;
+				out.push_back(e);
+				skip -= sizeof(uint64_t) + sizeof(uint32_t);
+			}
+			if (!in_.seekg(skip, std::ios::cur))
+			{
+				failed_ = true;
+				return false;
+			}
+		}
+	}
+
+	bool load_recording(const std::string& path, recording_contents& out, std::string* error)
+	{
+		recording_reader reader;
+		if (!reader.open(path, error))
+		{
+			return false;
+		}
+		out = recording_contents();
+		out.header = reader.header();
+		const size_t n_chans = out.header.n_chans;
+
+		// Collect per channel first, the total length is unknown until the end
+		std::vector<std::vector<double>> channels(n_chans);
+		recording_record r;
+		bool first = true;
+		uint64_t next_sample = 0;
+		size_t n_samples = 0;
+		while (reader.next(r))
+		{
+			if (r.type == recording_record_type::annotation)
+			{
+				out.annotations.push_back(stream_annotation{static_cast<size_t>(r.first_sample), r.text});
+				continue;
+			}
+			if (r.type != recording_record_type::data)
+			{
+				continue;
+			}
+			if (first)
+			{
+				out.first_sample = r.first_sample;
+				first = false;
+			}
+			else if (r.first_sample != next_sample)
+			{
+				out.gaps.push_back(sample_gap{n_samples, r.first_sample});
+			}
+			next_sample = r.first_sample + r.n_samples;
+			n_samples += r.n_samples;
+			for (size_t c = 0; c < n_chans; ++c)
+			{
+				const double* src = r.data.data() + c * r.n_samples;
+				channels[c].insert(channels[c].end(), src, src + r.n_samples);
+			}
+		}
+		if (reader.failed())
+		{
+			if (error)
+			{
+				*error = path + ": truncated record";
+			}
+			return false;
+		}
+
+		out.n_samples = n_chans > 0 ? channels[0].size() : 0;
+		out.data.reserve(n_chans * out.n_samples);
+		for (const std::vector<double>& ch : channels)
+		{
+			out.data.insert(out.data.end(), ch.begin(), ch.end());
+		}
+		return true;
+	}
+
+	namespace
+	{
+		/**
+		 * `*` and `?` wildcards against a whole file name.
+		 */
+		bool wildcard_match(const char* pattern, const char* name)
+		{
+			if (*pattern == '\0')
+			{
+				return *name == '\0';
+			}
+			if (*pattern == '*')
+			{
+				return wildcard_match(pattern + 1, name) || (*name != '\0' && wildcard_match(pattern, name + 1));
+			}
+			return *name != '\0' && (*pattern == '?' || *pattern == *name) && wildcard_match(pattern + 1, name + 1);
+		}
+	} // namespace
+
+	bool find_recordings(const std::string& input, std::vector<std::string>& out, std::string* error)
+	{
+		namespace fs = std::filesystem;
+		const fs::path p(input);
+		std::error_code ec;
+		std::string pattern;
+		fs::path dir;
+		if (fs::is_directory(p, ec))
+		{
+			dir = p;
+			pattern = "*";
+		}
+		else if (p.filename().string().find_first_of("*?") != std::string::npos)
+		{
+			dir = p.has_parent_path() ? p.parent_path() : fs::path(".");
+			pattern = p.filename().string();
+		}
+		else
+		{
+			out.push_back(input);
+			return true;
+		}
+
+		std::vector<std::string> found;
+		for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec))
+		{
+			const std::string name = it->path().filename().string();
+			recording_reader probe;
+			if (it->is_regular_file(ec) && wildcard_match(pattern.c_str(), name.c_str()) && probe.open(it->path().string()))
+			{
+				found.push_back(it->path().string());
+			}
+		}
+		if (ec)
+		{
+			if (error)
+			{
+				*error = dir.string() + ": " + ec.message();
+			}
+			return false;
+		}
+		std::sort(found.begin(), found.end());
+		out.insert(out.end(), found.begin(), found.end());
+		return true;
+	}
+} // namespace eeg
@@ -0,0 +1,268 @@
+/**
+ * @file recording.h
+ * @brief Binary recording file format for streamed samples and annotations
+ */
+
+#pragma once
+
+#include "stream/annotation_store.h"
+#include "stream/sample_numbers.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace eeg
+{
+	/**
+	 * @details File layout, native little-endian:
+	 *
+	 * - header: magic `"BAREC\r\n\x1a"`, uint32 version, uint32 channel
+	 *   count, float64 sampling rate, then per channel a uint16 length and
+	 *   the label bytes
+	 * - records: uint8 type, uint32 payload size, payload
+	 *
+	 * Readers skip record types they do not know, so new record types can be
+	 * added without breaking older readers.
+	 */
+	constexpr uint32_t recording_version = 1;
+
+	enum class recording_record_type : uint8_t
+	{
+		data = 1,       ///< uint64 first sample, uint32 n, then n samples per channel, channel-major float64
+		annotation = 2, ///< uint64 sample, then the text bytes
+		/// uint64 first sample, uint32 n, uint16 channel count, per channel a
+		/// uint16 label length and the label, then n bytes (0 or 1) per
+		/// channel, channel-major
+		digital = 3,
+		/// As `digital`, with each channel's values packed into
+		/// `packed_words(n)` uint64 words (see bit_pack.h)
+		digital_packed = 4,
+		/// As `data`, with float64 scales per channel followed by the samples
+		/// as int32 counts of them (see adc_counts.h)
+		counts = 5,
+	};
+
+	struct recording_header
+	{
+		uint32_t version = recording_version;
+		size_t n_chans = 0;
+		double sampling_rate = 0;
+		std::vector<std::string> labels; ///< One per channel, may be empty strings
+	};
+
+	/**
+	 * @brief Appends records to a recording file
+	 */
+	class recording_writer
+	{
+	public:
+		recording_writer() = default;
+		~recording_writer() { close(); }
+		recording_writer(const recording_writer&) = delete;
+		recording_writer& operator=(const recording_writer&) = delete;
+
+		/**
+		 * @brief Creates the file and writes the header; missing labels are
+		 * written empty
+		 */
+		bool open(const std::string& path, const recording_header& header);
+
+		/**
+		 * @brief Opens an existing recording to add records at its end
+		 */
+		bool append(const std::string& path, std::string* error = nullptr);
+
+		/**
+		 * @brief Writes a channel-major block (channel n at `x[n * n_samples]`)
+		 */
+		bool write_block(const double* x, size_t n_samples, uint64_t first_sample);
+
+		/**
+		 * @brief Writes a channel-major block with the chunk's
+		 * `BA_EEG_CHANNEL_ID_SAMPLE_NUMBER` values
+		 *
+		 * @details The block is split into one record per run of consecutive
+		 * sample numbers, so the file keeps every gap exactly while storing
+		 * only a first sample per run.
+		 */
+		bool write_block(const double* x, size_t n_samples, const size_t* sample_numbers);
+
+		/**
+		 * @brief Makes `write_block()` store samples as int32 counts of
+		 * `scales`, one per channel (`recording_record_type::counts`),
+		 * halving data records; an empty vector restores float64
+		 *
+		 * @details Values are rounded to the nearest count. A block whose
+		 * counts do not give back its samples (`counts_exact()`), such as
+		 * filtered data or samples from a device whose scale differs from
+		 * `adc_microvolts_per_count()`, is written as float64 instead, so
+		 * the file stays lossless; `float_fallbacks()` counts those records.
+		 * Readers older than the counts record type skip counts records.
+		 *
+		 * @return false if `scales` is neither empty nor one positive value
+		 * per channel
+		 */
+		bool set_counts(std::vector<double> scales);
+
+		bool write_annotation(uint64_t sample, const std::string& text);
+
+		/**
+		 * @brief Writes `bool` channels such as the digital input
+		 *
+		 * @param channels One pointer per label, each to `n_samples` values
+		 */
+		bool write_digital(const bool* const* channels, const std::vector<std::string>& labels, size_t n_samples, uint64_t first_sample);
+
+		/**
+		 * @brief Makes `write_digital()` store one bit per sample
+		 * (`recording_record_type::digital_packed`) instead of one byte
+		 *
+		 * @details Off by default: readers older than the packed record type
+		 * skip packed records.
+		 */
+		void set_pack_digital(bool pack) { pack_digital_ = pack; }
+
+		bool is_open() const { return out_.is_open(); }
+		const recording_header& header() const { return header_; }
+		uint64_t samples_written() const { return samples_written_; }
+
+		/**
+		 * @brief Data records written as float64 in counts mode because
+		 * their samples were off the count grid
+		 */
+		uint64_t float_fallbacks() const { return float_fallbacks_; }
+
+		bool flush();
+		void close();
+
+	private:
+		bool write_record(recording_record_type type, const std::vector<char>& payload);
+
+		/**
+		 * Writes samples `[offset, offset + n_samples)` of each channel of
+		 * `x`, channel c starting at `x[c * stride]`.
+		 */
+		bool write_samples(const double* x, size_t stride, size_t offset, size_t n_samples, uint64_t first_sample);
+
+		std::ofstream out_;
+		recording_header header_;
+		uint64_t samples_written_ = 0;
+		uint64_t float_fallbacks_ = 0;
+		bool pack_digital_ = false;
+		std::vector<double> scales_; ///< Counts mode when not empty
+		std::vector<int32_t> counts_;
+		sample_runs runs_;
+	};
+
+	/**
+	 * @brief One record read back from a recording
+	 */
+	struct recording_record
+	{
+		recording_record_type type = recording_record_type::data;
+		uint64_t first_sample = 0; ///< Annotation sample for annotation records
+		size_t n_samples = 0;
+		std::vector<double> data; ///< Channel-major
+		std::string text;
+		std::vector<std::string> labels; ///< Channels of a digital record
+		std::vector<uint8_t> digital;    ///< Digital record values, channel-major
+	};
+
+	/**
+	 * @brief Where a data record sits in a recording, from
+	 * `recording_reader::scan()`
+	 */
+	struct recording_extent
+	{
+		uint64_t position = 0; ///< Byte offset of the record, for `recording_reader::seek()`
+		uint64_t first_sample = 0;
+		size_t n_samples = 0;
+	};
+
+	/**
+	 * @brief Sequential reader of recording files
+	 */
+	class recording_reader
+	{
+	public:
+		bool open(const std::string& path, std::string* error = nullptr);
+
+		const recording_header& header() const { return header_; }
+
+		/**
+		 * @brief Reads the next known record
+		 *
+		 * @details Packed digital records are unpacked and returned as
+		 * `recording_record_type::digital`, and counts records are scaled
+		 * and returned as `recording_record_type::data`.
+		 *
+		 * @return false at the end of the file or on a truncated record;
+		 * `failed()` tells the two apart
+		 */
+		bool next(recording_record& record);
+
+		/**
+		 * @brief Byte offset of the next record
+		 */
+		uint64_t position();
+
+		/**
+		 * @brief Continues reading at a record boundary from `position()` or
+		 * `scan()`
+		 */
+		bool seek(uint64_t position);
+
+		/**
+		 * @brief Lists the data records from the current position to the end
+		 * of the file, reading only their first bytes
+		 *
+		 * @details Lets large recordings be split into segments that are read
+		 * independently, without reading the samples twice. Leaves the reader
+		 * at the end of the file.
+		 *
+		 * @return false on a truncated record
+		 */
+		bool scan(std::vector<recording_extent>& out);
+
+		bool failed() const { return failed_; }
+
+	private:
+		std::ifstream in_;
+		recording_header header_;
+		bool failed_ = false;
+	};
+
+	/**
+	 * @brief Whole recording loaded into memory
+	 */
+	struct recording_contents
+	{
+		recording_header header;
+		uint64_t first_sample = 0;
+		size_t n_samples = 0;
+		std::vector<double> data; ///< Channel n at `data[n * n_samples]`, blocks concatenated in file order
+		std::vector<sample_gap> gaps; ///< Where sample numbers do not continue from `first_sample`, see `sample_runs`
+		std::vector<stream_annotation> annotations;
+	};
+
+	/**
+	 * @brief Reads every data and annotation record of a recording
+	 *
+	 * @details Digital records are left to `recording_reader` users such as
+	 * `extract_recording_triggers()`.
+	 */
+	bool load_recording(const std::string& path, recording_contents& out, std::string* error = nullptr);
+
+	/**
+	 * @brief Recordings named on a command line, sorted by path
+	 *
+	 * @details `input` is a directory, a path whose last component has `*`
+	 * and `?` wildcards, or a single file. Files in a directory or matching
+	 * a pattern that are not recordings, such as pyramid sidecars, are left
+	 * out; a single file is passed through unchecked.
+	 */
+	bool find_recordings(const std::string& input, std::vector<std::string>& out, std::string* error = nullptr);
+} // namespace eeg
@@ -0,0 +1,107 @@
+#include "stream/sample_numbers.h"
+
+#include <algorithm>
+
+namespace eeg
+{
+	void sample_runs::assign(const size_t* x, size_t n)
+	{
+		clear();
+		append(x, n);
+	}
+
+	void sample_runs::append(const size_t* x, size_t n)
+	{
+		if (n == 0)
+		{
+			return;
+		}
+		uint64_t expected = n_ == 0 ? static_cast<uint64_t>(x[0]) : at(n_ - 1) + 1;
+		if (n_ == 0)
+		{
+			first_ = x[0];
+		}
+		for (size_t i = 0; i < n; ++i)
+		{
+			if (x[i] != expected)
+			{
+				gaps_.push_back(sample_gap{n_ + i, x[i]});
+			}
+			expected = static_cast<uint64_t>(x[i]) + 1;
+		}
+		n_ += n;
+	}
+
+	void sample_runs::append_run(uint64_t first, size_t n)
+	{
+		if (n == 0)
+		{
+			return;
+		}
+		if (n_ == 0)
+		{
+			first_ = first;
+		}
+		else if (at(n_ - 1) + 1 != first)
+		{
+			gaps_.push_back(sample_gap{n_, first});
+		}
+		n_ += n;
+	}
+
+	void sample_runs::clear()
+	{
+		first_ = 0;
+		n_ = 0;
+		gaps_.clear();
+	}
+
+	uint64_t sample_runs::at(size_t i) const
+	{
+		// Last gap at or before i
+		const auto it = std::upper_bound(gaps_.begin(), gaps_.end(), i, [](size_t v, const sample_gap& g) { return v < g.index; });
+		if (it == gaps_.begin())
+		{
+			return first_ + i;
+		}
+		const sample_gap& g = *(it - 1);
+		return g.sample + (i - g.index);
+	}
+
+	void sample_runs::decode(size_t offset, size_t n, uint64_t* out) const
+	{
+		if (n == 0)
+		{
+			return;
+		}
+		auto next = std::upper_bound(gaps_.begin(), gaps_.end(), offset, [](size_t v, const sample_gap& g) { return v < g.index; });
+		uint64_t sample = at(offset);
+		for (size_t i = 0; i < n; ++i)
+		{
+			if (next != gaps_.end() && next->index == offset + i)
+			{
+				sample = next->sample;
+				++next;
+			}
+			out[i] = sample++;
+		}
+	}
+
+	uint64_t sample_runs::missing() const
+	{
+		uint64_t missing = 0;
+		uint64_t expected = first_;
+		size_t start = 0;
+		for (const sample_gap& g : gaps_)
+		{
+			expected += g.index - start;
+			if (g.sample > expected)
+			{
+				missing += g.sample - expected;
+			}
+			expected = g.sample;
+			start = g.index;
+		}
+		return missing;
+	}
+} // namespace eeg
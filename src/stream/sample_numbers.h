@@ -0,0 +1,100 @@
+/**
+ * @file sample_numbers.h
+ * @brief Sample-number sequences as a first value plus the places they jump
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace eeg
+{
+	/**
+	 * @brief Place where a sample-number sequence does not continue by one
+	 */
+	struct sample_gap
+	{
+		size_t index = 0;    ///< Position in the sequence
+		uint64_t sample = 0; ///< Sample number at `index`
+	};
+
+	/**
+	 * @brief Run-length form of a `BA_EEG_CHANNEL_ID_SAMPLE_NUMBER` sequence
+	 *
+	 * @details Sample numbers almost always count up by one, so a sequence is
+	 * stored as its first value and a gap for every place it does not: after
+	 * dropped samples, or a restart. Any sequence round-trips exactly,
+	 * including jumps backwards, and an unbroken stream costs no memory per
+	 * sample.
+	 */
+	class sample_runs
+	{
+	public:
+		/**
+		 * @brief Replaces the sequence with `n` sample numbers from a chunk
+		 */
+		void assign(const size_t* x, size_t n);
+
+		/**
+		 * @brief Extends the sequence with `n` sample numbers
+		 */
+		void append(const size_t* x, size_t n);
+
+		/**
+		 * @brief Extends the sequence with `n` consecutive sample numbers from
+		 * `first`
+		 */
+		void append_run(uint64_t first, size_t n);
+
+		void clear();
+
+		size_t size() const { return n_; }
+		bool empty() const { return n_ == 0; }
+		uint64_t first() const { return first_; }
+		const std::vector<sample_gap>& gaps() const { return gaps_; }
+
+		/**
+		 * @brief Sample number at position `i < size()`; O(log gaps)
+		 */
+		uint64_t at(size_t i) const;
+
+		/**
+		 * @brief Writes the sample numbers at positions `offset` to
+		 * `offset + n` to `out`
+		 */
+		void decode(size_t offset, size_t n, uint64_t* out) const;
+
+		/**
+		 * @brief Samples skipped by forward jumps; backward jumps add none
+		 */
+		uint64_t missing() const;
+
+		/**
+		 * @brief Calls `f(offset, n, first_sample)` for each stretch of
+		 * consecutive sample numbers, in order
+		 */
+		template <typename F>
+		void for_each_run(F f) const
+		{
+			size_t start = 0;
+			uint64_t sample = first_;
+			for (const sample_gap& g : gaps_)
+			{
+				f(start, g.index - start, sample);
+				start = g.index;
+				sample = g.sample;
+			}
+			if (n_ > start)
+			{
+				f(start, n_ - start, sample);
+			}
+		}
+
+	private:
+		uint64_t first_ = 0;
+		size_t n_ = 0;
+		std::vector<sample_gap> gaps_;
+	};
+} // namespace eeg
@@ -0,0 +1,153 @@
+#include "stream/simulated_device.h"
+
+#include "stream/adc_counts.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace eeg
+{
+	simulated_device::simulated_device(const simulated_device_config& config)
+		: config_(config),
+		  sample_numbers_(tracked_allocator<size_t>(this, memory_category::chunk_buffers)),
+		  electrodes_(tracked_allocator<double>(this, memory_category::chunk_buffers))
+	{
+		config_.signal.sampling_rate = config_.sampling_rate;
+
+		channels_.push_back(BA_EEG_CHANNEL_ID_SAMPLE_NUMBER);
+		for (size_t i = 0; i < config_.n_electrodes; ++i)
+		{
+			channels_.push_back(static_cast<ba_eeg_channel>(BA_EEG_CHANNEL_ID_ELECTRODE_MEASUREMENT + i));
+		}
+		size_t n_flags = 1; // streaming
+		if (config_.contacts)
+		{
+			for (size_t i = 0; i < config_.n_electrodes; ++i)
+			{
+				channels_.push_back(static_cast<ba_eeg_channel>(BA_EEG_CHANNEL_ID_ELECTRODE_CONTACT + i));
+			}
+			n_flags += config_.n_electrodes;
+		}
+		if (config_.digital_input)
+		{
+			channels_.push_back(BA_EEG_CHANNEL_ID_DIGITAL_INPUT);
+			++n_flags;
+		}
+		channels_.push_back(BA_EEG_CHANNEL_ID_STREAMING);
+
+		const size_t n = config_.chunk_size;
+		sample_numbers_.resize(n);
+		electrodes_.resize(config_.n_electrodes * n);
+		flags_.reset(new bool[n_flags * n]);
+		flags_memory_ = tracked_external(this, memory_category::chunk_buffers, n_flags * n * sizeof(bool));
+
+		chunk_.push_back(sample_numbers_.data());
+		for (size_t i = 0; i < config_.n_electrodes; ++i)
+		{
+			chunk_.push_back(electrodes_.data() + i * n);
+		}
+		for (size_t i = 0; i < n_flags; ++i)
+		{
+			chunk_.push_back(flags_.get() + i * n);
+		}
+	}
+
+	simulated_device::~simulated_device()
+	{
+		stop_stream();
+	}
+
+	size_t simulated_device::channel_index(ba_eeg_channel ch) const
+	{
+		const auto it = std::find(channels_.begin(), channels_.end(), ch);
+		return it == channels_.end() ? static_cast<size_t>(-1) : static_cast<size_t>(it - channels_.begin());
+	}
+
+	void simulated_device::set_callback_chunk(ba_callback_chunk callback, void* data)
+	{
+		callback_ = callback;
+		callback_data_ = data;
+	}
+
+	void simulated_device::start_stream()
+	{
+		if (streaming_.exchange(true))
+		{
+			return;
+		}
+		stream_start_ = clock::now();
+		thread_ = std::thread(&simulated_device::run, this);
+	}
+
+	void simulated_device::stop_stream()
+	{
+		streaming_.store(false);
+		if (thread_.joinable())
+		{
+			thread_.join();
+		}
+	}
+
+	simulated_device::clock::time_point simulated_device::scheduled_time(uint64_t sample) const
+	{
+		if (config_.acceleration <= 0)
+		{
+			return stream_start_;
+		}
+		const double seconds = static_cast<double>(sample) / (config_.sampling_rate * config_.acceleration);
+		return stream_start_ + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(seconds));
+	}
+
+	void simulated_device::run()
+	{
+		while (streaming_.load())
+		{
+			// A chunk leaves the device once its last sample has been taken
+			const uint64_t next = samples_emitted() + config_.chunk_size;
+			std::this_thread::sleep_until(scheduled_time(next));
+			emit_chunk();
+		}
+	}
+
+	void simulated_device::emit_chunk()
+	{
+		const size_t n = config_.chunk_size;
+		const uint64_t first = samples_emitted();
+
+		for (size_t i = 0; i < n; ++i)
+		{
+			sample_numbers_[i] = static_cast<size_t>(first + i);
+		}
+		synthetic_eeg(config_.signal, config_.n_electrodes, n, static_cast<size_t>(first), electrodes_.data());
+		const double scale = adc_microvolts_per_count(config_.gain);
+		if (scale > 0)
+		{
+			for (double& x : electrodes_)
+			{
+				x = std::nearbyint(x / scale) * scale;
+			}
+		}
+
+		bool* flags = flags_.get();
+		if (config_.contacts)
+		{
+			std::fill(flags, flags + config_.n_electrodes * n, true);
+			flags += config_.n_electrodes * n;
+		}
+		if (config_.digital_input)
+		{
+			for (size_t i = 0; i < n; ++i)
+			{
+				flags[i] = config_.trigger_period > 0 && (first + i) % config_.trigger_period < config_.trigger_width;
+			}
+			flags += n;
+		}
+		std::fill(flags, flags + n, true);
+
+		samples_emitted_.store(first + n, std::memory_order_release);
+		if (callback_)
+		{
+			callback_(chunk_.data(), n, callback_data_);
+		}
+	}
+} // namespace eeg
@@ -0,0 +1,124 @@
+/**
+ * @file simulated_device.h
+ * @brief Software stand-in for a streaming BrainAccess device
+ */
+
+#pragma once
+
+#include "bacore.h"
+#include "callbacks.h"
+#include "eeg_channel.h"
+#include "gain_mode.h"
+#include "util/memory_accounting.h"
+#include "util/synthetic_signal.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace eeg
+{
+	struct simulated_device_config
+	{
+		double sampling_rate = 250;
+		size_t n_electrodes = 8;
+		size_t chunk_size = BA_CONFIG_DEFAULT_CHUNK_SIZE;
+		/// Stream time per wall time; 0 emits chunks as fast as possible
+		double acceleration = 1;
+		bool contacts = true;      ///< Emit `BA_EEG_CHANNEL_ID_ELECTRODE_CONTACT` channels
+		bool digital_input = true; ///< Emit `BA_EEG_CHANNEL_ID_DIGITAL_INPUT`
+		size_t trigger_period = 250; ///< Samples between digital input pulses, 0 for none
+		size_t trigger_width = 10;   ///< Samples the digital input stays high per pulse
+		/// When known, electrode samples are whole ADC counts at this gain, as
+		/// from the device (see `adc_microvolts_per_count()`)
+		ba_gain_mode gain = BA_GAIN_MODE_UNKNOWN;
+		synthetic_signal_spec signal;
+	};
+
+	/**
+	 * @brief Produces chunks shaped like those of `ba_eeg_manager`
+	 *
+	 * @details Chunks are delivered through a `ba_callback_chunk` with the same
+	 * layout the real manager uses: one array per enabled channel, typed per
+	 * eeg_channel.h, looked up with `channel_index()`. Enabled channels are
+	 * the sample number, `n_electrodes` electrode measurements, optional
+	 * contact channels, optional digital input and the streaming flag.
+	 *
+	 * Chunks are paced in a background thread at `sampling_rate *
+	 * acceleration` samples per second, so soak tests can compress hours of
+	 * streaming into minutes.
+	 *
+	 * The device stands in for a manager in memory accounting: chunk buffers
+	 * are tracked with the device as owner.
+	 */
+	class simulated_device
+	{
+	public:
+		using clock = std::chrono::steady_clock;
+
+		explicit simulated_device(const simulated_device_config& config);
+		~simulated_device();
+		simulated_device(const simulated_device&) = delete;
+		simulated_device& operator=(const simulated_device&) = delete;
+
+		const simulated_device_config& config() const { return config_; }
+
+		/**
+		 * @brief Chunk index of a channel, `(size_t)-1` if it is not emitted
+		 *
+		 * @details Same contract as `ba_eeg_manager_get_channel_index`
+		 */
+		size_t channel_index(ba_eeg_channel ch) const;
+
+		/**
+		 * @brief Emitted channels in chunk order
+		 */
+		const std::vector<ba_eeg_channel>& channels() const { return channels_; }
+
+		/**
+		 * @brief Sets the chunk callback; must not be called while streaming
+		 */
+		void set_callback_chunk(ba_callback_chunk callback, void* data);
+
+		void start_stream();
+		void stop_stream();
+		bool is_streaming() const { return streaming_.load(); }
+
+		/**
+		 * @brief Generates and delivers one chunk on the calling thread
+		 *
+		 * @details For unpaced use without `start_stream()`
+		 */
+		void emit_chunk();
+
+		uint64_t samples_emitted() const { return samples_emitted_.load(std::memory_order_acquire); }
+
+		/**
+		 * @brief Wall-clock time at which the pacing schedule emits `sample`
+		 */
+		clock::time_point scheduled_time(uint64_t sample) const;
+
+	private:
+		void run();
+
+		simulated_device_config config_;
+		std::vector<ba_eeg_channel> channels_;
+		ba_callback_chunk callback_ = nullptr;
+		void* callback_data_ = nullptr;
+
+		tracked_vector<size_t> sample_numbers_;
+		tracked_vector<double> electrodes_;
+		std::unique_ptr<bool[]> flags_; ///< Backing store for all `bool` channels
+		tracked_external flags_memory_;
+		std::vector<const void*> chunk_;
+
+		std::atomic<bool> streaming_{false};
+		std::atomic<uint64_t> samples_emitted_{0};
+		clock::time_point stream_start_;
+		std::thread thread_;
+	};
+} // namespace eeg
@@ -0,0 +1,175 @@
+#include "stream/stream_ring.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace eeg
+{
+	stream_ring::stream_ring(size_t n_chans, size_t capacity, memory_owner owner)
+		: n_chans_(n_chans), capacity_(capacity), data_(n_chans * capacity, tracked_allocator<double>(owner, memory_category::ring_buffers)),
+		  gap_pos_(capacity / 16 + 2, tracked_allocator<uint64_t>(owner, memory_category::ring_buffers)),
+		  gap_sample_(capacity / 16 + 2, tracked_allocator<uint64_t>(owner, memory_category::ring_buffers))
+	{
+	}
+
+	size_t stream_ring::write(const double* const* channels, size_t n)
+	{
+		return write(channels, n, nullptr);
+	}
+
+	size_t stream_ring::write(const double* const* channels, size_t n, const size_t* sample_numbers)
+	{
+		const uint64_t w = write_pos_.load(std::memory_order_relaxed);
+		const uint64_t r = read_pos_.load(std::memory_order_acquire);
+		const size_t space = capacity_ - static_cast<size_t>(w - r);
+		size_t count = std::min(n, space);
+		if (sample_numbers)
+		{
+			const size_t slots = gap_pos_.size();
+			const uint64_t tail = gap_tail_.load(std::memory_order_acquire);
+			uint64_t head = gap_head_.load(std::memory_order_relaxed);
+			for (size_t i = 0; i < count; ++i)
+			{
+				if (sample_numbers[i] != next_sample_)
+				{
+					if (head - tail == slots)
+					{
+						count = i;
+						break;
+					}
+					gap_pos_[head % slots] = w + i;
+					gap_sample_[head % slots] = sample_numbers[i];
+					++head;
+				}
+				next_sample_ = static_cast<uint64_t>(sample_numbers[i]) + 1;
+			}
+			gap_head_.store(head, std::memory_order_release);
+		}
+		else
+		{
+			next_sample_ += count;
+		}
+		if (count < n)
+		{
+			dropped_.fetch_add(n - count, std::memory_order_relaxed);
+		}
+
+		const size_t start = static_cast<size_t>(w % capacity_);
+		const size_t first = std::min(count, capacity_ - start);
+		for (size_t c = 0; c < n_chans_; ++c)
+		{
+			double* dst = data_.data() + c * capacity_;
+			std::memcpy(dst + start, channels[c], first * sizeof(double));
+			std::memcpy(dst, channels[c] + first, (count - first) * sizeof(double));
+		}
+
+		write_pos_.store(w + count, std::memory_order_release);
+		return count;
+	}
+
+	size_t stream_ring::available() const
+	{
+		return static_cast<size_t>(write_pos_.load(std::memory_order_acquire) - read_pos_.load(std::memory_order_relaxed));
+	}
+
+	bool stream_ring::peek(double* out, size_t n, size_t offset) const
+	{
+		if (available() < offset + n)
+		{
+			return false;
+		}
+
+		const size_t start = static_cast<size_t>((read_pos_.load(std::memory_order_relaxed) + offset) % capacity_);
+		const size_t first = std::min(n, capacity_ - start);
+		for (size_t c = 0; c < n_chans_; ++c)
+		{
+			const double* src = data_.data() + c * capacity_;
+			std::memcpy(out + c * n, src + start, first * sizeof(double));
+			std::memcpy(out + c * n + first, src, (n - first) * sizeof(double));
+		}
+		return true;
+	}
+
+	bool stream_ring::view(size_t n, size_t offset, stream_ring_span& first, stream_ring_span& second) const
+	{
+		if (available() < offset + n)
+		{
+			return false;
+		}
+
+		const size_t start = static_cast<size_t>((read_pos_.load(std::memory_order_relaxed) + offset) % capacity_);
+		const size_t head = std::min(n, capacity_ - start);
+		first.data = data_.data() + start;
+		first.n_samples = head;
+		first.stride = capacity_;
+		second.data = data_.data();
+		second.n_samples = n - head;
+		second.stride = capacity_;
+		return true;
+	}
+
+	bool stream_ring::peek_sample_numbers(uint64_t* out, size_t n, size_t offset) const
+	{
+		if (available() < offset + n)
+		{
+			return false;
+		}
+
+		const size_t slots = gap_pos_.size();
+		const uint64_t start = read_pos_.load(std::memory_order_relaxed) + offset;
+		const uint64_t head = gap_head_.load(std::memory_order_acquire);
+		// Last entry at or before start; entries are in position order
+		uint64_t lo = gap_tail_.load(std::memory_order_relaxed);
+		uint64_t hi = head;
+		while (hi - lo > 1)
+		{
+			const uint64_t mid = lo + (hi - lo) / 2;
+			if (gap_pos_[mid % slots] <= start)
+			{
+				lo = mid;
+			}
+			else
+			{
+				hi = mid;
+			}
+		}
+		uint64_t sample = gap_sample_[lo % slots] + (start - gap_pos_[lo % slots]);
+		uint64_t next = lo + 1;
+		for (size_t i = 0; i < n; ++i)
+		{
+			if (next < head && gap_pos_[next % slots] == start + i)
+			{
+				sample = gap_sample_[next % slots];
+				++next;
+			}
+			out[i] = sample++;
+		}
+		return true;
+	}
+
+	bool stream_ring::skip(size_t n)
+	{
+		if (available() < n)
+		{
+			return false;
+		}
+		const uint64_t r = read_pos_.fetch_add(n, std::memory_order_release) + n;
+
+		// Retire gap entries that a later entry at or before the read
+		// position supersedes
+		const size_t slots = gap_pos_.size();
+		const uint64_t head = gap_head_.load(std::memory_order_acquire);
+		uint64_t tail = gap_tail_.load(std::memory_order_relaxed);
+		while (tail + 1 < head && gap_pos_[(tail + 1) % slots] <= r)
+		{
+			++tail;
+		}
+		gap_tail_.store(tail, std::memory_order_release);
+		return true;
+	}
+
+	bool stream_ring::read(double* out, size_t n)
+	{
+		return peek(out, n) && skip(n);
+	}
+} // namespace eeg
@@ -0,0 +1,152 @@
+/**
+ * @file stream_ring.h
+ * @brief Lock-free multichannel sample ring between the chunk callback and
+ * processing threads
+ */
+
+#pragma once
+
+#include "util/memory_accounting.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace eeg
+{
+	/**
+	 * @brief Samples of every channel in ring memory, channel c at
+	 * `data[c * stride]`
+	 */
+	struct stream_ring_span
+	{
+		const double* data = nullptr;
+		size_t n_samples = 0;
+		size_t stride = 0;
+	};
+
+	/**
+	 * @brief Single-producer, single-consumer ring of per-channel samples
+	 *
+	 * @details The producer is the chunk callback, which must stay short
+	 * (see `ba_eeg_manager_set_callback_chunk`), so writing never blocks:
+	 * samples that do not fit are dropped and counted in `dropped()`.
+	 *
+	 * Reads produce channel-major blocks (channel n at `out[n * n_samples]`),
+	 * the layout processor.h functions expect.
+	 *
+	 * The ring also tracks each sample's sample number, in `sample_runs`
+	 * form: a table of the positions where the numbers do not count up by
+	 * one, sized for one such gap per 16 samples of capacity. Exact sample
+	 * numbers therefore cost no memory per sample, where a `double` channel
+	 * would cost 8 bytes.
+	 */
+	class stream_ring
+	{
+	public:
+		/**
+		 * @param owner Manager the ring's memory is accounted to under
+		 * `memory_category::ring_buffers`
+		 */
+		stream_ring(size_t n_chans, size_t capacity, memory_owner owner = nullptr);
+
+		size_t n_chans() const { return n_chans_; }
+		size_t capacity() const { return capacity_; }
+
+		/**
+		 * @brief Appends `n` samples per channel (producer side)
+		 *
+		 * @param channels `n_chans()` pointers, each to `n` values
+		 * @return Samples stored; fewer than `n` when the ring is full
+		 */
+		size_t write(const double* const* channels, size_t n);
+
+		/**
+		 * @brief As `write()`, with the chunk's
+		 * `BA_EEG_CHANNEL_ID_SAMPLE_NUMBER` values
+		 *
+		 * @details Samples without them are numbered on from the previous
+		 * write, starting at 0. A gap that does not fit the gap table drops
+		 * the samples from it on, as a full ring would.
+		 */
+		size_t write(const double* const* channels, size_t n, const size_t* sample_numbers);
+
+		/**
+		 * @brief Samples ready to be read (consumer side)
+		 */
+		size_t available() const;
+
+		/**
+		 * @brief Copies `n` samples starting `offset` samples after the read
+		 * position without consuming them
+		 *
+		 * @return false if fewer than `offset + n` samples are available
+		 */
+		bool peek(double* out, size_t n, size_t offset = 0) const;
+
+		/**
+		 * @brief Locates `n` samples starting `offset` samples after the read
+		 * position in ring memory, without copying (consumer side)
+		 *
+		 * @details Samples that wrap around the end of the ring come in two
+		 * spans; otherwise `second.n_samples` is 0. The producer never
+		 * overwrites unconsumed samples, so the spans stay valid until the
+		 * samples are skipped or read.
+		 *
+		 * @return false if fewer than `offset + n` samples are available
+		 */
+		bool view(size_t n, size_t offset, stream_ring_span& first, stream_ring_span& second) const;
+
+		/**
+		 * @brief Sample numbers of `n` samples starting `offset` samples after
+		 * the read position (consumer side)
+		 *
+		 * @return false if fewer than `offset + n` samples are available
+		 */
+		bool peek_sample_numbers(uint64_t* out, size_t n, size_t offset = 0) const;
+
+		/**
+		 * @brief Consumes `n` samples; false if fewer are available
+		 */
+		bool skip(size_t n);
+
+		/**
+		 * @brief `peek` followed by `skip`
+		 */
+		bool read(double* out, size_t n);
+
+		/**
+		 * @brief Total samples accepted since construction
+		 */
+		uint64_t total_written() const { return write_pos_.load(std::memory_order_acquire); }
+
+		/**
+		 * @brief Total samples consumed since construction
+		 */
+		uint64_t total_read() const { return read_pos_.load(std::memory_order_acquire); }
+
+		/**
+		 * @brief Samples dropped because the ring was full
+		 */
+		uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+	private:
+		size_t n_chans_;
+		size_t capacity_;
+		tracked_vector<double> data_; ///< Channel c occupies [c * capacity, (c + 1) * capacity)
+
+		// Gap table: entry k says the sample at ring position gap_pos_[k]
+		// has number gap_sample_[k], later ones counting up until the next
+		// entry. Entries [gap_tail_, gap_head_) are live; the consumer
+		// retires those the read position has passed.
+		tracked_vector<uint64_t> gap_pos_;
+		tracked_vector<uint64_t> gap_sample_;
+		std::atomic<uint64_t> gap_head_{1};
+		std::atomic<uint64_t> gap_tail_{0};
+		uint64_t next_sample_ = 0; ///< Producer side: number the next sample continues with
+
+		std::atomic<uint64_t> write_pos_{0};
+		std::atomic<uint64_t> read_pos_{0};
+		std::atomic<uint64_t> dropped_{0};
+	};
+} // namespace eeg
@@ -0,0 +1,181 @@
+#include "stream/trigger_detector.h"
+
+#include "stream/recording.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EEG_TRIGGER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace eeg
+{
+	namespace
+	{
+		unsigned lowest_bit(uint64_t v)
+		{
+#if defined(_MSC_VER)
+			unsigned long index = 0;
+			_BitScanForward64(&index, v);
+			return static_cast<unsigned>(index);
+#else
+			return static_cast<unsigned>(__builtin_ctzll(v));
+#endif
+		}
+
+#ifdef EEG_TRIGGER_SSE2
+		/**
+		 * Bit i set when x[i] is true, for 16 samples.
+		 */
+		uint64_t levels16(const bool* x, __m128i zero)
+		{
+			const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x));
+			return ~static_cast<uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero))) & 0xFFFF;
+		}
+#endif
+	} // namespace
+
+	size_t find_edges_scalar(const bool* x, size_t n, uint64_t first_sample, bool& previous, std::vector<trigger_edge>& out)
+	{
+		const size_t before = out.size();
+		bool level = previous;
+		for (size_t i = 0; i < n; ++i)
+		{
+			if (x[i] != level)
+			{
+				level = x[i];
+				out.push_back(trigger_edge{first_sample + i, level});
+			}
+		}
+		previous = level;
+		return out.size() - before;
+	}
+
+	size_t find_edges(const bool* x, size_t n, uint64_t first_sample, bool& previous, std::vector<trigger_edge>& out)
+	{
+		size_t i = 0;
+		size_t found = 0;
+#ifdef EEG_TRIGGER_SSE2
+		const __m128i zero = _mm_setzero_si128();
+		uint64_t carry = previous ? 1 : 0;
+		for (; i + 64 <= n; i += 64)
+		{
+			const uint64_t levels = levels16(x + i, zero) | levels16(x + i + 16, zero) << 16 | levels16(x + i + 32, zero) << 32 |
+									levels16(x + i + 48, zero) << 48;
+			// Bit j set where sample j differs from sample j - 1
+			uint64_t changes = levels ^ (levels << 1 | carry);
+			carry = levels >> 63;
+			while (changes)
+			{
+				const unsigned bit = lowest_bit(changes);
+				out.push_back(trigger_edge{first_sample + i + bit, ((levels >> bit) & 1) != 0});
+				changes &= changes - 1;
+				++found;
+			}
+		}
+		previous = carry != 0;
+#endif
+		return found + find_edges_scalar(x + i, n - i, first_sample + i, previous, out);
+	}
+
+	trigger_detector::trigger_detector(annotation_store& store) : store_(store)
+	{
+	}
+
+	void trigger_detector::add_channel(size_t chunk_index, const std::string& label)
+	{
+		channels_[find_label(label)].chunk_index = chunk_index;
+	}
+
+	size_t trigger_detector::find_label(const std::string& label)
+	{
+		for (size_t i = 0; i < labels_.size(); ++i)
+		{
+			if (labels_[i] == label)
+			{
+				return i;
+			}
+		}
+		labels_.push_back(label);
+		channels_.emplace_back();
+		return labels_.size() - 1;
+	}
+
+	void trigger_detector::process_chunk(const void* const* data, size_t size, size_t sample_number_index)
+	{
+		const size_t* samples = static_cast<const size_t*>(data[sample_number_index]);
+		for (size_t c = 0; c < channels_.size(); ++c)
+		{
+			scan(c, static_cast<const bool*>(data[channels_[c].chunk_index]), size, 0, samples);
+		}
+	}
+
+	void trigger_detector::process(const std::string& label, const bool* x, size_t n, uint64_t first_sample)
+	{
+		scan(find_label(label), x, n, first_sample, nullptr);
+	}
+
+	void trigger_detector::scan(size_t channel, const bool* x, size_t n, uint64_t first_sample, const size_t* sample_numbers)
+	{
+		channel_state& ch = channels_[channel];
+		if (n == 0)
+		{
+			return;
+		}
+		if (!ch.known)
+		{
+			ch.level = x[0];
+			ch.known = true;
+		}
+		scratch_.clear();
+		find_edges(x, n, first_sample, ch.level, scratch_);
+		for (const trigger_edge& e : scratch_)
+		{
+			const uint64_t sample = sample_numbers ? sample_numbers[e.sample] : e.sample;
+			store_.add(static_cast<size_t>(sample), labels_[channel] + (e.rising ? " rising" : " falling"));
+		}
+		edges_ += scratch_.size();
+	}
+
+	void trigger_detector::reset()
+	{
+		for (channel_state& ch : channels_)
+		{
+			ch.known = false;
+		}
+	}
+
+	bool extract_recording_triggers(const std::string& path, trigger_detector& detector, std::string* error)
+	{
+		recording_reader reader;
+		if (!reader.open(path, error))
+		{
+			return false;
+		}
+		recording_record r;
+		while (reader.next(r))
+		{
+			if (r.type != recording_record_type::digital)
+			{
+				continue;
+			}
+			for (size_t c = 0; c < r.labels.size(); ++c)
+			{
+				const bool* x = reinterpret_cast<const bool*>(r.digital.data() + c * r.n_samples);
+				detector.process(r.labels[c], x, r.n_samples, r.first_sample);
+			}
+		}
+		if (reader.failed())
+		{
+			if (error)
+			{
+				*error = path + ": truncated record";
+			}
+			return false;
+		}
+		return true;
+	}
+} // namespace eeg
@@ -0,0 +1,120 @@
+/**
+ * @file trigger_detector.h
+ * @brief Edge extraction from `bool` channels such as the digital input
+ */
+
+#pragma once
+
+#include "stream/annotation_store.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace eeg
+{
+	/**
+	 * @brief Level change of a `bool` channel
+	 */
+	struct trigger_edge
+	{
+		uint64_t sample; ///< First sample at the new level
+		bool rising;
+	};
+
+	/**
+	 * @brief Finds the level changes in `n` samples of a `bool` channel
+	 *
+	 * @details Scans 64 samples per step with SSE2 where the target has it
+	 * (`EEG_TRIGGER_SSE2`), so edge-free stretches, the common case, cost a
+	 * few instructions per step; the remainder and other targets use
+	 * `find_edges_scalar()`. Both produce identical results.
+	 *
+	 * @param first_sample Sample number of `x[0]`
+	 * @param previous Level before `x[0]`; updated to the level of the last
+	 * sample
+	 * @return Number of edges appended to `out`
+	 */
+	size_t find_edges(const bool* x, size_t n, uint64_t first_sample, bool& previous, std::vector<trigger_edge>& out);
+
+	/**
+	 * @brief Sample-by-sample reference for `find_edges()`
+	 */
+	size_t find_edges_scalar(const bool* x, size_t n, uint64_t first_sample, bool& previous, std::vector<trigger_edge>& out);
+
+	/**
+	 * @brief Turns edges on `bool` chunk channels into annotations
+	 *
+	 * @details Events are added to an `annotation_store` as `"<label>
+	 * rising"` or `"<label> falling"` at the sample number the chunk's
+	 * sample-number channel gives for the first sample at the new level, so
+	 * they stay exact across dropped samples. The first sample seen on a
+	 * channel only sets its level.
+	 *
+	 * `process_chunk()` is cheap enough for the chunk callback; a detector
+	 * must not be fed from more than one thread.
+	 */
+	class trigger_detector
+	{
+	public:
+		explicit trigger_detector(annotation_store& store);
+
+		/**
+		 * @brief Watches the chunk channel at `chunk_index` (see
+		 * `ba_eeg_manager_get_channel_index`)
+		 */
+		void add_channel(size_t chunk_index, const std::string& label);
+
+		/**
+		 * @brief Scans a chunk as passed to a `ba_callback_chunk`
+		 *
+		 * @param sample_number_index Chunk index of
+		 * `BA_EEG_CHANNEL_ID_SAMPLE_NUMBER`
+		 */
+		void process_chunk(const void* const* data, size_t size, size_t sample_number_index);
+
+		/**
+		 * @brief Scans samples of one channel, by label, with consecutive
+		 * sample numbers from `first_sample`; adds the channel if it is new
+		 */
+		void process(const std::string& label, const bool* x, size_t n, uint64_t first_sample);
+
+		const std::vector<std::string>& labels() const { return labels_; }
+
+		/**
+		 * @brief Edges found so far
+		 */
+		uint64_t edges() const { return edges_; }
+
+		/**
+		 * @brief Forgets channel levels, e.g. after a reconnect
+		 */
+		void reset();
+
+	private:
+		struct channel_state
+		{
+			size_t chunk_index = 0;
+			bool level = false;
+			bool known = false;
+		};
+
+		size_t find_label(const std::string& label);
+		void scan(size_t channel, const bool* x, size_t n, uint64_t first_sample, const size_t* sample_numbers);
+
+		annotation_store& store_;
+		std::vector<std::string> labels_;
+		std::vector<channel_state> channels_;
+		std::vector<trigger_edge> scratch_;
+		uint64_t edges_ = 0;
+	};
+
+	/**
+	 * @brief Runs a `trigger_detector` over the digital records of a
+	 * recording
+	 *
+	 * @return false if the file cannot be read
+	 */
+	bool extract_recording_triggers(const std::string& path, trigger_detector& detector, std::string* error = nullptr);
+} // namespace eeg
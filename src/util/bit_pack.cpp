@@ -0,0 +1,202 @@
+#include "util/bit_pack.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EEG_BIT_PACK_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace eeg
+{
+	namespace
+	{
+		size_t popcount(uint64_t v)
+		{
+#if defined(_MSC_VER) && defined(_M_X64)
+			return static_cast<size_t>(__popcnt64(v));
+#elif defined(_MSC_VER)
+			return static_cast<size_t>(__popcnt(static_cast<uint32_t>(v)) + __popcnt(static_cast<uint32_t>(v >> 32)));
+#else
+			return static_cast<size_t>(__builtin_popcountll(v));
+#endif
+		}
+
+		/**
+		 * Bits `[from, to)` of one word, `0 <= from < to <= 64`.
+		 */
+		uint64_t range_mask(size_t from, size_t to)
+		{
+			const uint64_t high = to == 64 ? ~uint64_t(0) : (uint64_t(1) << to) - 1;
+			return high & ~((uint64_t(1) << from) - 1);
+		}
+
+		uint64_t pack_word_scalar(const bool* x, size_t n)
+		{
+			uint64_t w = 0;
+			for (size_t i = 0; i < n; ++i)
+			{
+				w |= static_cast<uint64_t>(x[i] ? 1 : 0) << i;
+			}
+			return w;
+		}
+
+#ifdef EEG_BIT_PACK_SSE2
+		uint64_t pack16(const bool* x, __m128i zero)
+		{
+			const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x));
+			return ~static_cast<uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero))) & 0xFFFF;
+		}
+
+		/**
+		 * Spreads 16 bits to 16 bytes of 0 or 1.
+		 */
+		void unpack16(uint32_t bits, bool* x)
+		{
+			const __m128i select = _mm_set1_epi64x(static_cast<int64_t>(0x8040201008040201ULL));
+			const __m128i bytes = _mm_set_epi64x(static_cast<int64_t>(((bits >> 8) & 0xFF) * 0x0101010101010101ULL),
+												 static_cast<int64_t>((bits & 0xFF) * 0x0101010101010101ULL));
+			const __m128i set = _mm_cmpeq_epi8(_mm_and_si128(bytes, select), select);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(x), _mm_and_si128(set, _mm_set1_epi8(1)));
+		}
+#endif
+
+		uint64_t pack_word(const bool* x, size_t n)
+		{
+#ifdef EEG_BIT_PACK_SSE2
+			if (n == 64)
+			{
+				const __m128i zero = _mm_setzero_si128();
+				return pack16(x, zero) | pack16(x + 16, zero) << 16 | pack16(x + 32, zero) << 32 | pack16(x + 48, zero) << 48;
+			}
+#endif
+			return pack_word_scalar(x, n);
+		}
+
+		void unpack_word(uint64_t w, size_t n, bool* x)
+		{
+#ifdef EEG_BIT_PACK_SSE2
+			if (n == 64)
+			{
+				for (size_t k = 0; k < 4; ++k)
+				{
+					unpack16(static_cast<uint32_t>(w >> (16 * k)), x + 16 * k);
+				}
+				return;
+			}
+#endif
+			for (size_t i = 0; i < n; ++i)
+			{
+				x[i] = ((w >> i) & 1) != 0;
+			}
+		}
+	} // namespace
+
+	void pack_bools(const bool* x, size_t n, uint64_t* bits)
+	{
+		for (size_t w = 0; w < packed_words(n); ++w)
+		{
+			const size_t count = n - w * 64 < 64 ? n - w * 64 : 64;
+			bits[w] = pack_word(x + w * 64, count);
+		}
+	}
+
+	void pack_bools_scalar(const bool* x, size_t n, uint64_t* bits)
+	{
+		for (size_t w = 0; w < packed_words(n); ++w)
+		{
+			const size_t count = n - w * 64 < 64 ? n - w * 64 : 64;
+			bits[w] = pack_word_scalar(x + w * 64, count);
+		}
+	}
+
+	void pack_bools_at(const bool* x, size_t n, uint64_t* bits, size_t offset)
+	{
+		// Pack 64 input samples at a time and deposit them across at most two
+		// destination words
+		for (size_t i = 0; i < n; i += 64)
+		{
+			const size_t count = n - i < 64 ? n - i : 64;
+			const uint64_t w = pack_word(x + i, count);
+			const size_t pos = offset + i;
+			const size_t word = pos / 64;
+			const size_t shift = pos % 64;
+			const size_t first = 64 - shift < count ? 64 - shift : count;
+			const uint64_t mask = range_mask(shift, shift + first);
+			bits[word] = (bits[word] & ~mask) | ((w << shift) & mask);
+			if (first < count)
+			{
+				const uint64_t rest = range_mask(0, count - first);
+				bits[word + 1] = (bits[word + 1] & ~rest) | ((w >> first) & rest);
+			}
+		}
+	}
+
+	void unpack_bools(const uint64_t* bits, size_t offset, size_t n, bool* x)
+	{
+		size_t i = 0;
+		// Unaligned head up to a word boundary
+		if (offset % 64 != 0)
+		{
+			const size_t shift = offset % 64;
+			const size_t count = 64 - shift < n ? 64 - shift : n;
+			unpack_word(bits[offset / 64] >> shift, count, x);
+			i = count;
+		}
+		for (; i < n; i += 64)
+		{
+			const size_t count = n - i < 64 ? n - i : 64;
+			unpack_word(bits[(offset + i) / 64], count, x + i);
+		}
+	}
+
+	void unpack_bools_scalar(const uint64_t* bits, size_t offset, size_t n, bool* x)
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			const size_t pos = offset + i;
+			x[i] = ((bits[pos / 64] >> (pos % 64)) & 1) != 0;
+		}
+	}
+
+	size_t count_set(const uint64_t* bits, size_t from, size_t to)
+	{
+		if (from >= to)
+		{
+			return 0;
+		}
+		const size_t first = from / 64;
+		const size_t last = (to - 1) / 64;
+		if (first == last)
+		{
+			return popcount(bits[first] & range_mask(from % 64, (to - 1) % 64 + 1));
+		}
+		size_t count = popcount(bits[first] & range_mask(from % 64, 64));
+		for (size_t w = first + 1; w < last; ++w)
+		{
+			count += popcount(bits[w]);
+		}
+		return count + popcount(bits[last] & range_mask(0, (to - 1) % 64 + 1));
+	}
+
+	bool all_set(const uint64_t* bits, size_t from, size_t to)
+	{
+		if (from >= to)
+		{
+			return true;
+		}
+		const size_t first = from / 64;
+		const size_t last = (to - 1) / 64;
+		for (size_t w = first; w <= last; ++w)
+		{
+			const uint64_t mask = range_mask(w == first ? from % 64 : 0, w == last ? (to - 1) % 64 + 1 : 64);
+			if ((bits[w] & mask) != mask)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+} // namespace eeg
@@ -0,0 +1,61 @@
+/**
+ * @file bit_pack.h
+ * @brief One-bit-per-sample storage for `bool` channels
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace eeg
+{
+	/**
+	 * @details A packed channel is a stream of 64-bit words: sample `i` is
+	 * bit `i % 64` of word `i / 64`. Several channels are stored
+	 * channel-major, each starting on a word boundary, like the `double`
+	 * blocks processor.h uses. Kernels use SSE2 where the target has it and
+	 * fall back to scalar loops otherwise; both give identical results.
+	 */
+
+	/**
+	 * @brief Words needed for `n` samples of one channel
+	 */
+	constexpr size_t packed_words(size_t n)
+	{
+		return (n + 63) / 64;
+	}
+
+	/**
+	 * @brief Packs `n` values into `packed_words(n)` words; unused high bits
+	 * of the last word are cleared
+	 */
+	void pack_bools(const bool* x, size_t n, uint64_t* bits);
+
+	/**
+	 * @brief Writes `n` values into `bits` starting at bit `offset`, leaving
+	 * the other bits untouched
+	 */
+	void pack_bools_at(const bool* x, size_t n, uint64_t* bits, size_t offset);
+
+	/**
+	 * @brief Expands bits `offset` to `offset + n` into one `bool` per sample
+	 */
+	void unpack_bools(const uint64_t* bits, size_t offset, size_t n, bool* x);
+
+	/**
+	 * @brief Number of set bits in `[from, to)`
+	 */
+	size_t count_set(const uint64_t* bits, size_t from, size_t to);
+
+	/**
+	 * @brief True if every bit in `[from, to)` is set; true for an empty range
+	 */
+	bool all_set(const uint64_t* bits, size_t from, size_t to);
+
+	/**
+	 * @brief Scalar references for the kernels above, for tests and benchmarks
+	 */
+	void pack_bools_scalar(const bool* x, size_t n, uint64_t* bits);
+	void unpack_bools_scalar(const uint64_t* bits, size_t offset, size_t n, bool* x);
+} // namespace eeg
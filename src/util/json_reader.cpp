@@ -0,0 +1,433 @@
+#include "util/json_reader.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace eeg
+{
+	namespace
+	{
+		constexpr int max_depth = 64;
+	} // namespace
+
+	const json_value* json_value::find(const std::string& key) const
+	{
+		if (!is_object())
+		{
+			return nullptr;
+		}
+		for (size_t i = 0; i < keys_.size(); ++i)
+		{
+			if (keys_[i] == key)
+			{
+				return &items_[i];
+			}
+		}
+		return nullptr;
+	}
+
+	double json_value::number_or(const std::string& key, double def) const
+	{
+		const json_value* v = find(key);
+		return v ? v->as_number(def) : def;
+	}
+
+	std::string json_value::string_or(const std::string& key, const std::string& def) const
+	{
+		const json_value* v = find(key);
+		return v && v->is_string() ? v->as_string() : def;
+	}
+
+	bool json_value::bool_or(const std::string& key, bool def) const
+	{
+		const json_value* v = find(key);
+		return v ? v->as_bool(def) : def;
+	}
+
+	class json_parser
+	{
+	public:
+		explicit json_parser(const std::string& text) : text_(text) {}
+
+		bool parse(json_value& out, std::string* error)
+		{
+			skip_space();
+			bool ok = value(out, 0);
+			if (ok)
+			{
+				skip_space();
+				if (pos_ != text_.size())
+				{
+					ok = fail("unexpected trailing characters");
+				}
+			}
+			if (!ok && error)
+			{
+				size_t line = 1;
+				size_t column = 1;
+				for (size_t i = 0; i < pos_ && i < text_.size(); ++i)
+				{
+					column = text_[i] == '\n' ? 1 : column + 1;
+					line += text_[i] == '\n' ? 1 : 0;
+				}
+				*error = message_ + " at line " + std::to_string(line) + ", column " + std::to_string(column);
+			}
+			return ok;
+		}
+
+	private:
+		bool fail(const char* message)
+		{
+			message_ = message;
+			return false;
+		}
+
+		void skip_space()
+		{
+			while (pos_ < text_.size() && (text_[pos_] == ' ' || text_[pos_] == '\t' || text_[pos_] == '\n' || text_[pos_] == '\r'))
+			{
+				++pos_;
+			}
+		}
+
+		bool literal(const char* word)
+		{
+			for (size_t i = 0; word[i]; ++i, ++pos_)
+			{
+				if (pos_ >= text_.size() || text_[pos_] != word[i])
+				{
+					return fail("invalid literal");
+				}
+			}
+			return true;
+		}
+
+		bool value(json_value& out, int depth)
+		{
+			if (depth > max_depth)
+			{
+				return fail("nesting too deep");
+			}
+			if (pos_ >= text_.size())
+			{
+				return fail("unexpected end of input");
+			}
+			switch (text_[pos_])
+			{
+			case '{':
+				return object(out, depth);
+			case '[':
+				return array(out, depth);
+			case '"':
+				out.kind_ = json_value::kind::string;
+				return string(out.string_);
+			case 't':
+				out.kind_ = json_value::kind::boolean;
+				out.bool_ = true;
+				return literal("true");
+			case 'f':
+				out.kind_ = json_value::kind::boolean;
+				out.bool_ = false;
+				return literal("false");
+			case 'n':
+				out.kind_ = json_value::kind::null;
+				return literal("null");
+			default:
+				return number(out);
+			}
+		}
+
+		bool number(json_value& out)
+		{
+			const size_t start = pos_;
+			if (pos_ < text_.size() && text_[pos_] == '-')
+			{
+				++pos_;
+			}
+			const size_t digits = pos_;
+			while (pos_ < text_.size() && std::isdigit(static_cast<unsigned char>(text_[pos_])))
+			{
+				++pos_;
+			}
+			if (pos_ == digits)
+			{
+				return fail("invalid value");
+			}
+			if (pos_ < text_.size() && text_[pos_] == '.')
+			{
+				++pos_;
+				while (pos_ < text_.size() && std::isdigit(static_cast<unsigned char>(text_[pos_])))
+				{
+					++pos_;
+				}
+			}
+			if (pos_ < text_.size() && (text_[pos_] == 'e' || text_[pos_] == 'E'))
+			{
+				++pos_;
+				if (pos_ < text_.size() && (text_[pos_] == '+' || text_[pos_] == '-'))
+				{
+					++pos_;
+				}
+				while (pos_ < text_.size() && std::isdigit(static_cast<unsigned char>(text_[pos_])))
+				{
+					++pos_;
+				}
+			}
+			out.kind_ = json_value::kind::number;
+			out.number_ = std::strtod(text_.substr(start, pos_ - start).c_str(), nullptr);
+			return true;
+		}
+
+		bool hex4(unsigned& code)
+		{
+			if (pos_ + 4 > text_.size())
+			{
+				return fail("truncated unicode escape");
+			}
+			code = 0;
+			for (int i = 0; i < 4; ++i, ++pos_)
+			{
+				const char c = text_[pos_];
+				code <<= 4;
+				if (c >= '0' && c <= '9')
+				{
+					code |= static_cast<unsigned>(c - '0');
+				}
+				else if (c >= 'a' && c <= 'f')
+				{
+					code |= static_cast<unsigned>(c - 'a' + 10);
+				}
+				else if (c >= 'A' && c <= 'F')
+				{
+					code |= static_cast<unsigned>(c - 'A' + 10);
+				}
+				else
+				{
+					return fail("invalid unicode escape");
+				}
+			}
+			return true;
+		}
+
+		static void append_utf8(std::string& out, unsigned code)
+		{
+			if (code < 0x80)
+			{
+				out += static_cast<char>(code);
+			}
+			else if (code < 0x800)
+			{
+				out += static_cast<char>(0xC0 | (code >> 6));
+				out += static_cast<char>(0x80 | (code & 0x3F));
+			}
+			else if (code < 0x10000)
+			{
+				out += static_cast<char>(0xE0 | (code >> 12));
+				out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+				out += static_cast<char>(0x80 | (code & 0x3F));
+			}
+			else
+			{
+				out += static_cast<char>(0xF0 | (code >> 18));
+				out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+				out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+				out += static_cast<char>(0x80 | (code & 0x3F));
+			}
+		}
+
+		bool string(std::string& out)
+		{
+			++pos_; // opening quote
+			out.clear();
+			while (pos_ < text_.size())
+			{
+				const char c = text_[pos_++];
+				if (c == '"')
+				{
+					return true;
+				}
+				if (c != '\\')
+				{
+					out += c;
+					continue;
+				}
+				if (pos_ >= text_.size())
+				{
+					break;
+				}
+				const char e = text_[pos_++];
+				switch (e)
+				{
+				case '"':
+				case '\\':
+				case '/':
+					out += e;
+					break;
+				case 'b':
+					out += '\b';
+					break;
+				case 'f':
+					out += '\f';
+					break;
+				case 'n':
+					out += '\n';
+					break;
+				case 'r':
+					out += '\r';
+					break;
+				case 't':
+					out += '\t';
+					break;
+				case 'u':
+				{
+					unsigned code = 0;
+					if (!hex4(code))
+					{
+						return false;
+					}
+					// Surrogate pair
+					if (code >= 0xD800 && code < 0xDC00 && pos_ + 1 < text_.size() && text_[pos_] == '\\' && text_[pos_ + 1] == 'u')
+					{
+						pos_ += 2;
+						unsigned low = 0;
+						if (!hex4(low))
+						{
+							return false;
+						}
+						code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+					}
+					append_utf8(out, code);
+					break;
+				}
+				default:
+					return fail("invalid escape");
+				}
+			}
+			return fail("unterminated string");
+		}
+
+		bool array(json_value& out, int depth)
+		{
+			++pos_;
+			out.kind_ = json_value::kind::array;
+			skip_space();
+			if (pos_ < text_.size() && text_[pos_] == ']')
+			{
+				++pos_;
+				return true;
+			}
+			while (true)
+			{
+				out.items_.emplace_back();
+				skip_space();
+				if (!value(out.items_.back(), depth + 1))
+				{
+					return false;
+				}
+				skip_space();
+				if (pos_ >= text_.size())
+				{
+					return fail("unterminated array");
+				}
+				const char c = text_[pos_++];
+				if (c == ']')
+				{
+					return true;
+				}
+				if (c != ',')
+				{
+					--pos_;
+					return fail("expected ',' or ']'");
+				}
+			}
+		}
+
+		bool object(json_value& out, int depth)
+		{
+			++pos_;
+			out.kind_ = json_value::kind::object;
+			skip_space();
+			if (pos_ < text_.size() && text_[pos_] == '}')
+			{
+				++pos_;
+				return true;
+			}
+			while (true)
+			{
+				skip_space();
+				if (pos_ >= text_.size() || text_[pos_] != '"')
+				{
+					return fail("expected member name");
+				}
+				out.keys_.emplace_back();
+				if (!string(out.keys_.back()))
+				{
+					return false;
+				}
+				skip_space();
+				if (pos_ >= text_.size() || text_[pos_] != ':')
+				{
+					return fail("expected ':'");
+				}
+				++pos_;
+				skip_space();
+				out.items_.emplace_back();
+				if (!value(out.items_.back(), depth + 1))
+				{
+					return false;
+				}
+				skip_space();
+				if (pos_ >= text_.size())
+				{
+					return fail("unterminated object");
+				}
+				const char c = text_[pos_++];
+				if (c == '}')
+				{
+					return true;
+				}
+				if (c != ',')
+				{
+					--pos_;
+					return fail("expected ',' or '}'");
+				}
+			}
+		}
+
+		const std::string& text_;
+		size_t pos_ = 0;
+		std::string message_;
+	};
+
+	bool parse_json(const std::string& text, json_value& out, std::string* error)
+	{
+		out = json_value();
+		return json_parser(text).parse(out, error);
+	}
+
+	bool read_json_file(const std::string& path, json_value& out, std::string* error)
+	{
+		std::ifstream in(path, std::ios::binary);
+		if (!in)
+		{
+			if (error)
+			{
+				*error = "cannot open " + path;
+			}
+			return false;
+		}
+		std::ostringstream buf;
+		buf << in.rdbuf();
+		if (!parse_json(buf.str(), out, error))
+		{
+			if (error)
+			{
+				*error = path + ": " + *error;
+			}
+			return false;
+		}
+		return true;
+	}
+} // namespace eeg
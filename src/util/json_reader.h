@@ -0,0 +1,93 @@
+/**
+ * @file json_reader.h
+ * @brief Minimal JSON document parser used for configuration files
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace eeg
+{
+	/**
+	 * @brief Parsed JSON value
+	 *
+	 * @details Objects keep their members in document order. Accessors of the
+	 * wrong kind return the given default (or an empty value) instead of
+	 * failing, so configuration code can read optional settings directly.
+	 */
+	class json_value
+	{
+	public:
+		enum class kind
+		{
+			null,
+			boolean,
+			number,
+			string,
+			array,
+			object
+		};
+
+		json_value() = default;
+		explicit json_value(kind k) : kind_(k) {}
+
+		kind type() const { return kind_; }
+		bool is_null() const { return kind_ == kind::null; }
+		bool is_bool() const { return kind_ == kind::boolean; }
+		bool is_number() const { return kind_ == kind::number; }
+		bool is_string() const { return kind_ == kind::string; }
+		bool is_array() const { return kind_ == kind::array; }
+		bool is_object() const { return kind_ == kind::object; }
+
+		bool as_bool(bool def = false) const { return is_bool() ? bool_ : def; }
+		double as_number(double def = 0) const { return is_number() ? number_ : def; }
+		const std::string& as_string() const { return string_; }
+
+		/**
+		 * @brief Array elements or object member values
+		 */
+		const std::vector<json_value>& items() const { return items_; }
+
+		/**
+		 * @brief Object member names, parallel to `items()`
+		 */
+		const std::vector<std::string>& keys() const { return keys_; }
+
+		size_t size() const { return items_.size(); }
+
+		/**
+		 * @brief Object member by name, nullptr if absent or not an object
+		 */
+		const json_value* find(const std::string& key) const;
+
+		double number_or(const std::string& key, double def) const;
+		std::string string_or(const std::string& key, const std::string& def) const;
+		bool bool_or(const std::string& key, bool def) const;
+
+	private:
+		friend class json_parser;
+
+		kind kind_ = kind::null;
+		bool bool_ = false;
+		double number_ = 0;
+		std::string string_;
+		std::vector<json_value> items_;
+		std::vector<std::string> keys_;
+	};
+
+	/**
+	 * @brief Parses a complete JSON document
+	 *
+	 * @param error Receives a message with the line and column on failure
+	 * @return false on a syntax error
+	 */
+	bool parse_json(const std::string& text, json_value& out, std::string* error = nullptr);
+
+	/**
+	 * @brief Reads and parses a JSON file
+	 */
+	bool read_json_file(const std::string& path, json_value& out, std::string* error = nullptr);
+} // namespace eeg
@@ -0,0 +1,181 @@
+#include "util/json_writer.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+namespace eeg
+{
+	json_writer::json_writer(std::ostream& out, int indent) : out_(out), indent_(indent)
+	{
+	}
+
+	void json_writer::newline()
+	{
+		if (indent_ <= 0)
+		{
+			return;
+		}
+		out_ << '\n';
+		for (size_t i = 0; i < has_items_.size() * static_cast<size_t>(indent_); ++i)
+		{
+			out_ << ' ';
+		}
+	}
+
+	void json_writer::before_value()
+	{
+		if (after_key_)
+		{
+			after_key_ = false;
+			return;
+		}
+		if (!has_items_.empty())
+		{
+			if (has_items_.back())
+			{
+				out_ << ',';
+			}
+			has_items_.back() = true;
+			newline();
+		}
+	}
+
+	json_writer& json_writer::begin_object()
+	{
+		before_value();
+		out_ << '{';
+		has_items_.push_back(false);
+		return *this;
+	}
+
+	void json_writer::close(char bracket)
+	{
+		const bool had_items = has_items_.back();
+		has_items_.pop_back();
+		if (had_items)
+		{
+			newline();
+		}
+		out_ << bracket;
+	}
+
+	json_writer& json_writer::end_object()
+	{
+		close('}');
+		return *this;
+	}
+
+	json_writer& json_writer::begin_array()
+	{
+		before_value();
+		out_ << '[';
+		has_items_.push_back(false);
+		return *this;
+	}
+
+	json_writer& json_writer::end_array()
+	{
+		close(']');
+		return *this;
+	}
+
+	json_writer& json_writer::key(const std::string& name)
+	{
+		before_value();
+		out_ << json_quote(name) << (indent_ > 0 ? ": " : ":");
+		after_key_ = true;
+		return *this;
+	}
+
+	json_writer& json_writer::value(const std::string& v)
+	{
+		before_value();
+		out_ << json_quote(v);
+		return *this;
+	}
+
+	json_writer& json_writer::value(const char* v)
+	{
+		return value(std::string(v));
+	}
+
+	json_writer& json_writer::value(double v)
+	{
+		before_value();
+		if (!std::isfinite(v))
+		{
+			// JSON has no representation for NaN/Inf
+			out_ << "null";
+			return *this;
+		}
+		// Shortest of %.15g/%.17g that reads back to the same value
+		char buf[32];
+		std::snprintf(buf, sizeof(buf), "%.15g", v);
+		if (std::strtod(buf, nullptr) != v)
+		{
+			std::snprintf(buf, sizeof(buf), "%.17g", v);
+		}
+		out_ << buf;
+		return *this;
+	}
+
+	json_writer& json_writer::value(int64_t v)
+	{
+		before_value();
+		out_ << v;
+		return *this;
+	}
+
+	json_writer& json_writer::value(uint64_t v)
+	{
+		before_value();
+		out_ << v;
+		return *this;
+	}
+
+	json_writer& json_writer::value(bool v)
+	{
+		before_value();
+		out_ << (v ? "true" : "false");
+		return *this;
+	}
+
+	json_writer& json_writer::null()
+	{
+		before_value();
+		out_ << "null";
+		return *this;
+	}
+
+	std::string json_quote(const std::string& s)
+	{
+		std::string out;
+		out.reserve(s.size() + 2);
+		out += '"';
+		for (const char c : s)
+		{
+			switch (c)
+			{
+			case '"': out += "\\\""; break;
+			case '\\': out += "\\\\"; break;
+			case '\n': out += "\\n"; break;
+			case '\r': out += "\\r"; break;
+			case '\t': out += "\\t"; break;
+			default:
+				if (static_cast<unsigned char>(c) < 0x20)
+				{
+					char buf[8];
+					std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+					out += buf;
+				}
+				else
+				{
+					out += c;
+				}
+			}
+		}
+		out += '"';
+		return out;
+	}
+} // namespace eeg
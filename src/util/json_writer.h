@@ -0,0 +1,73 @@
+/**
+ * @file json_writer.h
+ * @brief Minimal streaming JSON writer used for reports and metrics
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace eeg
+{
+	/**
+	 * @brief Writes well-formed, indented JSON to an output stream
+	 *
+	 * @details Values are written in document order. Inside an object every
+	 * value must be preceded by `key()`. The writer does not validate nesting
+	 * beyond what is needed to place commas correctly.
+	 */
+	class json_writer
+	{
+	public:
+		explicit json_writer(std::ostream& out, int indent = 2);
+
+		json_writer& begin_object();
+		json_writer& end_object();
+		json_writer& begin_array();
+		json_writer& end_array();
+
+		/**
+		 * @brief Writes an object member name; the next call writes its value
+		 */
+		json_writer& key(const std::string& name);
+
+		json_writer& value(const std::string& v);
+		json_writer& value(const char* v);
+		json_writer& value(double v);
+		json_writer& value(int64_t v);
+		json_writer& value(uint64_t v);
+		json_writer& value(int v) { return value(static_cast<int64_t>(v)); }
+		json_writer& value(unsigned v) { return value(static_cast<uint64_t>(v)); }
+		json_writer& value(bool v);
+		json_writer& null();
+
+		/**
+		 * @brief Writes `"name": value` inside an object
+		 */
+		template <typename T>
+		json_writer& member(const std::string& name, const T& v)
+		{
+			key(name);
+			return value(v);
+		}
+
+	private:
+		void before_value();
+		void close(char bracket);
+		void newline();
+
+		std::ostream& out_;
+		int indent_;
+		std::vector<bool> has_items_;
+		bool after_key_ = false;
+	};
+
+	/**
+	 * @brief Escapes a string for inclusion in a JSON document, including quotes
+	 */
+	std::string json_quote(const std::string& s);
+} // namespace eeg
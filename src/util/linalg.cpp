@@ -0,0 +1,170 @@
+#include "util/linalg.h"
+
+#include "restrict.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace eeg
+{
+	namespace
+	{
+		/**
+		 * Diagonalises `a` in place by cyclic Jacobi sweeps, applying each
+		 * rotation to the columns of `v` as well, then writes the diagonal
+		 * sorted descending with the matching columns of `v`.
+		 */
+		void jacobi(std::vector<double>& a, std::vector<double>& v, size_t n, std::vector<double>& values, std::vector<double>& vectors)
+		{
+			for (int sweep = 0; sweep < 100; ++sweep)
+			{
+				double off = 0;
+				double diagonal = 0;
+				for (size_t p = 0; p < n; ++p)
+				{
+					diagonal += a[p * n + p] * a[p * n + p];
+					for (size_t q = p + 1; q < n; ++q)
+					{
+						off += a[p * n + q] * a[p * n + q];
+					}
+				}
+				if (off <= 1e-30 * diagonal || off == 0)
+				{
+					break;
+				}
+				for (size_t p = 0; p < n; ++p)
+				{
+					for (size_t q = p + 1; q < n; ++q)
+					{
+						const double apq = a[p * n + q];
+						if (apq == 0)
+						{
+							continue;
+						}
+						// Rotation zeroing a[p][q], the smaller of the two angles
+						const double theta = (a[q * n + q] - a[p * n + p]) / (2 * apq);
+						const double t = (theta >= 0 ? 1.0 : -1.0) / (std::abs(theta) + std::sqrt(theta * theta + 1));
+						const double c = 1 / std::sqrt(t * t + 1);
+						const double s = t * c;
+						for (size_t k = 0; k < n; ++k)
+						{
+							const double akp = a[k * n + p];
+							const double akq = a[k * n + q];
+							a[k * n + p] = c * akp - s * akq;
+							a[k * n + q] = s * akp + c * akq;
+						}
+						for (size_t k = 0; k < n; ++k)
+						{
+							const double apk = a[p * n + k];
+							const double aqk = a[q * n + k];
+							a[p * n + k] = c * apk - s * aqk;
+							a[q * n + k] = s * apk + c * aqk;
+						}
+						for (size_t k = 0; k < n; ++k)
+						{
+							const double vkp = v[k * n + p];
+							const double vkq = v[k * n + q];
+							v[k * n + p] = c * vkp - s * vkq;
+							v[k * n + q] = s * vkp + c * vkq;
+						}
+					}
+				}
+			}
+
+			std::vector<size_t> order(n);
+			std::iota(order.begin(), order.end(), size_t(0));
+			std::sort(order.begin(), order.end(), [&a, n](size_t i, size_t j) { return a[i * n + i] > a[j * n + j]; });
+			values.resize(n);
+			vectors.resize(n * n);
+			for (size_t k = 0; k < n; ++k)
+			{
+				values[k] = a[order[k] * n + order[k]];
+				for (size_t i = 0; i < n; ++i)
+				{
+					vectors[i * n + k] = v[i * n + order[k]];
+				}
+			}
+		}
+	} // namespace
+
+	void symmetric_eigen(const std::vector<double>& matrix, size_t n, std::vector<double>& values, std::vector<double>& vectors)
+	{
+		std::vector<double> a(matrix.begin(), matrix.begin() + static_cast<std::ptrdiff_t>(n * n));
+		std::vector<double> v(n * n, 0.0);
+		for (size_t i = 0; i < n; ++i)
+		{
+			v[i * n + i] = 1;
+		}
+		jacobi(a, v, n, values, vectors);
+	}
+
+	void refine_symmetric_eigen(const std::vector<double>& matrix, size_t n, std::vector<double>& values, std::vector<double>& vectors)
+	{
+		// In the previous basis the matrix is nearly diagonal, so the sweeps
+		// only mop up what changed
+		std::vector<double> v(vectors.begin(), vectors.begin() + static_cast<std::ptrdiff_t>(n * n));
+		std::vector<double> av;
+		matrix_multiply(matrix, v, n, n, n, av);
+		std::vector<double> a(n * n, 0.0);
+		for (size_t i = 0; i < n; ++i)
+		{
+			for (size_t j = i; j < n; ++j)
+			{
+				double sum = 0;
+				for (size_t k = 0; k < n; ++k)
+				{
+					sum += v[k * n + i] * av[k * n + j];
+				}
+				a[i * n + j] = a[j * n + i] = sum;
+			}
+		}
+		jacobi(a, v, n, values, vectors);
+	}
+
+	void covariance(const double* x, size_t n_chans, size_t n_samples, const double* mean, std::vector<double>& out)
+	{
+		out.assign(n_chans * n_chans, 0.0);
+		std::vector<double> centred(n_chans * n_samples);
+		for (size_t c = 0; c < n_chans; ++c)
+		{
+			for (size_t t = 0; t < n_samples; ++t)
+			{
+				centred[c * n_samples + t] = x[c * n_samples + t] - mean[c];
+			}
+		}
+		const double scale = n_samples > 0 ? 1.0 / static_cast<double>(n_samples) : 0.0;
+		for (size_t i = 0; i < n_chans; ++i)
+		{
+			const double* restrict a = &centred[i * n_samples];
+			for (size_t j = i; j < n_chans; ++j)
+			{
+				const double* restrict b = &centred[j * n_samples];
+				double sum = 0;
+				for (size_t t = 0; t < n_samples; ++t)
+				{
+					sum += a[t] * b[t];
+				}
+				out[i * n_chans + j] = out[j * n_chans + i] = sum * scale;
+			}
+		}
+	}
+
+	void matrix_multiply(const std::vector<double>& a, const std::vector<double>& b, size_t n, size_t k, size_t m, std::vector<double>& c)
+	{
+		c.assign(n * m, 0.0);
+		for (size_t i = 0; i < n; ++i)
+		{
+			double* restrict row = &c[i * m];
+			for (size_t j = 0; j < k; ++j)
+			{
+				const double aij = a[i * k + j];
+				const double* restrict bj = &b[j * m];
+				for (size_t l = 0; l < m; ++l)
+				{
+					row[l] += aij * bj[l];
+				}
+			}
+		}
+	}
+} // namespace eeg
@@ -0,0 +1,55 @@
+/**
+ * @file linalg.h
+ * @brief Small dense matrix helpers for channel-by-channel problems
+ *
+ * @details Matrices are row-major `std::vector<double>`s. Sizes are channel
+ * counts, so the routines favour simple loops that vectorise over the
+ * contiguous dimension rather than blocking for large matrices.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace eeg
+{
+	/**
+	 * @brief Eigen-decomposition of a symmetric `n` x `n` matrix by cyclic
+	 * Jacobi rotations
+	 *
+	 * @details Accurate to working precision, including for the small
+	 * eigenvalues that whitening divides by, and fast enough for the
+	 * matrices of up to a few dozen channels it is used on.
+	 *
+	 * @param values `n` eigenvalues, descending
+	 * @param vectors `n` x `n`; column k is the unit eigenvector of
+	 * `values[k]`
+	 */
+	void symmetric_eigen(const std::vector<double>& a, size_t n, std::vector<double>& values, std::vector<double>& vectors);
+
+	/**
+	 * @brief As `symmetric_eigen()`, starting from the eigenvectors of a
+	 * nearby matrix
+	 *
+	 * @details For matrices tracked over time, such as a sliding-window
+	 * covariance: rotated into the previous basis the new matrix is almost
+	 * diagonal and the Jacobi sweeps converge in one or two passes instead
+	 * of the several a cold start takes.
+	 *
+	 * @param vectors On entry an orthonormal `n` x `n` basis, e.g. the
+	 * previous result; on return as for `symmetric_eigen()`
+	 */
+	void refine_symmetric_eigen(const std::vector<double>& a, size_t n, std::vector<double>& values, std::vector<double>& vectors);
+
+	/**
+	 * @brief `n_chans` x `n_chans` covariance of a channel-major block
+	 * (channel n at `x[n * n_samples]`) about `mean`, divided by `n_samples`
+	 */
+	void covariance(const double* x, size_t n_chans, size_t n_samples, const double* mean, std::vector<double>& out);
+
+	/**
+	 * @brief `c = a * b` with `a` of `n` x `k` and `b` of `k` x `m`
+	 */
+	void matrix_multiply(const std::vector<double>& a, const std::vector<double>& b, size_t n, size_t k, size_t m, std::vector<double>& c);
+} // namespace eeg
@@ -0,0 +1,225 @@
+#include "util/memory_accounting.h"
+
+#include "util/json_writer.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <mutex>
+#include <unordered_map>
+
+namespace eeg
+{
+	namespace
+	{
+		using usage_table = std::array<memory_usage, memory_category_count>;
+
+		struct registry
+		{
+			std::mutex mutex;
+			std::unordered_map<memory_owner, usage_table> owners;
+			usage_table totals{};
+		};
+
+		registry& instance()
+		{
+			// Leaked on purpose: allocations may be freed during static destruction
+			static registry* r = new registry;
+			return *r;
+		}
+
+		void add(memory_usage& u, size_t bytes)
+		{
+			u.current_bytes += bytes;
+			u.peak_bytes = std::max(u.peak_bytes, u.current_bytes);
+			++u.allocations;
+		}
+
+		void sub(memory_usage& u, size_t bytes)
+		{
+			u.current_bytes -= std::min(u.current_bytes, bytes);
+		}
+
+		void write_usage(json_writer& w, const memory_usage& u)
+		{
+			w.begin_object();
+			w.member("current_bytes", static_cast<uint64_t>(u.current_bytes));
+			w.member("peak_bytes", static_cast<uint64_t>(u.peak_bytes));
+			w.member("allocations", u.allocations);
+			w.end_object();
+		}
+	} // namespace
+
+	const char* memory_category_name(memory_category c)
+	{
+		switch (c)
+		{
+		case memory_category::chunk_buffers: return "chunk_buffers";
+		case memory_category::annotations: return "annotations";
+		case memory_category::logs: return "logs";
+		case memory_category::ring_buffers: return "ring_buffers";
+		case memory_category::classifier_models: return "classifier_models";
+		default: return "unknown";
+		}
+	}
+
+	void memory_track_alloc(memory_owner owner, memory_category c, size_t bytes) noexcept
+	{
+		const size_t i = static_cast<size_t>(c);
+		if (i >= memory_category_count || bytes == 0)
+		{
+			return;
+		}
+		registry& r = instance();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		try
+		{
+			add(r.owners[owner][i], bytes);
+		}
+		catch (...)
+		{
+			// Accounting must never turn a successful allocation into a failure
+		}
+		add(r.totals[i], bytes);
+	}
+
+	void memory_track_free(memory_owner owner, memory_category c, size_t bytes) noexcept
+	{
+		const size_t i = static_cast<size_t>(c);
+		if (i >= memory_category_count || bytes == 0)
+		{
+			return;
+		}
+		registry& r = instance();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		const auto it = r.owners.find(owner);
+		if (it != r.owners.end())
+		{
+			sub(it->second[i], bytes);
+		}
+		sub(r.totals[i], bytes);
+	}
+
+	memory_usage memory_query(memory_owner owner, memory_category c)
+	{
+		const size_t i = static_cast<size_t>(c);
+		registry& r = instance();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		const auto it = r.owners.find(owner);
+		return it == r.owners.end() || i >= memory_category_count ? memory_usage{} : it->second[i];
+	}
+
+	memory_usage memory_query_total(memory_category c)
+	{
+		const size_t i = static_cast<size_t>(c);
+		registry& r = instance();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		return i >= memory_category_count ? memory_usage{} : r.totals[i];
+	}
+
+	std::vector<memory_owner> memory_owners()
+	{
+		registry& r = instance();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		std::vector<memory_owner> out;
+		for (const auto& entry : r.owners)
+		{
+			out.push_back(entry.first);
+		}
+		return out;
+	}
+
+	bool memory_forget_owner(memory_owner owner)
+	{
+		registry& r = instance();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		const auto it = r.owners.find(owner);
+		if (it == r.owners.end())
+		{
+			return true;
+		}
+		for (const memory_usage& u : it->second)
+		{
+			if (u.current_bytes > 0)
+			{
+				return false;
+			}
+		}
+		r.owners.erase(it);
+		return true;
+	}
+
+	void write_memory_report(json_writer& w)
+	{
+		registry& r = instance();
+		std::lock_guard<std::mutex> lock(r.mutex);
+
+		w.begin_object();
+		w.key("totals").begin_object();
+		for (size_t i = 0; i < memory_category_count; ++i)
+		{
+			w.key(memory_category_name(static_cast<memory_category>(i)));
+			write_usage(w, r.totals[i]);
+		}
+		w.end_object();
+
+		w.key("owners").begin_array();
+		for (const auto& entry : r.owners)
+		{
+			char id[32];
+			std::snprintf(id, sizeof(id), "%p", entry.first);
+			w.begin_object();
+			w.member("owner", std::string(id));
+			size_t current = 0;
+			for (size_t i = 0; i < memory_category_count; ++i)
+			{
+				current += entry.second[i].current_bytes;
+				w.key(memory_category_name(static_cast<memory_category>(i)));
+				write_usage(w, entry.second[i]);
+			}
+			w.member("current_bytes", static_cast<uint64_t>(current));
+			w.end_object();
+		}
+		w.end_array();
+		w.end_object();
+	}
+
+	tracked_external::tracked_external(memory_owner owner, memory_category category, size_t bytes) noexcept
+		: owner_(owner), category_(category), bytes_(bytes)
+	{
+		memory_track_alloc(owner_, category_, bytes_);
+	}
+
+	tracked_external::~tracked_external()
+	{
+		release();
+	}
+
+	tracked_external::tracked_external(tracked_external&& other) noexcept
+		: owner_(other.owner_), category_(other.category_), bytes_(other.bytes_)
+	{
+		other.bytes_ = 0;
+	}
+
+	tracked_external& tracked_external::operator=(tracked_external&& other) noexcept
+	{
+		if (this != &other)
+		{
+			release();
+			owner_ = other.owner_;
+			category_ = other.category_;
+			bytes_ = other.bytes_;
+			other.bytes_ = 0;
+		}
+		return *this;
+	}
+
+	void tracked_external::release() noexcept
+	{
+		if (bytes_ > 0)
+		{
+			memory_track_free(owner_, category_, bytes_);
+			bytes_ = 0;
+		}
+	}
+} // namespace eeg
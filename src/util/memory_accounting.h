@@ -0,0 +1,182 @@
+/**
+ * @file memory_accounting.h
+ * @brief Tracked allocation categories with per-manager current/peak bytes
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <vector>
+
+namespace eeg
+{
+	class json_writer;
+
+	/**
+	 * @brief What a tracked allocation is used for
+	 */
+	enum class memory_category : size_t
+	{
+		chunk_buffers,     ///< Per-chunk channel arrays handed to chunk callbacks
+		annotations,       ///< Annotation and event storage
+		logs,              ///< Log buffers
+		ring_buffers,      ///< Stream rings between callbacks and processing
+		classifier_models, ///< Classifier model instances
+		count
+	};
+
+	constexpr size_t memory_category_count = static_cast<size_t>(memory_category::count);
+
+	/**
+	 * @brief Report name of a category
+	 */
+	const char* memory_category_name(memory_category c);
+
+	/**
+	 * @brief Key that attributes allocations to an owner
+	 *
+	 * @details Normally the `ba_eeg_manager*` the memory serves, so hosts with
+	 * many headsets can see the cost of each one. `nullptr` collects memory
+	 * not tied to a manager.
+	 */
+	using memory_owner = const void*;
+
+	struct memory_usage
+	{
+		size_t current_bytes = 0;
+		size_t peak_bytes = 0;
+		uint64_t allocations = 0; ///< Allocations made over the owner's lifetime
+	};
+
+	/**
+	 * @brief Records `bytes` allocated for `owner` in category `c`
+	 *
+	 * @details Thread-safe. Intended for buffers sized at setup, not for
+	 * per-sample allocations.
+	 */
+	void memory_track_alloc(memory_owner owner, memory_category c, size_t bytes) noexcept;
+
+	/**
+	 * @brief Records `bytes` previously tracked with `memory_track_alloc` as freed
+	 */
+	void memory_track_free(memory_owner owner, memory_category c, size_t bytes) noexcept;
+
+	/**
+	 * @brief Current and peak bytes of one owner in one category
+	 */
+	memory_usage memory_query(memory_owner owner, memory_category c);
+
+	/**
+	 * @brief Current and peak bytes of a category summed over all owners
+	 *
+	 * @details The peak is the peak of the sum, not the sum of peaks.
+	 */
+	memory_usage memory_query_total(memory_category c);
+
+	/**
+	 * @brief Owners with any tracked memory, current or past
+	 */
+	std::vector<memory_owner> memory_owners();
+
+	/**
+	 * @brief Drops an owner's history once everything it tracked is freed,
+	 * e.g. after `ba_eeg_manager_free`
+	 *
+	 * @return false (and keeps the record) if the owner still has live bytes,
+	 * which indicates a leak
+	 */
+	bool memory_forget_owner(memory_owner owner);
+
+	/**
+	 * @brief Writes totals and per-owner usage for every category
+	 */
+	void write_memory_report(json_writer& w);
+
+	/**
+	 * @brief Standard allocator that accounts its allocations to an owner and
+	 * category
+	 *
+	 * @details Use with standard containers for long-lived buffers, e.g.
+	 * `std::vector<double, tracked_allocator<double>>`.
+	 */
+	template <typename T>
+	class tracked_allocator
+	{
+	public:
+		using value_type = T;
+
+		tracked_allocator(memory_owner owner, memory_category category) noexcept : owner_(owner), category_(category) {}
+
+		template <typename U>
+		tracked_allocator(const tracked_allocator<U>& other) noexcept : owner_(other.owner()), category_(other.category())
+		{
+		}
+
+		T* allocate(size_t n)
+		{
+			if (n > std::numeric_limits<size_t>::max() / sizeof(T))
+			{
+				throw std::bad_array_new_length();
+			}
+			T* p = static_cast<T*>(::operator new(n * sizeof(T)));
+			memory_track_alloc(owner_, category_, n * sizeof(T));
+			return p;
+		}
+
+		void deallocate(T* p, size_t n) noexcept
+		{
+			memory_track_free(owner_, category_, n * sizeof(T));
+			::operator delete(p);
+		}
+
+		memory_owner owner() const noexcept { return owner_; }
+		memory_category category() const noexcept { return category_; }
+
+		template <typename U>
+		bool operator==(const tracked_allocator<U>& other) const noexcept
+		{
+			return owner_ == other.owner() && category_ == other.category();
+		}
+
+		template <typename U>
+		bool operator!=(const tracked_allocator<U>& other) const noexcept
+		{
+			return !(*this == other);
+		}
+
+	private:
+		memory_owner owner_;
+		memory_category category_;
+	};
+
+	template <typename T>
+	using tracked_vector = std::vector<T, tracked_allocator<T>>;
+
+	/**
+	 * @brief Accounts memory allocated outside our control, such as library
+	 * internals, for as long as the object lives
+	 */
+	class tracked_external
+	{
+	public:
+		tracked_external() = default;
+		tracked_external(memory_owner owner, memory_category category, size_t bytes) noexcept;
+		~tracked_external();
+		tracked_external(tracked_external&& other) noexcept;
+		tracked_external& operator=(tracked_external&& other) noexcept;
+		tracked_external(const tracked_external&) = delete;
+		tracked_external& operator=(const tracked_external&) = delete;
+
+		size_t bytes() const { return bytes_; }
+
+	private:
+		void release() noexcept;
+
+		memory_owner owner_ = nullptr;
+		memory_category category_ = memory_category::count;
+		size_t bytes_ = 0;
+	};
+} // namespace eeg
@@ -0,0 +1,83 @@
+#include "util/npy_writer.h"
+
+#include <utility>
+
+namespace eeg
+{
+	namespace
+	{
+		const char npy_magic[] = "\x93NUMPY";
+
+		// Header length reserved up front: ample for a 20-digit leading
+		// dimension and several more, and a multiple of 64 as the format
+		// recommends for alignment
+		constexpr size_t header_bytes = 128;
+	} // namespace
+
+	bool npy_writer::open(const std::string& path, const std::string& descr, std::vector<size_t> item_shape, size_t item_size)
+	{
+		close();
+		descr_ = descr;
+		item_shape_ = std::move(item_shape);
+		item_bytes_ = item_size;
+		for (const size_t d : item_shape_)
+		{
+			item_bytes_ *= d;
+		}
+		n_items_ = 0;
+		out_.open(path, std::ios::binary | std::ios::trunc);
+		const std::string h = header(0);
+		ok_ = out_.is_open() && h.size() == header_bytes && static_cast<bool>(out_.write(h.data(), static_cast<std::streamsize>(h.size())));
+		return ok_;
+	}
+
+	bool npy_writer::append(const void* data, size_t n)
+	{
+		if (!ok_)
+		{
+			return false;
+		}
+		ok_ = static_cast<bool>(out_.write(static_cast<const char*>(data), static_cast<std::streamsize>(n * item_bytes_)));
+		n_items_ += n;
+		return ok_;
+	}
+
+	bool npy_writer::close()
+	{
+		if (!out_.is_open())
+		{
+			return ok_;
+		}
+		const std::string h = header(n_items_);
+		ok_ = ok_ && out_.seekp(0) && out_.write(h.data(), static_cast<std::streamsize>(h.size())) && out_.flush();
+		out_.close();
+		return ok_;
+	}
+
+	std::string npy_writer::header(uint64_t n_items) const
+	{
+		std::string shape = "(" + std::to_string(n_items) + ",";
+		for (size_t i = 0; i < item_shape_.size(); ++i)
+		{
+			shape += (i ? ", " : " ") + std::to_string(item_shape_[i]);
+		}
+		shape += ")";
+		std::string dict = "{'descr': '" + descr_ + "', 'fortran_order': False, 'shape': " + shape + ", }";
+
+		// Magic, version 1.0, little-endian uint16 header length, then the
+		// dictionary padded with spaces and ended by a newline
+		const size_t prefix = sizeof(npy_magic) - 1 + 2 + 2;
+		if (prefix + dict.size() + 1 > header_bytes)
+		{
+			return std::string();
+		}
+		dict.append(header_bytes - prefix - dict.size() - 1, ' ');
+		dict += '\n';
+		std::string h(npy_magic, sizeof(npy_magic) - 1);
+		h += '\x01';
+		h += '\x00';
+		h += static_cast<char>(dict.size() & 0xff);
+		h += static_cast<char>(dict.size() >> 8);
+		return h + dict;
+	}
+} // namespace eeg
@@ -0,0 +1,66 @@
+/**
+ * @file npy_writer.h
+ * @brief NumPy `.npy` files written incrementally along their first axis
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace eeg
+{
+	/**
+	 * @brief Writes a C-order `.npy` array whose leading dimension grows as
+	 * items are appended
+	 *
+	 * @details The header is written with room for any leading dimension
+	 * and rewritten by `close()`, so arrays larger than memory can be
+	 * streamed out and later opened with `numpy.load(path, mmap_mode="r")`.
+	 * Data is written in native byte order; `descr` must say which, e.g.
+	 * `"<f4"` for little-endian float32.
+	 */
+	class npy_writer
+	{
+	public:
+		npy_writer() = default;
+		~npy_writer() { close(); }
+		npy_writer(const npy_writer&) = delete;
+		npy_writer& operator=(const npy_writer&) = delete;
+
+		/**
+		 * @param item_shape Dimensions after the leading one; empty for a
+		 * one-dimensional array
+		 * @param item_size Bytes per element
+		 */
+		bool open(const std::string& path, const std::string& descr, std::vector<size_t> item_shape, size_t item_size);
+
+		/**
+		 * @brief Appends `n` items of the item shape
+		 */
+		bool append(const void* data, size_t n);
+
+		/**
+		 * @brief Items appended so far
+		 */
+		uint64_t size() const { return n_items_; }
+
+		/**
+		 * @brief Writes the final header; false if any write failed
+		 */
+		bool close();
+
+	private:
+		std::string header(uint64_t n_items) const;
+
+		std::ofstream out_;
+		std::string descr_;
+		std::vector<size_t> item_shape_;
+		size_t item_bytes_ = 0;
+		uint64_t n_items_ = 0;
+		bool ok_ = false;
+	};
+} // namespace eeg
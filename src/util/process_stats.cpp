@@ -0,0 +1,51 @@
+#include "util/process_stats.h"
+
+#include "platforms.h"
+
+#if defined(__PLATFORM_WINDOWS__)
+#define PSAPI_VERSION 2 // K32 entry points in kernel32, no psapi.lib needed
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__PLATFORM_LINUX__)
+#include <cstdio>
+#include <malloc.h>
+#include <unistd.h>
+#endif
+
+namespace eeg
+{
+	process_memory sample_process_memory()
+	{
+		process_memory m;
+#if defined(__PLATFORM_WINDOWS__)
+		PROCESS_MEMORY_COUNTERS_EX pmc;
+		if (GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&pmc), sizeof(pmc)))
+		{
+			m.rss_valid = true;
+			m.rss_bytes = pmc.WorkingSetSize;
+			m.heap_valid = true;
+			m.heap_in_use_bytes = pmc.PrivateUsage;
+		}
+#elif defined(__PLATFORM_LINUX__)
+		if (FILE* f = std::fopen("/proc/self/statm", "r"))
+		{
+			unsigned long size = 0;
+			unsigned long resident = 0;
+			if (std::fscanf(f, "%lu %lu", &size, &resident) == 2)
+			{
+				m.rss_valid = true;
+				m.rss_bytes = static_cast<size_t>(resident) * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+			}
+			std::fclose(f);
+		}
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+		const struct mallinfo2 mi = mallinfo2();
+		m.heap_valid = true;
+		m.heap_in_use_bytes = mi.uordblks + mi.hblkhd;
+		m.heap_free_bytes = mi.fordblks;
+		m.heap_mapped_bytes = mi.hblkhd;
+#endif
+#endif
+		return m;
+	}
+} // namespace eeg
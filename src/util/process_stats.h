@@ -0,0 +1,36 @@
+/**
+ * @file process_stats.h
+ * @brief Resident memory and heap statistics of the current process
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace eeg
+{
+	/**
+	 * @brief Point-in-time memory usage of the process
+	 *
+	 * @details Fields the platform cannot report are left at zero with their
+	 * `*_valid` flag false.
+	 */
+	struct process_memory
+	{
+		bool rss_valid = false;
+		size_t rss_bytes = 0; ///< Resident set (working set on Windows)
+
+		bool heap_valid = false;
+		size_t heap_in_use_bytes = 0; ///< Bytes handed out by malloc and still allocated
+		size_t heap_free_bytes = 0;   ///< Bytes the allocator holds but has not handed out
+		size_t heap_mapped_bytes = 0; ///< Large allocations served directly by mmap
+	};
+
+	/**
+	 * @brief Samples current memory usage
+	 *
+	 * @details Linux reads /proc/self/statm and glibc `mallinfo2`; Windows
+	 * reports the working set and private commit (as heap in use).
+	 */
+	process_memory sample_process_memory();
+} // namespace eeg
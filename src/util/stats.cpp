@@ -0,0 +1,55 @@
+#include "util/stats.h"
+
+#include <algorithm>
+
+namespace eeg
+{
+	double percentile(const std::vector<double>& sorted, double p)
+	{
+		if (sorted.empty())
+		{
+			return 0;
+		}
+		const size_t i = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+		return sorted[std::min(i, sorted.size() - 1)];
+	}
+
+	linear_fit fit_line(const std::vector<double>& x, const std::vector<double>& y)
+	{
+		linear_fit fit;
+		fit.n = std::min(x.size(), y.size());
+		if (fit.n < 2)
+		{
+			return fit;
+		}
+
+		const double n = static_cast<double>(fit.n);
+		double mx = 0;
+		double my = 0;
+		for (size_t i = 0; i < fit.n; ++i)
+		{
+			mx += x[i];
+			my += y[i];
+		}
+		mx /= n;
+		my /= n;
+
+		double sxx = 0;
+		double sxy = 0;
+		double syy = 0;
+		for (size_t i = 0; i < fit.n; ++i)
+		{
+			sxx += (x[i] - mx) * (x[i] - mx);
+			sxy += (x[i] - mx) * (y[i] - my);
+			syy += (y[i] - my) * (y[i] - my);
+		}
+		if (sxx <= 0)
+		{
+			return fit;
+		}
+		fit.slope = sxy / sxx;
+		fit.intercept = my - fit.slope * mx;
+		fit.r2 = syy > 0 ? (sxy * sxy) / (sxx * syy) : 0;
+		return fit;
+	}
+} // namespace eeg
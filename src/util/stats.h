@@ -0,0 +1,37 @@
+/**
+ * @file stats.h
+ * @brief Small descriptive statistics helpers
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace eeg
+{
+	/**
+	 * @brief Nearest-rank percentile of an ascending-sorted sample
+	 *
+	 * @param p Fraction in [0, 1]
+	 * @return 0 for an empty sample
+	 */
+	double percentile(const std::vector<double>& sorted, double p);
+
+	/**
+	 * @brief Least-squares line through (x, y) points
+	 */
+	struct linear_fit
+	{
+		double slope = 0;
+		double intercept = 0;
+		double r2 = 0; ///< Coefficient of determination, 0 when undefined
+		size_t n = 0;
+	};
+
+	/**
+	 * @brief Fits y = slope * x + intercept; returns a zero fit for fewer than
+	 * two distinct x values
+	 */
+	linear_fit fit_line(const std::vector<double>& x, const std::vector<double>& y);
+} // namespace eeg
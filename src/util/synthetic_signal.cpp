@@ -0,0 +1,50 @@
+#include "util/synthetic_signal.h"
+
+#include <cmath>
+
+namespace eeg
+{
+	namespace
+	{
+		constexpr double two_pi = 6.283185307179586;
+	}
+
+	double splitmix64::normal()
+	{
+		double u1 = uniform();
+		while (u1 <= 0)
+		{
+			u1 = uniform();
+		}
+		return std::sqrt(-2.0 * std::log(u1)) * std::cos(two_pi * uniform());
+	}
+
+	std::vector<double> synthetic_eeg(const synthetic_signal_spec& spec, size_t n_chans, size_t n_time_steps, size_t first_sample)
+	{
+		std::vector<double> x(n_chans * n_time_steps);
+		synthetic_eeg(spec, n_chans, n_time_steps, first_sample, x.data());
+		return x;
+	}
+
+	void synthetic_eeg(const synthetic_signal_spec& spec, size_t n_chans, size_t n_time_steps, size_t first_sample, double* x)
+	{
+		// Seed on the block position too, so blocks are reproducible on their own
+		splitmix64 rng(spec.seed ^ (first_sample * 0x9E3779B97F4A7C15ull));
+		for (size_t c = 0; c < n_chans; ++c)
+		{
+			const double phase = 0.3 * static_cast<double>(c);
+			double* out = x + c * n_time_steps;
+			for (size_t t = 0; t < n_time_steps; ++t)
+			{
+				const double time = static_cast<double>(first_sample + t) / spec.sampling_rate;
+				double v = spec.noise_uv * rng.normal();
+				v += spec.alpha_uv * std::sin(two_pi * spec.alpha_hz * time + phase);
+				if (spec.tone_hz > 0)
+				{
+					v += spec.tone_uv * std::sin(two_pi * spec.tone_hz * time);
+				}
+				out[t] = v;
+			}
+		}
+	}
+} // namespace eeg
@@ -0,0 +1,78 @@
+/**
+ * @file synthetic_signal.h
+ * @brief Deterministic EEG-like test signals
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace eeg
+{
+	/**
+	 * @brief Parameters of a synthetic multichannel signal
+	 *
+	 * @details Every channel is background noise (microvolts) plus an alpha
+	 * rhythm and an optional stimulus tone, with a per-channel phase offset so
+	 * channels are correlated but not identical.
+	 */
+	struct synthetic_signal_spec
+	{
+		double sampling_rate = 250;
+		double noise_uv = 10;
+		double alpha_hz = 10;
+		double alpha_uv = 15;
+		double tone_hz = 0;  ///< 0 disables the stimulus tone
+		double tone_uv = 5;
+		uint64_t seed = 1;
+	};
+
+	/**
+	 * @brief Generates a channel-major block of `n_chans * n_time_steps` samples
+	 *
+	 * @details Channel n data starts at position `n * n_time_steps`, the layout
+	 * processor.h functions expect.
+	 *
+	 * @param first_sample Sample number of the first sample, so consecutive
+	 * blocks join without phase jumps
+	 */
+	std::vector<double> synthetic_eeg(const synthetic_signal_spec& spec, size_t n_chans, size_t n_time_steps, size_t first_sample = 0);
+
+	/**
+	 * @brief Same as above, writing into caller-owned `out` of
+	 * `n_chans * n_time_steps` values so streaming callers do not allocate
+	 */
+	void synthetic_eeg(const synthetic_signal_spec& spec, size_t n_chans, size_t n_time_steps, size_t first_sample, double* out);
+
+	/**
+	 * @brief Small fast PRNG (splitmix64) for reproducible test data
+	 */
+	class splitmix64
+	{
+	public:
+		explicit splitmix64(uint64_t seed) : state_(seed) {}
+
+		uint64_t next()
+		{
+			uint64_t z = (state_ += 0x9E3779B97F4A7C15ull);
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+			return z ^ (z >> 31);
+		}
+
+		/**
+		 * @brief Uniform double in [0, 1)
+		 */
+		double uniform() { return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0); }
+
+		/**
+		 * @brief Standard normal variate (Box-Muller)
+		 */
+		double normal();
+
+	private:
+		uint64_t state_;
+	};
+} // namespace eeg
@@ -0,0 +1,132 @@
+#include "util/work_pool.h"
+
+#include <algorithm>
+
+namespace eeg
+{
+	namespace
+	{
+		// Pool and index of the worker running on this thread, if any
+		thread_local const work_pool* current_pool = nullptr;
+		thread_local size_t current_worker = 0;
+	} // namespace
+
+	work_pool::work_pool(size_t n_threads)
+	{
+		if (n_threads == 0)
+		{
+			n_threads = std::max(1u, std::thread::hardware_concurrency());
+		}
+		for (size_t i = 0; i < n_threads; ++i)
+		{
+			queues_.push_back(std::make_unique<queue>());
+		}
+		for (size_t i = 0; i < n_threads; ++i)
+		{
+			workers_.emplace_back(&work_pool::worker, this, i);
+		}
+	}
+
+	work_pool::~work_pool()
+	{
+		wait();
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stopping_ = true;
+		}
+		work_cv_.notify_all();
+		for (std::thread& t : workers_)
+		{
+			t.join();
+		}
+	}
+
+	void work_pool::submit(task t)
+	{
+		const size_t target = current_pool == this ? current_worker : next_queue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+		{
+			std::lock_guard<std::mutex> lock(queues_[target]->mutex);
+			queues_[target]->tasks.push_back(std::move(t));
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			++queued_;
+			++unfinished_;
+		}
+		work_cv_.notify_one();
+	}
+
+	void work_pool::wait()
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		idle_cv_.wait(lock, [this] { return unfinished_ == 0; });
+	}
+
+	bool work_pool::wait_for(std::chrono::milliseconds timeout)
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		return idle_cv_.wait_for(lock, timeout, [this] { return unfinished_ == 0; });
+	}
+
+	bool work_pool::take(size_t self, task& t)
+	{
+		{
+			queue& own = *queues_[self];
+			std::lock_guard<std::mutex> lock(own.mutex);
+			if (!own.tasks.empty())
+			{
+				t = std::move(own.tasks.back());
+				own.tasks.pop_back();
+				return true;
+			}
+		}
+		for (size_t i = 1; i < queues_.size(); ++i)
+		{
+			queue& victim = *queues_[(self + i) % queues_.size()];
+			std::lock_guard<std::mutex> lock(victim.mutex);
+			if (!victim.tasks.empty())
+			{
+				t = std::move(victim.tasks.front());
+				victim.tasks.pop_front();
+				steals_.fetch_add(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void work_pool::worker(size_t self)
+	{
+		current_pool = this;
+		current_worker = self;
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				work_cv_.wait(lock, [this] { return queued_ > 0 || stopping_; });
+				if (queued_ == 0)
+				{
+					return;
+				}
+				// Claim a task before looking for it, so two workers never
+				// chase the same last one
+				--queued_;
+			}
+			task t;
+			while (!take(self, t))
+			{
+				// Every claim has a queued task behind it, but the scan can
+				// pass a deque just before another task lands in it
+				std::this_thread::yield();
+			}
+			t();
+			t = nullptr;
+
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (--unfinished_ == 0)
+			{
+				idle_cv_.notify_all();
+			}
+		}
+	}
+} // namespace eeg
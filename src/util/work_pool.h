@@ -0,0 +1,98 @@
+/**
+ * @file work_pool.h
+ * @brief Work-stealing thread pool for offline jobs
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace eeg
+{
+	/**
+	 * @brief Fixed set of workers, each with its own task deque
+	 *
+	 * @details A worker runs its own newest task first and, when it has
+	 * none, steals the oldest task of another worker. Tasks submitted from a
+	 * worker go to that worker's deque, so a task that splits its work into
+	 * subtasks keeps them local until others run dry and steal them; tasks
+	 * from other threads are dealt round-robin.
+	 *
+	 * Meant for coarse tasks such as whole files or file segments: each
+	 * deque has its own mutex, which costs nothing next to such tasks.
+	 */
+	class work_pool
+	{
+	public:
+		using task = std::function<void()>;
+
+		/**
+		 * @param n_threads Workers; 0 for `std::thread::hardware_concurrency()`
+		 */
+		explicit work_pool(size_t n_threads = 0);
+
+		/**
+		 * @brief Finishes every task, then stops the workers
+		 */
+		~work_pool();
+
+		work_pool(const work_pool&) = delete;
+		work_pool& operator=(const work_pool&) = delete;
+
+		size_t threads() const { return workers_.size(); }
+
+		void submit(task t);
+
+		/**
+		 * @brief Blocks until every submitted task, including those submitted
+		 * by tasks, has finished
+		 */
+		void wait();
+
+		/**
+		 * @brief As `wait()`, giving up after `timeout`
+		 *
+		 * @return true if every task has finished
+		 */
+		bool wait_for(std::chrono::milliseconds timeout);
+
+		/**
+		 * @brief Tasks run by another worker than the one they were queued on
+		 */
+		uint64_t steals() const { return steals_.load(std::memory_order_relaxed); }
+
+	private:
+		struct queue
+		{
+			std::mutex mutex;
+			std::deque<task> tasks;
+		};
+
+		bool take(size_t self, task& t);
+		void worker(size_t self);
+
+		std::vector<std::unique_ptr<queue>> queues_;
+		std::vector<std::thread> workers_;
+		std::atomic<size_t> next_queue_{0};
+		std::atomic<uint64_t> steals_{0};
+
+		// Counts guarded by mutex_ so sleeping workers and waiters are woken
+		// reliably
+		std::mutex mutex_;
+		std::condition_variable work_cv_;
+		std::condition_variable idle_cv_;
+		size_t queued_ = 0;     ///< Tasks in any deque
+		size_t unfinished_ = 0; ///< Tasks queued or running
+		bool stopping_ = false;
+	};
+} // namespace eeg